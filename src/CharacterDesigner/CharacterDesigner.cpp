@@ -1,5 +1,6 @@
 #include "CharacterDesigner_Internal.h"
 #include "tnt_loader.h"
+#include "erf_cache.h"
 #include <set>
 #include <map>
 
@@ -75,7 +76,7 @@ void filterEncryptedErfs(AppState& state) {
     state.erfsByName.clear();
     for (size_t i = 0; i < state.erfFiles.size(); i++) {
         ERFFile testErf;
-        if (testErf.open(state.erfFiles[i]) && testErf.encryption() == 0) {
+        if (ERFTocCache::open(testErf, state.erfFiles[i]) && testErf.encryption() == 0) {
             state.filteredErfIndices.push_back(i);
             std::string filename = fs::path(state.erfFiles[i]).filename().string();
             state.erfsByName[filename].push_back(i);
@@ -1436,26 +1437,7 @@ void loadCharacterModel(AppState& state) {
         state.animPlaying = wasPlaying;
         state.animTime = savedTime;
         state.selectedAnimIndex = savedAnimIdx;
-        auto normalize = [](const std::string& s) {
-            std::string result;
-            for (char c : s) {
-                if (c != '_') result += std::tolower(c);
-            }
-            return result;
-        };
-        for (auto& track : state.currentAnim.tracks) {
-            track.boneIndex = state.currentModel.skeleton.findBone(track.boneName);
-            if (track.boneIndex < 0) {
-                std::string trackNorm = normalize(track.boneName);
-                for (size_t bi = 0; bi < state.currentModel.skeleton.bones.size(); bi++) {
-                    std::string boneNorm = normalize(state.currentModel.skeleton.bones[bi].name);
-                    if (trackNorm == boneNorm) {
-                        track.boneIndex = (int)bi;
-                        break;
-                    }
-                }
-            }
-        }
+        resolveAnimTracks(state.currentAnim, state.currentModel.skeleton);
     }
     loadMeshDatabase(state);
     if (!cd.animsLoaded) {
@@ -1529,26 +1511,7 @@ void loadCharacterModel(AppState& state) {
                             if (!animData.empty()) {
                                 state.currentAnim = loadANI(animData, entry.name);
                                 resolveX360AnimHashes(state.currentAnim, state.currentModel.skeleton);
-                                auto normalize = [](const std::string& s) {
-                                    std::string result;
-                                    for (char c : s) {
-                                        if (c != '_') result += std::tolower(c);
-                                    }
-                                    return result;
-                                };
-                                for (auto& track : state.currentAnim.tracks) {
-                                    track.boneIndex = state.currentModel.skeleton.findBone(track.boneName);
-                                    if (track.boneIndex < 0) {
-                                        std::string trackNorm = normalize(track.boneName);
-                                        for (size_t bi = 0; bi < state.currentModel.skeleton.bones.size(); bi++) {
-                                            std::string boneNorm = normalize(state.currentModel.skeleton.bones[bi].name);
-                                            if (trackNorm == boneNorm) {
-                                                track.boneIndex = (int)bi;
-                                                break;
-                                            }
-                                        }
-                                    }
-                                }
+                                resolveAnimTracks(state.currentAnim, state.currentModel.skeleton);
                                 state.selectedAnimIndex = defaultIdx;
                                 state.animPlaying = true;
                                 state.animLoop = true;
@@ -0,0 +1,165 @@
+#include "blob_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint64_t P1 = 0x9E3779B185EBCA87ull;
+static const uint64_t P2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t P3 = 0x165667B19E3779F9ull;
+static const uint64_t P4 = 0x85EBCA77C2B2AE63ull;
+static const uint64_t P5 = 0x27D4EB2F165667C5ull;
+
+static inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+    acc += input * P2;
+    acc = rotl(acc, 31);
+    return acc * P1;
+}
+
+static inline uint64_t merge64(uint64_t acc, uint64_t val) {
+    acc ^= round64(0, val);
+    return acc * P1 + P4;
+}
+
+// Reads as little-endian, which every platform this builds for is.
+uint64_t BlobStore::hash(const uint8_t* data, size_t size) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint64_t h;
+    if (size >= 32) {
+        uint64_t v1 = P1 + P2, v2 = P2, v3 = 0, v4 = 0 - P1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge64(h, v1);
+        h = merge64(h, v2);
+        h = merge64(h, v3);
+        h = merge64(h, v4);
+    } else {
+        h = P5;
+    }
+    h += static_cast<uint64_t>(size);
+    for (; p + 8 <= end; p += 8) h = rotl(h ^ round64(0, read64(p)), 27) * P1 + P4;
+    if (p + 4 <= end) {
+        h = rotl(h ^ (static_cast<uint64_t>(read32(p)) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) h = rotl(h ^ (*p * P5), 11) * P1;
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+BlobStore& BlobStore::shared() {
+    static BlobStore store;
+    return store;
+}
+
+// Bytes are compared on a hash match, so a collision costs a second copy,
+// never the wrong payload.
+Blob BlobStore::find(uint64_t key, const uint8_t* data, size_t size) {
+    auto range = m_blobs.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        Blob blob = it->second.lock();
+        if (blob && blob->size() == size && (size == 0 || std::memcmp(blob->data(), data, size) == 0))
+            return blob;
+    }
+    return nullptr;
+}
+
+Blob BlobStore::add(uint64_t key, std::vector<uint8_t> data) {
+    if (m_blobs.size() >= m_purgeAt) purge();
+    Blob blob = std::make_shared<const std::vector<uint8_t>>(std::move(data));
+    m_blobs.emplace(key, blob);
+    return blob;
+}
+
+// Drops slots whose blob is gone; runs whenever the table has doubled since
+// the last sweep, so the cost stays proportional to inserts.
+void BlobStore::purge() {
+    for (auto it = m_blobs.begin(); it != m_blobs.end();) {
+        if (it->second.expired()) it = m_blobs.erase(it);
+        else ++it;
+    }
+    m_purgeAt = std::max<size_t>(1024, m_blobs.size() * 2);
+}
+
+Blob BlobStore::intern(std::vector<uint8_t> data) {
+    uint64_t key = hash(data.data(), data.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Blob blob = find(key, data.data(), data.size())) return blob;
+    return add(key, std::move(data));
+}
+
+Blob BlobStore::intern(const uint8_t* data, size_t size) {
+    uint64_t key = hash(data, size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Blob blob = find(key, data, size)) return blob;
+    return add(key, std::vector<uint8_t>(data, data + size));
+}
+
+BlobStore::Stats BlobStore::stats() const {
+    Stats s;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& slot : m_blobs) {
+        long refs = slot.second.use_count();
+        if (refs <= 0) continue;
+        Blob blob = slot.second.lock();
+        if (!blob) continue;
+        s.blobs++;
+        s.references += static_cast<size_t>(refs);
+        s.storedBytes += blob->size();
+        s.referencedBytes += blob->size() * static_cast<uint64_t>(refs);
+    }
+    return s;
+}
+
+const std::vector<uint8_t>* BlobMap::find(const std::string& name) const {
+    auto it = m_names.find(name);
+    return it != m_names.end() ? it->second.get() : nullptr;
+}
+
+Blob BlobMap::get(const std::string& name) const {
+    auto it = m_names.find(name);
+    return it != m_names.end() ? it->second : nullptr;
+}
+
+Blob BlobMap::set(const std::string& name, std::vector<uint8_t> data) {
+    Blob blob = m_store->intern(std::move(data));
+    m_names[name] = blob;
+    return blob;
+}
+
+Blob BlobMap::set(const std::string& name, const uint8_t* data, size_t size) {
+    Blob blob = m_store->intern(data, size);
+    m_names[name] = blob;
+    return blob;
+}
+
+bool BlobMap::insert(const std::string& name, const uint8_t* data, size_t size) {
+    if (m_names.count(name)) return false;
+    m_names.emplace(name, m_store->intern(data, size));
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Immutable resource bytes shared by everyone holding the same content.
+using Blob = std::shared_ptr<const std::vector<uint8_t>>;
+
+// Content-addressed store for loaded resource bytes. The same texture, MAO or
+// mesh often ships in several packages; intern() hands back the one shared
+// copy of a payload seen before instead of keeping another. A blob lives as
+// long as someone holds it. Thread-safe.
+class BlobStore {
+public:
+    struct Stats {
+        size_t blobs = 0;
+        size_t references = 0;
+        uint64_t storedBytes = 0;     // one copy of each live payload
+        uint64_t referencedBytes = 0; // what every holder would cost with its own copy
+        uint64_t savedBytes() const { return referencedBytes - storedBytes; }
+    };
+
+    // The store BlobMaps use unless given another one.
+    static BlobStore& shared();
+
+    // Returns the blob holding these bytes, storing them first if new. The
+    // pointer form only copies when the content isn't already stored.
+    Blob intern(std::vector<uint8_t> data);
+    Blob intern(const uint8_t* data, size_t size);
+
+    Stats stats() const;
+
+    // 64-bit content hash (XXH64, seed 0) used as the store key.
+    static uint64_t hash(const uint8_t* data, size_t size);
+
+private:
+    Blob find(uint64_t key, const uint8_t* data, size_t size);
+    Blob add(uint64_t key, std::vector<uint8_t> data);
+    void purge();
+
+    mutable std::mutex m_mutex;
+    std::unordered_multimap<uint64_t, std::weak_ptr<const std::vector<uint8_t>>> m_blobs;
+    size_t m_purgeAt = 1024;
+};
+
+// Name -> blob map over a BlobStore, for caches keyed by resource name.
+// Identical payloads under different names (or in different maps) share one
+// copy. Not thread-safe itself; the store behind it is.
+class BlobMap {
+public:
+    using Map = std::map<std::string, Blob>;
+
+    explicit BlobMap(BlobStore& store = BlobStore::shared()) : m_store(&store) {}
+
+    // nullptr when the name isn't present.
+    const std::vector<uint8_t>* find(const std::string& name) const;
+    Blob get(const std::string& name) const;
+    bool contains(const std::string& name) const { return m_names.count(name) != 0; }
+
+    // Stores data under name, replacing what was there.
+    Blob set(const std::string& name, std::vector<uint8_t> data);
+    Blob set(const std::string& name, const uint8_t* data, size_t size);
+    // Stores data under name unless the name is already present (first one
+    // wins). True when stored.
+    bool insert(const std::string& name, const uint8_t* data, size_t size);
+    bool erase(const std::string& name) { return m_names.erase(name) != 0; }
+
+    size_t size() const { return m_names.size(); }
+    bool empty() const { return m_names.empty(); }
+    void clear() { m_names.clear(); }
+    Map::const_iterator begin() const { return m_names.begin(); }
+    Map::const_iterator end() const { return m_names.end(); }
+
+private:
+    BlobStore* m_store;
+    Map m_names;
+};
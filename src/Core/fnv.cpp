@@ -14,4 +14,18 @@ uint64_t fnv64(const std::string& s) {
         hash = (hash * 1099511628211ull) ^ static_cast<uint8_t>(c);
     }
     return hash;
-}
\ No newline at end of file
+}
+
+uint64_t fnv64Lower(const char* s, size_t len) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = static_cast<uint8_t>(s[i]);
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+        hash = (hash * 1099511628211ull) ^ c;
+    }
+    return hash;
+}
+
+uint64_t fnv64Lower(const std::string& s) {
+    return fnv64Lower(s.data(), s.size());
+}
@@ -1,6 +1,10 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
 uint32_t fnv32(const std::string& s);
-uint64_t fnv64(const std::string& s);
\ No newline at end of file
+uint64_t fnv64(const std::string& s);
+// fnv64 of the ASCII-lowercased bytes, without building a lowered copy.
+uint64_t fnv64Lower(const char* s, size_t len);
+uint64_t fnv64Lower(const std::string& s);
\ No newline at end of file
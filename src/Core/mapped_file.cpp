@@ -0,0 +1,140 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_open(false),
+#ifdef _WIN32
+    m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#else
+    m_fd(-1)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_size = static_cast<uint64_t>(size.QuadPart);
+
+    if (m_size > 0 && m_size <= static_cast<uint64_t>(SIZE_MAX)) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (view) {
+                m_mapping = mapping;
+                m_data = static_cast<const uint8_t*>(view);
+            } else {
+                CloseHandle(mapping);
+            }
+        }
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_size = static_cast<uint64_t>(st.st_size);
+
+    if (m_size > 0 && m_size <= static_cast<uint64_t>(SIZE_MAX)) {
+        void* view = mmap(nullptr, static_cast<size_t>(m_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (view != MAP_FAILED) m_data = static_cast<const uint8_t*>(view);
+    }
+#endif
+
+    m_open = true;
+    return true;
+}
+
+bool MappedFile::readAt(uint64_t offset, void* dst, size_t len) const {
+    if (!m_open || offset > m_size || len > m_size - offset) return false;
+    if (len == 0) return true;
+
+    if (m_data) {
+        std::memcpy(dst, m_data + offset, len);
+        return true;
+    }
+
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    while (len > 0) {
+#ifdef _WIN32
+        DWORD chunk = len > 0x40000000u ? 0x40000000u : static_cast<DWORD>(len);
+        OVERLAPPED ov = {};
+        ov.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFu);
+        ov.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD got = 0;
+        if (!ReadFile(static_cast<HANDLE>(m_file), out, chunk, &got, &ov) || got == 0) return false;
+#else
+        ssize_t got = pread(m_fd, out, len, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+#endif
+        out += got;
+        offset += static_cast<uint64_t>(got);
+        len -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+void MappedFile::prefetch(uint64_t offset, uint64_t len) const {
+    if (!m_data || offset >= m_size) return;
+    len = std::min(len, m_size - offset);
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<uint8_t*>(m_data + offset);
+    range.NumberOfBytes = static_cast<SIZE_T>(len);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+    static const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = offset & ~(page - 1);
+    madvise(const_cast<uint8_t*>(m_data + start), static_cast<size_t>(offset + len - start), MADV_WILLNEED);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(static_cast<HANDLE>(m_mapping));
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(static_cast<HANDLE>(m_file));
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_data) munmap(const_cast<uint8_t*>(m_data), static_cast<size_t>(m_size));
+    if (m_fd >= 0) ::close(m_fd);
+    m_fd = -1;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file. The mapped pages are shared with
+// the OS page cache, so any number of readers (and threads) can borrow views
+// into the file without copying. A zero-length file opens successfully with
+// data() == nullptr.
+//
+// If the file can be opened but not mapped (e.g. no address space left in a
+// 32-bit process), open() still succeeds with isMapped() == false and readAt()
+// falls back to positional reads (pread / ReadFile at an offset). Either way
+// readAt() keeps no seek cursor, so it is safe to call from many threads.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_open; }
+    bool isMapped() const { return m_data != nullptr || (m_open && m_size == 0); }
+    const uint8_t* data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+
+    // Copy len bytes starting at offset into dst. Fails (returns false) if the
+    // range runs past the end of the file.
+    bool readAt(uint64_t offset, void* dst, size_t len) const;
+
+    // Asks the OS to start reading [offset, offset + len) of a mapped file
+    // into memory, so touching it afterwards faults in from one large read
+    // instead of page by page. A hint only; does nothing when not mapped.
+    void prefetch(uint64_t offset, uint64_t len) const;
+
+private:
+    const uint8_t* m_data;
+    uint64_t m_size;
+    bool m_open;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_fd;
+#endif
+};
@@ -0,0 +1,127 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+    struct Pool {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        std::vector<std::thread> workers;
+        bool started = false;
+        bool shutdown = false;
+
+        // Current loop; fn is null between loops. Guarded by mutex except
+        // for the chunk counters.
+        uint64_t serial = 0;
+        const std::function<void(size_t, size_t)>* fn = nullptr;
+        size_t count = 0;
+        size_t grain = 0;
+        size_t chunks = 0;
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> chunksLeft{0};
+        size_t busy = 0;
+
+        ~Pool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                shutdown = true;
+            }
+            wake.notify_all();
+            for (auto& t : workers) t.join();
+        }
+    };
+
+    static Pool s_pool;
+    static std::mutex s_submitMutex;
+    // Set on pool workers and on a caller while it helps run its own loop, so
+    // loops nested inside a chunk run inline instead of re-entering the pool.
+    static thread_local bool t_inLoop = false;
+
+    static void runChunks(const std::function<void(size_t, size_t)>& fn, size_t count, size_t grain, size_t chunks) {
+        for (;;) {
+            size_t chunk = s_pool.nextChunk.fetch_add(1);
+            if (chunk >= chunks) return;
+            size_t begin = chunk * grain;
+            fn(begin, std::min(count, begin + grain));
+            if (s_pool.chunksLeft.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(s_pool.mutex);
+                s_pool.done.notify_all();
+            }
+        }
+    }
+
+    static void workerMain() {
+        t_inLoop = true;
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(s_pool.mutex);
+        for (;;) {
+            s_pool.wake.wait(lock, [&] { return s_pool.shutdown || s_pool.serial != seen; });
+            if (s_pool.shutdown) return;
+            seen = s_pool.serial;
+            // Woke after the loop already finished.
+            if (!s_pool.fn) continue;
+
+            const auto& fn = *s_pool.fn;
+            size_t count = s_pool.count, grain = s_pool.grain, chunks = s_pool.chunks;
+            s_pool.busy++;
+            lock.unlock();
+            runChunks(fn, count, grain, chunks);
+            lock.lock();
+            if (--s_pool.busy == 0) s_pool.done.notify_all();
+        }
+    }
+
+    size_t workerCount() {
+        static const size_t count = [] {
+            unsigned hw = std::thread::hardware_concurrency();
+            return hw > 1 ? std::min<size_t>(hw - 1, 15) : 0;
+        }();
+        return count;
+    }
+
+    void forRange(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+        if (count == 0) return;
+        if (grain == 0) grain = 1;
+        size_t chunks = (count + grain - 1) / grain;
+        if (chunks < 2 || t_inLoop || workerCount() == 0) {
+            fn(0, count);
+            return;
+        }
+        std::unique_lock<std::mutex> submit(s_submitMutex, std::try_to_lock);
+        if (!submit.owns_lock()) {
+            fn(0, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(s_pool.mutex);
+            if (!s_pool.started) {
+                s_pool.started = true;
+                for (size_t i = 0; i < workerCount(); i++)
+                    s_pool.workers.emplace_back(workerMain);
+            }
+            s_pool.fn = &fn;
+            s_pool.count = count;
+            s_pool.grain = grain;
+            s_pool.chunks = chunks;
+            s_pool.nextChunk = 0;
+            s_pool.chunksLeft = chunks;
+            s_pool.serial++;
+        }
+        s_pool.wake.notify_all();
+
+        t_inLoop = true;
+        runChunks(fn, count, grain, chunks);
+        t_inLoop = false;
+
+        std::unique_lock<std::mutex> lock(s_pool.mutex);
+        s_pool.done.wait(lock, [] { return s_pool.chunksLeft == 0 && s_pool.busy == 0; });
+        s_pool.fn = nullptr;
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// A small persistent worker pool for data-parallel loops on the hot path
+// (per-frame skinning and the like), where spawning threads per call would
+// cost more than the work. Workers start on first use and are joined at
+// exit.
+namespace Parallel {
+    // Worker threads, not counting the calling thread (which always helps).
+    size_t workerCount();
+
+    // Calls fn(begin, end) over [0, count) in chunks of at least grain items,
+    // spread across the pool, and returns once every chunk is done. Runs
+    // inline when the range is a single chunk, when called from inside
+    // another loop's chunk, or when another thread already has a loop on the
+    // pool.
+    void forRange(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+}
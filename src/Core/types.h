@@ -9,6 +9,7 @@
 #include "imgui.h"
 #include "Mesh.h"
 #include "erf.h"
+#include "blob_store.h"
 #include "CharacterDesigner/MorphLoader.h"
 #include "tnt_loader.h"
 #include "GffViewer.h"
@@ -16,6 +17,8 @@
 
 class ERFFile;
 class GDAFile;
+class GDAQuery;
+class GDAMergedView;
 
 constexpr float UI_FONT_SIZE_DEFAULT = 15.0f;
 constexpr float UI_FONT_SIZE_MIN = 11.0f;
@@ -27,17 +30,6 @@ inline float clampUIFontSize(float size) {
     return size;
 }
 
-struct ErfEntryIndex {
-    std::unordered_map<std::string, std::pair<size_t, size_t>> exact;
-    std::unordered_map<std::string, std::pair<size_t, size_t>> basename;
-    std::unordered_map<std::string, std::pair<size_t, size_t>> noext;
-    bool built = false;
-
-    void clear() { exact.clear(); basename.clear(); noext.clear(); built = false; }
-
-    void build(const std::vector<std::unique_ptr<ERFFile>>& erfs);
-};
-
 struct Keybinds {
     ImGuiKey moveForward   = ImGuiKey_W;
     ImGuiKey moveBackward  = ImGuiKey_S;
@@ -62,6 +54,16 @@ struct GDAEditorState {
     std::string statusMessage;
     std::vector<std::string> gdaFilesInErf;
     int selectedGdaInErf = -1;
+    GDAQuery* query = nullptr;
+    // The open worksheet merged with its M2DA extension tables, when the
+    // browsed archives hold any.
+    std::string worksheet;
+    std::shared_ptr<const GDAMergedView> merged;
+    bool showMerged = false;
+    // Rows passing rowFilter, rebuilt when the filter or the table changes.
+    std::vector<uint32_t> visibleRows;
+    std::string appliedFilter;
+    bool rowsDirty = true;
 
     ~GDAEditorState();
 };
@@ -398,13 +400,11 @@ struct AppState {
     bool textureErfsLoaded = false;
     bool modelErfsLoaded = false;
     bool materialErfsLoaded = false;
-    ErfEntryIndex modelErfIndex;
-    ErfEntryIndex materialErfIndex;
-    ErfEntryIndex textureErfIndex;
-    std::map<std::string, std::vector<uint8_t>> meshCache;
-    std::map<std::string, std::vector<uint8_t>> mmhCache;
-    std::map<std::string, std::vector<uint8_t>> maoCache;
-    std::map<std::string, std::vector<uint8_t>> textureCache;
+    // Preloaded resource bytes by lowercase name; copies shared across names.
+    BlobMap meshCache;
+    BlobMap mmhCache;
+    BlobMap maoCache;
+    BlobMap textureCache;
     TintCache tintCache;
     bool tintCacheLoaded = false;
     bool cacheBuilt = false;
@@ -425,8 +425,7 @@ struct AppState {
         float scale;
     };
     struct LevelLoadState {
-        int stage = 0;
-        int itemIndex = 0;
+        int stage = 0;            // 1 = scanning the ARL, 2 = LevelPipeline running
         int terrainLoaded = 0;
         int propsLoaded = 0;
         int sptLoaded = 0;
@@ -437,14 +436,9 @@ struct AppState {
         std::vector<size_t> terrainQueue;
         std::vector<PropWork> propQueue;
         std::vector<SptWork> sptQueue;
+        std::vector<std::string> arlTreeNames;   // ARL tree list; RML tree ids index it
         std::map<int32_t, std::string> sptIdToFile;
         std::map<std::string, std::string> sptFileToErf;
-
-        std::map<int32_t, SptModel> sptCache;
-        std::map<int32_t, int> sptBranchMatIdx;
-        std::map<int32_t, int> sptDdsMatIdx;
-        std::map<int32_t, std::string> sptBaseName;
-        bool sptSetupDone = false;
         int nextInstanceId = 0;   // running unique id per placed object instance
     };
     LevelLoadState levelLoad;
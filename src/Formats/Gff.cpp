@@ -1,15 +1,21 @@
 #include "Gff.h"
 #include "X360_Platform.h"
-#include "X360_GffQuirks.h"
+#include "mapped_file.h"
+#include "parallel.h"
 #include <fstream>
 #include <cstring>
 #include <cstdio>
 #include <map>
 #include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <sstream>
+#include <unordered_set>
 #include <vector>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 static std::map<uint32_t, std::string> s_knownLabels;
 static bool s_labelsLoaded = false;
@@ -155,70 +161,105 @@ bool GFFFile::load(const std::string& path) {
     file.read(reinterpret_cast<char*>(m_data.data()), size);
     file.close();
 
-    if (!parseHeader()) {
-        close();
-        return false;
-    }
-
-    if (!parseStructs()) {
-        close();
-        return false;
-    }
-
-    m_loaded = true;
-    return true;
+    return parse();
 }
 
 bool GFFFile::load(const std::vector<uint8_t>& data) {
-    static bool printedVersion = false;
-    if (!printedVersion) {
+    static std::atomic<bool> printedVersion{false};
+    if (!printedVersion.exchange(true))
         std::cout << "[GFF4] Gff.cpp version: PACKED_UINT32_FIX_v2 (2026-02-21)" << std::endl;
-        printedVersion = true;
-    }
     close();
 
     m_data = data;
+    return parse();
+}
 
-    if (!parseHeader()) {
-        close();
-        return false;
-    }
+bool GFFFile::load(std::vector<uint8_t>&& data) {
+    close();
+    m_data = std::move(data);
+    return parse();
+}
+
+bool GFFFile::loadBorrowed(const uint8_t* data, size_t size) {
+    close();
+    if (!data) return false;
+    m_borrowed = data;
+    m_borrowedSize = size;
+    std::memcpy(m_guard, data, std::min(size, GUARD_BYTES));
+    return parse();
+}
+
+bool GFFFile::loadShared(std::shared_ptr<const std::vector<uint8_t>> data) {
+    close();
+    if (!data) return false;
+    m_shared = std::move(data);
+    m_borrowed = m_shared->data();
+    m_borrowedSize = m_shared->size();
+    if (m_borrowed) std::memcpy(m_guard, m_borrowed, std::min(m_borrowedSize, GUARD_BYTES));
+    return parse();
+}
 
-    if (!parseStructs()) {
+bool GFFFile::parse() {
+    if (!parseHeader() || !parseStructs()) {
         close();
         return false;
     }
-
     m_loaded = true;
     return true;
 }
 
+// Copies borrowed bytes into m_data so they can be edited; the caller's
+// buffer is no longer referenced afterwards.
+void GFFFile::makeOwned() {
+    if (!m_borrowed) return;
+    m_data.assign(bytes(), bytes() + m_borrowedSize);
+    m_borrowed = nullptr;
+    m_borrowedSize = 0;
+    m_shared.reset();
+}
+
+// A freed heap block gets allocator bookkeeping (or a debug fill pattern)
+// written over its first bytes, which here are the GFF header.
+void GFFFile::checkBorrowed() const {
+    size_t n = std::min(m_borrowedSize, GUARD_BYTES);
+    if (std::memcmp(m_borrowed, m_guard, n) != 0) {
+        std::cerr << "[GFF4] borrowed buffer was freed or modified while the GFFFile still uses it" << std::endl;
+        assert(!"GFFFile borrowed buffer released");
+    }
+}
+
 void GFFFile::close() {
     m_data.clear();
+    m_borrowed = nullptr;
+    m_borrowedSize = 0;
+    m_shared.reset();
+    m_stringOffsets.clear();
+    m_decoded.clear();
     m_structs.clear();
     m_loaded = false;
     m_bigEndian = false;
+    m_normalized = false;
     std::memset(&m_header, 0, sizeof(m_header));
 }
 
 bool GFFFile::parseHeader() {
-    if (m_data.size() < 28) return false;
+    if (byteCount() < 28) return false;
 
     // Detect endianness from platform string at offset 8 (raw ASCII, no swap needed)
-    if (m_data.size() >= 12) {
+    if (byteCount() >= 12) {
         char plat[5] = {};
-        std::memcpy(plat, &m_data[8], 4);
+        std::memcpy(plat, bytes() + 8, 4);
         if (X360::isPlatformTag(plat)) {
             m_bigEndian = true;
         }
     }
 
     // Tag fields are 4-byte ASCII — read raw, NOT byte-swapped
-    std::memcpy(&m_header.magic, &m_data[0], 4);
-    std::memcpy(&m_header.version, &m_data[4], 4);
-    std::memcpy(&m_header.platform, &m_data[8], 4);
-    std::memcpy(&m_header.fileType, &m_data[12], 4);
-    std::memcpy(&m_header.fileVersion, &m_data[16], 4);
+    std::memcpy(&m_header.magic, bytes(), 4);
+    std::memcpy(&m_header.version, bytes() + 4, 4);
+    std::memcpy(&m_header.platform, bytes() + 8, 4);
+    std::memcpy(&m_header.fileType, bytes() + 12, 4);
+    std::memcpy(&m_header.fileVersion, bytes() + 16, 4);
     // Numeric field — needs byte-swap on big-endian
     m_header.structCount = readAt<uint32_t>(20);
 
@@ -231,24 +272,23 @@ bool GFFFile::parseHeader() {
     m_header.isV41 = (std::string(ver) >= "V4.1");
 
     if (m_header.isV41) {
-        if (m_data.size() < 36) return false;
+        if (byteCount() < 36) return false;
         m_header.stringCount = readAt<uint32_t>(24);
         m_header.stringOffset = readAt<uint32_t>(28);
         m_header.dataOffset = readAt<uint32_t>(32);
         uint32_t strStart = m_header.stringOffset;
         uint32_t strEnd = m_header.dataOffset;
-        if (strEnd > strStart && strEnd <= m_data.size()) {
-            std::string current;
-            for (uint32_t pos = strStart; pos < strEnd; pos++) {
-                uint8_t c = m_data[pos];
-                if (c == 0) {
-                    m_stringCache.push_back(current);
-                    current.clear();
-                    if (m_stringCache.size() >= m_header.stringCount) break;
-                } else {
-                    current += static_cast<char>(c);
-                }
+        if (strEnd > strStart && strEnd <= byteCount()) {
+            const uint8_t* data = bytes();
+            m_stringOffsets.reserve(std::min<size_t>(m_header.stringCount, strEnd - strStart) + 1);
+            uint32_t pos = strStart;
+            while (pos < strEnd && m_stringOffsets.size() < m_header.stringCount) {
+                const void* nul = std::memchr(data + pos, 0, strEnd - pos);
+                if (!nul) break;
+                m_stringOffsets.push_back(pos);
+                pos = static_cast<uint32_t>(static_cast<const uint8_t*>(nul) - data) + 1;
             }
+            if (!m_stringOffsets.empty()) m_stringOffsets.push_back(pos);
         }
     } else {
         m_header.stringCount = 0;
@@ -260,15 +300,15 @@ bool GFFFile::parseHeader() {
 }
 
 bool GFFFile::parseStructs() {
-    if (m_data.size() < 28) return false;
+    if (byteCount() < 28) return false;
 
     m_structs.resize(m_header.structCount);
 
     size_t structPos = m_header.isV41 ? 36 : 28;
 
     for (uint32_t i = 0; i < m_header.structCount; i++) {
-        if (structPos + 16 > m_data.size()) return false;
-        std::memcpy(m_structs[i].structType, &m_data[structPos], 4);
+        if (structPos + 16 > byteCount()) return false;
+        std::memcpy(m_structs[i].structType, bytes() + structPos, 4);
         m_structs[i].structType[4] = '\0';
         m_structs[i].fieldCount = readAt<uint32_t>(structPos + 4);
         m_structs[i].fieldOffset = readAt<uint32_t>(structPos + 8);
@@ -281,7 +321,7 @@ bool GFFFile::parseStructs() {
         m_structs[i].fields.resize(m_structs[i].fieldCount);
 
         for (uint32_t j = 0; j < m_structs[i].fieldCount; j++) {
-            if (fieldPos + 12 > m_data.size()) break;
+            if (fieldPos + 12 > byteCount()) break;
             m_structs[i].fields[j].label = readAt<uint32_t>(fieldPos);
             if (m_bigEndian) {
                 // On X360/PS3: the 4 bytes at fieldPos+4 are flags(BE16) then typeId(BE16)
@@ -294,11 +334,218 @@ bool GFFFile::parseStructs() {
             m_structs[i].fields[j].dataOffset = readAt<uint32_t>(fieldPos + 8);
             fieldPos += 12;
         }
+        buildFieldSlots(m_structs[i]);
+    }
+
+    return true;
+}
+
+void GFFFile::buildFieldSlots(GFFStruct& st) {
+    st.fieldSlots.clear();
+    st.slotShift = 32;
+    // Slots store index + 1 in 16 bits; anything larger stays on the linear scan.
+    if (st.fields.empty() || st.fields.size() >= 0x8000) return;
+
+    // At least twice as many slots as fields keeps probe chains short.
+    uint32_t bits = 1;
+    while ((1u << bits) < st.fields.size() * 2) bits++;
+    st.fieldSlots.assign(size_t(1) << bits, 0);
+    st.slotShift = 32 - bits;
+
+    uint32_t mask = (1u << bits) - 1;
+    for (size_t j = 0; j < st.fields.size(); j++) {
+        uint32_t label = st.fields[j].label;
+        uint32_t slot = st.fieldSlotFor(label);
+        bool duplicate = false;
+        while (st.fieldSlots[slot] != 0) {
+            // Keep the first of any duplicate labels, as the linear scan did.
+            if (st.fields[st.fieldSlots[slot] - 1].label == label) { duplicate = true; break; }
+            slot = (slot + 1) & mask;
+        }
+        if (!duplicate) st.fieldSlots[slot] = static_cast<uint16_t>(j + 1);
     }
+}
 
+bool GFFFile::normalizeByteOrder() {
+    if (!m_loaded) return false;
+    if (!m_bigEndian) return true;
+
+    // Everything is located with the swapping reads first, then swapped in
+    // one sweep, so shared lists and strings are only converted once.
+    std::vector<uint8_t> widths(byteCount(), 0);
+    planByteSwaps(widths);
+
+    makeOwned();
+    uint8_t* data = m_data.data();
+    size_t size = m_data.size();
+    for (size_t pos = 0; pos < size;) {
+        uint8_t w = widths[pos];
+        if (!w) {
+            pos++;
+            continue;
+        }
+        std::reverse(data + pos, data + pos + w);
+        pos += w;
+    }
+    m_bigEndian = false;
+    m_normalized = true;
     return true;
 }
 
+// Marks the start of every multi-byte value with its width, following the
+// same layouts the readers use.
+void GFFFile::planByteSwaps(std::vector<uint8_t>& widths) const {
+    size_t size = widths.size();
+    auto mark = [&](uint64_t pos, uint8_t w) {
+        if (pos + w <= size && !widths[pos]) widths[pos] = w;
+    };
+
+    mark(20, 4);
+    mark(24, 4);
+    if (m_header.isV41) {
+        mark(28, 4);
+        mark(32, 4);
+    }
+    size_t structPos = m_header.isV41 ? 36 : 28;
+    for (const auto& st : m_structs) {
+        mark(structPos + 4, 4);
+        mark(structPos + 8, 4);
+        mark(structPos + 12, 4);
+        structPos += 16;
+        // Swapping the flags/typeId word as a whole also puts typeId first.
+        for (size_t j = 0; j < st.fields.size(); j++) {
+            uint64_t fieldPos = uint64_t(st.fieldOffset) + j * 12;
+            mark(fieldPos, 4);
+            mark(fieldPos + 4, 4);
+            mark(fieldPos + 8, 4);
+        }
+    }
+
+    const uint64_t dataOffset = m_header.dataOffset;
+    auto markECString = [&](uint32_t address) {
+        if (m_header.isV41 || address == 0xFFFFFFFF) return;
+        uint64_t pos = dataOffset + address;
+        if (pos + 4 > size || widths[pos]) return;
+        mark(pos, 4);
+        uint64_t length = std::min<uint64_t>(readAt<uint32_t>(static_cast<uint32_t>(pos)), (size - pos - 4) / 2);
+        for (uint64_t i = 0; i < length; i++) mark(pos + 4 + i * 2, 2);
+    };
+    auto markValue = [&](uint16_t typeId, uint64_t pos) {
+        switch (typeId) {
+            case 0: case 1: break;
+            case 2: case 3: mark(pos, 2); break;
+            case 4: case 5: case 8: mark(pos, 4); break;
+            case 6: case 7: case 9: mark(pos, 8); break;
+            case 14:
+                mark(pos, 4);
+                markECString(readAt<uint32_t>(static_cast<uint32_t>(pos)));
+                break;
+            case 17:
+            {
+                mark(pos, 4);
+                mark(pos + 4, 4);
+                uint32_t address = readAt<uint32_t>(static_cast<uint32_t>(pos + 4));
+                if (address != 0) markECString(address);
+                break;
+            }
+            default:
+                // Vectors, quaternions, colours, matrices: 32-bit components.
+                for (uint32_t k = 0; k < primitiveTypeSize(typeId); k += 4) mark(pos + k, 4);
+                break;
+        }
+    };
+
+    // Each struct instance is walked once, which also stops reference
+    // cycles. Most offsets only ever hold one struct type, so the first is
+    // kept in a flat array and the set only sees the rest (an inline struct
+    // at offset 0 of its parent, say).
+    std::vector<std::pair<uint32_t, uint32_t>> pending;
+    std::vector<uint16_t> firstType(size - std::min<size_t>(size, dataOffset), 0);
+    std::unordered_set<uint64_t> seen;
+    auto visit = [&](uint32_t structIndex, uint32_t offset) {
+        if (structIndex >= m_structs.size()) return;
+        if (offset < firstType.size() && structIndex < 0xFFFF) {
+            uint16_t& first = firstType[offset];
+            if (first == structIndex + 1) return;
+            if (!first) {
+                first = static_cast<uint16_t>(structIndex + 1);
+                pending.push_back({ structIndex, offset });
+                return;
+            }
+        }
+        if (seen.insert((uint64_t(structIndex) << 32) | offset).second)
+            pending.push_back({ structIndex, offset });
+    };
+    if (!m_structs.empty()) visit(0, 0);
+
+    while (!pending.empty()) {
+        auto [structIndex, base] = pending.back();
+        pending.pop_back();
+        for (const auto& field : m_structs[structIndex].fields) {
+            bool isList = (field.flags & FLAG_LIST) != 0;
+            bool isStruct = (field.flags & FLAG_STRUCT) != 0;
+            bool isRef = (field.flags & FLAG_REFERENCE) != 0;
+            uint64_t dataPos = dataOffset + field.dataOffset + base;
+            if (dataPos >= size) continue;
+            uint32_t pos32 = static_cast<uint32_t>(dataPos);
+
+            if (isList) {
+                mark(dataPos, 4);
+                int32_t ref = readAt<int32_t>(pos32);
+                if (ref < 0) continue;
+                uint64_t listPos = dataOffset + static_cast<uint32_t>(ref);
+                if (listPos + 4 > size) continue;
+                mark(listPos, 4);
+                uint64_t count = readAt<uint32_t>(static_cast<uint32_t>(listPos));
+                uint64_t start = listPos + 4;
+                uint64_t avail = size - start;
+                if (isStruct && !isRef) {
+                    if (field.typeId >= m_structs.size()) continue;
+                    uint32_t stride = m_structs[field.typeId].structSize;
+                    if (stride) count = std::min(count, avail / stride);
+                    else count = std::min<uint64_t>(count, 1);
+                    for (uint64_t i = 0; i < count; i++)
+                        visit(field.typeId, static_cast<uint32_t>(ref + 4 + i * stride));
+                } else if (isStruct) {
+                    count = std::min(count, avail / 4);
+                    for (uint64_t i = 0; i < count; i++) {
+                        mark(start + i * 4, 4);
+                        visit(field.typeId, readAt<uint32_t>(static_cast<uint32_t>(start + i * 4)));
+                    }
+                } else if (isRef) {
+                    count = std::min(count, avail / 8);
+                    for (uint64_t i = 0; i < count; i++) {
+                        uint32_t p = static_cast<uint32_t>(start + i * 8);
+                        mark(p, 4);
+                        mark(p + 4, 4);
+                        visit(readAt<uint32_t>(p) & 0xFFFF, readAt<uint32_t>(p + 4));
+                    }
+                } else {
+                    uint32_t stride = primitiveTypeSize(field.typeId);
+                    count = std::min(count, avail / stride);
+                    for (uint64_t i = 0; i < count; i++) markValue(field.typeId, start + i * stride);
+                }
+            } else if (isStruct && !isRef) {
+                visit(field.typeId, field.dataOffset + base);
+            } else if (isStruct) {
+                mark(dataPos, 4);
+                int32_t ref = readAt<int32_t>(pos32);
+                if (ref >= 0) visit(field.typeId, static_cast<uint32_t>(ref));
+            } else if (isRef && field.typeId > 17) {
+                mark(dataPos, 4);
+                mark(dataPos + 4, 4);
+                visit(readAt<uint32_t>(pos32) & 0xFFFF, readAt<uint32_t>(pos32 + 4));
+            } else if (isRef && field.typeId != 14) {
+                mark(dataPos, 4);
+                uint32_t ptr = readAt<uint32_t>(pos32);
+                if (ptr != 0xFFFFFFFF) markValue(field.typeId, dataOffset + ptr);
+            } else {
+                markValue(field.typeId, dataPos);
+            }
+        }
+    }
+}
+
 bool GFFFile::isMMH() const {
     return m_header.fileType == 0x204D484D;
 }
@@ -308,6 +555,14 @@ bool GFFFile::isMSH() const {
 }
 
 const GFFField* GFFFile::findField(const GFFStruct& st, uint32_t label) const {
+    if (!st.fieldSlots.empty()) {
+        uint32_t mask = static_cast<uint32_t>(st.fieldSlots.size() - 1);
+        for (uint32_t slot = st.fieldSlotFor(label); st.fieldSlots[slot] != 0; slot = (slot + 1) & mask) {
+            const GFFField& field = st.fields[st.fieldSlots[slot] - 1];
+            if (field.label == label) return &field;
+        }
+        return nullptr;
+    }
     for (const auto& field : st.fields) {
         if (field.label == label) {
             return &field;
@@ -321,10 +576,20 @@ const GFFField* GFFFile::findField(uint32_t structIndex, uint32_t label) const {
     return findField(m_structs[structIndex], label);
 }
 
+GFFFieldHandle GFFFile::resolveField(uint32_t structIndex, uint32_t label) const {
+    GFFFieldHandle handle;
+    handle.structIndex = structIndex;
+    handle.label = label;
+    handle.field = findField(structIndex, label);
+    return handle;
+}
+
 std::string GFFFile::readStringByLabel(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
-    if (structIndex >= m_structs.size()) return "";
+    return readString(resolveField(structIndex, label), baseOffset);
+}
 
-    const GFFField* field = findField(structIndex, label);
+std::string GFFFile::readString(const GFFFieldHandle& handle, uint32_t baseOffset) {
+    const GFFField* field = handle.field;
     if (!field) return "";
 
     if (field->typeId != 14 && field->typeId != 10 && field->typeId != 11) return "";
@@ -334,74 +599,135 @@ std::string GFFFile::readStringByLabel(uint32_t structIndex, uint32_t label, uin
 
     if (address == 0xFFFFFFFF) return "";
 
-    if (field->typeId == 14 && m_header.isV41) {
-        if (address < m_stringCache.size()) return m_stringCache[address];
-        return "";
+    if (field->typeId == 14) {
+        // Loaders read most names once, so only the view accessors memoize.
+        if (m_header.isV41) return std::string(tableString(address));
+        if (!m_decoded.empty()) {
+            auto it = m_decoded.find(address);
+            if (it != m_decoded.end()) return it->second;
+        }
+        std::string result;
+        decodeECString(address, result);
+        return result;
     }
 
     uint32_t strPos = m_header.dataOffset + address;
-    if (strPos + 4 > m_data.size()) return "";
+    if (strPos + 4 > byteCount()) return "";
     uint32_t length = readAt<uint32_t>(strPos);
     strPos += 4;
 
     std::string result;
     result.reserve(length);
+    const uint8_t* data = bytes();
+    for (uint32_t i = 0; i < length && strPos < byteCount(); i++) {
+        char c = static_cast<char>(data[strPos]);
+        strPos += 1;
+        if (c != '\0') result += c;
+    }
+    return result;
+}
 
-    if (field->typeId == 14) {
-        for (uint32_t i = 0; i < length && strPos + 2 <= m_data.size(); i++) {
-            uint16_t wc = readAt<uint16_t>(strPos);
-            strPos += 2;
-            if (wc == 0) continue;
-            if (wc < 0x80) result += static_cast<char>(wc);
-            else if (wc < 0x800) {
-                result += static_cast<char>(0xC0 | (wc >> 6));
-                result += static_cast<char>(0x80 | (wc & 0x3F));
-            } else {
-                result += static_cast<char>(0xE0 | (wc >> 12));
-                result += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
-                result += static_cast<char>(0x80 | (wc & 0x3F));
-            }
-        }
+std::string_view GFFFile::readStringViewByLabel(uint32_t structIndex, uint32_t label, uint32_t baseOffset) const {
+    return readStringView(resolveField(structIndex, label), baseOffset);
+}
+
+std::string_view GFFFile::readStringView(const GFFFieldHandle& handle, uint32_t baseOffset) const {
+    const GFFField* field = handle.field;
+    if (!field) return {};
+    if (field->typeId != 14 && field->typeId != 10 && field->typeId != 11) return {};
+
+    uint32_t address = readAt<uint32_t>(m_header.dataOffset + field->dataOffset + baseOffset);
+    if (address == 0xFFFFFFFF) return {};
+    if (field->typeId == 14) return ecString(address);
+
+    size_t strPos = static_cast<size_t>(m_header.dataOffset) + address;
+    if (strPos + 4 > byteCount()) return {};
+    size_t length = std::min<size_t>(readAt<uint32_t>(static_cast<uint32_t>(strPos)), byteCount() - strPos - 4);
+    const char* text = reinterpret_cast<const char*>(bytes() + strPos + 4);
+    const void* nul = std::memchr(text, 0, length);
+    if (nul) length = static_cast<const char*>(nul) - text;
+    return std::string_view(text, length);
+}
+
+std::string_view GFFFile::tableString(uint32_t index) const {
+    if (index + 1 >= m_stringOffsets.size()) return {};
+    uint32_t start = m_stringOffsets[index];
+    return std::string_view(reinterpret_cast<const char*>(bytes() + start), m_stringOffsets[index + 1] - start - 1);
+}
+
+static void appendUtf8(std::string& out, uint16_t wc) {
+    if (wc < 0x80) out += static_cast<char>(wc);
+    else if (wc < 0x800) {
+        out += static_cast<char>(0xC0 | (wc >> 6));
+        out += static_cast<char>(0x80 | (wc & 0x3F));
     } else {
-        for (uint32_t i = 0; i < length && strPos < m_data.size(); i++) {
-            char c = static_cast<char>(m_data[strPos]);
-            strPos += 1;
-            if (c != '\0') result += c;
-        }
+        out += static_cast<char>(0xE0 | (wc >> 12));
+        out += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (wc & 0x3F));
     }
+}
 
-    return result;
+std::string_view GFFFile::ecString(uint32_t address) const {
+    if (address == 0xFFFFFFFF) return {};
+    if (m_header.isV41) return tableString(address);
+
+    auto it = m_decoded.find(address);
+    if (it != m_decoded.end()) return it->second;
+
+    std::string result;
+    decodeECString(address, result);
+    return m_decoded.emplace(address, std::move(result)).first->second;
+}
+
+// Inline V4.0 ECString: uint32 length, then UTF-16 code units.
+void GFFFile::decodeECString(uint32_t address, std::string& out) const {
+    uint32_t strPos = m_header.dataOffset + address;
+    if (strPos + 4 > byteCount()) return;
+    uint32_t length = readAt<uint32_t>(strPos);
+    strPos += 4;
+    size_t avail = (byteCount() - strPos) / 2;
+    if (length > avail) length = static_cast<uint32_t>(avail);
+    out.reserve(length);
+    for (uint32_t i = 0; i < length; i++, strPos += 2) {
+        uint16_t wc = readAt<uint16_t>(strPos);
+        if (wc != 0) appendUtf8(out, wc);
+    }
 }
 
 int32_t GFFFile::readInt32ByLabel(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
-    if (structIndex >= m_structs.size()) return 0;
-    const GFFField* field = findField(structIndex, label);
-    if (!field) return 0;
-    uint32_t dataPos = m_header.dataOffset + field->dataOffset + baseOffset;
-    return readAt<int32_t>(dataPos);
+    return readInt32(resolveField(structIndex, label), baseOffset);
+}
+
+int32_t GFFFile::readInt32(const GFFFieldHandle& handle, uint32_t baseOffset) {
+    if (!handle) return 0;
+    return readAt<int32_t>(m_header.dataOffset + handle.field->dataOffset + baseOffset);
 }
 
 uint32_t GFFFile::readUInt32ByLabel(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
-    if (structIndex >= m_structs.size()) return 0;
-    const GFFField* field = findField(structIndex, label);
-    if (!field) return 0;
-    uint32_t dataPos = m_header.dataOffset + field->dataOffset + baseOffset;
-    return readAt<uint32_t>(dataPos);
+    return readUInt32(resolveField(structIndex, label), baseOffset);
+}
+
+uint32_t GFFFile::readUInt32(const GFFFieldHandle& handle, uint32_t baseOffset) {
+    if (!handle) return 0;
+    return readAt<uint32_t>(m_header.dataOffset + handle.field->dataOffset + baseOffset);
 }
 
 float GFFFile::readFloatByLabel(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
-    if (structIndex >= m_structs.size()) return 0.0f;
-    const GFFField* field = findField(structIndex, label);
-    if (!field) return 0.0f;
-    uint32_t dataPos = m_header.dataOffset + field->dataOffset + baseOffset;
-    return readAt<float>(dataPos);
+    return readFloat(resolveField(structIndex, label), baseOffset);
+}
+
+float GFFFile::readFloat(const GFFFieldHandle& handle, uint32_t baseOffset) {
+    if (!handle) return 0.0f;
+    return readAt<float>(m_header.dataOffset + handle.field->dataOffset + baseOffset);
 }
 
 GFFStructRef GFFFile::readStructRef(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
-    GFFStructRef result = {0, 0};
-    if (structIndex >= m_structs.size()) return result;
+    return readStructRef(resolveField(structIndex, label), baseOffset);
+}
 
-    const GFFField* field = findField(structIndex, label);
+GFFStructRef GFFFile::readStructRef(const GFFFieldHandle& handle, uint32_t baseOffset) {
+    GFFStructRef result = {0, 0};
+    const GFFField* field = handle.field;
     if (!field) return result;
 
     bool isRef = (field->flags & FLAG_REFERENCE) != 0;
@@ -436,62 +762,32 @@ GFFStructRef GFFFile::readStructRef(uint32_t structIndex, uint32_t label, uint32
 }
 
 std::vector<GFFStructRef> GFFFile::readStructList(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
-    std::vector<GFFStructRef> result;
-    if (structIndex >= m_structs.size()) return result;
+    if (structIndex >= m_structs.size()) return {};
+    GFFFieldHandle handle = resolveField(structIndex, label);
+    if (!handle) return {};
+    return readStructList(handle, baseOffset);
+}
 
-    const GFFField* field = findField(structIndex, label);
-    if (!field) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label)) {
-            std::cout << "[GFF4-DEBUG] readStructList: field 6999 NOT FOUND in struct " << structIndex
-                      << " (has " << m_structs[structIndex].fields.size() << " fields)" << std::endl;
-            for (size_t fi = 0; fi < m_structs[structIndex].fields.size(); fi++) {
-                std::cout << "[GFF4-DEBUG]   field[" << fi << "] label=" << m_structs[structIndex].fields[fi].label << std::endl;
-            }
-        }
-        return result;
-    }
+std::vector<GFFStructRef> GFFFile::readStructList(const GFFFieldHandle& handle, uint32_t baseOffset) {
+    std::vector<GFFStructRef> result;
+    const GFFField* field = handle.field;
+    if (!field) return result;
 
     bool isList = (field->flags & FLAG_LIST) != 0;
     bool isStruct = (field->flags & FLAG_STRUCT) != 0;
     bool isRef = (field->flags & FLAG_REFERENCE) != 0;
 
-    if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label)) {
-        std::cout << "[GFF4-DEBUG] readStructList struct=" << structIndex
-                  << " label=" << label << " baseOff=0x" << std::hex << baseOffset
-                  << " flags=0x" << field->flags << std::dec
-                  << " isList=" << isList << " isStruct=" << isStruct << " isRef=" << isRef << std::endl;
-    }
-
     uint32_t dataPos = m_header.dataOffset + field->dataOffset + baseOffset;
     int32_t ref = readAt<int32_t>(dataPos);
-    if (ref < 0) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   ref=" << ref << " (NEGATIVE, returning empty)" << std::endl;
-        return result;
-    }
+    if (ref < 0) return result;
 
     uint32_t listPos = m_header.dataOffset + ref;
-    if (listPos + 4 > m_data.size()) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   listPos=0x" << std::hex << listPos << " > data size, returning empty" << std::dec << std::endl;
-        return result;
-    }
+    if (listPos + 4 > byteCount()) return result;
     uint32_t listCount = readAt<uint32_t>(listPos);
-    if (listCount > 100000) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   listCount=" << listCount << " (>100000, returning empty)" << std::endl;
-        return result;
-    }
+    if (listCount > 100000) return result;
     listPos += 4;
 
-    if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label)) {
-        std::cout << "[GFF4-DEBUG]   ref=0x" << std::hex << ref << " listPos=0x" << listPos
-                  << std::dec << " listCount=" << listCount << std::endl;
-    }
-
     if (isList && isStruct && !isRef) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   -> branch: isList && isStruct && !isRef" << std::endl;
         if (field->typeId >= m_structs.size()) return result;
         uint32_t structSize = m_structs[field->typeId].structSize;
         uint32_t itemOffset = ref + 4;
@@ -504,10 +800,8 @@ std::vector<GFFStructRef> GFFFile::readStructList(uint32_t structIndex, uint32_t
         }
     }
     else if (isList && isStruct && isRef) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   -> branch: isList && isStruct && isRef" << std::endl;
         for (uint32_t i = 0; i < listCount; i++) {
-            if (listPos + 4 > m_data.size()) break;
+            if (listPos + 4 > byteCount()) break;
             uint32_t itemOffset = readAt<uint32_t>(listPos);
             listPos += 4;
             GFFStructRef sr;
@@ -517,35 +811,20 @@ std::vector<GFFStructRef> GFFFile::readStructList(uint32_t structIndex, uint32_t
         }
     }
     else if (isList && isRef && !isStruct) {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   -> branch: isList && isRef && !isStruct (PACKED UINT32)" << std::endl;
         for (uint32_t i = 0; i < listCount; i++) {
-            if (listPos + 8 > m_data.size()) break;
+            if (listPos + 8 > byteCount()) break;
             // Each entry is a packed uint32: high 16 bits = flags, low 16 bits = struct index
             uint32_t packed = readAt<uint32_t>(listPos);
             uint16_t structRef = static_cast<uint16_t>(packed & 0xFFFF);
             listPos += 4;
             uint32_t fieldOffset = readAt<uint32_t>(listPos);
             listPos += 4;
-            if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label)) {
-                std::cout << "[GFF4-DEBUG]     entry[" << i << "] packed=0x" << std::hex << packed
-                          << " structRef=" << std::dec << structRef
-                          << " offset=0x" << std::hex << fieldOffset << std::dec << std::endl;
-            }
             GFFStructRef sr;
             sr.structIndex = structRef;
             sr.offset = fieldOffset;
             result.push_back(sr);
         }
     }
-    else {
-        if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label))
-            std::cout << "[GFF4-DEBUG]   -> NO BRANCH MATCHED! flags=0x" << std::hex << field->flags << std::dec << std::endl;
-    }
-
-    if (m_bigEndian && X360::GffQuirks::isListLengthLabel(label)) {
-        std::cout << "[GFF4-DEBUG]   returning " << result.size() << " entries" << std::endl;
-    }
     return result;
 }
 
@@ -557,23 +836,23 @@ uint32_t GFFFile::getListDataOffset(uint32_t structIndex, uint32_t label, uint32
 }
 
 std::string GFFFile::readRawString(size_t offset) const {
-    if (offset + 4 > m_data.size()) return "";
+    if (offset + 4 > byteCount()) return "";
     uint32_t len = readAt<uint32_t>(offset);
-    if (offset + 4 + len > m_data.size()) return "";
-    return std::string((const char*)m_data.data() + offset + 4, len);
+    if (offset + 4 + len > byteCount()) return "";
+    return std::string((const char*)bytes() + offset + 4, len);
 }
 
 std::string GFFFile::readLocString(size_t offset) const {
-    if (offset + 12 > m_data.size()) return "";
+    if (offset + 12 > byteCount()) return "";
     int32_t strRef = readAt<int32_t>(offset + 4);
     uint32_t count = readAt<uint32_t>(offset + 8);
 
     if (count > 0) {
         size_t current = offset + 12;
-        if (current + 8 <= m_data.size()) {
+        if (current + 8 <= byteCount()) {
             uint32_t len = readAt<uint32_t>(current + 4);
-            if (current + 8 + len <= m_data.size()) {
-                return std::string((const char*)m_data.data() + current + 8, len);
+            if (current + 8 + len <= byteCount()) {
+                return std::string((const char*)bytes() + current + 8, len);
             }
         }
     }
@@ -581,8 +860,8 @@ std::string GFFFile::readLocString(size_t offset) const {
     return "";
 }
 
-std::string GFFFile::getFieldDisplayValue(const GFFField& field) const {
-    size_t dataPos = m_header.dataOffset + field.dataOffset;
+std::string GFFFile::getFieldDisplayValue(const GFFField& field, uint32_t baseOffset) const {
+    size_t dataPos = m_header.dataOffset + field.dataOffset + baseOffset;
 
     if (field.flags & FLAG_LIST) return "(List)";
     if (field.flags & FLAG_STRUCT) return "(Struct)";
@@ -612,36 +891,7 @@ std::string GFFFile::getFieldDisplayValue(const GFFField& field) const {
             if (relOffset < 0) return "";
             return readRawString(m_header.dataOffset + relOffset);
         }
-        case 14:
-        {
-            uint32_t address = readAt<uint32_t>(dataPos);
-            if (address == 0xFFFFFFFF) return "";
-            if (m_header.isV41) {
-                if (address < m_stringCache.size()) return m_stringCache[address];
-                return "";
-            }
-            uint32_t strPos = m_header.dataOffset + address;
-            if (strPos + 4 > m_data.size()) return "";
-            uint32_t length = readAt<uint32_t>(strPos);
-            strPos += 4;
-            std::string result;
-            result.reserve(length);
-            for (uint32_t i = 0; i < length && strPos + 2 <= m_data.size(); i++) {
-                uint16_t wc = readAt<uint16_t>(strPos);
-                strPos += 2;
-                if (wc == 0) continue;
-                if (wc < 0x80) result += static_cast<char>(wc);
-                else if (wc < 0x800) {
-                    result += static_cast<char>(0xC0 | (wc >> 6));
-                    result += static_cast<char>(0x80 | (wc & 0x3F));
-                } else {
-                    result += static_cast<char>(0xE0 | (wc >> 12));
-                    result += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
-                    result += static_cast<char>(0x80 | (wc & 0x3F));
-                }
-            }
-            return result;
-        }
+        case 14: return std::string(ecString(readAt<uint32_t>(dataPos)));
         case 12:
         {
             int32_t relOffset = readAt<int32_t>(dataPos);
@@ -655,31 +905,7 @@ std::string GFFFile::getFieldDisplayValue(const GFFField& field) const {
             uint32_t address = readAt<uint32_t>(dataPos + 4);
             std::string label = std::to_string(tlkId);
             std::string text;
-            if (address != 0xFFFFFFFF && (address != 0 || m_header.isV41)) {
-                if (m_header.isV41) {
-                    if (address < m_stringCache.size()) text = m_stringCache[address];
-                } else {
-                    uint32_t strPos = m_header.dataOffset + address;
-                    if (strPos + 4 <= m_data.size()) {
-                        uint32_t length = readAt<uint32_t>(strPos);
-                        strPos += 4;
-                        for (uint32_t i = 0; i < length && strPos + 2 <= m_data.size(); i++) {
-                            uint16_t wc = readAt<uint16_t>(strPos);
-                            strPos += 2;
-                            if (wc == 0) continue;
-                            if (wc < 0x80) text += static_cast<char>(wc);
-                            else if (wc < 0x800) {
-                                text += static_cast<char>(0xC0 | (wc >> 6));
-                                text += static_cast<char>(0x80 | (wc & 0x3F));
-                            } else {
-                                text += static_cast<char>(0xE0 | (wc >> 12));
-                                text += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
-                                text += static_cast<char>(0x80 | (wc & 0x3F));
-                            }
-                        }
-                    }
-                }
-            }
+            if (address != 0 || m_header.isV41) text = std::string(ecString(address));
             if (text.empty() && GFF4TLK::isLoaded())
                 text = GFF4TLK::lookup(tlkId);
             if (!text.empty()) return label + ", " + text;
@@ -689,69 +915,134 @@ std::string GFFFile::getFieldDisplayValue(const GFFField& field) const {
     }
 }
 
-void GFFFile::walk(GFF4Visitor visitor) const {
-    if (!m_loaded || m_structs.empty()) return;
-    walkStruct(0, visitor, "", 0);
+uint32_t GFFFieldCursor::valuePos() const {
+    uint32_t pos = dataPos();
+    if (isReference() && !isStruct() && m_field->typeId <= 17 && m_field->typeId != 14) {
+        uint32_t ptr = m_file->readAt<uint32_t>(pos);
+        if (ptr == 0xFFFFFFFF) return 0;
+        pos = m_file->dataOffset() + ptr;
+    }
+    return pos;
 }
 
-void GFFFile::walkStruct(uint32_t structIdx, GFF4Visitor visitor, const std::string& basePath, int depth) const {
-    if (structIdx >= m_structs.size()) return;
-    const GFFStruct& st = m_structs[structIdx];
+GFFCursor GFFFieldCursor::child() const {
+    if (isList()) return GFFCursor();
+    if (isStruct() && !isReference())
+        return GFFCursor(m_file, m_field->typeId, m_field->dataOffset + m_base);
+    if (isStruct()) {
+        int32_t ref = m_file->readAt<int32_t>(dataPos());
+        if (ref < 0) return GFFCursor();
+        return GFFCursor(m_file, m_field->typeId, static_cast<uint32_t>(ref));
+    }
+    if (isReference() && m_field->typeId > 17) {
+        uint32_t packed = m_file->readAt<uint32_t>(dataPos());
+        return GFFCursor(m_file, packed & 0xFFFF, m_file->readAt<uint32_t>(dataPos() + 4));
+    }
+    return GFFCursor();
+}
 
-    for (const auto& field : st.fields) {
-        std::string labelName = getLabel(field.label);
-        std::string currentPath = basePath.empty() ? labelName : basePath + "." + labelName;
-        std::string valStr = getFieldDisplayValue(field);
-
-        std::string typeName = "Unknown";
-        bool isComplex = false;
-
-        if (field.flags & FLAG_LIST) { typeName = "List"; isComplex = true; }
-        else if (field.flags & FLAG_STRUCT) { typeName = "Struct"; isComplex = true; }
-        else if ((field.flags & FLAG_REFERENCE) && field.typeId > 17) { typeName = "Reference"; isComplex = true; }
-        else {
-            switch(field.typeId) {
-                case 0: typeName = "BYTE"; break;
-                case 4: typeName = "DWORD"; break;
-                case 5: typeName = "INT"; break;
-                case 8: typeName = "FLOAT"; break;
-                case 10: typeName = "STRING"; break;
-                case 11: typeName = "RESREF"; break;
-                default: typeName = "Type_" + std::to_string(field.typeId); break;
-            }
-        }
+// Same layouts as readStructList / readPrimitiveListInfo.
+GFFListCursor GFFFieldCursor::list() const {
+    using Kind = GFFListCursor::Kind;
+    if (!m_field || !isList()) return GFFListCursor();
+    int32_t ref = m_file->readAt<int32_t>(dataPos());
+    if (ref < 0) return GFFListCursor();
+    uint64_t listPos = static_cast<uint64_t>(m_file->dataOffset()) + static_cast<uint32_t>(ref);
+    size_t size = m_file->rawData().size();
+    if (listPos + 4 > size) return GFFListCursor();
+    uint32_t count = m_file->readAt<uint32_t>(static_cast<uint32_t>(listPos));
+
+    Kind kind;
+    uint32_t stride;
+    if (isStruct() && !isReference()) {
+        if (m_field->typeId >= m_file->structs().size()) return GFFListCursor();
+        kind = Kind::InlineStructs;
+        stride = m_file->structs()[m_field->typeId].structSize;
+    } else if (isStruct()) {
+        kind = Kind::StructRefs;
+        stride = 4;
+    } else if (isReference()) {
+        kind = Kind::GenericRefs;
+        stride = 8;
+    } else {
+        kind = Kind::Primitives;
+        stride = GFFFile::primitiveTypeSize(m_field->typeId);
+    }
+    uint64_t avail = size - (listPos + 4);
+    if (stride && count > avail / stride) count = static_cast<uint32_t>(avail / stride);
+    return GFFListCursor(m_file, kind, count, static_cast<uint32_t>(listPos + 4), stride, m_field->typeId);
+}
 
-        visitor(currentPath, labelName, typeName, valStr, depth, isComplex);
+GFFCursor GFFListCursor::at(uint32_t i) const {
+    if (i >= m_count) return GFFCursor();
+    uint32_t pos = elementPos(i);
+    switch (m_kind) {
+        case Kind::InlineStructs:
+            return GFFCursor(m_file, m_structIndex, pos - m_file->dataOffset());
+        case Kind::StructRefs:
+            return GFFCursor(m_file, m_structIndex, m_file->readAt<uint32_t>(pos));
+        case Kind::GenericRefs:
+            return GFFCursor(m_file, m_file->readAt<uint32_t>(pos) & 0xFFFF, m_file->readAt<uint32_t>(pos + 4));
+        default:
+            return GFFCursor();
+    }
+}
 
-        if (field.flags & FLAG_STRUCT && !(field.flags & FLAG_LIST) && !(field.flags & FLAG_REFERENCE)) {
-            walkStruct(field.typeId, visitor, currentPath, depth + 1);
-        }
-        else if (field.flags & FLAG_LIST) {
-            uint32_t listOffset = m_header.dataOffset + readAt<uint32_t>(m_header.dataOffset + field.dataOffset);
-            if (listOffset + 4 <= m_data.size()) {
-                uint32_t count = readAt<uint32_t>(listOffset);
-                for(uint32_t k=0; k<count; ++k) {
-                    if (listOffset + 4 + (k*4) + 4 > m_data.size()) break;
-                    uint32_t itemStructIdx = readAt<uint32_t>(listOffset + 4 + (k*4));
-                    std::string itemPath = currentPath + "[" + std::to_string(k) + "]";
-                    visitor(itemPath, std::to_string(k), "Struct", "", depth + 1, true);
-                    walkStruct(itemStructIdx, visitor, itemPath, depth + 2);
-                }
+static std::string walkTypeName(const GFFFieldCursor& f) {
+    if (f.isList()) return "List";
+    if (f.isStruct()) return "Struct";
+    if (f.isReference() && f.typeId() > 17) return "Reference";
+    switch (f.typeId()) {
+        case 0: return "BYTE";
+        case 4: return "DWORD";
+        case 5: return "INT";
+        case 8: return "FLOAT";
+        case 10: return "STRING";
+        case 11: return "RESREF";
+        default: return "Type_" + std::to_string(f.typeId());
+    }
+}
+
+// Inline structs and list elements are followed; references aren't, so a
+// reference cycle can't recurse forever.
+static void walkStruct(const GFFCursor& st, const std::string& basePath, const GFFFile::GFF4Visitor& visitor, int depth) {
+    if (depth > 64) return;
+    for (GFFFieldCursor f : st) {
+        std::string labelName = GFFFile::getLabel(f.label());
+        std::string currentPath = basePath.empty() ? labelName : basePath + "." + labelName;
+        visitor(currentPath, labelName, walkTypeName(f),
+                st.file().getFieldDisplayValue(f.field(), st.offset()), depth, f.isComplex());
+        if (f.isStruct() && !f.isList() && !f.isReference()) {
+            walkStruct(f.child(), currentPath, visitor, depth + 1);
+        } else if (f.isList()) {
+            GFFListCursor items = f.list();
+            uint32_t k = 0;
+            for (GFFCursor item : items) {
+                std::string itemPath = currentPath + "[" + std::to_string(k) + "]";
+                visitor(itemPath, std::to_string(k), "Struct", "", depth + 1, true);
+                if (item) walkStruct(item, itemPath, visitor, depth + 2);
+                k++;
             }
         }
     }
 }
 
+void GFFFile::walk(GFF4Visitor visitor) const {
+    GFFCursor top = root();
+    if (!top || m_structs.empty()) return;
+    walkStruct(top, "", visitor, 0);
+}
+
 std::pair<uint32_t, uint32_t> GFFFile::readPrimitiveListInfo(uint32_t structIndex, uint32_t label, uint32_t baseOffset) {
     const GFFField* field = findField(structIndex, label);
     if (!field) return {0, 0};
     if (!(field->flags & FLAG_LIST)) return {0, 0};
     uint32_t dataPos = m_header.dataOffset + baseOffset + field->dataOffset;
-    if (dataPos + 4 > m_data.size()) return {0, 0};
+    if (dataPos + 4 > byteCount()) return {0, 0};
     int32_t ref = readAt<int32_t>(dataPos);
     if (ref < 0) return {0, 0};
     uint32_t listPos = m_header.dataOffset + ref;
-    if (listPos + 4 > m_data.size()) return {0, 0};
+    if (listPos + 4 > byteCount()) return {0, 0};
     uint32_t count = readAt<uint32_t>(listPos);
     return {count, listPos + 4};
 }
@@ -788,6 +1079,8 @@ static std::vector<uint16_t> utf8ToUtf16(const std::string& str) {
 }
 
 bool GFFFile::writeECString(uint32_t fieldDataPos, const std::string& newStr) {
+    makeOwned();
+    m_decoded.clear();
     if (fieldDataPos + 4 > m_data.size()) return false;
     uint32_t address = readUInt32At(fieldDataPos);
     auto wchars = utf8ToUtf16(newStr);
@@ -819,12 +1112,69 @@ bool GFFFile::writeECString(uint32_t fieldDataPos, const std::string& newStr) {
 bool GFFFile::save(const std::string& path) {
     std::ofstream f(path, std::ios::binary);
     if (!f.is_open()) return false;
-    f.write(reinterpret_cast<const char*>(m_data.data()), m_data.size());
+    f.write(reinterpret_cast<const char*>(bytes()), byteCount());
     return f.good();
 }
 
 namespace GFF4TLK {
+    // Huffman tree and bit stream of one V0.5 table, plus lookup tables that
+    // decode up to TABLE_BITS bits per step. A tree node is a pair of int32
+    // children (bit 0, bit 1): >= 0 is another node, < 0 a leaf holding
+    // character -e - 1, and -1 ends the string. The root is the last node.
+    struct HuffmanSource {
+        static const uint32_t TABLE_BITS = 10;
+        // bits == 0: invalid path, stop. next < 0: leaf reached after bits.
+        // next >= 0: index of the table to continue with after TABLE_BITS.
+        struct Step {
+            int32_t next;
+            uint8_t bits;
+        };
+        std::vector<int32_t> tree;
+        std::vector<uint32_t> data;
+        std::vector<Step> steps;
+
+        void buildTables();
+        std::string decode(uint32_t bitStart) const;
+    };
+
+    struct LazyString {
+        uint32_t source;
+        uint32_t bitOffset;
+    };
+
+    struct CacheSlot {
+        uint32_t id = 0;
+        bool used = false;
+        std::string text;
+    };
+
+    // One talk table as parsed, before it is merged into the tables below.
+    struct TableData {
+        std::vector<std::pair<uint32_t, std::string>> strings;
+        std::unique_ptr<HuffmanSource> source;
+        std::vector<std::pair<uint32_t, uint32_t>> bitOffsets;
+    };
+
+    // The merged table loadAllFromPath() saved, served from the mapping:
+    // entries sorted by id, then the UTF-8 text they point into.
+    struct DiskEntry {
+        uint32_t id;
+        uint32_t offset;
+        uint32_t length;
+    };
+
     static std::unordered_map<uint32_t, std::string> s_strings;
+    // Shared so a cache write still running can decode from them.
+    static std::vector<std::shared_ptr<const HuffmanSource>> s_sources;
+    static std::unordered_map<uint32_t, LazyString> s_lazy;
+    // Direct-mapped by id: a lookup replaces whatever shared its slot.
+    static const uint32_t CACHE_BITS = 12;
+    static std::vector<CacheSlot> s_cache;
+    static std::mutex s_cacheMutex;
+    static MappedFile s_disk;
+    static const DiskEntry* s_diskEntries = nullptr;
+    static uint32_t s_diskCount = 0;
+    static const char* s_diskText = nullptr;
     static bool s_loaded = false;
 
     static std::string readECString(const GFFFile& gff, uint32_t dataPos) {
@@ -853,127 +1203,421 @@ namespace GFF4TLK {
         return result;
     }
 
-    static bool loadV02(GFFFile& gff) {
+    static bool parseV02(GFFFile& gff, TableData& out) {
         auto items = gff.readStructList(0, 19001, 0);
+        out.strings.reserve(items.size());
         for (auto& item : items) {
             uint32_t id = gff.readUInt32ByLabel(item.structIndex, 19002, item.offset);
             const GFFField* strField = gff.findField(item.structIndex, 19003);
             if (strField) {
                 uint32_t dataPos = gff.dataOffset() + item.offset + strField->dataOffset;
-                s_strings[id] = readECString(gff, dataPos);
+                out.strings.emplace_back(id, readECString(gff, dataPos));
             }
         }
         return true;
     }
 
-    static std::string huffmanDecompress(uint32_t bitStart,
-                                          const std::vector<int32_t>& tree,
-                                          const std::vector<uint32_t>& data) {
-        if (tree.empty() || data.empty()) return "";
-        uint32_t index = bitStart >> 5;
-        uint32_t shift = bitStart & 0x1F;
-        if (index >= data.size()) return "";
-        uint32_t n = data[index] >> shift;
-        std::string result;
-        while (true) {
-            int32_t e = (int32_t)(tree.size() / 2) - 1;
-            while (e >= 0) {
-                if ((uint32_t)e * 2 + 1 >= tree.size()) return result;
-                e = tree[e * 2 + (n & 1)];
-                if (shift < 31) {
-                    n >>= 1;
-                    shift++;
-                } else {
-                    index++;
-                    if (index >= data.size()) return result;
-                    n = data[index];
-                    shift = 0;
+    // One table per node reached at a multiple of TABLE_BITS from the root,
+    // built breadth-first; almost every character resolves in the first.
+    void HuffmanSource::buildTables() {
+        steps.clear();
+        if (tree.size() < 2) return;
+        const uint32_t size = 1u << TABLE_BITS;
+        int32_t nodeCount = static_cast<int32_t>(tree.size() / 2);
+        std::vector<int32_t> tableOf(nodeCount, -1);
+        std::vector<int32_t> queue{ nodeCount - 1 };
+        tableOf[nodeCount - 1] = 0;
+        for (size_t t = 0; t < queue.size(); t++) {
+            steps.resize((t + 1) * size);
+            Step* table = &steps[t * size];
+            for (uint32_t pattern = 0; pattern < size; pattern++) {
+                int32_t e = queue[t];
+                Step step{ 0, 0 };
+                for (uint32_t bit = 0; bit < TABLE_BITS; bit++) {
+                    if (e >= nodeCount) break;
+                    e = tree[e * 2 + ((pattern >> bit) & 1)];
+                    if (e < 0) {
+                        step = { e, static_cast<uint8_t>(bit + 1) };
+                        break;
+                    }
+                    if (bit + 1 == TABLE_BITS && e < nodeCount) {
+                        if (tableOf[e] < 0) {
+                            tableOf[e] = static_cast<int32_t>(queue.size());
+                            queue.push_back(e);
+                        }
+                        step = { tableOf[e], static_cast<uint8_t>(TABLE_BITS) };
+                    }
                 }
+                table[pattern] = step;
             }
-            if (e == -1) break;
-            uint16_t wc = (uint16_t)(-(e) - 1);
-            if (wc < 0x80) result += static_cast<char>(wc);
-            else if (wc < 0x800) {
-                result += static_cast<char>(0xC0 | (wc >> 6));
-                result += static_cast<char>(0x80 | (wc & 0x3F));
-            } else {
-                result += static_cast<char>(0xE0 | (wc >> 12));
-                result += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
-                result += static_cast<char>(0x80 | (wc & 0x3F));
+        }
+    }
+
+    // Bits are read from the least significant end of each 32-bit word. A
+    // string stops at the terminator or where the stream runs out; like the
+    // per-bit decoder this replaced, a character whose code ends on the very
+    // last bit of the stream is dropped.
+    std::string HuffmanSource::decode(uint32_t bitStart) const {
+        std::string result;
+        if (steps.empty()) return result;
+        const uint64_t totalBits = uint64_t(data.size()) * 32;
+        const uint32_t mask = (1u << TABLE_BITS) - 1;
+        uint64_t pos = bitStart;
+        int32_t table = 0;
+        while (pos < totalBits) {
+            size_t index = static_cast<size_t>(pos >> 5);
+            uint64_t window = data[index];
+            if (index + 1 < data.size()) window |= uint64_t(data[index + 1]) << 32;
+            const Step& step = steps[(size_t(table) << TABLE_BITS) | ((window >> (pos & 31)) & mask)];
+            if (step.bits == 0 || pos + step.bits >= totalBits) break;
+            pos += step.bits;
+            if (step.next >= 0) {
+                table = step.next;
+                continue;
             }
+            if (step.next == -1) break;
+            appendUtf8(result, static_cast<uint16_t>(-step.next - 1));
+            table = 0;
         }
         return result;
     }
 
-    static bool loadV05(GFFFile& gff) {
+    // Only the tree, the bit stream and each string's bit offset are kept;
+    // strings are decoded by lookup() or decodeAll().
+    static bool parseV05(GFFFile& gff, TableData& out) {
         auto [treeCount, treeStart] = gff.readPrimitiveListInfo(0, 19007, 0);
         auto [dataCount, dataStart] = gff.readPrimitiveListInfo(0, 19008, 0);
         if (treeCount == 0 || dataCount == 0) return false;
-        std::vector<int32_t> tree(treeCount);
+        auto source = std::make_unique<HuffmanSource>();
+        source->tree.resize(treeCount);
         for (uint32_t i = 0; i < treeCount; i++)
-            tree[i] = gff.readAt<int32_t>(treeStart + i * 4);
-        std::vector<uint32_t> data(dataCount);
+            source->tree[i] = gff.readAt<int32_t>(treeStart + i * 4);
+        source->data.resize(dataCount);
         for (uint32_t i = 0; i < dataCount; i++)
-            data[i] = gff.readAt<uint32_t>(dataStart + i * 4);
+            source->data[i] = gff.readAt<uint32_t>(dataStart + i * 4);
+        source->buildTables();
+        out.source = std::move(source);
+
         auto entries = gff.readStructList(0, 19006, 0);
+        out.bitOffsets.reserve(entries.size());
+        GFFFieldHandle idField, bitField;
+        uint32_t entryType = UINT32_MAX;
         for (auto& entry : entries) {
-            uint32_t id = gff.readUInt32ByLabel(entry.structIndex, 19004, entry.offset);
-            uint32_t bitOffset = gff.readUInt32ByLabel(entry.structIndex, 19005, entry.offset);
-            s_strings[id] = huffmanDecompress(bitOffset, tree, data);
+            if (entry.structIndex != entryType) {
+                entryType = entry.structIndex;
+                idField = gff.resolveField(entryType, 19004);
+                bitField = gff.resolveField(entryType, 19005);
+            }
+            out.bitOffsets.emplace_back(gff.readUInt32(idField, entry.offset), gff.readUInt32(bitField, entry.offset));
         }
         return true;
     }
 
-    bool loadFromData(const std::vector<uint8_t>& data) {
+    // Touches nothing shared, so tables can be parsed on several threads.
+    static bool parseTable(const std::vector<uint8_t>& data, TableData& out) {
         GFFFile gff;
-        if (!gff.load(data)) return false;
+        if (!gff.loadBorrowed(data)) return false;
         uint32_t fv = gff.header().fileVersion;
         char ver[5] = {};
         std::memcpy(ver, &fv, 4);
-        bool ok = false;
-        if (std::string(ver) == "V0.2") {
-            ok = loadV02(gff);
-        } else if (std::string(ver) == "V0.5") {
-            ok = loadV05(gff);
-        }
-        if (ok) s_loaded = true;
-        return ok;
+        if (std::string(ver) == "V0.2") return parseV02(gff, out);
+        if (std::string(ver) == "V0.5") return parseV05(gff, out);
+        return false;
     }
 
-    bool loadFromFile(const std::string& path) {
+    static bool readFile(const std::string& path, std::vector<uint8_t>& data) {
         std::ifstream f(path, std::ios::binary);
         if (!f) return false;
         f.seekg(0, std::ios::end);
         size_t sz = f.tellg();
         f.seekg(0, std::ios::beg);
-        std::vector<uint8_t> data(sz);
+        data.resize(sz);
         f.read(reinterpret_cast<char*>(data.data()), sz);
+        return true;
+    }
+
+    // Tables merge in load order; an id defined again replaces the old one.
+    static void merge(TableData&& table) {
+        for (auto& [id, text] : table.strings) {
+            s_strings[id] = std::move(text);
+            s_lazy.erase(id);
+        }
+        if (table.source) {
+            uint32_t sourceIndex = static_cast<uint32_t>(s_sources.size());
+            s_sources.push_back(std::move(table.source));
+            s_lazy.reserve(s_lazy.size() + table.bitOffsets.size());
+            for (const auto& [id, bitOffset] : table.bitOffsets) {
+                s_lazy[id] = { sourceIndex, bitOffset };
+                s_strings.erase(id);
+            }
+        }
+        s_loaded = true;
+        std::lock_guard<std::mutex> lock(s_cacheMutex);
+        s_cache.clear();
+    }
+
+    bool loadFromData(const std::vector<uint8_t>& data) {
+        TableData table;
+        if (!parseTable(data, table)) return false;
+        merge(std::move(table));
+        return true;
+    }
+
+    bool loadFromFile(const std::string& path) {
+        std::vector<uint8_t> data;
+        if (!readFile(path, data)) return false;
         return loadFromData(data);
     }
 
-    int loadAllFromPath(const std::string& gamePath) {
+    static const char DISK_MAGIC[4] = {'H', 'T', 'L', 'K'};
+    static const uint32_t DISK_VERSION = 1;
+
+    // A .tlk under the install as it was when the cache was written.
+    struct SourceFile {
+        std::string path;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    const char* defaultCachePath() {
+        return "haventools_tlkcache.bin";
+    }
+
+    static const DiskEntry* findOnDisk(uint32_t id) {
+        const DiskEntry* end = s_diskEntries + s_diskCount;
+        const DiskEntry* it = std::lower_bound(s_diskEntries, end, id,
+            [](const DiskEntry& e, uint32_t key) { return e.id < key; });
+        return it != end && it->id == id ? it : nullptr;
+    }
+
+    static void closeDisk() {
+        s_disk.close();
+        s_diskEntries = nullptr;
+        s_diskCount = 0;
+        s_diskText = nullptr;
+    }
+
+    // Layout: magic, version, source count, each source (path length, path,
+    // size, mtime), files used, entry count, padding to 4 bytes, entries,
+    // text. Native byte order; it never leaves the machine.
+    static bool openDisk(const std::string& cachePath, const std::vector<SourceFile>& sources, int& filesUsed) {
+        closeDisk();
+        if (!s_disk.open(cachePath) || !s_disk.isMapped()) {
+            s_disk.close();
+            return false;
+        }
+        const uint8_t* data = s_disk.data();
+        uint64_t size = s_disk.size();
+        uint64_t pos = 0;
+        auto read = [&](void* out, uint64_t len) {
+            if (pos + len > size) return false;
+            std::memcpy(out, data + pos, len);
+            pos += len;
+            return true;
+        };
+
+        char magic[4];
+        uint32_t version = 0, sourceCount = 0;
+        bool ok = read(magic, 4) && std::memcmp(magic, DISK_MAGIC, 4) == 0 &&
+                  read(&version, 4) && version == DISK_VERSION &&
+                  read(&sourceCount, 4) && sourceCount == sources.size();
+        for (uint32_t i = 0; ok && i < sourceCount; i++) {
+            uint32_t len = 0;
+            uint64_t fileSize = 0;
+            int64_t mtime = 0;
+            ok = read(&len, 4) && pos + len <= size &&
+                 sources[i].path.compare(0, std::string::npos, reinterpret_cast<const char*>(data + pos), len) == 0;
+            pos += len;
+            ok = ok && read(&fileSize, 8) && read(&mtime, 8) &&
+                 fileSize == sources[i].size && mtime == sources[i].mtime;
+        }
+        uint32_t used = 0, count = 0;
+        ok = ok && read(&used, 4) && read(&count, 4);
+        pos = (pos + 3) & ~uint64_t(3);
+        uint64_t entryBytes = uint64_t(count) * sizeof(DiskEntry);
+        ok = ok && pos + entryBytes <= size;
+        if (!ok) {
+            closeDisk();
+            return false;
+        }
+        const DiskEntry* entries = reinterpret_cast<const DiskEntry*>(data + pos);
+        uint64_t textSize = size - pos - entryBytes;
+        for (uint32_t i = 0; i < count; i++) {
+            if (uint64_t(entries[i].offset) + entries[i].length > textSize || (i && entries[i].id <= entries[i - 1].id)) {
+                closeDisk();
+                return false;
+            }
+        }
+        s_diskEntries = entries;
+        s_diskCount = count;
+        s_diskText = reinterpret_cast<const char*>(data + pos + entryBytes);
+        filesUsed = static_cast<int>(used);
+        return true;
+    }
+
+    // Everything writeDisk needs, copied out of the tables so the write can
+    // run while they are cleared or reloaded.
+    struct DiskSnapshot {
+        std::string cachePath;
+        std::vector<SourceFile> sources;
+        int filesUsed = 0;
+        std::vector<uint32_t> ids;
+        std::vector<std::string> texts;
+        std::vector<LazyString> lazy;
+        std::vector<std::shared_ptr<const HuffmanSource>> huffman;
+    };
+
+    static DiskSnapshot takeSnapshot(const std::string& cachePath, const std::vector<SourceFile>& sources, int filesUsed) {
+        DiskSnapshot snap;
+        snap.cachePath = cachePath;
+        snap.sources = sources;
+        snap.filesUsed = filesUsed;
+        snap.ids.reserve(s_strings.size() + s_lazy.size());
+        for (const auto& kv : s_strings) snap.ids.push_back(kv.first);
+        for (const auto& kv : s_lazy) snap.ids.push_back(kv.first);
+        std::sort(snap.ids.begin(), snap.ids.end());
+        snap.texts.resize(snap.ids.size());
+        snap.lazy.resize(snap.ids.size(), LazyString{ UINT32_MAX, 0 });
+        for (size_t i = 0; i < snap.ids.size(); i++) {
+            auto lazy = s_lazy.find(snap.ids[i]);
+            if (lazy != s_lazy.end()) snap.lazy[i] = lazy->second;
+            else snap.texts[i] = s_strings[snap.ids[i]];
+        }
+        snap.huffman = s_sources;
+        return snap;
+    }
+
+    // One write at a time, so two loads can't share the temp file.
+    static std::mutex s_writeMutex;
+
+    // Decodes the compressed strings (on the pool) and writes the snapshot
+    // out. Runs on its own thread; touches nothing but the snapshot.
+    static bool writeDisk(DiskSnapshot& snap) {
+        std::lock_guard<std::mutex> lock(s_writeMutex);
+        const auto& ids = snap.ids;
+        const auto& sources = snap.sources;
+        const std::string& cachePath = snap.cachePath;
+        Parallel::forRange(ids.size(), 512, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const LazyString& lazy = snap.lazy[i];
+                if (lazy.source != UINT32_MAX)
+                    snap.texts[i] = snap.huffman[lazy.source]->decode(lazy.bitOffset);
+            }
+        });
+
+        std::vector<uint8_t> out;
+        auto write = [&](const void* p, size_t len) {
+            out.insert(out.end(), static_cast<const uint8_t*>(p), static_cast<const uint8_t*>(p) + len);
+        };
+        uint32_t sourceCount = static_cast<uint32_t>(sources.size());
+        write(DISK_MAGIC, 4);
+        write(&DISK_VERSION, 4);
+        write(&sourceCount, 4);
+        for (const auto& src : sources) {
+            uint32_t len = static_cast<uint32_t>(src.path.size());
+            write(&len, 4);
+            write(src.path.data(), len);
+            write(&src.size, 8);
+            write(&src.mtime, 8);
+        }
+        uint32_t used = static_cast<uint32_t>(snap.filesUsed);
+        uint32_t count = static_cast<uint32_t>(ids.size());
+        write(&used, 4);
+        write(&count, 4);
+        out.resize((out.size() + 3) & ~size_t(3), 0);
+
+        size_t entriesPos = out.size();
+        out.resize(entriesPos + ids.size() * sizeof(DiskEntry));
+        uint64_t textSize = 0;
+        for (size_t i = 0; i < ids.size(); i++) {
+            const std::string& text = snap.texts[i];
+            if (textSize + text.size() > UINT32_MAX) return false;
+            DiskEntry e{ ids[i], static_cast<uint32_t>(textSize), static_cast<uint32_t>(text.size()) };
+            std::memcpy(&out[entriesPos + i * sizeof(DiskEntry)], &e, sizeof(e));
+            write(text.data(), text.size());
+            textSize += text.size();
+        }
+
+        // Same temp-and-rename as the ERF TOC cache.
+        namespace fs = std::filesystem;
+        std::string tmpPath = cachePath + ".tmp";
+        bool written;
+        {
+            std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+            f.write(reinterpret_cast<const char*>(out.data()), out.size());
+            f.close();
+            written = f.good();
+        }
+        std::error_code ec;
+        if (written) fs::rename(tmpPath, cachePath, ec);
+        if (!written || ec) {
+            // Don't leave a partial file behind.
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    int loadAllFromPath(const std::string& gamePath, const std::string& cachePath) {
         clear();
         namespace fs = std::filesystem;
-        int fileCount = 0;
         fs::path base(gamePath);
         if (!fs::exists(base)) return 0;
+        std::vector<SourceFile> sources;
         try {
             for (auto& entry : fs::recursive_directory_iterator(base, fs::directory_options::skip_permission_denied)) {
                 if (!entry.is_regular_file()) continue;
                 std::string ext = entry.path().extension().string();
                 std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
                 if (ext != ".tlk") continue;
-                size_t before = s_strings.size();
-                if (loadFromFile(entry.path().string())) {
-                    if (s_strings.size() > before) fileCount++;
-                }
+                SourceFile src;
+                src.path = entry.path().string();
+                std::error_code ec;
+                src.size = entry.file_size(ec);
+                src.mtime = static_cast<int64_t>(entry.last_write_time(ec).time_since_epoch().count());
+                sources.push_back(std::move(src));
             }
         } catch (...) {}
+
+        int fileCount = 0;
+        if (!cachePath.empty() && openDisk(cachePath, sources, fileCount)) {
+            s_loaded = s_diskCount > 0;
+            return fileCount;
+        }
+
+        // Parse on the pool, merge in directory order so overrides land as
+        // they did when the files were loaded one by one.
+        std::vector<TableData> tables(sources.size());
+        std::vector<uint8_t> parsed(sources.size(), 0);
+        Parallel::forRange(sources.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                std::vector<uint8_t> data;
+                parsed[i] = readFile(sources[i].path, data) && parseTable(data, tables[i]);
+            }
+        });
+        for (size_t i = 0; i < sources.size(); i++) {
+            if (!parsed[i]) continue;
+            size_t before = count();
+            merge(std::move(tables[i]));
+            if (count() > before) fileCount++;
+        }
+
+        // The parsed tables serve this session; decoding every string for
+        // the saved copy is left to a thread so the caller isn't held up.
+        if (!cachePath.empty() && count() > 0) {
+            auto snap = std::make_shared<DiskSnapshot>(takeSnapshot(cachePath, sources, fileCount));
+            std::thread([snap]() { writeDisk(*snap); }).detach();
+        }
         return fileCount;
     }
 
     void clear() {
         s_strings.clear();
+        s_lazy.clear();
+        s_sources.clear();
+        closeDisk();
+        std::lock_guard<std::mutex> lock(s_cacheMutex);
+        s_cache.clear();
         s_loaded = false;
     }
 
@@ -982,8 +1626,41 @@ namespace GFF4TLK {
     std::string lookup(uint32_t id) {
         auto it = s_strings.find(id);
         if (it != s_strings.end()) return it->second;
-        return "";
+        auto lazy = s_lazy.find(id);
+        if (lazy == s_lazy.end()) {
+            const DiskEntry* e = s_diskCount ? findOnDisk(id) : nullptr;
+            return e ? std::string(s_diskText + e->offset, e->length) : std::string();
+        }
+
+        std::lock_guard<std::mutex> lock(s_cacheMutex);
+        if (s_cache.empty()) s_cache.resize(size_t(1) << CACHE_BITS);
+        CacheSlot& slot = s_cache[(id * 2654435761u) >> (32 - CACHE_BITS)];
+        if (!slot.used || slot.id != id) {
+            slot.text = s_sources[lazy->second.source]->decode(lazy->second.bitOffset);
+            slot.id = id;
+            slot.used = true;
+        }
+        return slot.text;
+    }
+
+    size_t decodeAll() {
+        size_t decoded = s_lazy.size();
+        s_strings.reserve(s_strings.size() + decoded);
+        for (const auto& [id, lazy] : s_lazy)
+            s_strings[id] = s_sources[lazy.source]->decode(lazy.bitOffset);
+        s_lazy.clear();
+        s_sources.clear();
+        std::lock_guard<std::mutex> lock(s_cacheMutex);
+        s_cache.clear();
+        return decoded;
     }
 
-    size_t count() { return s_strings.size(); }
+    // Tables loaded on top of the saved copy can redefine ids it holds.
+    size_t count() {
+        size_t n = s_diskCount;
+        if (!n) return s_strings.size() + s_lazy.size();
+        for (const auto& kv : s_strings) n += findOnDisk(kv.first) ? 0 : 1;
+        for (const auto& kv : s_lazy) n += findOnDisk(kv.first) ? 0 : 1;
+        return n;
+    }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 #include <fstream>
@@ -10,6 +11,7 @@
 #include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <memory>
 
 enum GFFFieldFlags : uint16_t {
     FLAG_LIST = 0x8000,
@@ -43,6 +45,41 @@ struct GFFStruct {
     uint32_t fieldOffset;
     uint32_t structSize;
     std::vector<GFFField> fields;
+    // Open-addressed label -> field lookup built by parseStructs: each slot
+    // holds a field index + 1 (0 = empty), probed from fieldSlotFor(label).
+    std::vector<uint16_t> fieldSlots;
+    uint32_t slotShift = 32;
+
+    uint32_t fieldSlotFor(uint32_t label) const { return (label * 0x9E3779B1u) >> slotShift; }
+};
+
+// A field resolved once for a struct type. Hot loops over many instances of
+// the same struct resolve each label up front and read through the handle,
+// skipping the per-read lookup. Only valid while the GFFFile stays loaded.
+struct GFFFieldHandle {
+    uint32_t structIndex = 0;
+    uint32_t label = 0;
+    const GFFField* field = nullptr;
+
+    explicit operator bool() const { return field != nullptr; }
+};
+
+// Read-only view of the bytes a GFFFile parses. Converts from a vector, so
+// helpers that take one accept a file's rawData() as well.
+struct GFFBytes {
+    const uint8_t* ptr = nullptr;
+    size_t len = 0;
+
+    GFFBytes() = default;
+    GFFBytes(const uint8_t* p, size_t n) : ptr(p), len(n) {}
+    GFFBytes(const std::vector<uint8_t>& v) : ptr(v.data()), len(v.size()) {}
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const uint8_t& operator[](size_t i) const { return ptr[i]; }
+    const uint8_t* begin() const { return ptr; }
+    const uint8_t* end() const { return ptr + len; }
 };
 
 struct GFFStructRef {
@@ -50,32 +87,79 @@ struct GFFStructRef {
     uint32_t offset;
 };
 
+class GFFCursor;
+
 class GFFFile {
 public:
     GFFFile();
     ~GFFFile();
 
+    // Owning loads: the file keeps its own copy of the bytes. Use these for
+    // anything that edits or saves.
     bool load(const std::string& path);
     bool load(const std::vector<uint8_t>& data);
+    bool load(std::vector<uint8_t>&& data);
+
+    // Borrowed load: parses the caller's bytes in place, without a copy. The
+    // bytes must stay alive and unchanged until close(), another load() or
+    // the GFFFile is destroyed; rawData(), every read and every
+    // GFFFieldHandle point into them. Debug builds check the header bytes on
+    // each read and assert if the buffer has been freed or overwritten.
+    // Writing to a borrowed file first copies it into an owned buffer.
+    bool loadBorrowed(const uint8_t* data, size_t size);
+    bool loadBorrowed(const std::vector<uint8_t>& data) { return loadBorrowed(data.data(), data.size()); }
+    bool loadBorrowed(std::vector<uint8_t>&&) = delete;  // would dangle at the end of the statement
+    // Borrowed, but holds a reference that keeps the bytes alive (e.g. a Blob
+    // from a BlobMap), so there is no lifetime rule to follow.
+    bool loadShared(std::shared_ptr<const std::vector<uint8_t>> data);
     void close();
 
+    bool isBorrowed() const { return m_borrowed != nullptr; }
+
+    // Rewrites a big-endian (X360/PS3) file into little-endian layout in
+    // one pass over its type information, so later reads stop swapping.
+    // Headers, tables, field values, list counts, references and V4.0
+    // ECStrings are converted; byte lists (vertex/index buffers and other
+    // opaque payloads) keep their stored order, so readAt() into one of
+    // those no longer swaps. A borrowed file is copied first. The platform
+    // tag is left as is: the converted bytes aren't a file to save.
+    // No-op on little-endian files.
+    bool normalizeByteOrder();
+    bool isByteOrderNormalized() const { return m_normalized; }
+
     bool isLoaded() const { return m_loaded; }
     bool isMMH() const;
     bool isMSH() const;
 
     const GFFHeader& header() const { return m_header; }
     const std::vector<GFFStruct>& structs() const { return m_structs; }
-    const std::vector<uint8_t>& rawData() const { return m_data; }
-    const std::vector<std::string>& stringCache() const { return m_stringCache; }
+    GFFBytes rawData() const { return GFFBytes(bytes(), byteCount()); }
+    // V4.1 string table, indexed on load; entries are views into the file's
+    // bytes, so nothing is decoded or allocated until a string is used.
+    size_t stringCount() const { return m_stringOffsets.empty() ? 0 : m_stringOffsets.size() - 1; }
+    std::string_view tableString(uint32_t index) const;
+    // The ECString (type 14) a field's address refers to: a string-table
+    // index on V4.1, an offset to inline UTF-16 on V4.0. V4.0 strings are
+    // decoded to UTF-8 on first access and kept, so repeat reads are free.
+    // Views stay valid until the file is closed, reloaded or written to.
+    // The memo makes string reads unsafe to run on one file from several
+    // threads at once.
+    std::string_view ecString(uint32_t address) const;
     bool isV41() const { return m_header.isV41; }
 
     const GFFField* findField(const GFFStruct& st, uint32_t label) const;
     const GFFField* findField(uint32_t structIndex, uint32_t label) const;
+    GFFFieldHandle resolveField(uint32_t structIndex, uint32_t label) const;
 
     static std::string getLabel(uint32_t hash);
     static void initLabelCache();
 
-    std::string getFieldDisplayValue(const GFFField& field) const;
+    std::string getFieldDisplayValue(const GFFField& field, uint32_t baseOffset = 0) const;
+
+    // The top-level struct. Traversals go through GFFCursor (below), which
+    // doesn't allocate; walk() is a convenience dump built on it that
+    // formats every path, label and value as strings.
+    GFFCursor root() const;
 
     using GFF4Visitor = std::function<void(const std::string& path, const std::string& label, const std::string& typeName, const std::string& value, int depth, bool isComplex)>;
     void walk(GFF4Visitor visitor) const;
@@ -89,11 +173,25 @@ public:
     std::vector<GFFStructRef> readStructList(uint32_t structIndex, uint32_t label, uint32_t baseOffset = 0);
     uint32_t getListDataOffset(uint32_t structIndex, uint32_t label, uint32_t baseOffset = 0);
 
+    std::string readString(const GFFFieldHandle& field, uint32_t baseOffset = 0);
+    // readString without building a std::string, for comparing or hashing
+    // names; same lifetime as ecString(). Embedded NULs end a type 10/11
+    // string here, where readString drops them.
+    std::string_view readStringView(const GFFFieldHandle& field, uint32_t baseOffset = 0) const;
+    std::string_view readStringViewByLabel(uint32_t structIndex, uint32_t label, uint32_t baseOffset = 0) const;
+    int32_t readInt32(const GFFFieldHandle& field, uint32_t baseOffset = 0);
+    uint32_t readUInt32(const GFFFieldHandle& field, uint32_t baseOffset = 0);
+    float readFloat(const GFFFieldHandle& field, uint32_t baseOffset = 0);
+    GFFStructRef readStructRef(const GFFFieldHandle& field, uint32_t baseOffset = 0);
+    std::vector<GFFStructRef> readStructList(const GFFFieldHandle& field, uint32_t baseOffset = 0);
+
     std::pair<uint32_t, uint32_t> readPrimitiveListInfo(uint32_t structIndex, uint32_t label, uint32_t baseOffset = 0);
     static uint32_t primitiveTypeSize(uint16_t typeId);
 
     uint32_t dataOffset() const { return m_header.dataOffset; }
-    bool isBigEndian() const { return m_bigEndian; }
+    // Stored by a big-endian platform. Stays true after normalizeByteOrder(),
+    // since byte-list payloads are still in that order.
+    bool isBigEndian() const { return m_bigEndian || m_normalized; }
 
     template<typename T>
     static T bswap(T val) {
@@ -118,15 +216,17 @@ public:
 
     template<typename T>
     T readAt(uint32_t pos) const {
-        if (pos + sizeof(T) > m_data.size()) return T{};
+        if (pos + sizeof(T) > byteCount()) return T{};
         T val;
-        std::memcpy(&val, &m_data[pos], sizeof(T));
+        std::memcpy(&val, bytes() + pos, sizeof(T));
         if (m_bigEndian && sizeof(T) > 1) val = bswap(val);
         return val;
     }
 
     template<typename T>
     void writeAt(uint32_t pos, T val) {
+        makeOwned();
+        m_decoded.clear();
         if (pos + sizeof(T) <= m_data.size()) {
             std::memcpy(&m_data[pos], &val, sizeof(T));
         }
@@ -135,8 +235,8 @@ public:
     bool writeECString(uint32_t fieldDataPos, const std::string& newStr);
 
     bool save(const std::string& path);
-    std::vector<uint8_t>& mutableData() { return m_data; }
-    std::vector<std::string>& mutableStringCache() { return m_stringCache; }
+    // The owned bytes (a borrowed file is copied first).
+    std::vector<uint8_t>& mutableData() { makeOwned(); return m_data; }
 
     float readFloatAt(uint32_t pos) const { return readAt<float>(pos); }
     int32_t readInt32At(uint32_t pos) const { return readAt<int32_t>(pos); }
@@ -146,21 +246,201 @@ public:
     uint8_t readUInt8At(uint32_t pos) const { return readAt<uint8_t>(pos); }
 
 private:
+    bool parse();
     bool parseHeader();
     bool parseStructs();
+    void planByteSwaps(std::vector<uint8_t>& widths) const;
+    static void buildFieldSlots(GFFStruct& st);
 
+    void decodeECString(uint32_t address, std::string& out) const;
     std::string readRawString(size_t offset) const;
     std::string readLocString(size_t offset) const;
-    void walkStruct(uint32_t structIdx, GFF4Visitor visitor, const std::string& basePath, int depth) const;
+
+    const uint8_t* bytes() const {
+#ifndef NDEBUG
+        if (m_borrowed) checkBorrowed();
+#endif
+        return m_borrowed ? m_borrowed : m_data.data();
+    }
+    size_t byteCount() const { return m_borrowed ? m_borrowedSize : m_data.size(); }
+    void makeOwned();
+    void checkBorrowed() const;
 
     GFFHeader m_header;
     std::vector<GFFStruct> m_structs;
     std::vector<uint8_t> m_data;
-    std::vector<std::string> m_stringCache;
+    const uint8_t* m_borrowed = nullptr;
+    size_t m_borrowedSize = 0;
+    std::shared_ptr<const std::vector<uint8_t>> m_shared;
+    // First bytes of a borrowed buffer as loaded; checkBorrowed() compares.
+    static constexpr size_t GUARD_BYTES = 32;
+    uint8_t m_guard[GUARD_BYTES] = {};
+    // Start of each V4.1 string-table entry, plus one past the last NUL.
+    std::vector<uint32_t> m_stringOffsets;
+    // V4.0 ECStrings decoded so far, by address. Cleared on any write.
+    mutable std::unordered_map<uint32_t, std::string> m_decoded;
     bool m_loaded;
+    // Reads swap while this is set; normalizeByteOrder() clears it.
     bool m_bigEndian = false;
+    bool m_normalized = false;
 };
 
+class GFFFieldCursor;
+class GFFListCursor;
+
+// Allocation-free traversal of a loaded GFFFile. A GFFCursor is one struct
+// instance (struct type + offset of its data); its fields are GFFFieldCursors,
+// which read values in place or lead on to a child struct or a list. All
+// three are small values pointing into the file: copy them freely, and stop
+// using them once the file is closed or reloaded (or, for a borrowed load,
+// its bytes go away).
+class GFFCursor {
+public:
+    GFFCursor() = default;
+    GFFCursor(const GFFFile* file, uint32_t structIndex, uint32_t offset)
+        : m_file(file && structIndex < file->structs().size() ? file : nullptr),
+          m_structIndex(structIndex), m_offset(offset) {}
+
+    explicit operator bool() const { return m_file != nullptr; }
+    const GFFFile& file() const { return *m_file; }
+    uint32_t structIndex() const { return m_structIndex; }
+    uint32_t offset() const { return m_offset; }
+    const GFFStruct& type() const { return m_file->structs()[m_structIndex]; }
+
+    uint32_t fieldCount() const { return m_file ? static_cast<uint32_t>(type().fields.size()) : 0; }
+    GFFFieldCursor field(uint32_t index) const;
+    // Invalid cursor when the struct has no such field.
+    GFFFieldCursor find(uint32_t label) const;
+
+    class iterator;
+    iterator begin() const;
+    iterator end() const;
+
+private:
+    const GFFFile* m_file = nullptr;
+    uint32_t m_structIndex = 0;
+    uint32_t m_offset = 0;
+};
+
+class GFFFieldCursor {
+public:
+    GFFFieldCursor() = default;
+    GFFFieldCursor(const GFFFile* file, uint32_t structIndex, const GFFField* field, uint32_t baseOffset)
+        : m_file(file), m_field(field), m_structIndex(structIndex), m_base(baseOffset) {}
+
+    explicit operator bool() const { return m_field != nullptr; }
+    const GFFField& field() const { return *m_field; }
+    uint32_t label() const { return m_field->label; }
+    uint16_t typeId() const { return m_field->typeId; }
+    bool isList() const { return (m_field->flags & FLAG_LIST) != 0; }
+    bool isStruct() const { return (m_field->flags & FLAG_STRUCT) != 0; }
+    bool isReference() const { return (m_field->flags & FLAG_REFERENCE) != 0; }
+    // A list, struct or struct reference rather than a plain value.
+    bool isComplex() const { return isList() || isStruct() || (isReference() && m_field->typeId > 17); }
+    uint32_t baseOffset() const { return m_base; }
+    GFFFieldHandle handle() const { return { m_structIndex, m_field->label, m_field }; }
+
+    // Absolute position of the field's slot in rawData().
+    uint32_t dataPos() const { return m_file->dataOffset() + m_field->dataOffset + m_base; }
+    // Absolute position of the value, following a primitive reference; 0
+    // for a null reference.
+    uint32_t valuePos() const;
+    template<typename T>
+    T read() const { return m_file->readAt<T>(valuePos()); }
+    // String fields (types 10, 11, 14) as a view; see GFFFile::readStringView.
+    std::string_view string() const { return m_file->readStringView(handle(), m_base); }
+
+    // The struct an inline struct, struct reference or generic reference
+    // field leads to; invalid for anything else.
+    GFFCursor child() const;
+    // The field's list; empty when it isn't one.
+    GFFListCursor list() const;
+
+private:
+    const GFFFile* m_file = nullptr;
+    const GFFField* m_field = nullptr;
+    uint32_t m_structIndex = 0;
+    uint32_t m_base = 0;
+};
+
+// A list field's elements, read in place. Struct lists come in three
+// layouts (inline structs, offsets to structs of the field's type, and
+// packed struct-index/offset pairs); at() hides which. Primitive lists
+// read through read<T>(i). The count is clamped to what fits in the file.
+class GFFListCursor {
+public:
+    enum class Kind { None, InlineStructs, StructRefs, GenericRefs, Primitives };
+
+    GFFListCursor() = default;
+    GFFListCursor(const GFFFile* file, Kind kind, uint32_t count, uint32_t start, uint32_t stride, uint32_t structIndex)
+        : m_file(file), m_kind(kind), m_count(count), m_start(start), m_stride(stride), m_structIndex(structIndex) {}
+
+    Kind kind() const { return m_kind; }
+    uint32_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    bool holdsStructs() const { return m_kind != Kind::None && m_kind != Kind::Primitives; }
+    // Absolute position of element i's slot in rawData().
+    uint32_t elementPos(uint32_t i) const { return m_start + i * m_stride; }
+    template<typename T>
+    T read(uint32_t i) const { return m_file->readAt<T>(elementPos(i)); }
+    // Element i of a struct list; invalid for primitive lists.
+    GFFCursor at(uint32_t i) const;
+
+    class iterator;
+    iterator begin() const;
+    iterator end() const;
+
+private:
+    const GFFFile* m_file = nullptr;
+    Kind m_kind = Kind::None;
+    uint32_t m_count = 0;
+    uint32_t m_start = 0;
+    uint32_t m_stride = 0;
+    uint32_t m_structIndex = 0;
+};
+
+class GFFCursor::iterator {
+public:
+    iterator(const GFFCursor* owner, uint32_t index) : m_owner(owner), m_index(index) {}
+    GFFFieldCursor operator*() const { return m_owner->field(m_index); }
+    iterator& operator++() { ++m_index; return *this; }
+    bool operator!=(const iterator& other) const { return m_index != other.m_index; }
+
+private:
+    const GFFCursor* m_owner;
+    uint32_t m_index;
+};
+
+class GFFListCursor::iterator {
+public:
+    iterator(const GFFListCursor* owner, uint32_t index) : m_owner(owner), m_index(index) {}
+    GFFCursor operator*() const { return m_owner->at(m_index); }
+    iterator& operator++() { ++m_index; return *this; }
+    bool operator!=(const iterator& other) const { return m_index != other.m_index; }
+
+private:
+    const GFFListCursor* m_owner;
+    uint32_t m_index;
+};
+
+inline GFFCursor GFFFile::root() const {
+    return GFFCursor(m_loaded ? this : nullptr, 0, 0);
+}
+
+inline GFFFieldCursor GFFCursor::field(uint32_t index) const {
+    return GFFFieldCursor(m_file, m_structIndex, &type().fields[index], m_offset);
+}
+
+inline GFFFieldCursor GFFCursor::find(uint32_t label) const {
+    const GFFField* f = m_file ? m_file->findField(type(), label) : nullptr;
+    return GFFFieldCursor(f ? m_file : nullptr, m_structIndex, f, m_offset);
+}
+
+inline GFFCursor::iterator GFFCursor::begin() const { return iterator(this, 0); }
+inline GFFCursor::iterator GFFCursor::end() const { return iterator(this, fieldCount()); }
+inline GFFListCursor::iterator GFFListCursor::begin() const { return iterator(this, 0); }
+inline GFFListCursor::iterator GFFListCursor::end() const { return iterator(this, holdsStructs() ? m_count : 0); }
+
 namespace GFFFieldID {
     constexpr uint32_t NAME = 2;
     constexpr uint32_t NODE_NAME = 6000;
@@ -216,12 +496,25 @@ namespace VertexUsage {
     constexpr uint32_t COLOR = 10;
 }
 
+// Talk tables. V0.5 (Huffman-compressed) strings are decoded on first
+// lookup and kept in a small fixed-size cache; V0.2 strings are stored as
+// loaded. When several tables define an id, the last one loaded wins.
 namespace GFF4TLK {
+    // Default cache file for loadAllFromPath, alongside the settings.
+    const char* defaultCachePath();
+
     bool loadFromFile(const std::string& path);
     bool loadFromData(const std::vector<uint8_t>& data);
-    int loadAllFromPath(const std::string& gamePath);
+    // Loads every .tlk under gamePath, parsed in parallel and merged in
+    // directory order. The merged table is saved to cachePath (empty: no
+    // cache) on a background thread; while no .tlk has been added, removed,
+    // resized or touched since, later calls only map the saved copy.
+    int loadAllFromPath(const std::string& gamePath, const std::string& cachePath = defaultCachePath());
     void clear();
     bool isLoaded();
     std::string lookup(uint32_t id);
     size_t count();
+    // Decodes every string still compressed (for search or export); later
+    // lookups no longer decode. Returns how many were decoded.
+    size_t decodeAll();
 }
\ No newline at end of file
@@ -6,11 +6,97 @@
 #include <filesystem>
 #include <sstream>
 #include <iomanip>
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #include <zlib.h>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace fs = std::filesystem;
 
+namespace {
+
+// Read-only streambuf over a block of memory, so the header/TOC parsers can
+// keep working on an istream while entry reads go straight to the bytes.
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const uint8_t* data, uint64_t size) {
+        char* p = const_cast<char*>(reinterpret_cast<const char*>(data));
+        setg(p, p, p + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        off_type base = 0;
+        if (dir == std::ios_base::cur) base = gptr() - eback();
+        else if (dir == std::ios_base::end) base = egptr() - eback();
+        return seekpos(pos_type(base + off), which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        off_type p = off_type(pos);
+        if (!(which & std::ios_base::in) || p < 0 || p > egptr() - eback()) return pos_type(off_type(-1));
+        setg(eback(), eback() + p, egptr());
+        return pos;
+    }
+};
+
+// Buffered streambuf over MappedFile::readAt for archives that opened but
+// couldn't be mapped. Only the header/TOC parse goes through it.
+class PositionalStreamBuf : public std::streambuf {
+public:
+    explicit PositionalStreamBuf(const MappedFile& file) : m_file(file), m_bufStart(0) {
+        setg(m_buf, m_buf, m_buf);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        uint64_t pos = m_bufStart + static_cast<uint64_t>(egptr() - eback());
+        if (pos >= m_file.size()) return traits_type::eof();
+        size_t len = static_cast<size_t>(std::min<uint64_t>(sizeof(m_buf), m_file.size() - pos));
+        if (!m_file.readAt(pos, m_buf, len)) return traits_type::eof();
+        m_bufStart = pos;
+        setg(m_buf, m_buf, m_buf + len);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        off_type base = 0;
+        if (dir == std::ios_base::cur) base = static_cast<off_type>(m_bufStart) + (gptr() - eback());
+        else if (dir == std::ios_base::end) base = static_cast<off_type>(m_file.size());
+        return seekpos(pos_type(base + off), which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        off_type p = off_type(pos);
+        if (!(which & std::ios_base::in) || p < 0 || static_cast<uint64_t>(p) > m_file.size()) return pos_type(off_type(-1));
+        uint64_t target = static_cast<uint64_t>(p);
+        if (target >= m_bufStart && target <= m_bufStart + static_cast<uint64_t>(egptr() - eback())) {
+            setg(eback(), eback() + (target - m_bufStart), egptr());
+        } else {
+            m_bufStart = target;
+            setg(m_buf, m_buf, m_buf);
+        }
+        return pos;
+    }
+
+private:
+    const MappedFile& m_file;
+    uint64_t m_bufStart;
+    char m_buf[64 * 1024];
+};
+
+}
+
 template<typename T>
 T readLE(std::istream& s) {
     T val = 0;
@@ -48,7 +134,10 @@ std::string u16ToUtf8(const std::u16string& u16) {
     return result;
 }
 
-ERFFile::ERFFile() : m_isMemory(false), m_version(ERFVersion::Unknown), m_encryption(0), m_compression(0) {}
+static std::atomic<uint64_t> s_nextSerial{1};
+
+ERFFile::ERFFile() : m_data(nullptr), m_size(0), m_isMemory(false), m_version(ERFVersion::Unknown), m_encryption(0), m_compression(0),
+                     m_serial(s_nextSerial++) {}
 
 ERFFile::~ERFFile() {
     close();
@@ -72,11 +161,12 @@ bool ERFFile::open(const std::string& path) {
         return openFromBytes(std::move(data), path);
     }
 
-    auto f = std::make_unique<std::ifstream>(path, std::ios::binary);
-    if (!f->is_open()) return false;
-    m_stream = std::move(f);
-    m_isMemory = false;
     m_path = path;
+    m_isMemory = false;
+    if (!openDiskBackend()) {
+        m_path.clear();
+        return false;
+    }
 
     return parseHeaderAndDispatch();
 }
@@ -84,17 +174,53 @@ bool ERFFile::open(const std::string& path) {
 bool ERFFile::openFromBytes(std::vector<uint8_t> data, const std::string& virtualPath) {
     close();
 
-    auto ss = std::make_unique<std::stringstream>(std::ios::in | std::ios::out | std::ios::binary);
-    ss->write(reinterpret_cast<const char*>(data.data()), data.size());
-    ss->seekg(0);
-    if (!ss->good()) return false;
-    m_stream = std::move(ss);
+    m_bytes = std::move(data);
+    attachMemory(m_bytes.data(), m_bytes.size());
     m_isMemory = true;
     m_path = virtualPath;
 
     return parseHeaderAndDispatch();
 }
 
+bool ERFFile::openPreparsed(const std::string& path, ERFVersion version, std::vector<ERFEntry> entries,
+                            uint32_t encryption, uint32_t compression) {
+    close();
+
+    m_path = path;
+    m_isMemory = false;
+    if (!openDiskBackend()) {
+        m_path.clear();
+        return false;
+    }
+
+    m_version = version;
+    m_entries = std::move(entries);
+    m_encryption = encryption;
+    m_compression = compression;
+    return true;
+}
+
+// Map the archive at m_path. If the file opens but can't be mapped, entries
+// are still served through positional reads, just without zero-copy views.
+bool ERFFile::openDiskBackend() {
+    if (!m_map.open(m_path)) return false;
+
+    if (m_map.isMapped()) {
+        attachMemory(m_map.data(), m_map.size());
+    } else {
+        m_streamBuf = std::make_unique<PositionalStreamBuf>(m_map);
+        m_stream = std::make_unique<std::istream>(m_streamBuf.get());
+    }
+    return true;
+}
+
+void ERFFile::attachMemory(const uint8_t* data, uint64_t size) {
+    m_data = data;
+    m_size = size;
+    m_streamBuf = std::make_unique<MemoryStreamBuf>(data, size);
+    m_stream = std::make_unique<std::istream>(m_streamBuf.get());
+}
+
 bool ERFFile::parseHeaderAndDispatch() {
     char magic[16];
     m_stream->read(magic, 16);
@@ -136,12 +262,19 @@ bool ERFFile::parseHeaderAndDispatch() {
 
 void ERFFile::close() {
     m_stream.reset();
+    m_streamBuf.reset();
+    m_map.close();
+    m_bytes.clear();
+    m_bytes.shrink_to_fit();
+    m_data = nullptr;
+    m_size = 0;
     m_isMemory = false;
     m_entries.clear();
     m_version = ERFVersion::Unknown;
     m_path.clear();
     m_encryption = 0;
     m_compression = 0;
+    m_serial = s_nextSerial++;
 }
 
 bool ERFFile::parseV1() {
@@ -183,7 +316,7 @@ bool ERFFile::parseV1() {
         uint32_t length = readLE<uint32_t>(*m_stream);
 
         m_entries[i].name = keys[i].resref;
-        m_entries[i].name_hash = fnv64(keys[i].resref);
+        m_entries[i].name_hash = fnv64Lower(keys[i].resref);
         m_entries[i].type_hash = keys[i].restype;
         m_entries[i].offset = offset;
         m_entries[i].packed_length = length;
@@ -208,7 +341,7 @@ bool ERFFile::parseV2_0() {
         m_entries[i].offset = readLE<uint32_t>(*m_stream);
         m_entries[i].packed_length = readLE<uint32_t>(*m_stream);
         m_entries[i].length = m_entries[i].packed_length;
-        m_entries[i].name_hash = fnv64(m_entries[i].name);
+        m_entries[i].name_hash = fnv64Lower(m_entries[i].name);
         m_entries[i].type_hash = 0;
         m_entries[i].resid = i;
         m_entries[i].restype = 0;
@@ -236,7 +369,7 @@ bool ERFFile::parseV2_1() {
         m_entries[i].offset = readLE<uint32_t>(*m_stream);
         m_entries[i].packed_length = readLE<uint32_t>(*m_stream);
         m_entries[i].length = readLE<uint32_t>(*m_stream);
-        m_entries[i].name_hash = fnv64(name);
+        m_entries[i].name_hash = fnv64Lower(name);
         m_entries[i].type_hash = 0;
         m_entries[i].resid = i;
         m_entries[i].restype = 0;
@@ -265,7 +398,7 @@ bool ERFFile::parseV2_2() {
         m_entries[i].offset = readLE<uint32_t>(*m_stream);
         m_entries[i].packed_length = readLE<uint32_t>(*m_stream);
         m_entries[i].length = readLE<uint32_t>(*m_stream);
-        m_entries[i].name_hash = fnv64(m_entries[i].name);
+        m_entries[i].name_hash = fnv64Lower(m_entries[i].name);
         m_entries[i].type_hash = 0;
         m_entries[i].resid = i;
         m_entries[i].restype = 0;
@@ -340,185 +473,811 @@ bool ERFFile::parseV3_0() {
     return true;
 }
 
-std::vector<uint8_t> ERFFile::readEntry(const ERFEntry& entry) {
-    if (!isOpen()) return {};
+bool ERFFile::needsDecompression(const ERFEntry& entry) const {
+    return m_version == ERFVersion::V2_1 && entry.packed_length != entry.length && entry.length > 0;
+}
 
-    m_stream->clear();
-    m_stream->seekg(entry.offset);
+ERFEntryView ERFFile::viewEntry(const ERFEntry& entry) const {
+    ERFEntryView view;
+    if (!m_data || needsDecompression(entry)) return view;
+    if (entry.offset > m_size || entry.packed_length > m_size - entry.offset) return view;
+    view.data = m_data + entry.offset;
+    view.size = entry.packed_length;
+    return view;
+}
 
-    std::vector<uint8_t> data(entry.packed_length);
-    m_stream->read(reinterpret_cast<char*>(data.data()), entry.packed_length);
+std::vector<uint8_t> ERFFile::readEntry(const ERFEntry& entry) const {
+    if (!isOpen()) return {};
+
+    std::vector<uint8_t> data;
+    const uint8_t* packed = nullptr;
+    if (m_data) {
+        if (entry.offset > m_size || entry.packed_length > m_size - entry.offset) return {};
+        packed = m_data + entry.offset;
+    } else {
+        data.resize(entry.packed_length);
+        if (!m_map.readAt(entry.offset, data.data(), entry.packed_length)) return {};
+        packed = data.data();
+    }
 
-    if (m_version == ERFVersion::V2_1 && entry.packed_length != entry.length && entry.length > 0) {
+    if (needsDecompression(entry)) {
         std::vector<uint8_t> decompressed(entry.length);
         uLongf destLen = entry.length;
         int ret = uncompress(decompressed.data(), &destLen,
-                             data.data(), static_cast<uLong>(data.size()));
+                             packed, static_cast<uLong>(entry.packed_length));
         if (ret == Z_OK) {
             decompressed.resize(destLen);
             return decompressed;
         }
     }
 
+    if (m_data) data.assign(packed, packed + entry.packed_length);
     return data;
 }
 
-bool ERFFile::extractEntry(const ERFEntry& entry, const std::string& destPath) {
-    std::vector<uint8_t> data = readEntry(entry);
-    if (data.empty() && entry.packed_length > 0) return false;
+bool ERFFile::extractEntry(const ERFEntry& entry, const std::string& destPath) const {
+    ERFEntryView view = viewEntry(entry);
+    std::vector<uint8_t> data;
+    if (!view) {
+        data = readEntry(entry);
+        if (data.empty() && entry.packed_length > 0) return false;
+        view.data = data.data();
+        view.size = data.size();
+    }
 
     std::ofstream out(destPath, std::ios::binary);
     if (!out) return false;
 
-    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+    out.write(reinterpret_cast<const char*>(view.data), view.size);
     return out.good();
 }
 
-bool ERFFile::replaceEntry(size_t entryIndex, const std::vector<uint8_t>& newData) {
-    if (entryIndex >= m_entries.size() || !isOpen()) return false;
-    if (m_isMemory) return false;  // Cannot write back into a memory-backed ERF (e.g. ISO-extracted).
+// Entries closer than this are fetched in the same read; the gap bytes cost
+// less than another seek. Runs are capped so one read stays bounded.
+static const uint64_t BATCH_MAX_GAP = 64 * 1024;
+static const uint64_t BATCH_MAX_RUN = 8 * 1024 * 1024;
 
-    std::vector<std::vector<uint8_t>> allData(m_entries.size());
-    for (size_t i = 0; i < m_entries.size(); i++) {
-        if (i == entryIndex) {
-            allData[i] = newData;
+void ERFFile::readEntries(const std::vector<const ERFEntry*>& entries, const BatchFn& fn) const {
+    if (!isOpen()) {
+        for (size_t i = 0; i < entries.size(); i++) fn(i, ERFEntryView());
+        return;
+    }
+
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return entries[a]->offset < entries[b]->offset;
+    });
+
+    static const uint8_t empty = 0;
+    std::vector<uint8_t> run;
+    std::vector<uint8_t> inflated;
+    auto deliver = [&](size_t index, const uint8_t* packed) {
+        const ERFEntry& entry = *entries[index];
+        ERFEntryView view;
+        view.data = entry.packed_length ? packed : &empty;
+        view.size = entry.packed_length;
+        if (needsDecompression(entry)) {
+            inflated.resize(entry.length);
+            uLongf destLen = entry.length;
+            if (uncompress(inflated.data(), &destLen, packed, static_cast<uLong>(entry.packed_length)) == Z_OK) {
+                view.data = inflated.data();
+                view.size = destLen;
+            }
+        }
+        fn(index, view);
+    };
+
+    size_t k = 0;
+    while (k < order.size()) {
+        uint64_t start = entries[order[k]]->offset;
+        uint64_t end = start + entries[order[k]]->packed_length;
+        size_t last = k + 1;
+        while (last < order.size()) {
+            const ERFEntry& next = *entries[order[last]];
+            uint64_t nextEnd = std::max(end, next.offset + next.packed_length);
+            if (next.offset > end + BATCH_MAX_GAP || nextEnd - start > BATCH_MAX_RUN) break;
+            end = nextEnd;
+            last++;
+        }
+
+        const uint8_t* base = nullptr;
+        if (m_data) {
+            if (end <= m_size) {
+                m_map.prefetch(start, end - start);
+                base = m_data + start;
+            }
         } else {
-            allData[i] = readEntry(m_entries[i]);
+            run.resize(static_cast<size_t>(end - start));
+            if (m_map.readAt(start, run.data(), run.size())) base = run.data();
+        }
+
+        for (; k < last; k++) {
+            size_t index = order[k];
+            if (base) {
+                deliver(index, base + (entries[index]->offset - start));
+                continue;
+            }
+            // The run reaches past the end of the file; go entry by entry.
+            const ERFEntry& entry = *entries[index];
+            bool inFile = entry.offset <= fileSize() && entry.packed_length <= fileSize() - entry.offset;
+            if (m_data && inFile) {
+                deliver(index, m_data + entry.offset);
+            } else if (!m_data && inFile) {
+                run.resize(entry.packed_length);
+                if (m_map.readAt(entry.offset, run.data(), run.size())) deliver(index, run.data());
+                else fn(index, ERFEntryView());
+            } else {
+                fn(index, ERFEntryView());
+            }
         }
     }
+}
 
-    m_stream.reset();
+ERFBatch ERFFile::readEntries(const std::vector<const ERFEntry*>& entries) const {
+    ERFBatch batch;
+    batch.spans.assign(entries.size(), { SIZE_MAX, 0 });
+    size_t total = 0;
+    for (const ERFEntry* entry : entries)
+        total += needsDecompression(*entry) ? entry->length : entry->packed_length;
+    batch.data.reserve(total);
+    readEntries(entries, [&](size_t index, ERFEntryView view) {
+        if (!view) return;
+        batch.spans[index] = { batch.data.size(), view.size };
+        batch.data.insert(batch.data.end(), view.data, view.data + view.size);
+    });
+    return batch;
+}
 
-    std::ofstream out(m_path, std::ios::binary | std::ios::trunc);
-    if (!out) return false;
+bool ERFFile::isWritable() const {
+    if (!isOpen() || m_isMemory) return false;
+    return m_version == ERFVersion::V2_0 || m_version == ERFVersion::V2_2 || m_version == ERFVersion::V3_0;
+}
 
-    auto writeU32 = [&](uint32_t val) { out.write(reinterpret_cast<const char*>(&val), 4); };
-    auto writeU64 = [&](uint64_t val) { out.write(reinterpret_cast<const char*>(&val), 8); };
-    auto writeI32 = [&](int32_t val) { out.write(reinterpret_cast<const char*>(&val), 4); };
-    auto writeU16 = [&](uint16_t val) { out.write(reinterpret_cast<const char*>(&val), 2); };
+uint64_t ERFFile::fileSize() const {
+    return m_isMemory ? m_size : m_map.size();
+}
 
-    uint32_t fileCount = static_cast<uint32_t>(m_entries.size());
+bool ERFFile::readStored(uint64_t offset, void* dst, size_t len) const {
+    if (m_data) {
+        if (offset > m_size || len > m_size - offset) return false;
+        if (len) std::memcpy(dst, m_data + offset, len);
+        return true;
+    }
+    return m_map.readAt(offset, dst, len);
+}
+
+static bool hasStoredName(const ERFEntry& entry) {
+    return !entry.name.empty() && entry.name[0] != '[';
+}
 
+// Where the data starts: header plus TOC for V2.x/V3.0, just the header for
+// V1.x, whose key and resource lists can sit anywhere.
+static uint64_t tocEndFor(ERFVersion version, const std::vector<ERFEntry>& entries) {
+    switch (version) {
+    case ERFVersion::V1_0:
+    case ERFVersion::V1_1: return 160;
+    case ERFVersion::V2_0: return 32 + (uint64_t)entries.size() * 72;
+    case ERFVersion::V2_2: return 56 + (uint64_t)entries.size() * 76;
+    case ERFVersion::V3_0: {
+        uint64_t stSize = 0;
+        for (const auto& e : entries)
+            if (hasStoredName(e)) stSize += e.name.size() + 1;
+        return 48 + stSize + (uint64_t)entries.size() * 28;
+    }
+    default: return 0;
+    }
+}
+
+uint64_t ERFFile::tocEnd(const std::vector<ERFEntry>& entries) const {
+    return tocEndFor(m_version, entries);
+}
+
+// The V3.0 string table may be padded or hold names differently from how
+// appendToc() would write them, so the stored sizes are the ones to trust.
+uint64_t ERFFile::storedTocEnd() const {
+    uint32_t fields[2] = { 0, 0 };
     switch (m_version) {
-    case ERFVersion::V2_0: {
-        char16_t magic16[] = u"ERF V2.0";
-        out.write(reinterpret_cast<const char*>(magic16), 16);
-        writeU32(fileCount);
-        writeU32(0); writeU32(0); writeU32(0xFFFFFFFF);
-
-        uint32_t tocSize = fileCount * 72;
-        uint32_t dataStart = 32 + tocSize;
-        uint32_t currentOffset = dataStart;
-
-        for (size_t i = 0; i < m_entries.size(); i++) {
-            std::u16string name16(32, u'\0');
-            for (size_t c = 0; c < m_entries[i].name.size() && c < 31; c++)
-                name16[c] = static_cast<char16_t>(m_entries[i].name[c]);
-            out.write(reinterpret_cast<const char*>(name16.data()), 64);
-            writeU32(currentOffset);
-            writeU32(static_cast<uint32_t>(allData[i].size()));
-            m_entries[i].offset = currentOffset;
-            m_entries[i].packed_length = static_cast<uint32_t>(allData[i].size());
-            m_entries[i].length = m_entries[i].packed_length;
-            currentOffset += static_cast<uint32_t>(allData[i].size());
+    case ERFVersion::V2_0:
+        if (!readStored(16, fields, 4)) return tocEnd(m_entries);
+        return 32 + (uint64_t)fields[0] * 72;
+    case ERFVersion::V2_2:
+        if (!readStored(16, fields, 4)) return tocEnd(m_entries);
+        return 56 + (uint64_t)fields[0] * 76;
+    case ERFVersion::V3_0:
+        if (!readStored(16, fields, 8)) return tocEnd(m_entries);
+        return 48 + (uint64_t)fields[0] + (uint64_t)fields[1] * 28;
+    default:
+        return tocEnd(m_entries);
+    }
+}
+
+template<typename T>
+static void appendLE(std::vector<uint8_t>& out, T val) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&val);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+template<typename T>
+static void storeLE(std::vector<uint8_t>& out, size_t at, T val) {
+    std::memcpy(&out[at], &val, sizeof(T));
+}
+
+static void appendName16(std::vector<uint8_t>& out, const std::string& name) {
+    for (size_t c = 0; c < 32; c++)
+        appendLE<uint16_t>(out, c < name.size() ? static_cast<uint8_t>(name[c]) : 0);
+}
+
+// Appends the V2.x/V3.0 TOC (and V3.0 string table) for entries to out,
+// which holds the fixed header, and sets the header's counts.
+static bool appendToc(ERFVersion version, const std::vector<ERFEntry>& entries, std::vector<uint8_t>& out) {
+    out.reserve(static_cast<size_t>(tocEndFor(version, entries)));
+    uint32_t fileCount = static_cast<uint32_t>(entries.size());
+
+    switch (version) {
+    case ERFVersion::V2_0:
+        storeLE<uint32_t>(out, 16, fileCount);
+        for (const auto& e : entries) {
+            appendName16(out, e.name);
+            appendLE<uint32_t>(out, static_cast<uint32_t>(e.offset));
+            appendLE<uint32_t>(out, e.packed_length);
         }
+        return true;
+    case ERFVersion::V2_2:
+        storeLE<uint32_t>(out, 16, fileCount);
+        for (const auto& e : entries) {
+            appendName16(out, e.name);
+            appendLE<uint32_t>(out, static_cast<uint32_t>(e.offset));
+            appendLE<uint32_t>(out, e.packed_length);
+            appendLE<uint32_t>(out, e.length);
+        }
+        return true;
+    case ERFVersion::V3_0: {
+        std::vector<int32_t> nameOffsets(entries.size(), -1);
+        size_t stStart = out.size();
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!hasStoredName(entries[i])) continue;
+            nameOffsets[i] = static_cast<int32_t>(out.size() - stStart);
+            out.insert(out.end(), entries[i].name.begin(), entries[i].name.end());
+            out.push_back(0);
+        }
+        storeLE<uint32_t>(out, 16, static_cast<uint32_t>(out.size() - stStart));
+        storeLE<uint32_t>(out, 20, fileCount);
+        for (size_t i = 0; i < entries.size(); i++) {
+            const ERFEntry& e = entries[i];
+            appendLE<int32_t>(out, nameOffsets[i]);
+            appendLE<uint64_t>(out, e.name_hash);
+            appendLE<uint32_t>(out, e.type_hash);
+            appendLE<uint32_t>(out, static_cast<uint32_t>(e.offset));
+            appendLE<uint32_t>(out, e.packed_length);
+            appendLE<uint32_t>(out, e.length);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
 
-        for (size_t i = 0; i < m_entries.size(); i++)
-            out.write(reinterpret_cast<const char*>(allData[i].data()), allData[i].size());
-        break;
+// The header is copied from the open file, so the fields the parser doesn't
+// keep (build date, module id, digest, unused flag bits) survive a patch.
+bool ERFFile::buildHeader(const std::vector<ERFEntry>& entries, std::vector<uint8_t>& out) const {
+    size_t headerSize = m_version == ERFVersion::V2_0 ? 32 : m_version == ERFVersion::V2_2 ? 56 : 48;
+    out.assign(headerSize, 0);
+    if (!readStored(0, out.data(), headerSize)) return false;
+    return appendToc(m_version, entries, out);
+}
+
+// Sorted, merged [begin, end) ranges covering [0, reserved) and every entry.
+static std::vector<std::pair<uint64_t, uint64_t>> usedRanges(const std::vector<ERFEntry>& entries, uint64_t reserved) {
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    ranges.reserve(entries.size() + 1);
+    ranges.push_back({ 0, reserved });
+    for (const auto& e : entries)
+        if (e.packed_length) ranges.push_back({ e.offset, e.offset + e.packed_length });
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<uint64_t, uint64_t>> merged;
+    for (const auto& r : ranges) {
+        if (!merged.empty() && r.first <= merged.back().second)
+            merged.back().second = std::max(merged.back().second, r.second);
+        else
+            merged.push_back(r);
     }
-    case ERFVersion::V2_2: {
-        char16_t magic16[] = u"ERF V2.2";
-        out.write(reinterpret_cast<const char*>(magic16), 16);
-        writeU32(fileCount);
-        writeU32(0); writeU32(0); writeU32(0xFFFFFFFF);
-        uint32_t flags = (static_cast<uint32_t>(m_encryption) << 4) | (static_cast<uint32_t>(m_compression) << 29);
-        writeU32(flags);
-        writeU32(0);
-        char zero16[16] = {};
-        out.write(zero16, 16);
-
-        uint32_t tocSize = fileCount * 76;
-        uint32_t dataStart = 56 + tocSize;
-        uint32_t currentOffset = dataStart;
-
-        for (size_t i = 0; i < m_entries.size(); i++) {
-            std::u16string name16(32, u'\0');
-            for (size_t c = 0; c < m_entries[i].name.size() && c < 31; c++)
-                name16[c] = static_cast<char16_t>(m_entries[i].name[c]);
-            out.write(reinterpret_cast<const char*>(name16.data()), 64);
-            writeU32(currentOffset);
-            writeU32(static_cast<uint32_t>(allData[i].size()));
-            writeU32(static_cast<uint32_t>(allData[i].size()));
-            m_entries[i].offset = currentOffset;
-            m_entries[i].packed_length = static_cast<uint32_t>(allData[i].size());
-            m_entries[i].length = m_entries[i].packed_length;
-            currentOffset += static_cast<uint32_t>(allData[i].size());
+    return merged;
+}
+
+uint64_t ERFFile::deadBytes() const {
+    if (!isWritable()) return 0;
+    uint64_t live = 0;
+    for (const auto& r : usedRanges(m_entries, storedTocEnd())) live += r.second - r.first;
+    uint64_t size = fileSize();
+    return size > live ? size - live : 0;
+}
+
+bool ERFFile::replaceEntry(size_t entryIndex, const std::vector<uint8_t>& newData) {
+    if (entryIndex >= m_entries.size() || !isWritable()) return false;
+
+    std::vector<ERFEntry> entries = m_entries;
+    entries[entryIndex].packed_length = static_cast<uint32_t>(newData.size());
+    entries[entryIndex].length = static_cast<uint32_t>(newData.size());
+    std::vector<PendingWrite> writes(1);
+    writes[0].entry = entryIndex;
+    writes[0].data = newData.data();
+    writes[0].size = newData.size();
+    return commitPatch(std::move(entries), std::move(writes));
+}
+
+static std::string lowered(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s;
+}
+
+bool ERFFile::patchEntries(const std::map<std::string, std::vector<uint8_t>>& upserts,
+                           const std::vector<std::string>& removals) {
+    if (!isWritable()) return false;
+
+    // V3.0 archives may only carry a name's hash, so match on the hash and
+    // confirm against the name where there is one.
+    std::unordered_map<uint64_t, size_t> byHash;
+    byHash.reserve(m_entries.size());
+    for (size_t i = 0; i < m_entries.size(); i++) byHash.emplace(m_entries[i].name_hash, i);
+    auto find = [&](const std::string& name) -> size_t {
+        auto it = byHash.find(fnv64Lower(name));
+        if (it == byHash.end()) return SIZE_MAX;
+        const ERFEntry& e = m_entries[it->second];
+        if (hasStoredName(e) && lowered(e.name) != lowered(name)) return SIZE_MAX;
+        return it->second;
+    };
+
+    std::vector<bool> removed(m_entries.size(), false);
+    for (const auto& name : removals) {
+        size_t i = find(name);
+        if (i != SIZE_MAX) removed[i] = true;
+    }
+
+    std::vector<const std::vector<uint8_t>*> payload(m_entries.size(), nullptr);
+    std::vector<std::pair<const std::string*, const std::vector<uint8_t>*>> added;
+    for (const auto& [name, data] : upserts) {
+        if (name.empty()) return false;
+        if (m_version != ERFVersion::V3_0 && name.size() > 32) return false;
+        size_t i = find(name);
+        if (i == SIZE_MAX) {
+            added.push_back({ &name, &data });
+        } else {
+            payload[i] = &data;
+            removed[i] = false;
         }
+    }
 
-        for (size_t i = 0; i < m_entries.size(); i++)
-            out.write(reinterpret_cast<const char*>(allData[i].data()), allData[i].size());
-        break;
+    std::vector<ERFEntry> entries;
+    std::vector<PendingWrite> writes;
+    entries.reserve(m_entries.size() + added.size());
+    auto queue = [&](const std::vector<uint8_t>& data) {
+        PendingWrite w;
+        w.entry = entries.size() - 1;
+        w.data = data.data();
+        w.size = data.size();
+        writes.push_back(std::move(w));
+        entries.back().packed_length = static_cast<uint32_t>(data.size());
+        entries.back().length = static_cast<uint32_t>(data.size());
+    };
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        if (removed[i]) continue;
+        entries.push_back(m_entries[i]);
+        if (payload[i]) queue(*payload[i]);
     }
-    case ERFVersion::V3_0: {
-        char16_t magic16[] = u"ERF V3.0";
-        out.write(reinterpret_cast<const char*>(magic16), 16);
-
-        std::string stringTable;
-        std::vector<int32_t> nameOffsets(m_entries.size(), -1);
-        for (size_t i = 0; i < m_entries.size(); i++) {
-            if (!m_entries[i].name.empty() && m_entries[i].name[0] != '[') {
-                nameOffsets[i] = static_cast<int32_t>(stringTable.size());
-                stringTable += m_entries[i].name;
-                stringTable += '\0';
+    for (const auto& [name, data] : added) {
+        ERFEntry e;
+        e.name = *name;
+        e.name_hash = fnv64Lower(*name);
+        // V3.0 keys the type on the FNV32 of the lowercased extension.
+        size_t dot = name->rfind('.');
+        e.type_hash = (m_version == ERFVersion::V3_0 && dot != std::string::npos) ? fnv32(lowered(name->substr(dot + 1))) : 0;
+        e.offset = 0;
+        e.resid = 0;
+        e.restype = 0;
+        entries.push_back(e);
+        queue(*data);
+    }
+    for (size_t i = 0; i < entries.size(); i++) entries[i].resid = static_cast<uint32_t>(i);
+    return commitPatch(std::move(entries), std::move(writes));
+}
+
+// Positional writer with a flush that reaches the disk, used to patch an
+// archive in place and to write whole archives through a temp file.
+class DurableFile {
+public:
+    ~DurableFile() { close(); }
+
+    bool open(const std::string& path, bool create) {
+        m_file = std::fopen(path.c_str(), create ? "wb" : "r+b");
+        return m_file != nullptr;
+    }
+
+    bool writeAt(uint64_t offset, const void* data, size_t len) {
+#ifdef _WIN32
+        if (_fseeki64(m_file, static_cast<__int64>(offset), SEEK_SET) != 0) return false;
+#else
+        if (fseeko(m_file, static_cast<off_t>(offset), SEEK_SET) != 0) return false;
+#endif
+        return len == 0 || std::fwrite(data, 1, len, m_file) == len;
+    }
+
+    bool write(const void* data, size_t len) {
+        return len == 0 || std::fwrite(data, 1, len, m_file) == len;
+    }
+
+    bool sync() {
+        if (std::fflush(m_file) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(m_file)) == 0;
+#else
+        return fsync(fileno(m_file)) == 0;
+#endif
+    }
+
+    bool close() {
+        if (!m_file) return true;
+        bool ok = std::fclose(m_file) == 0;
+        m_file = nullptr;
+        return ok;
+    }
+
+private:
+    FILE* m_file = nullptr;
+};
+
+bool ERFFile::commitPatch(std::vector<ERFEntry> entries, std::vector<PendingWrite> writes) {
+    uint64_t oldEnd = storedTocEnd();
+    uint64_t newEnd = tocEnd(entries);
+
+    // Live entries the grown TOC would overwrite move out of its way.
+    std::vector<bool> written(entries.size(), false);
+    for (const auto& w : writes) written[w.entry] = true;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (written[i] || entries[i].packed_length == 0 || entries[i].offset >= newEnd) continue;
+        PendingWrite w;
+        w.entry = i;
+        w.owned.resize(entries[i].packed_length);
+        if (!readStored(entries[i].offset, w.owned.data(), w.owned.size())) return false;
+        w.data = w.owned.data();
+        w.size = w.owned.size();
+        writes.push_back(std::move(w));
+    }
+
+    // Every byte the current header, TOC and entries use stays untouched
+    // until the new TOC is written, so payloads only go into the gaps
+    // between them or past the end of the file.
+    uint64_t size = fileSize();
+    std::vector<std::pair<uint64_t, uint64_t>> gaps;
+    uint64_t cursor = 0;
+    for (const auto& r : usedRanges(m_entries, std::max(oldEnd, newEnd))) {
+        if (r.first > cursor) gaps.push_back({ cursor, r.first - cursor });
+        cursor = std::max(cursor, r.second);
+    }
+    uint64_t end = std::max(size, cursor);
+    if (cursor < size) gaps.push_back({ cursor, size - cursor });
+
+    std::sort(writes.begin(), writes.end(), [](const PendingWrite& a, const PendingWrite& b) { return a.size > b.size; });
+    for (auto& w : writes) {
+        uint64_t offset = end;
+        for (auto& g : gaps) {
+            if (g.second >= w.size) {
+                offset = g.first;
+                g.first += w.size;
+                g.second -= w.size;
+                break;
+            }
+        }
+        if (offset == end) end += w.size;
+        if (offset + w.size > UINT32_MAX) return false;  // offsets are 32-bit on disk
+        entries[w.entry].offset = offset;
+    }
+
+    std::vector<uint8_t> header;
+    if (!buildHeader(entries, header)) return false;
+    std::vector<uint8_t> oldHeader(static_cast<size_t>(oldEnd));
+    if (!readStored(0, oldHeader.data(), oldHeader.size())) return false;
+
+    DurableFile out;
+    if (!out.open(m_path, false)) return false;
+    for (const auto& w : writes)
+        if (!out.writeAt(entries[w.entry].offset, w.data, w.size)) return false;
+    if (!out.sync()) return false;
+
+    // Only the changed runs of the header and TOC are written; replacing one
+    // entry touches a single 8-12 byte record.
+    size_t pos = 0;
+    while (pos < header.size()) {
+        if (pos < oldHeader.size() && header[pos] == oldHeader[pos]) { pos++; continue; }
+        size_t run = pos;
+        while (run < header.size() && (run >= oldHeader.size() || header[run] != oldHeader[run])) run++;
+        if (!out.writeAt(pos, &header[pos], run - pos)) return false;
+        pos = run;
+    }
+    if (!out.sync() || !out.close()) return false;
+
+    // The mapping stops short of anything appended, so map the file again.
+    m_stream.reset();
+    m_streamBuf.reset();
+    m_map.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_entries = std::move(entries);
+    m_serial = s_nextSerial++;
+    return openDiskBackend();
+}
+
+bool ERFFile::compact() {
+    if (!isWritable()) return false;
+
+    std::vector<ERFEntry> entries = m_entries;
+    uint64_t offset = tocEnd(entries);
+    for (auto& e : entries) {
+        e.offset = offset;
+        offset += e.packed_length;
+    }
+    if (offset > UINT32_MAX) return false;
+
+    std::vector<uint8_t> header;
+    if (!buildHeader(entries, header)) return false;
+
+    std::string tmpPath = m_path + ".tmp";
+    {
+        DurableFile out;
+        if (!out.open(tmpPath, true)) return false;
+        bool ok = out.write(header.data(), header.size());
+        std::vector<uint8_t> chunk;
+        for (size_t i = 0; ok && i < m_entries.size(); i++) {
+            const ERFEntry& e = m_entries[i];
+            if (m_data) {
+                ok = e.offset <= m_size && e.packed_length <= m_size - e.offset &&
+                     out.write(m_data + e.offset, e.packed_length);
+                continue;
+            }
+            for (uint64_t done = 0; ok && done < e.packed_length; ) {
+                size_t len = static_cast<size_t>(std::min<uint64_t>(e.packed_length - done, 1 << 20));
+                chunk.resize(len);
+                ok = m_map.readAt(e.offset + done, chunk.data(), len) && out.write(chunk.data(), len);
+                done += len;
             }
         }
-        uint32_t stSize = static_cast<uint32_t>(stringTable.size());
-
-        writeU32(stSize);
-        writeU32(fileCount);
-        uint32_t flags = (static_cast<uint32_t>(m_encryption) << 4) | (static_cast<uint32_t>(m_compression) << 29);
-        writeU32(flags);
-        writeU32(0);
-        char zero16[16] = {};
-        out.write(zero16, 16);
-
-        out.write(stringTable.data(), stSize);
-
-        uint32_t tocSize = fileCount * 28;
-        uint32_t dataStart = 48 + stSize + tocSize;
-        uint32_t currentOffset = dataStart;
-
-        for (size_t i = 0; i < m_entries.size(); i++) {
-            writeI32(nameOffsets[i]);
-            writeU64(m_entries[i].name_hash);
-            writeU32(m_entries[i].type_hash);
-            writeU32(currentOffset);
-            writeU32(static_cast<uint32_t>(allData[i].size()));
-            writeU32(static_cast<uint32_t>(allData[i].size()));
-            m_entries[i].offset = currentOffset;
-            m_entries[i].packed_length = static_cast<uint32_t>(allData[i].size());
-            m_entries[i].length = m_entries[i].packed_length;
-            currentOffset += static_cast<uint32_t>(allData[i].size());
+        ok = ok && out.sync();
+        if (!out.close() || !ok) {
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            return false;
         }
+    }
+
+    // Windows won't replace a file this process still has mapped.
+    m_stream.reset();
+    m_streamBuf.reset();
+    m_map.close();
+    m_data = nullptr;
+    m_size = 0;
+    m_serial = s_nextSerial++;
+
+    std::error_code ec;
+    fs::rename(tmpPath, m_path, ec);
+    if (ec) {
+        fs::remove(tmpPath, ec);
+        openDiskBackend();   // the original archive is untouched
+        return false;
+    }
+    m_entries = std::move(entries);
+    return openDiskBackend();
+}
 
-        for (size_t i = 0; i < m_entries.size(); i++)
-            out.write(reinterpret_cast<const char*>(allData[i].data()), allData[i].size());
+ERFWriter::ERFWriter() {}
+
+ERFWriter::~ERFWriter() {
+    abort();
+}
+
+void ERFWriter::abort() {
+    if (!m_out) return;
+    m_out->close();
+    m_out.reset();
+    std::error_code ec;
+    fs::remove(m_path + ".tmp", ec);
+}
+
+bool ERFWriter::begin(const std::string& path, ERFVersion version, std::vector<ERFEntry> entries) {
+    abort();
+    m_path = path;
+    m_version = version;
+    m_entries = std::move(entries);
+    m_next = 0;
+    m_failed = false;
+
+    size_t nameLimit;
+    switch (version) {
+    case ERFVersion::V1_0: nameLimit = 16; break;
+    case ERFVersion::V1_1:
+    case ERFVersion::V2_0:
+    case ERFVersion::V2_2: nameLimit = 32; break;
+    case ERFVersion::V3_0: nameLimit = SIZE_MAX; break;
+    default: return false;
+    }
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        ERFEntry& e = m_entries[i];
+        if (e.name.empty() || e.name.size() > nameLimit) return false;
+        if (version != ERFVersion::V3_0 || (hasStoredName(e) && e.name_hash == 0))
+            e.name_hash = fnv64Lower(e.name);
+        if (version == ERFVersion::V3_0 && e.type_hash == 0) {
+            size_t dot = e.name.rfind('.');
+            if (hasStoredName(e) && dot != std::string::npos) e.type_hash = fnv32(lowered(e.name.substr(dot + 1)));
+        }
+        e.offset = 0;
+        e.packed_length = 0;
+        e.length = 0;
+        e.resid = static_cast<uint32_t>(i);
+    }
+
+    // Payloads start where the TOC will end; finish() fills in the front.
+    m_cursor = tocEndFor(version, m_entries);
+    m_out = std::make_unique<DurableFile>();
+    if (!m_out->open(m_path + ".tmp", true) || !m_out->writeAt(m_cursor, nullptr, 0)) {
+        abort();
+        return false;
+    }
+    return true;
+}
+
+bool ERFWriter::beginEntry() {
+    return m_out && !m_failed && m_next < m_entries.size();
+}
+
+bool ERFWriter::endEntry(uint64_t size) {
+    if (m_failed || m_cursor + size > UINT32_MAX) {   // offsets are 32-bit on disk
+        m_failed = true;
+        return false;
+    }
+    ERFEntry& e = m_entries[m_next++];
+    e.offset = m_cursor;
+    e.packed_length = static_cast<uint32_t>(size);
+    e.length = static_cast<uint32_t>(size);
+    m_cursor += size;
+    return true;
+}
+
+bool ERFWriter::write(const void* data, size_t size) {
+    if (!beginEntry()) return false;
+    if (m_cursor + size > UINT32_MAX || !m_out->write(data, size)) m_failed = true;
+    return endEntry(size);
+}
+
+bool ERFWriter::write(const Producer& producer) {
+    if (!beginEntry()) return false;
+    m_buffer.resize(1 << 20);
+    uint64_t size = 0;
+    for (;;) {
+        size_t n = std::min(producer(m_buffer.data(), m_buffer.size()), m_buffer.size());
+        if (n == 0) break;
+        if (m_cursor + size + n > UINT32_MAX || !m_out->write(m_buffer.data(), n)) {
+            m_failed = true;
+            break;
+        }
+        size += n;
+    }
+    return endEntry(size);
+}
+
+bool ERFWriter::finish() {
+    if (!m_out || m_failed || m_next != m_entries.size()) {
+        abort();
+        return false;
+    }
+
+    std::vector<uint8_t> header;
+    auto appendMagic16 = [&](const char* magic) {
+        for (int i = 0; i < 8; i++) appendLE<uint16_t>(header, static_cast<uint8_t>(magic[i]));
+    };
+    uint32_t fileCount = static_cast<uint32_t>(m_entries.size());
+
+    switch (m_version) {
+    case ERFVersion::V1_0:
+    case ERFVersion::V1_1: {
+        // V1.x points at its key and resource lists, so they go after the data.
+        size_t nameLen = m_version == ERFVersion::V1_0 ? 16 : 32;
+        uint64_t keyOffset = m_cursor;
+        uint64_t resOffset = keyOffset + (uint64_t)fileCount * (nameLen + 8);
+        if (resOffset + (uint64_t)fileCount * 8 > UINT32_MAX) {
+            abort();
+            return false;
+        }
+        std::vector<uint8_t> lists;
+        for (const auto& e : m_entries) {
+            lists.insert(lists.end(), e.name.begin(), e.name.end());
+            lists.resize(lists.size() + nameLen - e.name.size(), 0);
+            appendLE<uint32_t>(lists, e.resid);
+            appendLE<uint16_t>(lists, e.restype);
+            appendLE<uint16_t>(lists, 0);
+        }
+        for (const auto& e : m_entries) {
+            appendLE<uint32_t>(lists, static_cast<uint32_t>(e.offset));
+            appendLE<uint32_t>(lists, e.packed_length);
+        }
+        if (!m_out->writeAt(keyOffset, lists.data(), lists.size())) {
+            abort();
+            return false;
+        }
+        const char* magic = m_version == ERFVersion::V1_0 ? "ERF V1.0" : "ERF V1.1";
+        header.assign(magic, magic + 8);
+        appendLE<uint32_t>(header, 0);              // language count
+        appendLE<uint32_t>(header, 0);              // language size
+        appendLE<uint32_t>(header, fileCount);
+        appendLE<uint32_t>(header, 160);            // language list
+        appendLE<uint32_t>(header, static_cast<uint32_t>(keyOffset));
+        appendLE<uint32_t>(header, static_cast<uint32_t>(resOffset));
+        appendLE<uint32_t>(header, 0);              // build year
+        appendLE<uint32_t>(header, 0);              // build day
+        appendLE<uint32_t>(header, 0xFFFFFFFF);     // description strref
+        header.resize(160, 0);
         break;
     }
+    case ERFVersion::V2_0:
+        appendMagic16("ERF V2.0");
+        appendLE<uint32_t>(header, fileCount);
+        appendLE<uint32_t>(header, 0); appendLE<uint32_t>(header, 0); appendLE<uint32_t>(header, 0xFFFFFFFF);
+        appendToc(m_version, m_entries, header);
+        break;
+    case ERFVersion::V2_2:
+        appendMagic16("ERF V2.2");
+        appendLE<uint32_t>(header, fileCount);
+        appendLE<uint32_t>(header, 0); appendLE<uint32_t>(header, 0); appendLE<uint32_t>(header, 0xFFFFFFFF);
+        appendLE<uint32_t>(header, 0);              // flags: no encryption or compression
+        appendLE<uint32_t>(header, 0);              // module id
+        header.resize(header.size() + 16, 0);       // digest
+        appendToc(m_version, m_entries, header);
+        break;
+    case ERFVersion::V3_0:
+        appendMagic16("ERF V3.0");
+        appendLE<uint32_t>(header, 0);              // string table size, set by appendToc
+        appendLE<uint32_t>(header, fileCount);
+        appendLE<uint32_t>(header, 0);
+        appendLE<uint32_t>(header, 0);
+        header.resize(header.size() + 16, 0);
+        appendToc(m_version, m_entries, header);
+        break;
     default:
+        abort();
         return false;
     }
 
-    if (!out.good()) return false;
-    out.close();
-
-    auto reopened = std::make_unique<std::ifstream>(m_path, std::ios::binary);
-    if (!reopened->is_open()) return false;
-    m_stream = std::move(reopened);
+    bool ok = m_out->writeAt(0, header.data(), header.size()) && m_out->sync();
+    ok = m_out->close() && ok;
+    m_out.reset();
+    std::string tmpPath = m_path + ".tmp";
+    std::error_code ec;
+    if (ok) fs::rename(tmpPath, m_path, ec);
+    if (!ok || ec) {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
     return true;
 }
 
+static std::mutex s_sharedErfMutex;
+static std::unordered_map<std::string, std::shared_ptr<ERFFile>> s_sharedErfs;
+
+std::shared_ptr<ERFFile> openSharedERF(const std::string& path) {
+    std::lock_guard<std::mutex> lock(s_sharedErfMutex);
+    auto it = s_sharedErfs.find(path);
+    if (it != s_sharedErfs.end()) return it->second;
+
+    auto erf = std::make_shared<ERFFile>();
+    if (!erf->open(path)) return nullptr;
+    s_sharedErfs[path] = erf;
+    return erf;
+}
+
+void releaseSharedERFs() {
+    std::lock_guard<std::mutex> lock(s_sharedErfMutex);
+    s_sharedErfs.clear();
+}
+
 std::vector<std::string> scanForERFFiles(const std::string& rootPath) {
     std::vector<std::string> result;
 
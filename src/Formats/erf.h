@@ -3,11 +3,14 @@
 #include <vector>
 #include <cstdint>
 #include <fstream>
+#include <functional>
+#include <map>
 #include <memory>
+#include "mapped_file.h"
 
 struct ERFEntry {
     std::string name;
-    uint64_t name_hash;
+    uint64_t name_hash;     // fnv64Lower(name); V3.0 keeps the hash stored in the archive
     uint32_t type_hash;
     uint64_t offset;
     uint32_t packed_length;
@@ -16,6 +19,31 @@ struct ERFEntry {
     uint16_t restype;
 };
 
+// Borrowed, read-only view of an entry's stored bytes inside an open ERF.
+// data is nullptr when no view could be provided.
+struct ERFEntryView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    explicit operator bool() const { return data != nullptr; }
+};
+
+// Result of ERFFile::readEntries(): every entry read, in one allocation.
+// spans[i] locates request entry i in data; failed reads have an empty view.
+struct ERFBatch {
+    std::vector<uint8_t> data;
+    std::vector<std::pair<size_t, size_t>> spans;  // offset, size; offset SIZE_MAX on failure
+
+    size_t size() const { return spans.size(); }
+    ERFEntryView operator[](size_t i) const {
+        static const uint8_t empty = 0;
+        ERFEntryView view;
+        if (spans[i].first == SIZE_MAX) return view;
+        view.data = spans[i].second ? data.data() + spans[i].first : &empty;
+        view.size = spans[i].second;
+        return view;
+    }
+};
+
 enum class ERFVersion {
     Unknown,
     V1_0,
@@ -26,6 +54,10 @@ enum class ERFVersion {
     V3_0
 };
 
+// Entry reads (readEntry / viewEntry / extractEntry) are positional and keep
+// no seek cursor, so one open ERFFile can serve any number of threads at
+// once. open(), close(), replaceEntry(), patchEntries() and compact() must
+// not overlap with readers.
 class ERFFile {
 public:
     ERFFile();
@@ -38,23 +70,78 @@ public:
     // replaceEntry() is unsupported on memory-backed ERFs.
     bool openFromBytes(std::vector<uint8_t> data, const std::string& virtualPath);
 
+    // Open an archive whose header and TOC are already known (e.g. from
+    // ERFTocCache), skipping the parse. The caller vouches that the entries
+    // still describe the file on disk.
+    bool openPreparsed(const std::string& path, ERFVersion version, std::vector<ERFEntry> entries,
+                       uint32_t encryption, uint32_t compression);
+
     void close();
     bool isOpen() const { return m_stream != nullptr; }
     bool isMemoryBacked() const { return m_isMemory; }
+    // True when entry bytes are served from memory (a mapped file or an
+    // in-memory ERF) rather than through a file stream.
+    bool isMapped() const { return m_data != nullptr; }
 
     const std::vector<ERFEntry>& entries() const { return m_entries; }
     ERFVersion version() const { return m_version; }
     const std::string& path() const { return m_path; }
     std::string filename() const;
 
-    bool extractEntry(const ERFEntry& entry, const std::string& destPath);
-    std::vector<uint8_t> readEntry(const ERFEntry& entry);
+    bool extractEntry(const ERFEntry& entry, const std::string& destPath) const;
+    std::vector<uint8_t> readEntry(const ERFEntry& entry) const;
+    // Zero-copy access to an entry. Fails for entries that need decompression
+    // (use readEntry) and when the archive isn't mapped. The view is valid
+    // until the ERF is closed, reopened or replaceEntry() rewrites it.
+    ERFEntryView viewEntry(const ERFEntry& entry) const;
+
+    // Reads many entries in one pass over the file. Entries are visited in
+    // offset order and ranges less than 64 KiB apart are merged into single
+    // reads of up to 8 MiB (a prefetch hint on mapped archives), instead of
+    // one seek and read per entry. fn(i, data) gets the index into entries
+    // and the entry's decompressed bytes, valid only for the call; a failed
+    // read gets an empty view.
+    using BatchFn = std::function<void(size_t index, ERFEntryView data)>;
+    void readEntries(const std::vector<const ERFEntry*>& entries, const BatchFn& fn) const;
+    ERFBatch readEntries(const std::vector<const ERFEntry*>& entries) const;
+
+    // In-place patching for V2.0, V2.2 and V3.0 archives (the other versions
+    // are read-only). New payloads go into a gap no live entry uses or onto
+    // the end of the file and are flushed to disk before the header and TOC
+    // are touched, and of those only the bytes that changed are rewritten.
+    // A patch that only replaces payloads rewrites a few TOC records and
+    // leaves the old archive readable if interrupted before then. Adding or
+    // removing entries resizes the TOC, which has to sit right behind the
+    // header, so it is rewritten in place and an interrupted patch of that
+    // kind can leave the archive torn; keep a backup (the importer does).
+    // Replaced payloads turn into dead space; see deadBytes() and
+    // compact(). Payloads are stored uncompressed.
     bool replaceEntry(size_t entryIndex, const std::vector<uint8_t>& newData);
+    // Replaces or adds each named entry (names match case-insensitively) and
+    // drops the removals, as one patch. Entries the grown TOC would cover are
+    // moved out of the way first. Removal names that aren't present are
+    // ignored.
+    bool patchEntries(const std::map<std::string, std::vector<uint8_t>>& upserts,
+                      const std::vector<std::string>& removals = {});
+    // Rewrites the archive without dead space into "<path>.tmp" and renames
+    // it over the original, so a failure at any point leaves one complete
+    // archive on disk. Stored bytes are copied as-is.
+    bool compact();
+    // Bytes of the file no header, TOC or entry refers to.
+    uint64_t deadBytes() const;
+    bool isWritable() const;
 
     uint32_t encryption() const { return m_encryption; }
     uint32_t compression() const { return m_compression; }
 
+    // Changes whenever the archive is closed, reopened or rewritten, so
+    // indexes built over entries() can tell when they have gone stale.
+    uint64_t serial() const { return m_serial; }
+
 private:
+    bool openDiskBackend();
+    void attachMemory(const uint8_t* data, uint64_t size);
+    bool needsDecompression(const ERFEntry& entry) const;
     bool parseHeaderAndDispatch();
     bool parseV1();
     bool parseV2_0();
@@ -62,13 +149,86 @@ private:
     bool parseV2_2();
     bool parseV3_0();
 
+    struct PendingWrite {
+        size_t entry;               // index into the new entry table
+        const uint8_t* data;
+        size_t size;
+        std::vector<uint8_t> owned; // backs data for relocated entries
+    };
+    bool readStored(uint64_t offset, void* dst, size_t len) const;
+    uint64_t fileSize() const;
+    uint64_t tocEnd(const std::vector<ERFEntry>& entries) const;
+    // Where the TOC on disk ends, from the counts in the stored header.
+    uint64_t storedTocEnd() const;
+    bool buildHeader(const std::vector<ERFEntry>& entries, std::vector<uint8_t>& out) const;
+    bool commitPatch(std::vector<ERFEntry> entries, std::vector<PendingWrite> writes);
+
     std::string m_path;
+    MappedFile m_map;
+    std::vector<uint8_t> m_bytes;
+    const uint8_t* m_data;
+    uint64_t m_size;
+    std::unique_ptr<std::streambuf> m_streamBuf;
     std::unique_ptr<std::istream> m_stream;
     bool m_isMemory;
     ERFVersion m_version;
     std::vector<ERFEntry> m_entries;
     uint32_t m_encryption;
     uint32_t m_compression;
+    uint64_t m_serial;
+};
+
+class DurableFile;
+
+// Builds a new archive on disk one entry at a time, so memory stays at the
+// entry table plus one copy buffer however large the payloads get. V2.x and
+// V3.0 keep the TOC in front of the data, so every entry is declared in
+// begin(); payloads then follow in that order, and finish() writes the
+// header and TOC. Everything goes to "<path>.tmp", which is only renamed
+// over path once it is complete.
+//
+// Entries are described like the reader's: name (for V1.x the resref, with
+// restype alongside), and for V3.0 name_hash/type_hash, filled in from the
+// name and extension when left 0. Offsets and lengths are set as payloads
+// are written; nothing is compressed.
+class ERFWriter {
+public:
+    // Fills buffer with up to capacity bytes of the current entry and
+    // returns how many; 0 ends the entry.
+    using Producer = std::function<size_t(uint8_t* buffer, size_t capacity)>;
+
+    ERFWriter();
+    ~ERFWriter();   // an unfinished archive is discarded
+
+    bool begin(const std::string& path, ERFVersion version, std::vector<ERFEntry> entries);
+    bool write(const void* data, size_t size);
+    bool write(const std::vector<uint8_t>& data) { return write(data.data(), data.size()); }
+    bool write(const Producer& producer);
+    bool finish();
+    void abort();
+
+    size_t written() const { return m_next; }
+    const std::vector<ERFEntry>& entries() const { return m_entries; }
+
+private:
+    bool beginEntry();
+    bool endEntry(uint64_t size);
+
+    std::string m_path;
+    ERFVersion m_version = ERFVersion::Unknown;
+    std::vector<ERFEntry> m_entries;
+    std::unique_ptr<DurableFile> m_out;
+    std::vector<uint8_t> m_buffer;
+    size_t m_next = 0;
+    uint64_t m_cursor = 0;
+    bool m_failed = false;
 };
 
+// Process-wide pool of opened archives keyed by path, so lookups that would
+// otherwise re-open and re-parse an ERF each time share one instance across
+// callers and threads. Returns nullptr if the archive can't be opened. Call
+// releaseSharedERFs() before rewriting archives on disk.
+std::shared_ptr<ERFFile> openSharedERF(const std::string& path);
+void releaseSharedERFs();
+
 std::vector<std::string> scanForERFFiles(const std::string& rootPath);
\ No newline at end of file
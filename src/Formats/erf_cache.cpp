@@ -0,0 +1,263 @@
+#include "erf_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace ERFTocCache {
+    static const char CACHE_MAGIC[4] = {'H', 'T', 'O', 'C'};
+    static const uint32_t CACHE_VERSION = 2;
+
+    struct Record {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        ERFVersion version = ERFVersion::Unknown;
+        uint32_t encryption = 0;
+        uint32_t compression = 0;
+        std::vector<ERFEntry> entries;
+        bool touched = false;
+    };
+
+    static std::mutex s_mutex;
+    static std::mutex s_saveMutex;
+    static std::unordered_map<std::string, Record> s_records;
+    static size_t s_hits = 0;
+    static size_t s_misses = 0;
+
+    static bool statFile(const std::string& path, uint64_t& size, int64_t& mtime) {
+        std::error_code ec;
+        size = fs::file_size(path, ec);
+        if (ec) return false;
+        auto t = fs::last_write_time(path, ec);
+        if (ec) return false;
+        mtime = static_cast<int64_t>(t.time_since_epoch().count());
+        return true;
+    }
+
+    class Reader {
+    public:
+        Reader(const std::vector<uint8_t>& data) : m_data(data), m_pos(0), m_ok(true) {}
+
+        template<typename T>
+        T read() {
+            T val{};
+            if (m_pos + sizeof(T) > m_data.size()) { m_ok = false; return val; }
+            std::memcpy(&val, &m_data[m_pos], sizeof(T));
+            m_pos += sizeof(T);
+            return val;
+        }
+
+        std::string readString() {
+            uint32_t len = read<uint32_t>();
+            if (!m_ok || m_pos + len > m_data.size()) { m_ok = false; return {}; }
+            std::string s(reinterpret_cast<const char*>(&m_data[m_pos]), len);
+            m_pos += len;
+            return s;
+        }
+
+        bool ok() const { return m_ok; }
+        size_t remaining() const { return m_data.size() - m_pos; }
+
+    private:
+        const std::vector<uint8_t>& m_data;
+        size_t m_pos;
+        bool m_ok;
+    };
+
+    class Writer {
+    public:
+        template<typename T>
+        void write(T val) {
+            const uint8_t* p = reinterpret_cast<const uint8_t*>(&val);
+            m_data.insert(m_data.end(), p, p + sizeof(T));
+        }
+
+        void writeString(const std::string& s) {
+            write<uint32_t>(static_cast<uint32_t>(s.size()));
+            m_data.insert(m_data.end(), s.begin(), s.end());
+        }
+
+        std::vector<uint8_t>& data() { return m_data; }
+
+    private:
+        std::vector<uint8_t> m_data;
+    };
+
+    const char* defaultPath() {
+        return "haventools_erfcache.bin";
+    }
+
+    bool load(const std::string& cachePath) {
+        std::vector<uint8_t> data;
+        {
+            std::ifstream f(cachePath, std::ios::binary | std::ios::ate);
+            if (!f) return false;
+            size_t size = f.tellg();
+            f.seekg(0);
+            data.resize(size);
+            f.read(reinterpret_cast<char*>(data.data()), size);
+            if (!f) return false;
+        }
+
+        Reader r(data);
+        char magic[4];
+        for (char& c : magic) c = r.read<char>();
+        if (std::memcmp(magic, CACHE_MAGIC, 4) != 0 || r.read<uint32_t>() != CACHE_VERSION) return false;
+
+        // Smallest encodings of a record and of an entry (empty strings), so
+        // counts from a truncated or corrupt file are caught before they
+        // size anything.
+        const uint64_t minRecordSize = 4 + 8 + 8 + 1 + 4 + 4 + 4;
+        const uint64_t minEntrySize = 4 + 8 + 4 + 8 + 4 + 4 + 4 + 2;
+
+        std::unordered_map<std::string, Record> records;
+        uint32_t recordCount = r.read<uint32_t>();
+        if (!r.ok() || recordCount * minRecordSize > r.remaining()) return false;
+        for (uint32_t i = 0; i < recordCount && r.ok(); i++) {
+            std::string path = r.readString();
+            Record rec;
+            rec.size = r.read<uint64_t>();
+            rec.mtime = r.read<int64_t>();
+            rec.version = static_cast<ERFVersion>(r.read<uint8_t>());
+            rec.encryption = r.read<uint32_t>();
+            rec.compression = r.read<uint32_t>();
+            uint32_t entryCount = r.read<uint32_t>();
+            if (!r.ok()) break;
+            if (entryCount * minEntrySize > r.remaining()) return false;
+            rec.entries.resize(entryCount);
+            for (auto& e : rec.entries) {
+                e.name = r.readString();
+                e.name_hash = r.read<uint64_t>();
+                e.type_hash = r.read<uint32_t>();
+                e.offset = r.read<uint64_t>();
+                e.packed_length = r.read<uint32_t>();
+                e.length = r.read<uint32_t>();
+                e.resid = r.read<uint32_t>();
+                e.restype = r.read<uint16_t>();
+                if (!r.ok()) break;
+            }
+            records[path] = std::move(rec);
+        }
+        if (!r.ok()) return false;
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_records = std::move(records);
+        s_hits = 0;
+        s_misses = 0;
+        return true;
+    }
+
+    bool save(const std::string& cachePath) {
+        std::lock_guard<std::mutex> saveLock(s_saveMutex);
+        Writer w;
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            for (char c : CACHE_MAGIC) w.write<char>(c);
+            w.write<uint32_t>(CACHE_VERSION);
+
+            uint32_t recordCount = 0;
+            for (const auto& [path, rec] : s_records)
+                if (rec.touched) recordCount++;
+            w.write<uint32_t>(recordCount);
+
+            for (const auto& [path, rec] : s_records) {
+                if (!rec.touched) continue;
+                w.writeString(path);
+                w.write<uint64_t>(rec.size);
+                w.write<int64_t>(rec.mtime);
+                w.write<uint8_t>(static_cast<uint8_t>(rec.version));
+                w.write<uint32_t>(rec.encryption);
+                w.write<uint32_t>(rec.compression);
+                w.write<uint32_t>(static_cast<uint32_t>(rec.entries.size()));
+                for (const auto& e : rec.entries) {
+                    w.writeString(e.name);
+                    w.write<uint64_t>(e.name_hash);
+                    w.write<uint32_t>(e.type_hash);
+                    w.write<uint64_t>(e.offset);
+                    w.write<uint32_t>(e.packed_length);
+                    w.write<uint32_t>(e.length);
+                    w.write<uint32_t>(e.resid);
+                    w.write<uint16_t>(e.restype);
+                }
+            }
+        }
+
+        // Write beside the old cache and swap it in, so a crash mid-write
+        // never leaves a truncated cache behind.
+        std::string tmpPath = cachePath + ".tmp";
+        {
+            std::ofstream f(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!f) return false;
+            f.write(reinterpret_cast<const char*>(w.data().data()), w.data().size());
+            if (!f.good()) return false;
+        }
+        std::error_code ec;
+        fs::rename(tmpPath, cachePath, ec);
+        if (ec) {
+            fs::remove(tmpPath, ec);
+            return false;
+        }
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_records.clear();
+        s_hits = 0;
+        s_misses = 0;
+    }
+
+    bool open(ERFFile& erf, const std::string& path) {
+        if (path.rfind("iso://", 0) == 0) return erf.open(path);
+
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        if (!statFile(path, size, mtime)) return erf.open(path);
+
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            auto it = s_records.find(path);
+            if (it != s_records.end() && it->second.size == size && it->second.mtime == mtime) {
+                Record& rec = it->second;
+                rec.touched = true;
+                std::vector<ERFEntry> entries = rec.entries;
+                ERFVersion version = rec.version;
+                uint32_t encryption = rec.encryption;
+                uint32_t compression = rec.compression;
+                s_hits++;
+                lock.unlock();
+                return erf.openPreparsed(path, version, std::move(entries), encryption, compression);
+            }
+        }
+
+        if (!erf.open(path)) return false;
+
+        Record rec;
+        rec.size = size;
+        rec.mtime = mtime;
+        rec.version = erf.version();
+        rec.encryption = erf.encryption();
+        rec.compression = erf.compression();
+        rec.entries = erf.entries();
+        rec.touched = true;
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_records[path] = std::move(rec);
+        s_misses++;
+        return true;
+    }
+
+    size_t hits() {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        return s_hits;
+    }
+
+    size_t misses() {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        return s_misses;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include "erf.h"
+
+// Persistent table-of-contents cache for ERF/RIM archives.
+//
+// Every launch used to open and parse the header + TOC of every archive under
+// the install (and buildErfIndex did it again later). The cache records each
+// archive's path, size, mtime, version, flags and full entry table in one
+// binary file next to the settings, so a warm launch is served from a single
+// file read and only archives whose size or mtime changed are re-parsed.
+namespace ERFTocCache {
+    // Default cache file, alongside haventools_settings.ini.
+    const char* defaultPath();
+
+    bool load(const std::string& cachePath);
+    // Writes every archive seen since the last load(); archives that weren't
+    // opened this session (deleted, or no longer under the install) drop out.
+    bool save(const std::string& cachePath);
+    void clear();
+
+    // Open an archive through the cache: on a hit the entry table comes from
+    // the cache and only the file mapping is created, on a miss the archive is
+    // parsed normally and recorded. iso:// paths bypass the cache.
+    bool open(ERFFile& erf, const std::string& path);
+
+    size_t hits();
+    size_t misses();
+}
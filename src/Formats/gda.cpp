@@ -31,7 +31,7 @@ uint32_t GDAFile::hashColumnName(const std::string& name) {
     return crc ^ 0xFFFFFFFF;
 }
 
-const std::map<uint32_t, std::string> GDAFile::s_knownColumns = {
+const std::unordered_map<uint32_t, std::string> GDAFile::s_knownColumns = {
     {hashColumnName("ID"), "ID"},
     {hashColumnName("LABEL"), "LABEL"},
     {hashColumnName("MODELTYPE"), "MODELTYPE"},
@@ -64,12 +64,19 @@ GDAFile::GDAFile() {}
 GDAFile::~GDAFile() {}
 
 int GDAFile::findColumn(const std::string& name) const {
-    std::string lowerName = name;
-    std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(), ::tolower);
+    uint32_t hash = hashColumnName(name);
     for (size_t i = 0; i < m_columns.size(); i++) {
-        std::string colLower = m_columns[i].name;
-        std::transform(colLower.begin(), colLower.end(), colLower.begin(), ::tolower);
-        if (colLower == lowerName) return static_cast<int>(i);
+        if (m_columns[i].hash == hash) return static_cast<int>(i);
+    }
+    // Columns without a known name are listed as COL_<hash>.
+    for (size_t i = 0; i < m_columns.size(); i++) {
+        const std::string& colName = m_columns[i].name;
+        if (colName.size() == name.size() &&
+            std::equal(colName.begin(), colName.end(), name.begin(), [](char a, char b) {
+                return ::tolower(static_cast<unsigned char>(a)) == ::tolower(static_cast<unsigned char>(b));
+            })) {
+            return static_cast<int>(i);
+        }
     }
     return -1;
 }
@@ -79,34 +86,120 @@ bool GDAFile::load(const std::vector<uint8_t>& data, const std::string& name) {
     m_modified = false;
     m_name = name;
     m_columns.clear();
-    m_rows.clear();
+    m_cells.clear();
+    m_rowCount = 0;
+    m_strings.clear();
+    m_stringTable.clear();
+    m_stringCount = 0;
 
     if (!parseGDA(data)) return false;
     m_loaded = true;
     return true;
 }
 
-std::string GDAFile::readString(const std::vector<uint8_t>& data, uint32_t offset) {
-    if (offset == 0xFFFFFFFF || offset >= data.size()) return "****";
+bool GDAFile::isMissing(size_t row, size_t col) const {
+    const auto& missing = m_cells[col].missing;
+    return !missing.empty() && std::binary_search(missing.begin(), missing.end(), static_cast<uint32_t>(row));
+}
+
+GDAValue GDAFile::value(size_t row, size_t col) const {
+    if (isMissing(row, col)) return std::string("****");
+    switch (m_columns[col].type) {
+        case GDAType::String:
+        case GDAType::Resource:
+            return std::string(stringAt(row, col));
+        case GDAType::Float:
+            return floatAt(row, col);
+        case GDAType::Bool:
+            return boolAt(row, col);
+        default:
+            return intAt(row, col);
+    }
+}
 
-    if (offset + 4 > data.size()) return "****";
-    uint32_t len = *reinterpret_cast<const uint32_t*>(&data[offset]);
-    if (len == 0 || len > 10000) return "****";
+GDARow GDAFile::row(size_t index) const {
+    GDARow row;
+    row.values.reserve(m_columns.size());
+    for (size_t c = 0; c < m_columns.size(); c++) row.values.push_back(value(index, c));
+    return row;
+}
+
+size_t GDAFile::memoryUsage() const {
+    size_t bytes = m_columns.capacity() * sizeof(GDAColumn) + m_cells.capacity() * sizeof(GDAColumnData);
+    for (const auto& c : m_cells) {
+        bytes += c.ints.capacity() * sizeof(int32_t) + c.floats.capacity() * sizeof(float) +
+                 c.bools.capacity() + c.strings.capacity() * sizeof(uint32_t) +
+                 c.missing.capacity() * sizeof(uint32_t);
+    }
+    return bytes + m_strings.capacity() + m_stringTable.capacity() * sizeof(uint32_t);
+}
+
+static uint32_t hashString(const char* str) {
+    uint32_t h = 2166136261u;
+    for (; *str; ++str) h = (h ^ static_cast<uint8_t>(*str)) * 16777619u;
+    return h;
+}
+
+uint32_t GDAFile::findString(const char* str) const {
+    if (m_stringTable.empty()) return UINT32_MAX;
+    uint32_t mask = static_cast<uint32_t>(m_stringTable.size() - 1);
+    for (uint32_t pos = hashString(str) & mask;; pos = (pos + 1) & mask) {
+        uint32_t off = m_stringTable[pos];
+        if (off == UINT32_MAX || std::strcmp(&m_strings[off], str) == 0) return off;
+    }
+}
+
+uint32_t GDAFile::internString(const std::string& str) {
+    if (m_stringCount * 2 >= m_stringTable.size()) {
+        m_stringTable.assign(std::max<size_t>(256, m_stringTable.size() * 2), UINT32_MAX);
+        uint32_t mask = static_cast<uint32_t>(m_stringTable.size() - 1);
+        for (size_t off = 0; off < m_strings.size(); off += std::strlen(&m_strings[off]) + 1) {
+            uint32_t pos = hashString(&m_strings[off]) & mask;
+            while (m_stringTable[pos] != UINT32_MAX) pos = (pos + 1) & mask;
+            m_stringTable[pos] = static_cast<uint32_t>(off);
+        }
+    }
+    uint32_t mask = static_cast<uint32_t>(m_stringTable.size() - 1);
+    for (uint32_t pos = hashString(str.c_str()) & mask;; pos = (pos + 1) & mask) {
+        uint32_t off = m_stringTable[pos];
+        if (off == UINT32_MAX) {
+            off = static_cast<uint32_t>(m_strings.size());
+            m_strings.insert(m_strings.end(), str.c_str(), str.c_str() + str.size() + 1);
+            m_stringTable[pos] = off;
+            m_stringCount++;
+            return off;
+        }
+        if (std::strcmp(&m_strings[off], str.c_str()) == 0) return off;
+    }
+}
+
+void GDAFile::readString(const std::vector<uint8_t>& data, uint32_t offset, std::string& result) {
+    result.clear();
+    if (offset == 0xFFFFFFFF || offset >= data.size() || offset + 4 > data.size()) {
+        result = "****";
+        return;
+    }
+    uint32_t len;
+    std::memcpy(&len, &data[offset], sizeof(len));
+    if (len == 0 || len > 10000) {
+        result = "****";
+        return;
+    }
 
     offset += 4;
-    std::string result;
     for (uint32_t i = 0; i < len && offset + i * 2 + 1 < data.size(); i++) {
-        uint16_t wc = *reinterpret_cast<const uint16_t*>(&data[offset + i * 2]);
+        uint16_t wc;
+        std::memcpy(&wc, &data[offset + i * 2], sizeof(wc));
         if (wc == 0) break;
         if (wc < 128) result += static_cast<char>(wc);
         else result += '?';
     }
-    return result.empty() ? "****" : result;
+    if (result.empty()) result = "****";
 }
 
 bool GDAFile::parseGDA(const std::vector<uint8_t>& data) {
     GFFFile gff;
-    if (!gff.load(data)) return false;
+    if (!gff.loadBorrowed(data)) return false;
 
     const auto& structs = gff.structs();
     if (structs.size() < 3) return false;
@@ -190,16 +283,27 @@ bool GDAFile::parseGDA(const std::vector<uint8_t>& data) {
         m_columns.push_back(col);
     }
 
-    for (uint32_t r = 0; r < rowCount; r++) {
-        GDARow row;
-        uint32_t rowOff = rowDataStart + r * rowSize;
+    // Filled a column at a time so each typed array is written front to back.
+    m_rowCount = rowCount;
+    m_cells.resize(colInfos.size());
+    std::string str;
+    uint32_t none = internString("****");
+    for (size_t c = 0; c < colInfos.size(); c++) {
+        const auto& ci = colInfos[c];
+        GDAColumnData& cells = m_cells[c];
+        switch (m_columns[c].type) {
+            case GDAType::String:
+            case GDAType::Resource: cells.strings.resize(rowCount, none); break;
+            case GDAType::Float: cells.floats.resize(rowCount); break;
+            case GDAType::Bool: cells.bools.resize(rowCount); break;
+            default: cells.ints.resize(rowCount); break;
+        }
 
-        for (size_t c = 0; c < colInfos.size(); c++) {
-            const auto& ci = colInfos[c];
-            uint32_t valOff = rowOff + ci.offset;
+        for (uint32_t r = 0; r < rowCount; r++) {
+            uint32_t valOff = rowDataStart + r * rowSize + ci.offset;
 
             if (valOff + 4 > data.size()) {
-                row.values.push_back(std::string("****"));
+                cells.missing.push_back(r);
                 continue;
             }
 
@@ -208,53 +312,48 @@ bool GDAFile::parseGDA(const std::vector<uint8_t>& data) {
                 case 4:
                 {
                     int32_t strOff = gff.readInt32At(valOff);
-                    if (strOff < 0 || strOff == (int32_t)0xFFFFFFFF) {
-                        row.values.push_back(std::string("****"));
-                    } else {
-                        std::string str = readString(data, dataOffset + strOff);
-                        row.values.push_back(str);
+                    if (strOff >= 0) {
+                        readString(data, dataOffset + strOff, str);
+                        cells.strings[r] = internString(str);
                     }
                     break;
                 }
                 case 1:
                 {
                     switch (ci.gffTypeId) {
-                        case 0: row.values.push_back(static_cast<int32_t>(gff.readUInt8At(valOff))); break;
-                        case 1: row.values.push_back(static_cast<int32_t>(gff.readAt<int8_t>(valOff))); break;
-                        case 2: row.values.push_back(static_cast<int32_t>(gff.readUInt16At(valOff))); break;
-                        case 3: row.values.push_back(static_cast<int32_t>(gff.readInt16At(valOff))); break;
-                        case 4: row.values.push_back(static_cast<int32_t>(gff.readUInt32At(valOff))); break;
-                        case 5: row.values.push_back(gff.readInt32At(valOff)); break;
-                        default: row.values.push_back(gff.readInt32At(valOff)); break;
+                        case 0: cells.ints[r] = static_cast<int32_t>(gff.readUInt8At(valOff)); break;
+                        case 1: cells.ints[r] = static_cast<int32_t>(gff.readAt<int8_t>(valOff)); break;
+                        case 2: cells.ints[r] = static_cast<int32_t>(gff.readUInt16At(valOff)); break;
+                        case 3: cells.ints[r] = static_cast<int32_t>(gff.readInt16At(valOff)); break;
+                        case 4: cells.ints[r] = static_cast<int32_t>(gff.readUInt32At(valOff)); break;
+                        default: cells.ints[r] = gff.readInt32At(valOff); break;
                     }
                     break;
                 }
                 case 2:
                 {
                     if (ci.gffTypeId == 9) {
-                        row.values.push_back(static_cast<float>(gff.readAt<double>(valOff)));
+                        cells.floats[r] = static_cast<float>(gff.readAt<double>(valOff));
                     } else {
-                        row.values.push_back(gff.readFloatAt(valOff));
+                        cells.floats[r] = gff.readFloatAt(valOff);
                     }
                     break;
                 }
                 case 3:
                 {
                     if (ci.gffTypeId == 0) {
-                        row.values.push_back(gff.readUInt8At(valOff) != 0);
+                        cells.bools[r] = gff.readUInt8At(valOff) != 0;
                     } else {
-                        row.values.push_back(gff.readInt32At(valOff) != 0);
+                        cells.bools[r] = gff.readInt32At(valOff) != 0;
                     }
                     break;
                 }
                 default:
-                    row.values.push_back(gff.readInt32At(valOff));
+                    cells.ints[r] = gff.readInt32At(valOff);
                     break;
             }
         }
-
-        m_rows.push_back(row);
     }
 
     return true;
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <cstdint>
 #include <variant>
 #include <filesystem>
@@ -28,6 +29,18 @@ struct GDARow {
     std::vector<GDAValue> values;
 };
 
+// One column's cells, stored as the column's type: ints for Int, floats
+// for Float, bools for Bool, and pool offsets for String and Resource.
+// Cells that lay past the end of the file are listed in missing and read
+// back as "****".
+struct GDAColumnData {
+    std::vector<int32_t> ints;
+    std::vector<float> floats;
+    std::vector<uint8_t> bools;
+    std::vector<uint32_t> strings;
+    std::vector<uint32_t> missing;
+};
+
 class GDAFile {
 public:
     GDAFile();
@@ -36,8 +49,27 @@ public:
     bool load(const std::vector<uint8_t>& data, const std::string& name = "");
 
     const std::vector<GDAColumn>& columns() const { return m_columns; }
-    const std::vector<GDARow>& rows() const { return m_rows; }
-    std::vector<GDARow>& rows() { return m_rows; }
+    size_t rowCount() const { return m_rowCount; }
+
+    // Whole-column access for scans; see GDAColumnData.
+    const GDAColumnData& cells(size_t col) const { return m_cells[col]; }
+    const char* poolString(uint32_t offset) const { return m_strings.data() + offset; }
+    // Pool offset of a cell string, or UINT32_MAX when no cell holds it.
+    uint32_t findString(const char* str) const;
+
+    // Single cells. Each typed accessor expects a column of that type.
+    int32_t intAt(size_t row, size_t col) const { return m_cells[col].ints[row]; }
+    float floatAt(size_t row, size_t col) const { return m_cells[col].floats[row]; }
+    bool boolAt(size_t row, size_t col) const { return m_cells[col].bools[row] != 0; }
+    const char* stringAt(size_t row, size_t col) const { return poolString(m_cells[col].strings[row]); }
+    bool isMissing(size_t row, size_t col) const;
+
+    // Rebuilds cells in the variant form the row layout used to hold.
+    GDAValue value(size_t row, size_t col) const;
+    GDARow row(size_t index) const;
+
+    // Bytes held by the column arrays and the string pool.
+    size_t memoryUsage() const;
 
     bool isLoaded() const { return m_loaded; }
     bool isModified() const { return m_modified; }
@@ -51,13 +83,20 @@ public:
 
 private:
     bool parseGDA(const std::vector<uint8_t>& data);
-    std::string readString(const std::vector<uint8_t>& data, uint32_t offset);
+    void readString(const std::vector<uint8_t>& data, uint32_t offset, std::string& out);
+    uint32_t internString(const std::string& str);
 
     std::vector<GDAColumn> m_columns;
-    std::vector<GDARow> m_rows;
+    std::vector<GDAColumnData> m_cells;
+    size_t m_rowCount = 0;
+    // Distinct cell strings, NUL-terminated, with an open-addressed table
+    // of their offsets.
+    std::vector<char> m_strings;
+    std::vector<uint32_t> m_stringTable;
+    size_t m_stringCount = 0;
     std::string m_name;
     bool m_loaded = false;
     bool m_modified = false;
 
-    static const std::map<uint32_t, std::string> s_knownColumns;
+    static const std::unordered_map<uint32_t, std::string> s_knownColumns;
 };
\ No newline at end of file
@@ -0,0 +1,564 @@
+#include "gda_query.h"
+#include "erf.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Index keys: ints and bools as their value with the sign bit flipped and
+// floats with their bits arranged so that key order is numeric order;
+// strings as pool offsets, which only support equality.
+static uint64_t intKey(int64_t v) {
+    return static_cast<uint64_t>(v) ^ (1ull << 63);
+}
+
+static uint64_t floatKey(float f) {
+    if (f == 0.0f) f = 0.0f;
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static double keyNumber(GDAType type, uint64_t key) {
+    if (type != GDAType::Float) return static_cast<double>(static_cast<int64_t>(key ^ (1ull << 63)));
+    uint32_t bits = static_cast<uint32_t>(key);
+    bits = (bits & 0x80000000u) ? (bits & 0x7FFFFFFFu) : ~bits;
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static bool isStringType(GDAType type) {
+    return type == GDAType::String || type == GDAType::Resource;
+}
+
+static bool cellKey(const GDAFile& gda, size_t col, uint32_t row, uint64_t& key) {
+    if (gda.isMissing(row, col)) return false;
+    switch (gda.columns()[col].type) {
+        case GDAType::String:
+        case GDAType::Resource: key = gda.cells(col).strings[row]; break;
+        case GDAType::Float: key = floatKey(gda.floatAt(row, col)); break;
+        case GDAType::Bool: key = intKey(gda.boolAt(row, col)); break;
+        default: key = intKey(gda.intAt(row, col)); break;
+    }
+    return true;
+}
+
+// False when no cell of the column can equal value.
+static bool valueKey(const GDAFile& gda, size_t col, const GDAValue& value, uint64_t& key) {
+    GDAType type = gda.columns()[col].type;
+    if (isStringType(type)) {
+        const std::string* str = std::get_if<std::string>(&value);
+        if (!str) return false;
+        uint32_t offset = gda.findString(str->c_str());
+        if (offset == UINT32_MAX) return false;
+        key = offset;
+        return true;
+    }
+
+    double number;
+    if (const int32_t* i = std::get_if<int32_t>(&value)) number = *i;
+    else if (const float* f = std::get_if<float>(&value)) number = *f;
+    else if (const bool* b = std::get_if<bool>(&value)) number = *b;
+    else return false;
+    if (std::isnan(number)) return false;
+
+    if (type == GDAType::Float) {
+        key = floatKey(static_cast<float>(number));
+        return true;
+    }
+    if (number != std::floor(number) || number < INT32_MIN || number > INT32_MAX) return false;
+    if (type == GDAType::Bool && number != 0 && number != 1) return false;
+    key = intKey(static_cast<int64_t>(number));
+    return true;
+}
+
+static unsigned countTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+static uint32_t bucketHash(uint64_t key) {
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+namespace {
+    // A filter bound to one table's column, comparing against the typed
+    // cell arrays directly.
+    struct Matcher {
+        size_t column = 0;
+        GDAType type = GDAType::Int;
+        const GDAColumnData* cells = nullptr;
+        bool isRange = false;
+        bool possible = false;
+        int32_t intValue = 0;
+        float floatValue = 0;
+        uint32_t stringValue = 0;
+        double low = 0;
+        double high = 0;
+
+        Matcher(const GDAFile& gda, int col, const GDAFilter& filter) : isRange(filter.isRange), low(filter.low), high(filter.high) {
+            if (col < 0 || static_cast<size_t>(col) >= gda.columns().size()) return;
+            column = static_cast<size_t>(col);
+            type = gda.columns()[column].type;
+            cells = &gda.cells(column);
+            if (isRange) {
+                possible = low <= high;
+                return;
+            }
+            uint64_t key;
+            possible = valueKey(gda, column, filter.value, key);
+            if (!possible) return;
+            if (isStringType(type)) stringValue = static_cast<uint32_t>(key);
+            else if (type == GDAType::Float) floatValue = static_cast<float>(keyNumber(type, key));
+            else intValue = static_cast<int32_t>(keyNumber(type, key));
+        }
+
+        bool test(const GDAFile& gda, uint32_t row) const {
+            if (!cells->missing.empty() && gda.isMissing(row, column)) return false;
+            if (isRange) {
+                double number;
+                switch (type) {
+                    case GDAType::String:
+                    case GDAType::Resource: return false;
+                    case GDAType::Float: number = cells->floats[row]; break;
+                    case GDAType::Bool: number = cells->bools[row] != 0; break;
+                    default: number = cells->ints[row]; break;
+                }
+                return number >= low && number <= high;
+            }
+            switch (type) {
+                case GDAType::String:
+                case GDAType::Resource: return cells->strings[row] == stringValue;
+                case GDAType::Float: return cells->floats[row] == floatValue;
+                case GDAType::Bool: return (cells->bools[row] != 0) == (intValue != 0);
+                default: return cells->ints[row] == intValue;
+            }
+        }
+
+        // Every matching row of the table, ascending: one typed pass over
+        // the column instead of test() per row.
+        void collect(const GDAFile& gda, std::vector<uint32_t>& rows) const {
+            uint32_t count = static_cast<uint32_t>(gda.rowCount());
+            auto keep = [&](auto pred) {
+                for (uint32_t r = 0; r < count; r++) {
+                    if (pred(r)) rows.push_back(r);
+                }
+            };
+            const int32_t* ints = cells->ints.data();
+            const float* floats = cells->floats.data();
+            const uint8_t* bools = cells->bools.data();
+            const uint32_t* strings = cells->strings.data();
+            double lo = low, hi = high;
+            if (isStringType(type)) {
+                if (!isRange) keep([&](uint32_t r) { return strings[r] == stringValue; });
+            } else if (type == GDAType::Float) {
+                if (isRange) keep([&](uint32_t r) { return floats[r] >= lo && floats[r] <= hi; });
+                else keep([&](uint32_t r) { return floats[r] == floatValue; });
+            } else if (type == GDAType::Bool) {
+                if (isRange) keep([&](uint32_t r) { return bools[r] >= lo && bools[r] <= hi; });
+                else keep([&](uint32_t r) { return (bools[r] != 0) == (intValue != 0); });
+            } else {
+                if (isRange) keep([&](uint32_t r) { return ints[r] >= lo && ints[r] <= hi; });
+                else keep([&](uint32_t r) { return ints[r] == intValue; });
+            }
+            if (!cells->missing.empty()) {
+                rows.erase(std::remove_if(rows.begin(), rows.end(), [&](uint32_t r) { return gda.isMissing(r, column); }),
+                           rows.end());
+            }
+        }
+    };
+}  // namespace
+
+GDAFilter GDAFilter::equal(size_t column, GDAValue value) {
+    GDAFilter f;
+    f.column = column;
+    f.value = std::move(value);
+    return f;
+}
+
+GDAFilter GDAFilter::range(size_t column, double low, double high) {
+    GDAFilter f;
+    f.column = column;
+    f.isRange = true;
+    f.low = low;
+    f.high = high;
+    return f;
+}
+
+bool GDAIndex::build(const GDAFile& gda, size_t column) {
+    m_gda = &gda;
+    m_column = column;
+    m_keys.clear();
+    m_rows.clear();
+    m_buckets.clear();
+    if (column >= gda.columns().size()) return false;
+
+    bool isFloat = gda.columns()[column].type == GDAType::Float;
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    entries.reserve(gda.rowCount());
+    for (uint32_t r = 0; r < gda.rowCount(); r++) {
+        uint64_t key;
+        if (!cellKey(gda, column, r, key)) continue;
+        // NaN equals nothing and has no place in the value order.
+        if (isFloat && std::isnan(gda.floatAt(r, column))) continue;
+        entries.emplace_back(key, r);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    m_keys.reserve(entries.size());
+    m_rows.reserve(entries.size());
+    size_t distinct = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (i == 0 || entries[i].first != entries[i - 1].first) distinct++;
+        m_keys.push_back(entries[i].first);
+        m_rows.push_back(entries[i].second);
+    }
+
+    size_t bucketCount = 16;
+    while (bucketCount < distinct * 2) bucketCount *= 2;
+    m_buckets.assign(bucketCount, Bucket{0, 0, 0});
+    uint32_t mask = static_cast<uint32_t>(bucketCount - 1);
+    for (size_t begin = 0; begin < m_keys.size();) {
+        size_t end = begin + 1;
+        while (end < m_keys.size() && m_keys[end] == m_keys[begin]) end++;
+        uint32_t pos = bucketHash(m_keys[begin]) & mask;
+        while (m_buckets[pos].end != 0) pos = (pos + 1) & mask;
+        m_buckets[pos] = Bucket{m_keys[begin], static_cast<uint32_t>(begin), static_cast<uint32_t>(end)};
+        begin = end;
+    }
+    return true;
+}
+
+GDARowSpan GDAIndex::equal(const GDAValue& value) const {
+    uint64_t key;
+    if (m_buckets.empty() || !valueKey(*m_gda, m_column, value, key)) return {};
+    uint32_t mask = static_cast<uint32_t>(m_buckets.size() - 1);
+    for (uint32_t pos = bucketHash(key) & mask; m_buckets[pos].end != 0; pos = (pos + 1) & mask) {
+        const Bucket& b = m_buckets[pos];
+        if (b.key == key) return GDARowSpan{m_rows.data() + b.begin, b.end - b.begin};
+    }
+    return {};
+}
+
+GDARowSpan GDAIndex::range(double low, double high) const {
+    if (!m_gda || !(low <= high)) return {};
+    GDAType type = m_gda->columns()[m_column].type;
+    if (isStringType(type)) return {};
+    auto first = std::lower_bound(m_keys.begin(), m_keys.end(), low, [&](uint64_t key, double bound) {
+        return keyNumber(type, key) < bound;
+    });
+    auto last = std::upper_bound(first, m_keys.end(), high, [&](double bound, uint64_t key) {
+        return bound < keyNumber(type, key);
+    });
+    return GDARowSpan{m_rows.data() + (first - m_keys.begin()), static_cast<size_t>(last - first)};
+}
+
+GDAQuery::GDAQuery(const GDAFile& gda) : m_gda(gda) {
+    m_indexes.resize(gda.columns().size());
+    int id = gda.findColumn("ID");
+    if (id >= 0 && gda.columns()[id].type == GDAType::Int) {
+        m_idColumn = id;
+        addIndex(static_cast<size_t>(id));
+    }
+}
+
+int GDAQuery::findId(int32_t id) const {
+    const GDAIndex* idx = m_idColumn >= 0 ? index(static_cast<size_t>(m_idColumn)) : nullptr;
+    if (!idx) return -1;
+    GDARowSpan rows = idx->equal(id);
+    return rows.empty() ? -1 : static_cast<int>(rows.first[rows.count - 1]);
+}
+
+const GDAIndex& GDAQuery::addIndex(size_t column) {
+    if (column >= m_indexes.size()) m_indexes.resize(column + 1);
+    if (!m_indexes[column]) {
+        m_indexes[column] = std::make_unique<GDAIndex>();
+        m_indexes[column]->build(m_gda, column);
+    }
+    return *m_indexes[column];
+}
+
+const GDAIndex* GDAQuery::index(size_t column) const {
+    return column < m_indexes.size() ? m_indexes[column].get() : nullptr;
+}
+
+std::vector<uint32_t> GDAQuery::select(const std::vector<GDAFilter>& filters) const {
+    std::vector<uint32_t> rows;
+    std::vector<Matcher> matchers;
+    matchers.reserve(filters.size());
+    for (const auto& f : filters) {
+        matchers.emplace_back(m_gda, static_cast<int>(f.column), f);
+        if (!matchers.back().possible) return rows;
+    }
+
+    // Start from the smallest indexed result, if any filter has an index.
+    size_t driver = filters.size();
+    GDARowSpan span;
+    for (size_t i = 0; i < filters.size(); i++) {
+        const GDAIndex* idx = index(filters[i].column);
+        if (!idx) continue;
+        GDARowSpan s = filters[i].isRange ? idx->range(filters[i].low, filters[i].high) : idx->equal(filters[i].value);
+        if (driver == filters.size() || s.size() < span.size()) {
+            driver = i;
+            span = s;
+        }
+    }
+
+    auto passes = [&](uint32_t row) {
+        for (size_t i = 0; i < matchers.size(); i++) {
+            if (i != driver && !matchers[i].test(m_gda, row)) return false;
+        }
+        return true;
+    };
+
+    if (driver < filters.size() && filters[driver].isRange && span.size() > m_gda.rowCount() / 64) {
+        // A wide range comes back in value order; marking the rows and
+        // sweeping the marks puts them in row order without a sort.
+        std::vector<uint64_t> marks((m_gda.rowCount() + 63) / 64);
+        for (uint32_t row : span) marks[row >> 6] |= 1ull << (row & 63);
+        for (size_t w = 0; w < marks.size(); w++) {
+            for (uint64_t bits = marks[w]; bits; bits &= bits - 1) {
+                uint32_t row = static_cast<uint32_t>(w * 64 + countTrailingZeros(bits));
+                if (passes(row)) rows.push_back(row);
+            }
+        }
+    } else if (driver < filters.size()) {
+        for (uint32_t row : span) {
+            if (passes(row)) rows.push_back(row);
+        }
+        if (filters[driver].isRange) std::sort(rows.begin(), rows.end());
+    } else if (!matchers.empty()) {
+        driver = 0;
+        matchers[0].collect(m_gda, rows);
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [&](uint32_t row) { return !passes(row); }), rows.end());
+    } else {
+        rows.resize(m_gda.rowCount());
+        for (uint32_t row = 0; row < rows.size(); row++) rows[row] = row;
+    }
+    return rows;
+}
+
+// String and Resource cells are both read back as strings.
+static bool sameStorage(GDAType a, GDAType b) {
+    auto isText = [](GDAType t) { return t == GDAType::String || t == GDAType::Resource; };
+    return a == b || (isText(a) && isText(b));
+}
+
+bool GDAMergedView::build(std::vector<std::shared_ptr<const GDAFile>> sources) {
+    m_sources.clear();
+    m_columns.clear();
+    m_columnMap.clear();
+    m_rows.clear();
+    if (sources.empty()) return false;
+
+    std::vector<int> idColumns;
+    for (const auto& src : sources) {
+        int id = src ? src->findColumn("ID") : -1;
+        if (id < 0 || src->columns()[id].type != GDAType::Int) return false;
+        idColumns.push_back(id);
+    }
+
+    m_sources = std::move(sources);
+    m_columns = m_sources[0]->columns();
+    m_columnMap.assign(m_sources.size() * m_columns.size(), -1);
+    size_t total = 0;
+    for (size_t s = 0; s < m_sources.size(); s++) {
+        const auto& srcColumns = m_sources[s]->columns();
+        for (size_t c = 0; c < m_columns.size(); c++) {
+            for (size_t sc = 0; sc < srcColumns.size(); sc++) {
+                // A column the extension stores as another type stays
+                // unmapped, so its cells read as "****" rather than as a
+                // value of the wrong kind.
+                if (srcColumns[sc].hash == m_columns[c].hash) {
+                    if (!sameStorage(srcColumns[sc].type, m_columns[c].type)) break;
+                    m_columnMap[s * m_columns.size() + c] = static_cast<int>(sc);
+                    break;
+                }
+            }
+        }
+        total += m_sources[s]->rowCount();
+    }
+
+    m_rows.reserve(total);
+    for (size_t s = 0; s < m_sources.size(); s++) {
+        const GDAFile& src = *m_sources[s];
+        size_t idCol = static_cast<size_t>(idColumns[s]);
+        for (uint32_t r = 0; r < src.rowCount(); r++) {
+            if (src.isMissing(r, idCol)) continue;
+            m_rows.push_back(Row{src.intAt(r, idCol), static_cast<uint32_t>(s), r});
+        }
+    }
+
+    // Rows went in by table, so after a stable sort the last of each run of
+    // equal IDs is the one with the highest precedence.
+    std::stable_sort(m_rows.begin(), m_rows.end(), [](const Row& a, const Row& b) { return a.id < b.id; });
+    size_t kept = 0;
+    for (size_t i = 0; i < m_rows.size(); i++) {
+        if (i + 1 < m_rows.size() && m_rows[i + 1].id == m_rows[i].id) continue;
+        m_rows[kept++] = m_rows[i];
+    }
+    m_rows.resize(kept);
+    return true;
+}
+
+int GDAMergedView::findId(int32_t id) const {
+    auto it = std::lower_bound(m_rows.begin(), m_rows.end(), id, [](const Row& row, int32_t v) { return row.id < v; });
+    return it != m_rows.end() && it->id == id ? static_cast<int>(it - m_rows.begin()) : -1;
+}
+
+bool GDAMergedView::isMissing(size_t row, size_t col) const {
+    const Row& r = m_rows[row];
+    int sc = sourceColumn(r.source, col);
+    return sc < 0 || m_sources[r.source]->isMissing(r.row, static_cast<size_t>(sc));
+}
+
+GDAValue GDAMergedView::value(size_t row, size_t col) const {
+    const Row& r = m_rows[row];
+    int sc = sourceColumn(r.source, col);
+    if (sc < 0) return std::string("****");
+    return m_sources[r.source]->value(r.row, static_cast<size_t>(sc));
+}
+
+std::vector<uint32_t> GDAMergedView::select(const std::vector<GDAFilter>& filters) const {
+    // Filters are bound per table: column positions and string offsets
+    // differ from one table to the next.
+    std::vector<std::vector<Matcher>> matchers(m_sources.size());
+    std::vector<uint8_t> possible(m_sources.size(), 1);
+    for (size_t s = 0; s < m_sources.size(); s++) {
+        for (const auto& f : filters) {
+            int sc = f.column < m_columns.size() ? sourceColumn(s, f.column) : -1;
+            matchers[s].emplace_back(*m_sources[s], sc, f);
+            if (!matchers[s].back().possible) possible[s] = 0;
+        }
+    }
+
+    std::vector<uint32_t> rows;
+    for (uint32_t i = 0; i < m_rows.size(); i++) {
+        const Row& r = m_rows[i];
+        if (!possible[r.source]) continue;
+        bool match = true;
+        for (const auto& m : matchers[r.source]) {
+            if (!m.test(*m_sources[r.source], r.row)) {
+                match = false;
+                break;
+            }
+        }
+        if (match) rows.push_back(i);
+    }
+    return rows;
+}
+
+namespace GDAViewCache {
+    struct Stamp {
+        std::string path;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+
+        bool operator==(const Stamp& o) const { return size == o.size && mtime == o.mtime && path == o.path; }
+    };
+
+    struct Entry {
+        std::vector<Stamp> stamps;
+        std::shared_ptr<const GDAMergedView> view;
+    };
+
+    static std::mutex s_mutex;
+    static std::unordered_map<std::string, Entry> s_entries;
+
+    static std::string foldCase(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+        return s;
+    }
+
+    static std::shared_ptr<const GDAFile> loadTable(const ERFFile& erf, size_t entryIndex) {
+        const ERFEntry& entry = erf.entries()[entryIndex];
+        std::vector<uint8_t> data = erf.readEntry(entry);
+        auto gda = std::make_shared<GDAFile>();
+        if (data.empty() || !gda->load(data, entry.name)) return nullptr;
+        return gda;
+    }
+
+    static std::shared_ptr<const GDAMergedView> buildView(const std::string& worksheet,
+                                                         const std::vector<std::unique_ptr<ERFFile>>& archives) {
+        std::string baseName = worksheet + ".gda";
+        std::string prefix = worksheet + "_";
+
+        // Folded table name -> the first archive entry holding it, in name order.
+        std::map<std::string, std::pair<const ERFFile*, size_t>> tables;
+        for (const auto& erf : archives) {
+            if (!erf) continue;
+            const auto& entries = erf->entries();
+            for (size_t i = 0; i < entries.size(); i++) {
+                const std::string& name = entries[i].name;
+                size_t sl = name.find_last_of("/\\");
+                std::string table = foldCase(sl == std::string::npos ? name : name.substr(sl + 1));
+                bool isExtension = table.size() > prefix.size() + 4 && table.compare(0, prefix.size(), prefix) == 0 &&
+                                   table.compare(table.size() - 4, 4, ".gda") == 0;
+                if (table == baseName || isExtension) tables.emplace(std::move(table), std::make_pair(erf.get(), i));
+            }
+        }
+
+        auto base = tables.find(baseName);
+        if (base == tables.end()) return nullptr;
+        std::vector<std::shared_ptr<const GDAFile>> sources;
+        sources.push_back(loadTable(*base->second.first, base->second.second));
+        if (!sources[0]) return nullptr;
+        for (const auto& t : tables) {
+            if (t.first == baseName) continue;
+            auto gda = loadTable(*t.second.first, t.second.second);
+            if (!gda) continue;
+            int id = gda->findColumn("ID");
+            if (id >= 0 && gda->columns()[id].type == GDAType::Int) sources.push_back(std::move(gda));
+        }
+
+        auto view = std::make_shared<GDAMergedView>();
+        if (!view->build(std::move(sources))) return nullptr;
+        return view;
+    }
+
+    std::shared_ptr<const GDAMergedView> get(const std::string& worksheet,
+                                             const std::vector<std::unique_ptr<ERFFile>>& archives) {
+        std::string key = foldCase(worksheet);
+        // Archives are patched through other ERFFile objects (imports, the
+        // browser's delete), so the files on disk are what's compared.
+        std::vector<Stamp> stamps;
+        stamps.reserve(archives.size());
+        for (const auto& erf : archives) {
+            Stamp st;
+            if (erf) {
+                std::error_code ec;
+                st.path = erf->path();
+                st.size = fs::file_size(st.path, ec);
+                if (ec) st.size = 0;
+                auto t = fs::last_write_time(st.path, ec);
+                st.mtime = ec ? 0 : static_cast<int64_t>(t.time_since_epoch().count());
+            }
+            stamps.push_back(std::move(st));
+        }
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        auto it = s_entries.find(key);
+        if (it != s_entries.end() && it->second.stamps == stamps) return it->second.view;
+
+        Entry& entry = s_entries[key];
+        entry.view = buildView(key, archives);
+        entry.stamps = std::move(stamps);
+        return entry.view;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_entries.clear();
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "gda.h"
+
+class ERFFile;
+
+// One condition on a column. Equality matches cells equal to value (ints
+// and floats compare numerically, strings exactly); range matches numeric
+// cells in [low, high]. Missing cells never match.
+struct GDAFilter {
+    size_t column = 0;
+    bool isRange = false;
+    GDAValue value;
+    double low = 0;
+    double high = 0;
+
+    static GDAFilter equal(size_t column, GDAValue value);
+    static GDAFilter range(size_t column, double low, double high);
+};
+
+// Rows of one table, as returned by an index.
+struct GDARowSpan {
+    const uint32_t* first = nullptr;
+    size_t count = 0;
+
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+// Hash index over one column of a loaded table. Rows are kept sorted by
+// cell value, so the same index answers equality through the hash table and
+// numeric ranges by binary search. The table must outlive the index.
+class GDAIndex {
+public:
+    bool build(const GDAFile& gda, size_t column);
+
+    size_t column() const { return m_column; }
+    // Matching rows in row order.
+    GDARowSpan equal(const GDAValue& value) const;
+    // Matching rows in value order; empty for string columns.
+    GDARowSpan range(double low, double high) const;
+
+private:
+    struct Bucket {
+        uint64_t key;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    const GDAFile* m_gda = nullptr;
+    size_t m_column = 0;
+    std::vector<uint64_t> m_keys;
+    std::vector<uint32_t> m_rows;
+    std::vector<Bucket> m_buckets;
+};
+
+// Filters and ID lookups over one table. The ID column is indexed up front;
+// other columns are indexed on request, and filters on an indexed column
+// start from the index instead of a scan.
+class GDAQuery {
+public:
+    explicit GDAQuery(const GDAFile& gda);
+
+    const GDAFile& table() const { return m_gda; }
+    int idColumn() const { return m_idColumn; }
+    // Row holding id, or -1. The last row wins when an ID repeats.
+    int findId(int32_t id) const;
+
+    const GDAIndex& addIndex(size_t column);
+    const GDAIndex* index(size_t column) const;
+
+    // Rows passing every filter, ascending.
+    std::vector<uint32_t> select(const std::vector<GDAFilter>& filters) const;
+
+private:
+    const GDAFile& m_gda;
+    int m_idColumn = -1;
+    std::vector<std::unique_ptr<GDAIndex>> m_indexes;
+};
+
+// An M2DA worksheet: a base table with extension tables layered over it by
+// ID. Columns are the base table's, matched in the extensions by hash; an
+// extension column of another type is treated as absent. A row whose ID
+// appears in several tables comes from the last of them.
+// Merged rows are ordered by ID.
+class GDAMergedView {
+public:
+    // sources[0] is the base table. Fails unless every table has an int ID
+    // column.
+    bool build(std::vector<std::shared_ptr<const GDAFile>> sources);
+
+    const std::vector<GDAColumn>& columns() const { return m_columns; }
+    size_t rowCount() const { return m_rows.size(); }
+    size_t sourceCount() const { return m_sources.size(); }
+    const GDAFile& source(size_t index) const { return *m_sources[index]; }
+
+    int32_t id(size_t row) const { return m_rows[row].id; }
+    // Which table, and which row of it, a merged row comes from.
+    size_t rowSource(size_t row) const { return m_rows[row].source; }
+    uint32_t sourceRow(size_t row) const { return m_rows[row].row; }
+    // Merged row holding id, or -1.
+    int findId(int32_t id) const;
+
+    // Cells of columns an extension table lacks read as "****".
+    bool isMissing(size_t row, size_t col) const;
+    GDAValue value(size_t row, size_t col) const;
+
+    std::vector<uint32_t> select(const std::vector<GDAFilter>& filters) const;
+
+private:
+    struct Row {
+        int32_t id;
+        uint32_t source;
+        uint32_t row;
+    };
+
+    int sourceColumn(size_t source, size_t col) const { return m_columnMap[source * m_columns.size() + col]; }
+
+    std::vector<std::shared_ptr<const GDAFile>> m_sources;
+    std::vector<GDAColumn> m_columns;
+    std::vector<int> m_columnMap;
+    std::vector<Row> m_rows;
+};
+
+// Merged worksheet views read from archives, kept until one of the archive
+// files changes on disk (path, size or mtime) or the archive list does. The
+// views hold their own copies of the tables, so the archives can be closed
+// once get() returns.
+//
+// The base table is <worksheet>.gda and the extensions are every
+// <worksheet>_*.gda, layered in name order. When several archives hold the
+// same table name the first archive wins, as in ResourceLocator. Tables
+// without an ID column are left out.
+namespace GDAViewCache {
+    // nullptr when no archive holds the base table.
+    std::shared_ptr<const GDAMergedView> get(const std::string& worksheet,
+                                             const std::vector<std::unique_ptr<ERFFile>>& archives);
+    void clear();
+}
@@ -1,4 +1,4 @@
-#include "Gff32.h"
+#include "gff32.h"
 #include <fstream>
 #include <cstring>
 #include <sstream>
@@ -23,7 +23,7 @@ static bool isValidUtf8(const char* data, size_t len) {
     return true;
 }
 
-static std::string win1251ToUtf8(const char* data, size_t len) {
+static void win1251ToUtf8(const char* data, size_t len, std::vector<char>& result) {
     static const uint16_t win1251_80BF[64] = {
         0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
         0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
@@ -34,12 +34,10 @@ static std::string win1251ToUtf8(const char* data, size_t len) {
         0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
         0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457
     };
-    std::string result;
-    result.reserve(len * 2);
     for (size_t i = 0; i < len; i++) {
         uint8_t c = static_cast<uint8_t>(data[i]);
         if (c < 0x80) {
-            result += static_cast<char>(c);
+            result.push_back(static_cast<char>(c));
         } else {
             uint16_t cp;
             if (c >= 0xC0)
@@ -48,24 +46,75 @@ static std::string win1251ToUtf8(const char* data, size_t len) {
                 cp = win1251_80BF[c - 0x80];
             if (cp == 0) continue;
             if (cp < 0x80) {
-                result += static_cast<char>(cp);
+                result.push_back(static_cast<char>(cp));
             } else if (cp < 0x800) {
-                result += static_cast<char>(0xC0 | (cp >> 6));
-                result += static_cast<char>(0x80 | (cp & 0x3F));
+                result.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
             } else {
-                result += static_cast<char>(0xE0 | (cp >> 12));
-                result += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
-                result += static_cast<char>(0x80 | (cp & 0x3F));
+                result.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                result.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                result.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
             }
         }
     }
-    return result;
 }
 
-static std::string ensureUtf8(const char* data, size_t len) {
-    if (len == 0) return std::string();
-    if (isValidUtf8(data, len)) return std::string(data, len);
-    return win1251ToUtf8(data, len);
+template<typename T>
+static T readLE(const uint8_t* data, size_t offset) {
+    T val;
+    std::memcpy(&val, data + offset, sizeof(T));
+    return val;
+}
+
+static std::string bytesDisplayValue(const uint8_t* data, size_t size) {
+    std::ostringstream oss;
+    oss << "(" << size << " bytes)";
+    if (size <= 16) {
+        oss << " [";
+        for (size_t i = 0; i < size; ++i) {
+            if (i > 0) oss << " ";
+            oss << std::hex << std::setw(2) << std::setfill('0') << (int)data[i];
+        }
+        oss << "]";
+    }
+    return oss.str();
+}
+
+static bool isComplexType(GFF32::TypeID type) {
+    using GFF32::TypeID;
+    return type == TypeID::DWORD64 ||
+           type == TypeID::INT64 ||
+           type == TypeID::DOUBLE ||
+           type == TypeID::ExoString ||
+           type == TypeID::ResRef ||
+           type == TypeID::ExoLocString ||
+           type == TypeID::VOID ||
+           type == TypeID::Structure ||
+           type == TypeID::List;
+}
+
+static bool readHeader(const uint8_t* data, size_t size, GFF32::Header& header) {
+    if (size < 56) return false;
+    std::memcpy(header.fileType, data, 4);
+    header.fileType[4] = '\0';
+    std::memcpy(header.fileVersion, data + 4, 4);
+    header.fileVersion[4] = '\0';
+    if (std::string(header.fileVersion) != "V3.2") {
+        return false;
+    }
+    header.structOffset = readLE<uint32_t>(data, 8);
+    header.structCount = readLE<uint32_t>(data, 12);
+    header.fieldOffset = readLE<uint32_t>(data, 16);
+    header.fieldCount = readLE<uint32_t>(data, 20);
+    header.labelOffset = readLE<uint32_t>(data, 24);
+    header.labelCount = readLE<uint32_t>(data, 28);
+    header.fieldDataOffset = readLE<uint32_t>(data, 32);
+    header.fieldDataCount = readLE<uint32_t>(data, 36);
+    header.fieldIndicesOffset = readLE<uint32_t>(data, 40);
+    header.fieldIndicesCount = readLE<uint32_t>(data, 44);
+    header.listIndicesOffset = readLE<uint32_t>(data, 48);
+    header.listIndicesCount = readLE<uint32_t>(data, 52);
+    return true;
 }
 
 namespace GFF32 {
@@ -80,17 +129,7 @@ std::string ExoLocString::getDisplayValue() const {
 }
 
 std::string VoidData::getDisplayValue() const {
-    std::ostringstream oss;
-    oss << "(" << data.size() << " bytes)";
-    if (data.size() <= 16) {
-        oss << " [";
-        for (size_t i = 0; i < data.size(); ++i) {
-            if (i > 0) oss << " ";
-            oss << std::hex << std::setw(2) << std::setfill('0') << (int)data[i];
-        }
-        oss << "]";
-    }
-    return oss.str();
+    return bytesDisplayValue(data.data(), data.size());
 }
 
 std::string Field::getTypeName() const {
@@ -102,15 +141,7 @@ std::string Field::getDisplayValue() const {
 }
 
 bool Field::isComplex() const {
-    return typeId == TypeID::DWORD64 ||
-           typeId == TypeID::INT64 ||
-           typeId == TypeID::DOUBLE ||
-           typeId == TypeID::ExoString ||
-           typeId == TypeID::ResRef ||
-           typeId == TypeID::ExoLocString ||
-           typeId == TypeID::VOID ||
-           typeId == TypeID::Structure ||
-           typeId == TypeID::List;
+    return isComplexType(typeId);
 }
 
 bool Structure::hasField(const std::string& label) const {
@@ -177,562 +208,958 @@ bool GFF32File::load(const uint8_t* data, size_t size) {
 }
 
 bool GFF32File::parseHeader(const uint8_t* data, size_t size) {
-    if (size < 56) return false;
-    std::memcpy(m_header.fileType, data, 4);
-    m_header.fileType[4] = '\0';
-    std::memcpy(m_header.fileVersion, data + 4, 4);
-    m_header.fileVersion[4] = '\0';
-    if (std::string(m_header.fileVersion) != "V3.2") {
+    return readHeader(data, size, m_header);
+}
+
+bool GFF32File::parseContent(const uint8_t* data, size_t size) {
+    FlatFile flat;
+    if (!flat.load(data, size)) {
         return false;
     }
-    m_header.structOffset = readAt<uint32_t>(data, 8);
-    m_header.structCount = readAt<uint32_t>(data, 12);
-    m_header.fieldOffset = readAt<uint32_t>(data, 16);
-    m_header.fieldCount = readAt<uint32_t>(data, 20);
-    m_header.labelOffset = readAt<uint32_t>(data, 24);
-    m_header.labelCount = readAt<uint32_t>(data, 28);
-    m_header.fieldDataOffset = readAt<uint32_t>(data, 32);
-    m_header.fieldDataCount = readAt<uint32_t>(data, 36);
-    m_header.fieldIndicesOffset = readAt<uint32_t>(data, 40);
-    m_header.fieldIndicesCount = readAt<uint32_t>(data, 44);
-    m_header.listIndicesOffset = readAt<uint32_t>(data, 48);
-    m_header.listIndicesCount = readAt<uint32_t>(data, 52);
+    if (flat.structCount() > 0) {
+        m_root = std::make_shared<Structure>(flat.toStructure());
+        m_root->fileType = m_header.fileType;
+        m_root->fileVersion = m_header.fileVersion;
+    }
     return true;
 }
 
-bool GFF32File::parseContent(const uint8_t* data, size_t size) {
-    std::vector<std::string> labels;
-    labels.resize(m_header.labelCount);
-    for (uint32_t i = 0; i < m_header.labelCount; ++i) {
-        uint32_t offset = m_header.labelOffset + i * 16;
-        if (offset + 16 > size) return false;
-        char labelBuf[17];
-        std::memcpy(labelBuf, data + offset, 16);
-        labelBuf[16] = '\0';
-        std::string label(labelBuf);
-        size_t end = label.find('\0');
-        if (end != std::string::npos) {
-            label = label.substr(0, end);
-        }
-        labels[i] = label;
+std::string GFF32File::fileType() const {
+    if (m_root) return m_root->fileType;
+    return std::string(m_header.fileType);
+}
+
+std::string GFF32File::fileVersion() const {
+    if (m_root) return m_root->fileVersion;
+    return std::string(m_header.fileVersion);
+}
+
+bool GFF32File::is2DA() const {
+    return fileType() == "2DA ";
+}
+
+bool GFF32File::isDLG() const {
+    return fileType() == "DLG ";
+}
+
+bool GFF32File::isUTI() const {
+    return fileType() == "UTI ";
+}
+
+bool GFF32File::isUTC() const {
+    return fileType() == "UTC ";
+}
+
+bool GFF32File::isUTP() const {
+    return fileType() == "UTP ";
+}
+
+bool GFF32File::isGFF32(const std::vector<uint8_t>& data) {
+    return isGFF32(data.data(), data.size());
+}
+
+bool GFF32File::isGFF32(const uint8_t* data, size_t size) {
+    if (size < 8) return false;
+    if (data[4] == 'V' && data[5] == '3' && data[6] == '.' && data[7] == '2') {
+        return true;
     }
-    std::vector<Structure> structs;
-    structs.resize(m_header.structCount);
-    struct StructDef {
-        uint32_t structId;
-        uint32_t fieldOffset;
-        uint32_t fieldCount;
+    return false;
+}
+
+bool FlatFile::load(const std::string& path) {
+    close();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    size_t size = file.tellg();
+    file.seekg(0);
+    std::vector<uint8_t> data(size);
+    file.read(reinterpret_cast<char*>(data.data()), size);
+    return load(data);
+}
+
+bool FlatFile::load(const std::vector<uint8_t>& data) {
+    return load(data.data(), data.size());
+}
+
+void FlatFile::close() {
+    std::vector<StructRec>().swap(m_structs);
+    std::vector<FieldRec>().swap(m_fields);
+    std::vector<uint32_t>().swap(m_listItems);
+    std::vector<LocalRec>().swap(m_locals);
+    std::vector<Span>().swap(m_labels);
+    std::vector<char>().swap(m_arena);
+    m_header = Header{};
+    m_loaded = false;
+}
+
+uint32_t FlatFile::appendText(const char* text, size_t length) {
+    uint32_t offset = static_cast<uint32_t>(m_arena.size());
+    m_arena.insert(m_arena.end(), text, text + length);
+    return offset;
+}
+
+uint32_t FlatFile::appendUtf8(const char* text, size_t length) {
+    if (isValidUtf8(text, length)) return appendText(text, length);
+    uint32_t offset = static_cast<uint32_t>(m_arena.size());
+    win1251ToUtf8(text, length, m_arena);
+    return offset;
+}
+
+bool FlatFile::load(const uint8_t* data, size_t size) {
+    close();
+    if (!readHeader(data, size, m_header)) {
+        return false;
+    }
+    const Header& h = m_header;
+    auto fits = [&](uint32_t offset, uint32_t count, uint32_t width) {
+        return count == 0 || uint64_t(offset) + uint64_t(count) * width <= size;
     };
-    std::vector<StructDef> structDefs(m_header.structCount);
-    for (uint32_t i = 0; i < m_header.structCount; ++i) {
-        uint32_t offset = m_header.structOffset + i * 12;
-        if (offset + 12 > size) return false;
-        structDefs[i].structId = readAt<uint32_t>(data, offset);
-        structDefs[i].fieldOffset = readAt<uint32_t>(data, offset + 4);
-        structDefs[i].fieldCount = readAt<uint32_t>(data, offset + 8);
-        if (structDefs[i].structId == 0xFFFFFFFF) {
-            structs[i].structId = -1;
-        } else {
-            structs[i].structId = static_cast<int32_t>(structDefs[i].structId);
-        }
+    if (!fits(h.labelOffset, h.labelCount, 16) ||
+        !fits(h.structOffset, h.structCount, 12) ||
+        !fits(h.fieldOffset, h.fieldCount, 12)) {
+        close();
+        return false;
     }
-    struct FieldDef {
-        uint32_t typeId;
-        uint32_t labelIndex;
-        uint32_t dataOrOffset;
+
+    // Labels are up to 16 bytes, NUL padded. Sorting them interns repeats
+    // and lets lookups binary search.
+    auto fileLabel = [&](uint32_t i) {
+        const char* p = reinterpret_cast<const char*>(data + h.labelOffset + size_t(i) * 16);
+        return std::string_view(p, std::find(p, p + 16, '\0') - p);
     };
-    std::vector<FieldDef> fieldDefs(m_header.fieldCount);
-    for (uint32_t i = 0; i < m_header.fieldCount; ++i) {
-        uint32_t offset = m_header.fieldOffset + i * 12;
-        if (offset + 12 > size) return false;
-        fieldDefs[i].typeId = readAt<uint32_t>(data, offset);
-        fieldDefs[i].labelIndex = readAt<uint32_t>(data, offset + 4);
-        fieldDefs[i].dataOrOffset = readAt<uint32_t>(data, offset + 8);
-    }
-    auto getFieldIndices = [&](const StructDef& sd) -> std::vector<uint32_t> {
-        std::vector<uint32_t> indices;
-        if (sd.fieldCount == 0) {
-            return indices;
-        } else if (sd.fieldCount == 1) {
-            indices.push_back(sd.fieldOffset);
-        } else {
-            for (uint32_t j = 0; j < sd.fieldCount; ++j) {
-                uint32_t idxOffset = m_header.fieldIndicesOffset + sd.fieldOffset + j * 4;
-                if (idxOffset + 4 <= size) {
-                    indices.push_back(readAt<uint32_t>(data, idxOffset));
-                }
-            }
+    std::vector<uint32_t> labelIndex(h.labelCount);
+    for (uint32_t i = 0; i < h.labelCount; ++i) labelIndex[i] = i;
+    std::sort(labelIndex.begin(), labelIndex.end(), [&](uint32_t a, uint32_t b) {
+        return fileLabel(a) < fileLabel(b);
+    });
+    size_t fieldDataSize = h.fieldDataOffset <= size ? size - h.fieldDataOffset : 0;
+    const uint8_t* fieldData = data + (size - fieldDataSize);
+    m_arena.reserve(size_t(h.labelCount) * 16 + std::min<size_t>(h.fieldDataCount, fieldDataSize));
+    m_labels.reserve(h.labelCount);
+    std::vector<uint32_t> interned(h.labelCount);
+    for (uint32_t i : labelIndex) {
+        std::string_view label = fileLabel(i);
+        if (m_labels.empty() || text(m_labels.back().offset, m_labels.back().length) != label) {
+            m_labels.push_back({ appendText(label.data(), label.size()), static_cast<uint32_t>(label.size()) });
         }
-        return indices;
-    };
-    const uint8_t* fieldData = data + m_header.fieldDataOffset;
-    size_t fieldDataSize = size - m_header.fieldDataOffset;
-    auto parseFieldValue = [&](const FieldDef& fd, std::vector<Structure>& structs) -> std::pair<TypeID, FieldValue> {
-        TypeID type = static_cast<TypeID>(fd.typeId);
-        FieldValue value;
-        switch (type) {
-            case TypeID::BYTE:
-                value = static_cast<uint8_t>(fd.dataOrOffset & 0xFF);
-                break;
-            case TypeID::CHAR:
-                value = static_cast<int8_t>(fd.dataOrOffset & 0xFF);
-                break;
-            case TypeID::WORD:
-                value = static_cast<uint16_t>(fd.dataOrOffset & 0xFFFF);
-                break;
-            case TypeID::SHORT:
-                value = static_cast<int16_t>(fd.dataOrOffset & 0xFFFF);
-                break;
-            case TypeID::DWORD:
-                value = fd.dataOrOffset;
-                break;
-            case TypeID::INT:
-                value = static_cast<int32_t>(fd.dataOrOffset);
-                break;
-            case TypeID::FLOAT: {
-                float f;
-                std::memcpy(&f, &fd.dataOrOffset, sizeof(float));
-                value = f;
-                break;
-            }
-            case TypeID::DWORD64: {
-                if (fd.dataOrOffset + 8 <= fieldDataSize) {
-                    uint64_t v;
-                    std::memcpy(&v, fieldData + fd.dataOrOffset, 8);
-                    value = v;
-                } else {
-                    value = uint64_t(0);
-                }
-                break;
-            }
-            case TypeID::INT64: {
-                if (fd.dataOrOffset + 8 <= fieldDataSize) {
-                    int64_t v;
-                    std::memcpy(&v, fieldData + fd.dataOrOffset, 8);
-                    value = v;
-                } else {
-                    value = int64_t(0);
-                }
-                break;
-            }
-            case TypeID::DOUBLE: {
-                if (fd.dataOrOffset + 8 <= fieldDataSize) {
-                    double d;
-                    std::memcpy(&d, fieldData + fd.dataOrOffset, 8);
-                    value = d;
-                } else {
-                    value = 0.0;
+        interned[i] = static_cast<uint32_t>(m_labels.size() - 1);
+    }
+
+    // Where each label last landed, so a repeated label overwrites the
+    // earlier field in place the way Structure::setField does.
+    std::vector<uint32_t> seenIn(m_labels.size(), NONE);
+    std::vector<uint32_t> seenAt(m_labels.size());
+    m_structs.resize(h.structCount);
+    m_fields.reserve(h.fieldCount);
+    for (uint32_t i = 0; i < h.structCount; ++i) {
+        size_t def = h.structOffset + size_t(i) * 12;
+        uint32_t fieldOffset = readLE<uint32_t>(data, def + 4);
+        uint32_t fieldCount = readLE<uint32_t>(data, def + 8);
+        StructRec& st = m_structs[i];
+        st.structId = static_cast<int32_t>(readLE<uint32_t>(data, def));
+        st.firstField = static_cast<uint32_t>(m_fields.size());
+        // Plain values first, then structs and lists: the field order
+        // GFF32File has always produced.
+        for (int pass = 0; pass < 2; ++pass) {
+            for (uint32_t j = 0; j < fieldCount; ++j) {
+                uint32_t fidx = fieldOffset;
+                if (fieldCount > 1) {
+                    size_t idxOffset = size_t(h.fieldIndicesOffset) + fieldOffset + size_t(j) * 4;
+                    if (idxOffset + 4 > size) break;
+                    fidx = readLE<uint32_t>(data, idxOffset);
                 }
-                break;
-            }
-            case TypeID::ExoString: {
-                if (fd.dataOrOffset + 4 <= fieldDataSize) {
-                    uint32_t len = readAt<uint32_t>(fieldData, fd.dataOrOffset);
-                    if (fd.dataOrOffset + 4 + len <= fieldDataSize) {
-                        value = ensureUtf8(reinterpret_cast<const char*>(fieldData + fd.dataOrOffset + 4), len);
-                    } else {
-                        value = std::string();
+                if (fidx >= h.fieldCount) continue;
+                size_t fdef = h.fieldOffset + size_t(fidx) * 12;
+                TypeID type = static_cast<TypeID>(readLE<uint32_t>(data, fdef));
+                uint32_t labelIdx = readLE<uint32_t>(data, fdef + 4);
+                uint32_t value = readLE<uint32_t>(data, fdef + 8);
+                if (labelIdx >= h.labelCount) continue;
+                bool nested = type == TypeID::Structure || type == TypeID::List;
+                if (nested != (pass == 1)) continue;
+
+                FieldRec field{ interned[labelIdx], type, 0, 0 };
+                switch (type) {
+                    case TypeID::BYTE:
+                        field.data = value & 0xFF;
+                        break;
+                    case TypeID::CHAR:
+                        field.data = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int8_t>(value & 0xFF)));
+                        break;
+                    case TypeID::WORD:
+                        field.data = value & 0xFFFF;
+                        break;
+                    case TypeID::SHORT:
+                        field.data = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int16_t>(value & 0xFFFF)));
+                        break;
+                    case TypeID::INT:
+                        field.data = static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(value)));
+                        break;
+                    case TypeID::DWORD:
+                    case TypeID::FLOAT:
+                        field.data = value;
+                        break;
+                    case TypeID::DWORD64:
+                    case TypeID::INT64:
+                    case TypeID::DOUBLE:
+                        if (size_t(value) + 8 <= fieldDataSize) {
+                            field.data = readLE<uint64_t>(fieldData, value);
+                        }
+                        break;
+                    case TypeID::ExoString:
+                        if (size_t(value) + 4 <= fieldDataSize) {
+                            uint32_t len = readLE<uint32_t>(fieldData, value);
+                            if (size_t(value) + 4 + len <= fieldDataSize) {
+                                field.data = appendUtf8(reinterpret_cast<const char*>(fieldData + value + 4), len);
+                                field.size = static_cast<uint32_t>(m_arena.size() - field.data);
+                            }
+                        }
+                        break;
+                    case TypeID::ResRef:
+                        if (size_t(value) + 1 <= fieldDataSize) {
+                            uint8_t len = fieldData[value];
+                            if (size_t(value) + 1 + len <= fieldDataSize) {
+                                field.data = appendText(reinterpret_cast<const char*>(fieldData + value + 1), len);
+                                field.size = len;
+                                for (size_t k = field.data; k < m_arena.size(); ++k) {
+                                    m_arena[k] = static_cast<char>(::tolower(static_cast<unsigned char>(m_arena[k])));
+                                }
+                            }
+                        }
+                        break;
+                    case TypeID::ExoLocString: {
+                        uint32_t strRef = NONE;
+                        uint32_t first = static_cast<uint32_t>(m_locals.size());
+                        if (size_t(value) + 12 <= fieldDataSize) {
+                            strRef = readLE<uint32_t>(fieldData, value + 4);
+                            uint32_t strCount = readLE<uint32_t>(fieldData, value + 8);
+                            size_t strOffset = size_t(value) + 12;
+                            for (uint32_t s = 0; s < strCount && strOffset + 8 <= fieldDataSize; ++s) {
+                                uint32_t strId = readLE<uint32_t>(fieldData, strOffset);
+                                uint32_t strLen = readLE<uint32_t>(fieldData, strOffset + 4);
+                                strOffset += 8;
+                                if (strOffset + strLen <= fieldDataSize) {
+                                    LocalRec local{ strId >> 2, strId & 1, 0, 0 };
+                                    local.offset = appendUtf8(reinterpret_cast<const char*>(fieldData + strOffset), strLen);
+                                    local.length = static_cast<uint32_t>(m_arena.size() - local.offset);
+                                    m_locals.push_back(local);
+                                }
+                                strOffset += strLen;
+                            }
+                        }
+                        field.data = (uint64_t(strRef) << 32) | first;
+                        field.size = static_cast<uint32_t>(m_locals.size() - first);
+                        break;
                     }
-                } else {
-                    value = std::string();
-                }
-                break;
-            }
-            case TypeID::ResRef: {
-                if (fd.dataOrOffset + 1 <= fieldDataSize) {
-                    uint8_t len = fieldData[fd.dataOrOffset];
-                    if (fd.dataOrOffset + 1 + len <= fieldDataSize) {
-                        std::string s(reinterpret_cast<const char*>(fieldData + fd.dataOrOffset + 1), len);
-                        std::transform(s.begin(), s.end(), s.begin(), ::tolower);
-                        value = s;
-                    } else {
-                        value = std::string();
+                    case TypeID::VOID:
+                        if (size_t(value) + 4 <= fieldDataSize) {
+                            uint32_t len = readLE<uint32_t>(fieldData, value);
+                            if (size_t(value) + 4 + len <= fieldDataSize) {
+                                field.data = appendText(reinterpret_cast<const char*>(fieldData + value + 4), len);
+                                field.size = len;
+                            }
+                        }
+                        break;
+                    case TypeID::Structure:
+                        field.data = value < h.structCount ? value : NONE;
+                        break;
+                    case TypeID::List: {
+                        uint32_t first = static_cast<uint32_t>(m_listItems.size());
+                        if (size_t(value) + 4 <= h.listIndicesCount) {
+                            size_t listPos = size_t(h.listIndicesOffset) + value;
+                            if (listPos + 4 <= size) {
+                                uint32_t count = readLE<uint32_t>(data, listPos);
+                                listPos += 4;
+                                for (uint32_t li = 0; li < count && listPos + 4 <= size; ++li) {
+                                    uint32_t structIdx = readLE<uint32_t>(data, listPos);
+                                    listPos += 4;
+                                    if (structIdx < h.structCount) m_listItems.push_back(structIdx);
+                                }
+                            }
+                        }
+                        field.data = first;
+                        field.size = static_cast<uint32_t>(m_listItems.size() - first);
+                        break;
                     }
+                    default:
+                        break;
+                }
+
+                if (seenIn[field.label] == i) {
+                    m_fields[seenAt[field.label]] = field;
                 } else {
-                    value = std::string();
+                    seenIn[field.label] = i;
+                    seenAt[field.label] = static_cast<uint32_t>(m_fields.size());
+                    m_fields.push_back(field);
                 }
-                break;
             }
+        }
+        st.fieldCount = static_cast<uint32_t>(m_fields.size()) - st.firstField;
+    }
+    if (m_arena.size() > 0xFFFFFFFFull || m_fields.size() > 0xFFFFFFFFull) {
+        close();
+        return false;
+    }
+    m_loaded = true;
+    return true;
+}
+
+FlatStruct FlatFile::root() const {
+    return m_structs.empty() ? FlatStruct() : FlatStruct(this, 0);
+}
+
+size_t FlatFile::memoryUsage() const {
+    return m_structs.capacity() * sizeof(StructRec) +
+           m_fields.capacity() * sizeof(FieldRec) +
+           m_listItems.capacity() * sizeof(uint32_t) +
+           m_locals.capacity() * sizeof(LocalRec) +
+           m_labels.capacity() * sizeof(Span) +
+           m_arena.capacity();
+}
+
+uint32_t FlatFile::findLabel(std::string_view label) const {
+    auto it = std::lower_bound(m_labels.begin(), m_labels.end(), label, [&](const Span& span, std::string_view l) {
+        return text(span.offset, span.length) < l;
+    });
+    if (it == m_labels.end() || text(it->offset, it->length) != label) return NONE;
+    return static_cast<uint32_t>(it - m_labels.begin());
+}
+
+Structure FlatFile::toStructure() const {
+    Structure out;
+    if (m_structs.empty()) return out;
+    std::vector<uint8_t> expanded(m_structs.size(), 0);
+    buildStructure(0, out, expanded);
+    return out;
+}
+
+// Well-formed files give every struct one parent. A struct referenced a
+// second time (or through a cycle) comes out empty rather than expanding
+// again.
+void FlatFile::buildStructure(uint32_t index, Structure& out, std::vector<uint8_t>& expanded) const {
+    out.structId = m_structs[index].structId;
+    if (expanded[index]) return;
+    expanded[index] = 1;
+    FlatStruct st(this, index);
+    out.fieldOrder.reserve(st.fieldCount());
+    for (FlatField field : st) {
+        std::string label(field.label());
+        FieldValue value;
+        switch (field.typeId()) {
+            case TypeID::BYTE: value = static_cast<uint8_t>(field.asUInt()); break;
+            case TypeID::CHAR: value = static_cast<int8_t>(field.asInt()); break;
+            case TypeID::WORD: value = static_cast<uint16_t>(field.asUInt()); break;
+            case TypeID::SHORT: value = static_cast<int16_t>(field.asInt()); break;
+            case TypeID::DWORD: value = static_cast<uint32_t>(field.asUInt()); break;
+            case TypeID::INT: value = static_cast<int32_t>(field.asInt()); break;
+            case TypeID::DWORD64: value = field.asUInt(); break;
+            case TypeID::INT64: value = field.asInt(); break;
+            case TypeID::FLOAT: value = field.asFloat(); break;
+            case TypeID::DOUBLE: value = field.asDouble(); break;
+            case TypeID::ExoString:
+            case TypeID::ResRef:
+                value = std::string(field.asString());
+                break;
             case TypeID::ExoLocString: {
                 ExoLocString els;
-                if (fd.dataOrOffset + 12 <= fieldDataSize) {
-                    uint32_t totalSize = readAt<uint32_t>(fieldData, fd.dataOrOffset);
-                    uint32_t strRef = readAt<uint32_t>(fieldData, fd.dataOrOffset + 4);
-                    uint32_t strCount = readAt<uint32_t>(fieldData, fd.dataOrOffset + 8);
-                    els.stringref = (strRef == 0xFFFFFFFF) ? -1 : static_cast<int32_t>(strRef);
-                    uint32_t strOffset = fd.dataOrOffset + 12;
-                    for (uint32_t s = 0; s < strCount && strOffset + 8 <= fieldDataSize; ++s) {
-                        uint32_t strId = readAt<uint32_t>(fieldData, strOffset);
-                        uint32_t strLen = readAt<uint32_t>(fieldData, strOffset + 4);
-                        strOffset += 8;
-                        if (strOffset + strLen <= fieldDataSize) {
-                            LocalString ls;
-                            ls.language = strId >> 2;
-                            ls.gender = (strId & 1) != 0;
-                            ls.text = ensureUtf8(reinterpret_cast<const char*>(fieldData + strOffset), strLen);
-                            els.strings.push_back(ls);
-                        }
-                        strOffset += strLen;
-                    }
+                els.stringref = field.stringRef();
+                for (size_t i = 0; i < field.localCount(); ++i) {
+                    FlatLocalString local = field.local(i);
+                    els.strings.push_back({ local.language, local.gender, std::string(local.text) });
                 }
-                value = els;
+                value = std::move(els);
                 break;
             }
             case TypeID::VOID: {
                 VoidData vd;
-                if (fd.dataOrOffset + 4 <= fieldDataSize) {
-                    uint32_t len = readAt<uint32_t>(fieldData, fd.dataOrOffset);
-                    if (fd.dataOrOffset + 4 + len <= fieldDataSize) {
-                        vd.data.resize(len);
-                        std::memcpy(vd.data.data(), fieldData + fd.dataOrOffset + 4, len);
-                    }
-                }
-                value = vd;
+                std::string_view bytes = field.asBytes();
+                vd.data.assign(bytes.begin(), bytes.end());
+                value = std::move(vd);
                 break;
             }
             case TypeID::Structure: {
-                if (fd.dataOrOffset < structs.size()) {
-                    auto ptr = std::make_shared<Structure>(structs[fd.dataOrOffset]);
-                    value = ptr;
-                } else {
-                    value = std::make_shared<Structure>();
-                }
+                auto child = std::make_shared<Structure>();
+                FlatStruct ref = field.asStruct();
+                if (ref) buildStructure(ref.m_index, *child, expanded);
+                value = child;
                 break;
             }
             case TypeID::List: {
-                auto listPtr = std::make_shared<std::vector<Structure>>();
-                if (fd.dataOrOffset + 4 <= m_header.listIndicesCount) {
-                    uint32_t listPos = m_header.listIndicesOffset + fd.dataOrOffset;
-                    if (listPos + 4 <= size) {
-                        uint32_t count = readAt<uint32_t>(data, listPos);
-                        listPos += 4;
-                        for (uint32_t li = 0; li < count && listPos + 4 <= size; ++li) {
-                            uint32_t structIdx = readAt<uint32_t>(data, listPos);
-                            listPos += 4;
-                            if (structIdx < structs.size()) {
-                                listPtr->push_back(structs[structIdx]);
-                            }
-                        }
-                    }
+                FlatList list = field.asList();
+                auto items = std::make_shared<std::vector<Structure>>(list.size());
+                for (size_t i = 0; i < list.size(); ++i) {
+                    buildStructure(list[i].m_index, (*items)[i], expanded);
                 }
-                value = listPtr;
+                value = items;
                 break;
             }
             default:
                 value = uint32_t(0);
                 break;
         }
-        return {type, value};
-    };
-    for (uint32_t i = 0; i < m_header.structCount; ++i) {
-        auto fieldIndices = getFieldIndices(structDefs[i]);
-        for (uint32_t fidx : fieldIndices) {
-            if (fidx >= fieldDefs.size()) continue;
-            const FieldDef& fd = fieldDefs[fidx];
-            if (fd.labelIndex >= labels.size()) continue;
-            const std::string& label = labels[fd.labelIndex];
-            TypeID type = static_cast<TypeID>(fd.typeId);
-            if (type == TypeID::Structure || type == TypeID::List) {
-                continue;
-            }
-            auto [parsedType, parsedValue] = parseFieldValue(fd, structs);
-            structs[i].setField(label, parsedType, std::move(parsedValue));
-        }
+        out.fieldOrder.push_back(label);
+        out.fields.emplace(label, Field{ label, field.typeId(), std::move(value) });
     }
-    for (uint32_t i = 0; i < m_header.structCount; ++i) {
-        auto fieldIndices = getFieldIndices(structDefs[i]);
-        for (uint32_t fidx : fieldIndices) {
-            if (fidx >= fieldDefs.size()) continue;
-            const FieldDef& fd = fieldDefs[fidx];
-            if (fd.labelIndex >= labels.size()) continue;
-            const std::string& label = labels[fd.labelIndex];
-            TypeID type = static_cast<TypeID>(fd.typeId);
-            if (type != TypeID::Structure && type != TypeID::List) {
-                continue;
-            }
-            auto [parsedType, parsedValue] = parseFieldValue(fd, structs);
-            structs[i].setField(label, parsedType, std::move(parsedValue));
-        }
+}
+
+int32_t FlatStruct::structId() const {
+    return m_file ? m_file->m_structs[m_index].structId : -1;
+}
+
+size_t FlatStruct::fieldCount() const {
+    return m_file ? m_file->m_structs[m_index].fieldCount : 0;
+}
+
+FlatField FlatStruct::operator[](size_t i) const {
+    return FlatField(m_file, m_file->m_structs[m_index].firstField + static_cast<uint32_t>(i));
+}
+
+FlatField FlatStruct::getField(std::string_view label) const {
+    if (!m_file) return FlatField();
+    uint32_t id = m_file->findLabel(label);
+    if (id == FlatFile::NONE) return FlatField();
+    const auto& st = m_file->m_structs[m_index];
+    for (uint32_t i = st.firstField; i < st.firstField + st.fieldCount; ++i) {
+        if (m_file->m_fields[i].label == id) return FlatField(m_file, i);
     }
-    if (!structs.empty()) {
-        m_root = std::make_shared<Structure>(structs[0]);
-        m_root->fileType = m_header.fileType;
-        m_root->fileVersion = m_header.fileVersion;
+    return FlatField();
+}
+
+FlatStruct FlatList::operator[](size_t i) const {
+    return FlatStruct(m_file, m_file->m_listItems[m_first + i]);
+}
+
+std::string_view FlatField::label() const {
+    if (!m_file) return std::string_view();
+    const auto& span = m_file->m_labels[m_file->m_fields[m_index].label];
+    return m_file->text(span.offset, span.length);
+}
+
+TypeID FlatField::typeId() const {
+    return m_file ? m_file->m_fields[m_index].typeId : static_cast<TypeID>(FlatFile::NONE);
+}
+
+std::string FlatField::getTypeName() const {
+    return typeIdToString(typeId());
+}
+
+bool FlatField::isComplex() const {
+    return isComplexType(typeId());
+}
+
+int64_t FlatField::asInt() const {
+    switch (typeId()) {
+        case TypeID::FLOAT:
+        case TypeID::DOUBLE:
+            return static_cast<int64_t>(asDouble());
+        default:
+            return static_cast<int64_t>(asUInt());
     }
-    return true;
 }
 
-std::string GFF32File::fileType() const {
-    if (m_root) return m_root->fileType;
-    return std::string(m_header.fileType);
+uint64_t FlatField::asUInt() const {
+    switch (typeId()) {
+        case TypeID::BYTE:
+        case TypeID::CHAR:
+        case TypeID::WORD:
+        case TypeID::SHORT:
+        case TypeID::DWORD:
+        case TypeID::INT:
+        case TypeID::DWORD64:
+        case TypeID::INT64:
+            return m_file->m_fields[m_index].data;
+        case TypeID::FLOAT:
+        case TypeID::DOUBLE:
+            return static_cast<uint64_t>(asDouble());
+        default:
+            return 0;
+    }
 }
 
-std::string GFF32File::fileVersion() const {
-    if (m_root) return m_root->fileVersion;
-    return std::string(m_header.fileVersion);
+double FlatField::asDouble() const {
+    TypeID type = typeId();
+    switch (type) {
+        case TypeID::BYTE:
+        case TypeID::WORD:
+        case TypeID::DWORD:
+        case TypeID::DWORD64:
+            return static_cast<double>(m_file->m_fields[m_index].data);
+        case TypeID::CHAR:
+        case TypeID::SHORT:
+        case TypeID::INT:
+        case TypeID::INT64:
+            return static_cast<double>(static_cast<int64_t>(m_file->m_fields[m_index].data));
+        case TypeID::FLOAT: {
+            uint32_t bits = static_cast<uint32_t>(m_file->m_fields[m_index].data);
+            float f;
+            std::memcpy(&f, &bits, sizeof(f));
+            return f;
+        }
+        case TypeID::DOUBLE: {
+            double d;
+            std::memcpy(&d, &m_file->m_fields[m_index].data, sizeof(d));
+            return d;
+        }
+        default:
+            return 0.0;
+    }
 }
 
-bool GFF32File::is2DA() const {
-    return fileType() == "2DA ";
+std::string_view FlatField::asString() const {
+    TypeID type = typeId();
+    if (type != TypeID::ExoString && type != TypeID::ResRef) return std::string_view();
+    const auto& rec = m_file->m_fields[m_index];
+    return m_file->text(static_cast<uint32_t>(rec.data), rec.size);
 }
 
-bool GFF32File::isDLG() const {
-    return fileType() == "DLG ";
+std::string_view FlatField::asBytes() const {
+    if (typeId() != TypeID::VOID) return std::string_view();
+    const auto& rec = m_file->m_fields[m_index];
+    return m_file->text(static_cast<uint32_t>(rec.data), rec.size);
 }
 
-bool GFF32File::isUTI() const {
-    return fileType() == "UTI ";
+int32_t FlatField::stringRef() const {
+    if (typeId() != TypeID::ExoLocString) return -1;
+    return static_cast<int32_t>(m_file->m_fields[m_index].data >> 32);
 }
 
-bool GFF32File::isUTC() const {
-    return fileType() == "UTC ";
+size_t FlatField::localCount() const {
+    return typeId() == TypeID::ExoLocString ? m_file->m_fields[m_index].size : 0;
 }
 
-bool GFF32File::isUTP() const {
-    return fileType() == "UTP ";
+FlatLocalString FlatField::local(size_t i) const {
+    if (!m_file || i >= localCount()) return FlatLocalString();
+    const auto& rec = m_file->m_fields[m_index];
+    const auto& local = m_file->m_locals[static_cast<uint32_t>(rec.data) + i];
+    return { local.language, local.gender != 0, m_file->text(local.offset, local.length) };
 }
 
-bool GFF32File::isGFF32(const std::vector<uint8_t>& data) {
-    return isGFF32(data.data(), data.size());
+FlatStruct FlatField::asStruct() const {
+    if (!m_file || typeId() != TypeID::Structure) return FlatStruct();
+    uint64_t index = m_file->m_fields[m_index].data;
+    return index == FlatFile::NONE ? FlatStruct() : FlatStruct(m_file, static_cast<uint32_t>(index));
 }
 
-bool GFF32File::isGFF32(const uint8_t* data, size_t size) {
-    if (size < 8) return false;
-    if (data[4] == 'V' && data[5] == '3' && data[6] == '.' && data[7] == '2') {
-        return true;
-    }
-    return false;
+FlatList FlatField::asList() const {
+    if (!m_file || typeId() != TypeID::List) return FlatList();
+    const auto& rec = m_file->m_fields[m_index];
+    return FlatList(m_file, static_cast<uint32_t>(rec.data), rec.size);
 }
 
-bool GFF32File::save(const std::string& path) {
-    auto data = save();
-    if (data.empty()) return false;
-    std::ofstream file(path, std::ios::binary);
-    if (!file) return false;
-    file.write(reinterpret_cast<const char*>(data.data()), data.size());
-    return true;
+std::string FlatField::getDisplayValue() const {
+    std::ostringstream oss;
+    switch (typeId()) {
+        case TypeID::BYTE:
+        case TypeID::WORD:
+        case TypeID::DWORD:
+        case TypeID::DWORD64:
+            oss << asUInt();
+            break;
+        case TypeID::CHAR:
+        case TypeID::SHORT:
+        case TypeID::INT:
+        case TypeID::INT64:
+            oss << asInt();
+            break;
+        case TypeID::FLOAT:
+            oss << std::fixed << std::setprecision(6) << asFloat();
+            break;
+        case TypeID::DOUBLE:
+            oss << std::fixed << std::setprecision(9) << asDouble();
+            break;
+        case TypeID::ExoString:
+        case TypeID::ResRef:
+            oss << "\"" << asString() << "\"";
+            break;
+        case TypeID::ExoLocString:
+            if (localCount() > 0) {
+                oss << local(0).text;
+            } else if (stringRef() >= 0) {
+                oss << "StrRef:" << stringRef();
+            }
+            break;
+        case TypeID::VOID: {
+            std::string_view bytes = asBytes();
+            oss << bytesDisplayValue(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+            break;
+        }
+        case TypeID::Structure: {
+            FlatStruct st = asStruct();
+            oss << "(Struct:" << st.structId() << ", " << st.fieldCount() << " fields)";
+            break;
+        }
+        case TypeID::List:
+            oss << "(" << asList().size() << " items)";
+            break;
+        default:
+            oss << "???";
+            break;
+    }
+    return oss.str();
 }
 
-struct WriterState {
-    std::vector<uint8_t> structsBuf;
-    std::vector<uint8_t> fieldsBuf;
-    std::vector<uint8_t> labelsBuf;
-    std::vector<uint8_t> fieldDataBuf;
-    std::vector<uint8_t> fieldIndicesBuf;
-    std::vector<uint8_t> listIndicesBuf;
-    std::map<std::string, uint32_t> labelMap;
-    uint32_t structCount = 0;
-    uint32_t fieldCount = 0;
-
-    template<typename T>
-    static void append(std::vector<uint8_t>& buf, T val) {
-        size_t pos = buf.size();
-        buf.resize(pos + sizeof(T));
-        std::memcpy(&buf[pos], &val, sizeof(T));
-    }
-
-    uint32_t getLabelIndex(const std::string& label) {
-        auto it = labelMap.find(label);
-        if (it != labelMap.end()) return it->second;
-        uint32_t idx = static_cast<uint32_t>(labelMap.size());
-        labelMap[label] = idx;
-        char b[16];
-        std::memset(b, 0, 16);
-        std::memcpy(b, label.c_str(), std::min(label.size(), (size_t)16));
-        labelsBuf.insert(labelsBuf.end(), b, b + 16);
-        return idx;
+namespace {
+
+// Serializes a Structure tree straight into its final layout. A first walk
+// numbers structs depth-first in field order, gives each struct's fields
+// consecutive indices and interns labels; after that every section size
+// and offset is known, so each section is written front to back with
+// nothing assembled on the side.
+class Writer {
+public:
+    explicit Writer(const Structure& root) { layout(root); }
+
+    size_t size() const {
+        return 56 + m_structs.size() * 12 + m_fields.size() * 12 + m_labels.size() * 16 +
+               m_dataSize + m_indicesSize + m_listSize;
+    }
+
+    template<typename Sink>
+    void write(Sink& out, const char* fileType, const char* fileVersion) const;
+
+private:
+    struct StructSlot {
+        int32_t structId;
+        uint32_t firstField;
+        uint32_t fieldCount;
+        uint32_t subtree;    // this struct plus everything below it
+    };
+    // value is the record's inline value for BYTE..FLOAT, the byte count
+    // for types stored in field data and the item count for lists, so the
+    // field section is written without going back to the tree.
+    struct FieldSlot {
+        const Field* field;
+        uint32_t label;
+        TypeID typeId;
+        uint32_t value;
+    };
+
+    static const Structure& structOf(const Field& field) {
+        static const Structure empty;
+        const Structure* ptr = std::get<StructurePtr>(field.value).get();
+        return ptr ? *ptr : empty;
+    }
+    static const std::vector<Structure>* listOf(const Field& field) {
+        return std::get<ListPtr>(field.value).get();
     }
+    static uint32_t slotValue(const Field& field);
+    static uint32_t hashLabel(const std::string& label) {
+        uint32_t h = 2166136261u;
+        for (char c : label) h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+        return h;
+    }
+    uint32_t intern(const std::string& label);
+    void layout(const Structure& st);
+
+    std::vector<StructSlot> m_structs;
+    std::vector<FieldSlot> m_fields;
+    std::vector<const std::string*> m_labels;
+    std::vector<uint32_t> m_labelTable;    // open-addressed label indices
+    uint32_t m_dataSize = 0;
+    uint32_t m_indicesSize = 0;
+    uint32_t m_listSize = 0;
 };
 
-std::vector<uint8_t> GFF32File::save() {
-    if (!m_root) return {};
+uint32_t Writer::slotValue(const Field& field) {
+    uint32_t value = 0;
+    switch (field.typeId) {
+        case TypeID::BYTE:
+            return std::get<uint8_t>(field.value);
+        case TypeID::CHAR:
+            return static_cast<uint8_t>(std::get<int8_t>(field.value));
+        case TypeID::WORD:
+            return std::get<uint16_t>(field.value);
+        case TypeID::SHORT:
+            return static_cast<uint16_t>(std::get<int16_t>(field.value));
+        case TypeID::DWORD:
+            return std::get<uint32_t>(field.value);
+        case TypeID::INT:
+            return static_cast<uint32_t>(std::get<int32_t>(field.value));
+        case TypeID::FLOAT:
+            std::memcpy(&value, &std::get<float>(field.value), 4);
+            return value;
+        case TypeID::List: {
+            const auto* list = listOf(field);
+            return list ? static_cast<uint32_t>(list->size()) : 0;
+        }
+        case TypeID::DWORD64:
+        case TypeID::INT64:
+        case TypeID::DOUBLE:
+            return 8;
+        case TypeID::ExoString:
+            return 4 + static_cast<uint32_t>(std::get<std::string>(field.value).size());
+        case TypeID::ResRef:
+            return 1 + static_cast<uint32_t>(std::min(std::get<std::string>(field.value).size(), (size_t)255));
+        case TypeID::ExoLocString:
+            value = 12;
+            for (const auto& ls : std::get<ExoLocString>(field.value).strings)
+                value += 8 + static_cast<uint32_t>(ls.text.size());
+            return value;
+        case TypeID::VOID:
+            return 4 + static_cast<uint32_t>(std::get<VoidData>(field.value).data.size());
+        default:
+            return 0;
+    }
+}
 
-    WriterState w;
-
-    std::function<uint32_t(const Structure&)> writeStruct;
-    writeStruct = [&](const Structure& st) -> uint32_t {
-        uint32_t structIdx = w.structCount++;
-        size_t structPos = w.structsBuf.size();
-        WriterState::append(w.structsBuf, static_cast<uint32_t>(st.structId == -1 ? 0xFFFFFFFF : st.structId));
-        WriterState::append(w.structsBuf, uint32_t(0));
-        WriterState::append(w.structsBuf, static_cast<uint32_t>(st.fieldOrder.size()));
-
-        std::vector<uint32_t> fieldIndices;
-        for (const auto& label : st.fieldOrder) {
-            auto it = st.fields.find(label);
-            if (it == st.fields.end()) continue;
-            const Field& field = it->second;
-            uint32_t fieldIdx = w.fieldCount++;
-            fieldIndices.push_back(fieldIdx);
-            uint32_t labelIdx = w.getLabelIndex(label);
-            uint32_t typeId = static_cast<uint32_t>(field.typeId);
-            uint32_t dataOrOffset = 0;
-
-            switch (field.typeId) {
-                case TypeID::BYTE:
-                    dataOrOffset = std::get<uint8_t>(field.value);
-                    break;
-                case TypeID::CHAR:
-                    dataOrOffset = static_cast<uint32_t>(static_cast<uint8_t>(std::get<int8_t>(field.value)));
-                    break;
-                case TypeID::WORD:
-                    dataOrOffset = std::get<uint16_t>(field.value);
-                    break;
-                case TypeID::SHORT: {
-                    int16_t v = std::get<int16_t>(field.value);
-                    dataOrOffset = static_cast<uint32_t>(static_cast<uint16_t>(v));
-                    break;
-                }
-                case TypeID::DWORD:
-                    dataOrOffset = std::get<uint32_t>(field.value);
-                    break;
-                case TypeID::INT: {
-                    int32_t v = std::get<int32_t>(field.value);
-                    std::memcpy(&dataOrOffset, &v, 4);
-                    break;
-                }
-                case TypeID::FLOAT: {
-                    float v = std::get<float>(field.value);
-                    std::memcpy(&dataOrOffset, &v, 4);
-                    break;
-                }
-                case TypeID::DWORD64: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    uint64_t v = std::get<uint64_t>(field.value);
-                    WriterState::append(w.fieldDataBuf, v);
-                    break;
-                }
-                case TypeID::INT64: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    int64_t v = std::get<int64_t>(field.value);
-                    WriterState::append(w.fieldDataBuf, v);
-                    break;
-                }
-                case TypeID::DOUBLE: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    double v = std::get<double>(field.value);
-                    WriterState::append(w.fieldDataBuf, v);
-                    break;
-                }
-                case TypeID::ExoString: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    const auto& s = std::get<std::string>(field.value);
-                    uint32_t len = static_cast<uint32_t>(s.size());
-                    WriterState::append(w.fieldDataBuf, len);
-                    w.fieldDataBuf.insert(w.fieldDataBuf.end(), s.begin(), s.end());
-                    break;
-                }
-                case TypeID::ResRef: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    const auto& s = std::get<std::string>(field.value);
-                    uint8_t len = static_cast<uint8_t>(std::min(s.size(), (size_t)255));
-                    w.fieldDataBuf.push_back(len);
-                    w.fieldDataBuf.insert(w.fieldDataBuf.end(), s.begin(), s.begin() + len);
-                    break;
-                }
-                case TypeID::ExoLocString: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    const auto& loc = std::get<ExoLocString>(field.value);
-                    uint32_t sref = (loc.stringref == -1) ? 0xFFFFFFFF : static_cast<uint32_t>(loc.stringref);
-                    uint32_t scount = static_cast<uint32_t>(loc.strings.size());
-                    size_t sizePos = w.fieldDataBuf.size();
-                    WriterState::append(w.fieldDataBuf, uint32_t(0));
-                    WriterState::append(w.fieldDataBuf, sref);
-                    WriterState::append(w.fieldDataBuf, scount);
-                    for (const auto& ls : loc.strings) {
-                        uint32_t sid = (ls.language << 2) | (ls.gender ? 1 : 0);
-                        uint32_t slen = static_cast<uint32_t>(ls.text.size());
-                        WriterState::append(w.fieldDataBuf, sid);
-                        WriterState::append(w.fieldDataBuf, slen);
-                        w.fieldDataBuf.insert(w.fieldDataBuf.end(), ls.text.begin(), ls.text.end());
-                    }
-                    uint32_t totalSize = static_cast<uint32_t>(w.fieldDataBuf.size() - sizePos - 4);
-                    std::memcpy(&w.fieldDataBuf[sizePos], &totalSize, 4);
-                    break;
-                }
-                case TypeID::VOID: {
-                    dataOrOffset = static_cast<uint32_t>(w.fieldDataBuf.size());
-                    const auto& vd = std::get<VoidData>(field.value);
-                    uint32_t len = static_cast<uint32_t>(vd.data.size());
-                    WriterState::append(w.fieldDataBuf, len);
-                    w.fieldDataBuf.insert(w.fieldDataBuf.end(), vd.data.begin(), vd.data.end());
-                    break;
-                }
-                case TypeID::Structure: {
-                    auto ptr = std::get<StructurePtr>(field.value);
-                    dataOrOffset = writeStruct(ptr ? *ptr : Structure());
-                    break;
+static bool inFieldData(TypeID type) {
+    switch (type) {
+        case TypeID::DWORD64:
+        case TypeID::INT64:
+        case TypeID::DOUBLE:
+        case TypeID::ExoString:
+        case TypeID::ResRef:
+        case TypeID::ExoLocString:
+        case TypeID::VOID:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t Writer::intern(const std::string& label) {
+    if (m_labels.size() * 2 >= m_labelTable.size()) {
+        m_labelTable.assign(std::max<size_t>(64, m_labelTable.size() * 2), UINT32_MAX);
+        uint32_t mask = static_cast<uint32_t>(m_labelTable.size() - 1);
+        for (uint32_t i = 0; i < m_labels.size(); ++i) {
+            uint32_t pos = hashLabel(*m_labels[i]) & mask;
+            while (m_labelTable[pos] != UINT32_MAX) pos = (pos + 1) & mask;
+            m_labelTable[pos] = i;
+        }
+    }
+    uint32_t mask = static_cast<uint32_t>(m_labelTable.size() - 1);
+    for (uint32_t pos = hashLabel(label) & mask;; pos = (pos + 1) & mask) {
+        uint32_t idx = m_labelTable[pos];
+        if (idx == UINT32_MAX) {
+            idx = static_cast<uint32_t>(m_labels.size());
+            m_labelTable[pos] = idx;
+            m_labels.push_back(&label);
+            return idx;
+        }
+        if (*m_labels[idx] == label) return idx;
+    }
+}
+
+void Writer::layout(const Structure& st) {
+    uint32_t index = static_cast<uint32_t>(m_structs.size());
+    m_structs.push_back({ st.structId, static_cast<uint32_t>(m_fields.size()), 0, 0 });
+    for (const auto& label : st.fieldOrder) {
+        auto it = st.fields.find(label);
+        if (it == st.fields.end()) continue;
+        const Field& field = it->second;
+        uint32_t value = slotValue(field);
+        m_fields.push_back({ &field, intern(label), field.typeId, value });
+        if (inFieldData(field.typeId)) {
+            m_dataSize += value;
+        } else if (field.typeId == TypeID::List) {
+            m_listSize += 4 + 4 * value;
+        }
+    }
+    uint32_t first = m_structs[index].firstField;
+    uint32_t count = static_cast<uint32_t>(m_fields.size()) - first;
+    m_structs[index].fieldCount = count;
+    if (count > 1) m_indicesSize += 4 * count;
+    for (uint32_t i = first; i < first + count; ++i) {
+        const Field& field = *m_fields[i].field;
+        if (field.typeId == TypeID::Structure) {
+            layout(structOf(field));
+        } else if (field.typeId == TypeID::List && m_fields[i].value > 0) {
+            if (const auto* list = listOf(field)) {
+                for (const auto& item : *list) layout(item);
+            }
+        }
+    }
+    m_structs[index].subtree = static_cast<uint32_t>(m_structs.size()) - index;
+}
+
+template<typename Sink>
+void Writer::write(Sink& out, const char* fileType, const char* fileVersion) const {
+    uint32_t structOff = 56;
+    uint32_t fieldOff = structOff + static_cast<uint32_t>(m_structs.size() * 12);
+    uint32_t labelOff = fieldOff + static_cast<uint32_t>(m_fields.size() * 12);
+    uint32_t fieldDataOff = labelOff + static_cast<uint32_t>(m_labels.size() * 16);
+    uint32_t fieldIndicesOff = fieldDataOff + m_dataSize;
+    uint32_t listIndicesOff = fieldIndicesOff + m_indicesSize;
+    out.put(fileType, 4);
+    out.put(fileVersion, 4);
+    uint32_t header[12] = {
+        structOff, static_cast<uint32_t>(m_structs.size()),
+        fieldOff, static_cast<uint32_t>(m_fields.size()),
+        labelOff, static_cast<uint32_t>(m_labels.size()),
+        fieldDataOff, m_dataSize,
+        fieldIndicesOff, m_indicesSize,
+        listIndicesOff, m_listSize
+    };
+    out.put(header, sizeof(header));
+
+    uint32_t indices = 0;
+    for (const auto& st : m_structs) {
+        uint32_t rec[3] = { static_cast<uint32_t>(st.structId), 0, st.fieldCount };
+        if (st.fieldCount == 1) {
+            rec[1] = st.firstField;
+        } else if (st.fieldCount > 1) {
+            rec[1] = indices;
+            indices += 4 * st.fieldCount;
+        }
+        out.put(rec, sizeof(rec));
+    }
+
+    // Children of struct i are numbered from i + 1 in field order, each
+    // followed by its own subtree.
+    uint32_t data = 0;
+    uint32_t list = 0;
+    for (uint32_t s = 0; s < m_structs.size(); ++s) {
+        const StructSlot& st = m_structs[s];
+        uint32_t child = s + 1;
+        for (uint32_t i = st.firstField; i < st.firstField + st.fieldCount; ++i) {
+            const FieldSlot& slot = m_fields[i];
+            uint32_t value = slot.value;
+            if (slot.typeId == TypeID::Structure) {
+                value = child;
+                child += m_structs[child].subtree;
+            } else if (slot.typeId == TypeID::List) {
+                for (uint32_t k = 0; k < slot.value; ++k) child += m_structs[child].subtree;
+                value = list;
+                list += 4 + 4 * slot.value;
+            } else if (inFieldData(slot.typeId)) {
+                value = data;
+                data += slot.value;
+            }
+            uint32_t rec[3] = { static_cast<uint32_t>(slot.typeId), slot.label, value };
+            out.put(rec, sizeof(rec));
+        }
+    }
+
+    for (const std::string* label : m_labels) {
+        char buf[16] = {};
+        std::memcpy(buf, label->data(), std::min(label->size(), (size_t)16));
+        out.put(buf, 16);
+    }
+
+    for (const auto& slot : m_fields) {
+        if (!inFieldData(slot.typeId)) continue;
+        const Field& field = *slot.field;
+        switch (field.typeId) {
+            case TypeID::DWORD64:
+                out.put(&std::get<uint64_t>(field.value), 8);
+                break;
+            case TypeID::INT64:
+                out.put(&std::get<int64_t>(field.value), 8);
+                break;
+            case TypeID::DOUBLE:
+                out.put(&std::get<double>(field.value), 8);
+                break;
+            case TypeID::ExoString: {
+                const auto& s = std::get<std::string>(field.value);
+                uint32_t len = static_cast<uint32_t>(s.size());
+                out.put(&len, 4);
+                out.put(s.data(), len);
+                break;
+            }
+            case TypeID::ResRef: {
+                const auto& s = std::get<std::string>(field.value);
+                uint8_t len = static_cast<uint8_t>(std::min(s.size(), (size_t)255));
+                out.put(&len, 1);
+                out.put(s.data(), len);
+                break;
+            }
+            case TypeID::ExoLocString: {
+                const auto& loc = std::get<ExoLocString>(field.value);
+                uint32_t head[3] = {
+                    slot.value - 4,
+                    loc.stringref == -1 ? 0xFFFFFFFF : static_cast<uint32_t>(loc.stringref),
+                    static_cast<uint32_t>(loc.strings.size())
+                };
+                out.put(head, sizeof(head));
+                for (const auto& ls : loc.strings) {
+                    uint32_t str[2] = { (ls.language << 2) | (ls.gender ? 1u : 0u), static_cast<uint32_t>(ls.text.size()) };
+                    out.put(str, sizeof(str));
+                    out.put(ls.text.data(), ls.text.size());
                 }
-                case TypeID::List: {
-                    auto ptr = std::get<ListPtr>(field.value);
-                    dataOrOffset = static_cast<uint32_t>(w.listIndicesBuf.size());
-                    uint32_t count = ptr ? static_cast<uint32_t>(ptr->size()) : 0;
-                    WriterState::append(w.listIndicesBuf, count);
-                    if (ptr) {
-                        for (const auto& item : *ptr) {
-                            uint32_t childIdx = writeStruct(item);
-                            WriterState::append(w.listIndicesBuf, childIdx);
-                        }
-                    }
-                    break;
+                break;
+            }
+            case TypeID::VOID: {
+                const auto& vd = std::get<VoidData>(field.value).data;
+                uint32_t len = static_cast<uint32_t>(vd.size());
+                out.put(&len, 4);
+                out.put(vd.data(), vd.size());
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    for (const auto& st : m_structs) {
+        if (st.fieldCount < 2) continue;
+        for (uint32_t i = st.firstField; i < st.firstField + st.fieldCount; ++i) out.put(&i, 4);
+    }
+
+    for (uint32_t s = 0; s < m_structs.size(); ++s) {
+        const StructSlot& st = m_structs[s];
+        uint32_t child = s + 1;
+        for (uint32_t i = st.firstField; i < st.firstField + st.fieldCount; ++i) {
+            const FieldSlot& slot = m_fields[i];
+            if (slot.typeId == TypeID::Structure) {
+                child += m_structs[child].subtree;
+            } else if (slot.typeId == TypeID::List) {
+                out.put(&slot.value, 4);
+                for (uint32_t k = 0; k < slot.value; ++k) {
+                    out.put(&child, 4);
+                    child += m_structs[child].subtree;
                 }
-                default:
-                    break;
             }
-            WriterState::append(w.fieldsBuf, typeId);
-            WriterState::append(w.fieldsBuf, labelIdx);
-            WriterState::append(w.fieldsBuf, dataOrOffset);
         }
+    }
+}
+
+struct MemorySink {
+    uint8_t* pos;
+    void put(const void* data, size_t size) {
+        if (size) std::memcpy(pos, data, size);
+        pos += size;
+    }
+};
 
-        if (fieldIndices.size() == 1) {
-            std::memcpy(&w.structsBuf[structPos + 4], &fieldIndices[0], 4);
-        } else if (fieldIndices.size() > 1) {
-            uint32_t indicesOffset = static_cast<uint32_t>(w.fieldIndicesBuf.size());
-            std::memcpy(&w.structsBuf[structPos + 4], &indicesOffset, 4);
-            for (uint32_t fi : fieldIndices)
-                WriterState::append(w.fieldIndicesBuf, fi);
+// Batches the many small puts into large writes.
+struct FileSink {
+    std::ofstream& file;
+    std::vector<char> buffer;
+    size_t used = 0;
+    explicit FileSink(std::ofstream& f) : file(f), buffer(1 << 16) {}
+    void put(const void* data, size_t size) {
+        if (used + size > buffer.size()) flush();
+        if (size > buffer.size()) {
+            file.write(static_cast<const char*>(data), size);
+            return;
         }
-        return structIdx;
-    };
+        if (size) std::memcpy(buffer.data() + used, data, size);
+        used += size;
+    }
+    void flush() {
+        file.write(buffer.data(), used);
+        used = 0;
+    }
+};
 
-    writeStruct(*m_root);
-
-    uint32_t headerSize = 56;
-    uint32_t structOff = headerSize;
-    uint32_t fieldOff = structOff + static_cast<uint32_t>(w.structsBuf.size());
-    uint32_t labelOff = fieldOff + static_cast<uint32_t>(w.fieldsBuf.size());
-    uint32_t fieldDataOff = labelOff + static_cast<uint32_t>(w.labelsBuf.size());
-    uint32_t fieldIndicesOff = fieldDataOff + static_cast<uint32_t>(w.fieldDataBuf.size());
-    uint32_t listIndicesOff = fieldIndicesOff + static_cast<uint32_t>(w.fieldIndicesBuf.size());
-    uint32_t totalSize = listIndicesOff + static_cast<uint32_t>(w.listIndicesBuf.size());
-
-    std::vector<uint8_t> out(totalSize);
-    std::memcpy(&out[0], m_header.fileType, 4);
-    std::memcpy(&out[4], m_header.fileVersion, 4);
-    auto w32 = [&](size_t off, uint32_t val) { std::memcpy(&out[off], &val, 4); };
-    w32(8, structOff);
-    w32(12, w.structCount);
-    w32(16, fieldOff);
-    w32(20, w.fieldCount);
-    w32(24, labelOff);
-    w32(28, static_cast<uint32_t>(w.labelMap.size()));
-    w32(32, fieldDataOff);
-    w32(36, static_cast<uint32_t>(w.fieldDataBuf.size()));
-    w32(40, fieldIndicesOff);
-    w32(44, static_cast<uint32_t>(w.fieldIndicesBuf.size()));
-    w32(48, listIndicesOff);
-    w32(52, static_cast<uint32_t>(w.listIndicesBuf.size()));
-
-    std::memcpy(&out[structOff], w.structsBuf.data(), w.structsBuf.size());
-    std::memcpy(&out[fieldOff], w.fieldsBuf.data(), w.fieldsBuf.size());
-    std::memcpy(&out[labelOff], w.labelsBuf.data(), w.labelsBuf.size());
-    if (!w.fieldDataBuf.empty())
-        std::memcpy(&out[fieldDataOff], w.fieldDataBuf.data(), w.fieldDataBuf.size());
-    if (!w.fieldIndicesBuf.empty())
-        std::memcpy(&out[fieldIndicesOff], w.fieldIndicesBuf.data(), w.fieldIndicesBuf.size());
-    if (!w.listIndicesBuf.empty())
-        std::memcpy(&out[listIndicesOff], w.listIndicesBuf.data(), w.listIndicesBuf.size());
+}  // namespace
 
+bool GFF32File::save(const std::string& path) {
+    if (!m_root) return false;
+    Writer writer(*m_root);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    FileSink sink(file);
+    writer.write(sink, m_header.fileType, m_header.fileVersion);
+    sink.flush();
+    return static_cast<bool>(file);
+}
+
+std::vector<uint8_t> GFF32File::save() {
+    if (!m_root) return {};
+    Writer writer(*m_root);
+    std::vector<uint8_t> out(writer.size());
+    MemorySink sink{ out.data() };
+    writer.write(sink, m_header.fileType, m_header.fileVersion);
     return out;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <variant>
@@ -129,20 +130,173 @@ public:
 private:
     bool parseHeader(const uint8_t* data, size_t size);
     bool parseContent(const uint8_t* data, size_t size);
-    Structure parseStruct(const uint8_t* data, size_t size, 
-                          const std::vector<std::string>& labels,
-                          uint32_t structIndex,
-                          std::vector<Structure>& structs);
-    template<typename T>
-    T readAt(const uint8_t* data, size_t offset) const {
-        T val;
-        std::memcpy(&val, data + offset, sizeof(T));
-        return val;
-    }
     Header m_header;
     std::shared_ptr<Structure> m_root;
     bool m_loaded;
 };
+class FlatFile;
+class FlatStruct;
+class FlatList;
+
+template<typename Owner, typename Item>
+class FlatIterator {
+public:
+    FlatIterator(Owner owner, size_t index) : m_owner(owner), m_index(index) {}
+    Item operator*() const { return m_owner[m_index]; }
+    FlatIterator& operator++() { ++m_index; return *this; }
+    bool operator!=(const FlatIterator& other) const { return m_index != other.m_index; }
+private:
+    Owner m_owner;
+    size_t m_index;
+};
+
+struct FlatLocalString {
+    uint32_t language;
+    bool gender;
+    std::string_view text;
+};
+
+// Views into a FlatFile. They are two words wide, copied by value, and
+// stay valid until the file is closed or reloaded.
+class FlatField {
+public:
+    FlatField() = default;
+    explicit operator bool() const { return m_file != nullptr; }
+    std::string_view label() const;
+    TypeID typeId() const;
+    std::string getTypeName() const;
+    std::string getDisplayValue() const;
+    bool isComplex() const;
+    // Any numeric type converts; everything else reads as 0.
+    int64_t asInt() const;
+    uint64_t asUInt() const;
+    float asFloat() const { return static_cast<float>(asDouble()); }
+    double asDouble() const;
+    // ExoString / ResRef text and VOID bytes; empty for other types.
+    std::string_view asString() const;
+    std::string_view asBytes() const;
+    // ExoLocString parts.
+    int32_t stringRef() const;
+    size_t localCount() const;
+    FlatLocalString local(size_t i) const;
+    FlatStruct asStruct() const;
+    FlatList asList() const;
+private:
+    friend class FlatStruct;
+    FlatField(const FlatFile* file, uint32_t index) : m_file(file), m_index(index) {}
+    const FlatFile* m_file = nullptr;
+    uint32_t m_index = 0;
+};
+
+class FlatStruct {
+public:
+    using iterator = FlatIterator<FlatStruct, FlatField>;
+    FlatStruct() = default;
+    // False for a missing root or an out-of-range struct reference, which
+    // reads as an empty struct with id -1.
+    explicit operator bool() const { return m_file != nullptr; }
+    int32_t structId() const;
+    size_t fieldCount() const;
+    FlatField operator[](size_t i) const;
+    bool hasField(std::string_view label) const { return static_cast<bool>(getField(label)); }
+    FlatField getField(std::string_view label) const;
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, fieldCount()); }
+private:
+    friend class FlatFile;
+    friend class FlatField;
+    friend class FlatList;
+    FlatStruct(const FlatFile* file, uint32_t index) : m_file(file), m_index(index) {}
+    const FlatFile* m_file = nullptr;
+    uint32_t m_index = 0;
+};
+
+class FlatList {
+public:
+    using iterator = FlatIterator<FlatList, FlatStruct>;
+    FlatList() = default;
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    FlatStruct operator[](size_t i) const;
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, m_count); }
+private:
+    friend class FlatField;
+    FlatList(const FlatFile* file, uint32_t first, uint32_t count) : m_file(file), m_first(first), m_count(count) {}
+    const FlatFile* m_file = nullptr;
+    uint32_t m_first = 0;
+    uint32_t m_count = 0;
+};
+
+// Read-only GFF32 tree kept in a handful of flat arrays: one record per
+// struct, each struct's fields as one contiguous run of records, list items
+// as struct indices, and every label, string and VOID payload in a single
+// byte arena. Labels are interned, so lookups compare indices. Children are
+// referenced by index, so any file costs a fixed number of allocations and
+// close() releases them together. Fields come back in the same order and
+// with the same values as GFF32File::root().
+class FlatFile {
+public:
+    bool load(const std::string& path);
+    bool load(const std::vector<uint8_t>& data);
+    bool load(const uint8_t* data, size_t size);
+    void close();
+    bool isLoaded() const { return m_loaded; }
+    const Header& header() const { return m_header; }
+    std::string fileType() const { return std::string(m_header.fileType); }
+    std::string fileVersion() const { return std::string(m_header.fileVersion); }
+    FlatStruct root() const;
+    size_t structCount() const { return m_structs.size(); }
+    // Bytes held by the arrays and the arena.
+    size_t memoryUsage() const;
+    // Copies the tree out into the editable Structure form.
+    Structure toStructure() const;
+private:
+    friend class FlatField;
+    friend class FlatStruct;
+    friend class FlatList;
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+    struct StructRec {
+        int32_t structId;
+        uint32_t firstField;
+        uint32_t fieldCount;
+    };
+    // data holds the value for BYTE..DOUBLE (integers widened, FLOAT and
+    // DOUBLE as their bits), the arena offset for strings and VOID, the
+    // struct index, the first list item, or stringref << 32 | first local.
+    // size is the byte, item or local count.
+    struct FieldRec {
+        uint32_t label;
+        TypeID typeId;
+        uint32_t size;
+        uint64_t data;
+    };
+    struct LocalRec {
+        uint32_t language;
+        uint32_t gender;
+        uint32_t offset;
+        uint32_t length;
+    };
+    struct Span {
+        uint32_t offset;
+        uint32_t length;
+    };
+    uint32_t appendText(const char* text, size_t length);
+    uint32_t appendUtf8(const char* text, size_t length);
+    std::string_view text(uint32_t offset, uint32_t length) const {
+        return std::string_view(m_arena.data() + offset, length);
+    }
+    uint32_t findLabel(std::string_view label) const;
+    void buildStructure(uint32_t index, Structure& out, std::vector<uint8_t>& expanded) const;
+    Header m_header{};
+    std::vector<StructRec> m_structs;
+    std::vector<FieldRec> m_fields;
+    std::vector<uint32_t> m_listItems;
+    std::vector<LocalRec> m_locals;
+    std::vector<Span> m_labels;    // distinct labels, sorted
+    std::vector<char> m_arena;
+    bool m_loaded = false;
+};
 std::string typeIdToString(TypeID type);
 std::string fieldValueToString(const FieldValue& value, TypeID type);
 using FieldVisitor = std::function<void(const std::string& path, const Field& field, int depth)>;
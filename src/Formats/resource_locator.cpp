@@ -0,0 +1,218 @@
+#include "resource_locator.h"
+#include "fnv.h"
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace ResourceLocator {
+    struct ArchiveStamp {
+        const ERFFile* erf;
+        uint64_t serial;
+    };
+
+    struct Package {
+        int priority = 0;
+        uint64_t order = 0;
+        std::vector<ArchiveStamp> archives;
+    };
+
+    struct Slot {
+        const ERFFile* erf;
+        uint32_t entry;
+        uint32_t archive;
+        const Package* package;
+    };
+
+    static std::shared_mutex s_mutex;
+    static std::unordered_multimap<uint64_t, Slot> s_tables[3];
+    // unordered_map nodes don't move, so slots can point at their package.
+    static std::unordered_map<const void*, Package> s_packages;
+    static uint64_t s_nextOrder = 0;
+    static uint64_t s_generation = 0;
+
+    // The part of a name each Match kind hashes and compares.
+    static void keyRange(const std::string& name, Match match, size_t& begin, size_t& end) {
+        begin = 0;
+        end = name.size();
+        if (match == Match::Exact) return;
+        size_t sl = name.find_last_of("/\\");
+        if (sl != std::string::npos) begin = sl + 1;
+        if (match == Match::NoExt) {
+            size_t dp = name.rfind('.');
+            if (dp != std::string::npos && dp >= begin) end = dp;
+        }
+    }
+
+    static bool sameFolded(const char* a, size_t aLen, const char* b, size_t bLen) {
+        if (aLen != bLen) return false;
+        for (size_t i = 0; i < aLen; i++) {
+            char ca = a[i], cb = b[i];
+            if (ca >= 'A' && ca <= 'Z') ca += 'a' - 'A';
+            if (cb >= 'A' && cb <= 'Z') cb += 'a' - 'A';
+            if (ca != cb) return false;
+        }
+        return true;
+    }
+
+    static bool stampMatches(const ArchiveStamp& stamp, const ERFFile* erf) {
+        return stamp.erf == erf && (!erf || stamp.serial == erf->serial());
+    }
+
+    static void indexArchive(const Package& package, uint32_t archive, const ERFFile& erf) {
+        const auto& entries = erf.entries();
+        // V3.0 archives carry the game's own hash, not fnv64Lower of the name.
+        bool hashIsFolded = erf.version() != ERFVersion::V3_0;
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            const std::string& name = entries[i].name;
+            Slot slot{&erf, static_cast<uint32_t>(i), archive, &package};
+            uint64_t exactKey = hashIsFolded ? entries[i].name_hash : fnv64Lower(name);
+            s_tables[static_cast<int>(Match::Exact)].emplace(exactKey, slot);
+
+            size_t begin, end;
+            keyRange(name, Match::Basename, begin, end);
+            s_tables[static_cast<int>(Match::Basename)].emplace(fnv64Lower(name.data() + begin, end - begin), slot);
+            keyRange(name, Match::NoExt, begin, end);
+            s_tables[static_cast<int>(Match::NoExt)].emplace(fnv64Lower(name.data() + begin, end - begin), slot);
+        }
+    }
+
+    static void removeSlots(const Package* package) {
+        for (auto& table : s_tables) {
+            for (auto it = table.begin(); it != table.end();) {
+                if (it->second.package == package) it = table.erase(it);
+                else ++it;
+            }
+        }
+    }
+
+    static Package& packageFor(const void* package) {
+        auto [it, inserted] = s_packages.try_emplace(package);
+        if (inserted) it->second.order = s_nextOrder++;
+        return it->second;
+    }
+
+    void syncPackage(const void* package, const std::unique_ptr<ERFFile>* erfs, size_t count) {
+        {
+            std::shared_lock<std::shared_mutex> lock(s_mutex);
+            auto it = s_packages.find(package);
+            if (it != s_packages.end() && it->second.archives.size() == count) {
+                bool same = true;
+                for (size_t i = 0; i < count && same; i++)
+                    same = stampMatches(it->second.archives[i], erfs[i].get());
+                if (same) return;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(s_mutex);
+        Package& pkg = packageFor(package);
+
+        // Archives appended since the last sync are indexed on their own; any
+        // other change (removed, reordered, reopened, rewritten) rebuilds the
+        // package.
+        size_t keep = 0;
+        while (keep < pkg.archives.size() && keep < count && stampMatches(pkg.archives[keep], erfs[keep].get()))
+            keep++;
+        if (keep == pkg.archives.size() && keep == count) return;
+        if (keep < pkg.archives.size()) {
+            removeSlots(&pkg);
+            pkg.archives.clear();
+            keep = 0;
+        }
+
+        size_t added = 0;
+        for (size_t i = keep; i < count; i++)
+            if (erfs[i]) added += erfs[i]->entries().size();
+        for (auto& table : s_tables) table.reserve(table.size() + added);
+
+        for (size_t i = keep; i < count; i++) {
+            const ERFFile* erf = erfs[i].get();
+            pkg.archives.push_back({erf, erf ? erf->serial() : 0});
+            if (erf) indexArchive(pkg, static_cast<uint32_t>(i), *erf);
+        }
+        s_generation++;
+    }
+
+    void syncPackage(const void* package, const std::vector<std::unique_ptr<ERFFile>>& erfs) {
+        syncPackage(package, erfs.data(), erfs.size());
+    }
+
+    void setPriority(const void* package, int priority) {
+        std::unique_lock<std::shared_mutex> lock(s_mutex);
+        Package& pkg = packageFor(package);
+        if (pkg.priority == priority) return;
+        pkg.priority = priority;
+        s_generation++;
+    }
+
+    void removePackage(const void* package) {
+        std::unique_lock<std::shared_mutex> lock(s_mutex);
+        auto it = s_packages.find(package);
+        if (it == s_packages.end()) return;
+        removeSlots(&it->second);
+        s_packages.erase(it);
+        s_generation++;
+    }
+
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(s_mutex);
+        for (auto& table : s_tables) table.clear();
+        s_packages.clear();
+        s_generation++;
+    }
+
+    // True if a should win over b.
+    static bool outranks(const Slot& a, const Slot& b) {
+        if (a.package->priority != b.package->priority) return a.package->priority > b.package->priority;
+        if (a.package->order != b.package->order) return a.package->order < b.package->order;
+        if (a.archive != b.archive) return a.archive < b.archive;
+        return a.entry < b.entry;
+    }
+
+    ResourceRef find(const std::string& name, Match match, const void* package) {
+        size_t begin, end;
+        keyRange(name, match, begin, end);
+        uint64_t key = fnv64Lower(name.data() + begin, end - begin);
+
+        std::shared_lock<std::shared_mutex> lock(s_mutex);
+        const Package* scope = nullptr;
+        if (package) {
+            auto pit = s_packages.find(package);
+            if (pit == s_packages.end()) return {};
+            scope = &pit->second;
+        }
+
+        auto range = s_tables[static_cast<int>(match)].equal_range(key);
+        const Slot* best = nullptr;
+        for (auto it = range.first; it != range.second; ++it) {
+            const Slot& slot = it->second;
+            if (scope && slot.package != scope) continue;
+            if (best && !outranks(slot, *best)) continue;
+            // Guard against hash collisions.
+            const std::string& entryName = slot.erf->entries()[slot.entry].name;
+            size_t eBegin, eEnd;
+            keyRange(entryName, match, eBegin, eEnd);
+            if (!sameFolded(entryName.data() + eBegin, eEnd - eBegin, name.data() + begin, end - begin)) continue;
+            best = &slot;
+        }
+
+        ResourceRef ref;
+        if (best) {
+            ref.erf = best->erf;
+            ref.entryIndex = best->entry;
+        }
+        return ref;
+    }
+
+    ResourceRef findAny(const std::string& name, const void* package) {
+        ResourceRef ref = find(name, Match::Exact, package);
+        if (!ref) ref = find(name, Match::Basename, package);
+        if (!ref) ref = find(name, Match::NoExt, package);
+        return ref;
+    }
+
+    uint64_t generation() {
+        std::shared_lock<std::shared_mutex> lock(s_mutex);
+        return s_generation;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "erf.h"
+
+// A resolved resource: one entry inside one open archive.
+struct ResourceRef {
+    const ERFFile* erf = nullptr;
+    size_t entryIndex = 0;
+
+    explicit operator bool() const { return erf != nullptr; }
+    const ERFEntry& entry() const { return erf->entries()[entryIndex]; }
+    std::vector<uint8_t> read() const { return erf ? erf->readEntry(entry()) : std::vector<uint8_t>{}; }
+};
+
+// Process-wide resource name -> (archive, entry) index.
+//
+// Names are keyed by the 64-bit FNV of the case-folded name, three ways: the
+// full entry name, its basename and its basename without extension. Archives
+// are registered in packages (any stable address works as the key; the ERF
+// vectors in AppState use their own address). When several archives provide
+// the same name, the package with the higher priority wins, and within equal
+// priority the package registered first wins, then the earlier archive in the
+// package - the same first-match order the old linear scans had.
+//
+// The locator holds raw ERFFile pointers. syncPackage() re-checks a package
+// against its archives (pointer + ERFFile::serial) and re-indexes whatever
+// was added, removed, reopened or rewritten; a package that is not re-synced
+// before its archives are destroyed must be removed with removePackage().
+namespace ResourceLocator {
+    enum class Match {
+        Exact,      // full entry name
+        Basename,   // last path component
+        NoExt       // last path component without its extension
+    };
+
+    void syncPackage(const void* package, const std::unique_ptr<ERFFile>* erfs, size_t count);
+    void syncPackage(const void* package, const std::vector<std::unique_ptr<ERFFile>>& erfs);
+    // Packages start at priority 0; changing it doesn't re-index anything.
+    void setPriority(const void* package, int priority);
+    void removePackage(const void* package);
+    void clear();
+
+    // package == nullptr searches every registered package, so every package
+    // must be in sync (or removed) first.
+    ResourceRef find(const std::string& name, Match match, const void* package = nullptr);
+    // Exact, then basename, then extension-less.
+    ResourceRef findAny(const std::string& name, const void* package = nullptr);
+
+    // Bumped whenever the index changes.
+    uint64_t generation();
+}
@@ -0,0 +1,234 @@
+#include "bulk_extract.h"
+#include "erf.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+// Files per pool loop. Between loops the pool is free for the render
+// thread's per-frame work, and a loop that finds the pool busy only runs
+// one batch inline.
+static const size_t BATCH_FILES = 256;
+
+static int64_t nowTicks() {
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+BulkExtractor::~BulkExtractor() {
+    cancel();
+}
+
+void BulkExtractor::addArchive(const std::string& path) {
+    Request r;
+    r.archive = path;
+    r.all = true;
+    m_queue.push_back(std::move(r));
+}
+
+void BulkExtractor::addEntries(const std::string& path, std::vector<size_t> entryIndices) {
+    Request r;
+    r.archive = path;
+    r.entries = std::move(entryIndices);
+    m_queue.push_back(std::move(r));
+}
+
+void BulkExtractor::start(const std::string& outDir) {
+    cancel();
+    reset();
+    m_startTicks = nowTicks();
+    m_thread = std::thread(&BulkExtractor::execute, this, std::move(m_queue), outDir);
+    m_queue.clear();
+}
+
+bool BulkExtractor::run(const std::string& outDir) {
+    start(outDir);
+    wait();
+    return m_failures.empty() && !cancelled();
+}
+
+void BulkExtractor::cancel() {
+    m_cancel = true;
+    {
+        std::lock_guard<std::mutex> lock(m_bufferMutex);
+        m_bufferFree.notify_all();
+    }
+    wait();
+}
+
+void BulkExtractor::wait() {
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void BulkExtractor::reset() {
+    wait();
+    m_cancel = false;
+    m_finished = false;
+    m_filesDone = 0;
+    m_filesTotal = 0;
+    m_bytesDone = 0;
+    m_bytesTotal = 0;
+    m_failures.clear();
+    m_stats = Stats();
+}
+
+double BulkExtractor::elapsedSeconds() const {
+    auto ticks = std::chrono::steady_clock::duration(nowTicks() - m_startTicks.load());
+    return std::chrono::duration<double>(ticks).count();
+}
+
+void BulkExtractor::fail(const std::string& archive, const std::string& name, const char* reason) {
+    std::lock_guard<std::mutex> lock(m_failMutex);
+    m_failures.push_back({ archive, name, reason });
+}
+
+// Entries bigger than the whole budget still go through, one at a time.
+uint64_t BulkExtractor::acquireBuffer(uint64_t bytes) {
+    bytes = std::min(bytes, BUFFER_BUDGET);
+    std::unique_lock<std::mutex> lock(m_bufferMutex);
+    m_bufferFree.wait(lock, [&] { return m_buffered + bytes <= BUFFER_BUDGET || cancelled(); });
+    m_buffered += bytes;
+    return bytes;
+}
+
+void BulkExtractor::releaseBuffer(uint64_t bytes) {
+    if (!bytes) return;
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    m_buffered -= bytes;
+    m_bufferFree.notify_all();
+}
+
+// Entry names come from the archive; keep them inside the output folder.
+static bool safeRelativePath(const fs::path& p) {
+    if (p.empty() || p.has_root_path()) return false;
+    for (const auto& part : p)
+        if (part == "..") return false;
+    return true;
+}
+
+void BulkExtractor::execute(std::vector<Request> requests, std::string outDir) {
+    struct Job {
+        size_t archive;
+        size_t entry;
+        uint64_t offset;
+        std::string outPath;
+    };
+
+    std::vector<std::unique_ptr<ERFFile>> archives;
+    std::unordered_map<std::string, size_t> archiveIndex;
+    std::vector<Job> jobs;
+    std::unordered_map<std::string, size_t> jobByPath;
+    fs::path root(outDir);
+
+    for (const auto& req : requests) {
+        auto it = archiveIndex.find(req.archive);
+        if (it == archiveIndex.end()) {
+            auto erf = std::make_unique<ERFFile>();
+            if (!erf->open(req.archive)) {
+                fail(req.archive, "", "cannot open archive");
+                continue;
+            }
+            it = archiveIndex.emplace(req.archive, archives.size()).first;
+            archives.push_back(std::move(erf));
+        }
+        size_t ai = it->second;
+        const auto& entries = archives[ai]->entries();
+        size_t count = req.all ? entries.size() : req.entries.size();
+        for (size_t k = 0; k < count; k++) {
+            size_t ei = req.all ? k : req.entries[k];
+            if (ei >= entries.size()) {
+                fail(req.archive, "#" + std::to_string(ei), "no such entry");
+                continue;
+            }
+            const ERFEntry& entry = entries[ei];
+            fs::path rel(entry.name);
+            if (!safeRelativePath(rel)) {
+                fail(req.archive, entry.name, "name escapes the output folder");
+                continue;
+            }
+            Job job{ ai, ei, entry.offset, (root / rel).string() };
+            std::string key = job.outPath;
+            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+            auto dup = jobByPath.find(key);
+            if (dup != jobByPath.end()) {
+                jobs[dup->second] = std::move(job);
+            } else {
+                jobByPath.emplace(std::move(key), jobs.size());
+                jobs.push_back(std::move(job));
+            }
+        }
+    }
+
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+        return a.archive != b.archive ? a.archive < b.archive : a.offset < b.offset;
+    });
+    uint64_t totalBytes = 0;
+    for (const auto& job : jobs) totalBytes += archives[job.archive]->entries()[job.entry].length;
+    m_bytesTotal = totalBytes;
+    m_filesTotal = jobs.size();
+
+    // Every folder is created once up front instead of per file.
+    std::set<fs::path> dirs;
+    for (const auto& job : jobs) dirs.insert(fs::path(job.outPath).parent_path());
+    for (const auto& dir : dirs) {
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+    }
+
+    auto extractOne = [&](const Job& job) {
+        const ERFFile& erf = *archives[job.archive];
+        const ERFEntry& entry = erf.entries()[job.entry];
+        ERFEntryView view = erf.viewEntry(entry);
+        std::vector<uint8_t> data;
+        uint64_t held = 0;
+        if (!view) {
+            held = acquireBuffer(std::max<uint64_t>(entry.length, entry.packed_length));
+            if (cancelled()) {
+                releaseBuffer(held);
+                return;
+            }
+            data = erf.readEntry(entry);
+            if (data.empty() && entry.packed_length > 0) {
+                releaseBuffer(held);
+                fail(erf.path(), entry.name, "read failed");
+                return;
+            }
+            view.data = data.data();
+            view.size = data.size();
+        }
+
+        FILE* out = std::fopen(job.outPath.c_str(), "wb");
+        if (!out) {
+            releaseBuffer(held);
+            fail(erf.path(), entry.name, "cannot create file");
+            return;
+        }
+        bool ok = view.size == 0 || std::fwrite(view.data, 1, view.size, out) == view.size;
+        ok = std::fclose(out) == 0 && ok;
+        releaseBuffer(held);
+        if (!ok) {
+            fail(erf.path(), entry.name, "write failed");
+            return;
+        }
+        m_filesDone++;
+        m_bytesDone += view.size;
+    };
+
+    for (size_t base = 0; base < jobs.size() && !cancelled(); base += BATCH_FILES) {
+        size_t count = std::min(BATCH_FILES, jobs.size() - base);
+        Parallel::forRange(count, 4, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end && !cancelled(); i++) extractOne(jobs[base + i]);
+        });
+    }
+
+    m_stats.files = m_filesDone;
+    m_stats.failed = m_failures.size();
+    m_stats.bytes = m_bytesDone;
+    m_stats.seconds = elapsedSeconds();
+    m_finished = true;
+}
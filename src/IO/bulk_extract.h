@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Extracts entries from any number of archives into one folder on a
+// background thread. Entries are written straight out of the archive
+// mapping on the worker pool, each archive's entries in offset order so the
+// reads stay sequential; entries that need a buffer (compressed, or an
+// archive that couldn't be mapped) share a fixed in-flight byte budget.
+// Needs no UI: start() then wait(), or run().
+class BulkExtractor {
+public:
+    struct Failure {
+        std::string archive;
+        std::string name;    // empty when the archive itself failed
+        std::string reason;
+    };
+
+    struct Stats {
+        size_t files = 0;
+        size_t failed = 0;
+        uint64_t bytes = 0;
+        double seconds = 0;
+        double mbPerSecond() const { return seconds > 0 ? bytes / (1024.0 * 1024.0) / seconds : 0; }
+        double filesPerSecond() const { return seconds > 0 ? files / seconds : 0; }
+    };
+
+    ~BulkExtractor();
+
+    // Queue every entry of an archive, or just the given entry indices.
+    void addArchive(const std::string& path);
+    void addEntries(const std::string& path, std::vector<size_t> entryIndices);
+
+    // Extracts everything queued so far to outDir/<entry name>, creating
+    // subfolders for names that have them. When two entries land on the
+    // same file the one queued last wins.
+    void start(const std::string& outDir);
+    // start() + wait(); true when every file was written.
+    bool run(const std::string& outDir);
+    // Stops handing out files, waits for the ones in flight and returns.
+    void cancel();
+    void wait();
+    // Drops the results of a finished run.
+    void reset();
+
+    bool active() const { return m_thread.joinable() && !m_finished.load(); }
+    bool finished() const { return m_finished.load(); }
+    bool cancelled() const { return m_cancel.load(std::memory_order_relaxed); }
+    size_t filesDone() const { return m_filesDone.load(); }
+    size_t filesTotal() const { return m_filesTotal.load(); }
+    uint64_t bytesDone() const { return m_bytesDone.load(); }
+    uint64_t bytesTotal() const { return m_bytesTotal.load(); }
+    double elapsedSeconds() const;
+
+    // Valid once finished() (or after wait()).
+    const std::vector<Failure>& failures() const { return m_failures; }
+    Stats stats() const { return m_stats; }
+
+private:
+    struct Request {
+        std::string archive;
+        bool all = false;
+        std::vector<size_t> entries;
+    };
+
+    void execute(std::vector<Request> requests, std::string outDir);
+    void fail(const std::string& archive, const std::string& name, const char* reason);
+    uint64_t acquireBuffer(uint64_t bytes);
+    void releaseBuffer(uint64_t bytes);
+
+    std::vector<Request> m_queue;
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_finished{false};
+    std::atomic<size_t> m_filesDone{0};
+    std::atomic<size_t> m_filesTotal{0};
+    std::atomic<uint64_t> m_bytesDone{0};
+    std::atomic<uint64_t> m_bytesTotal{0};
+    std::atomic<int64_t> m_startTicks{0};
+
+    std::mutex m_failMutex;
+    std::vector<Failure> m_failures;
+    Stats m_stats;
+
+    // Bytes held in read buffers across the pool.
+    static const uint64_t BUFFER_BUDGET = 256ull << 20;
+    std::mutex m_bufferMutex;
+    std::condition_variable m_bufferFree;
+    uint64_t m_buffered = 0;
+};
@@ -1,4 +1,5 @@
 #include "export.h"
+#include "png_encoder.h"
 #include <fstream>
 #include <iostream>
 #include <cstring>
@@ -497,78 +498,23 @@ bool exportToGLB(const Model& model, const std::vector<Animation>& animations, c
     std::map<uint32_t, int> texIdToImageIdx;
     struct MaterialTextures { int diffuse = -1; int normal = -1; int specular = -1; int tint = -1; };
     std::vector<MaterialTextures> materialTextures;
-    auto encodePNGToBuffer = [&](const std::vector<uint8_t>& rgbaData, int w, int h, bool forceOpaqueAlpha) -> int {
+    // Textures are queued first and encoded together so independent images
+    // compress in parallel; buffer views are still appended in material order.
+    std::vector<PNGEncodeJob> pngJobs;
+    auto queuePNG = [&](const std::vector<uint8_t>& rgbaData, int w, int h, bool forceOpaqueAlpha) -> int {
         if (rgbaData.empty() || w <= 0 || h <= 0) return -1;
+        PNGEncodeJob job;
+        job.rgba = &rgbaData;
+        job.width = w;
+        job.height = h;
+        job.forceOpaqueAlpha = forceOpaqueAlpha;
+        pngJobs.push_back(std::move(job));
+        return (int)pngJobs.size() - 1;
+    };
+    auto appendPNGToBuffer = [&](int job) -> int {
+        if (job < 0 || pngJobs[job].png.empty()) return -1;
+        const std::vector<uint8_t>& png = pngJobs[job].png;
         size_t imgOff = binBuffer.size();
-        std::vector<uint8_t> png;
-        std::vector<uint8_t> exportData = rgbaData;
-        if (forceOpaqueAlpha) {
-            for (size_t i = 3; i < exportData.size(); i += 4) {
-                exportData[i] = 255;
-            }
-        }
-        uint32_t crc_table[256];
-        for (int n = 0; n < 256; n++) {
-            uint32_t c = n;
-            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
-            crc_table[n] = c;
-        }
-        auto crc32 = [&](const uint8_t* data, size_t len) {
-            uint32_t c = 0xffffffff;
-            for (size_t i = 0; i < len; i++) c = crc_table[(c ^ data[i]) & 0xff] ^ (c >> 8);
-            return c ^ 0xffffffff;
-        };
-        auto write32be = [](std::vector<uint8_t>& v, uint32_t val) {
-            v.push_back((val >> 24) & 0xff); v.push_back((val >> 16) & 0xff);
-            v.push_back((val >> 8) & 0xff); v.push_back(val & 0xff);
-        };
-        auto writeChunk = [&](const char* type, const std::vector<uint8_t>& data) {
-            write32be(png, (uint32_t)data.size());
-            png.insert(png.end(), type, type + 4);
-            png.insert(png.end(), data.begin(), data.end());
-            std::vector<uint8_t> forCrc(type, type + 4);
-            forCrc.insert(forCrc.end(), data.begin(), data.end());
-            write32be(png, crc32(forCrc.data(), forCrc.size()));
-        };
-        png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
-        std::vector<uint8_t> ihdr(13);
-        ihdr[0] = (w >> 24) & 0xff; ihdr[1] = (w >> 16) & 0xff; ihdr[2] = (w >> 8) & 0xff; ihdr[3] = w & 0xff;
-        ihdr[4] = (h >> 24) & 0xff; ihdr[5] = (h >> 16) & 0xff; ihdr[6] = (h >> 8) & 0xff; ihdr[7] = h & 0xff;
-        ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
-        writeChunk("IHDR", ihdr);
-        std::vector<uint8_t> raw;
-        for (int y = 0; y < h; y++) {
-            raw.push_back(0);
-            raw.insert(raw.end(), exportData.begin() + y * w * 4, exportData.begin() + (y + 1) * w * 4);
-        }
-        std::vector<uint8_t> deflated;
-        deflated.push_back(0x78); deflated.push_back(0x01);
-        size_t pos = 0;
-        while (pos < raw.size()) {
-            size_t remain = raw.size() - pos;
-            size_t blockLen = remain > 65535 ? 65535 : remain;
-            bool last = (pos + blockLen >= raw.size());
-            deflated.push_back(last ? 1 : 0);
-            deflated.push_back(blockLen & 0xff);
-            deflated.push_back((blockLen >> 8) & 0xff);
-            deflated.push_back(~blockLen & 0xff);
-            deflated.push_back((~blockLen >> 8) & 0xff);
-            deflated.insert(deflated.end(), raw.begin() + pos, raw.begin() + pos + blockLen);
-            pos += blockLen;
-        }
-        uint32_t adler = 1;
-        for (size_t i = 0; i < raw.size(); i++) {
-            uint32_t s1 = adler & 0xffff, s2 = (adler >> 16) & 0xffff;
-            s1 = (s1 + raw[i]) % 65521;
-            s2 = (s2 + s1) % 65521;
-            adler = (s2 << 16) | s1;
-        }
-        deflated.push_back((adler >> 24) & 0xff);
-        deflated.push_back((adler >> 16) & 0xff);
-        deflated.push_back((adler >> 8) & 0xff);
-        deflated.push_back(adler & 0xff);
-        writeChunk("IDAT", deflated);
-        writeChunk("IEND", {});
         binBuffer.insert(binBuffer.end(), png.begin(), png.end());
         padTo4(binBuffer);
         int imgView = (int)bufferViews.size();
@@ -590,19 +536,26 @@ bool exportToGLB(const Model& model, const std::vector<Animation>& animations, c
                                matNameLower.find("_ulm_") != std::string::npos) &&
                               matNameLower.find("bld") == std::string::npos;
         if (!mat.diffuseData.empty() && mat.diffuseWidth > 0 && mat.diffuseHeight > 0) {
-            mtex.diffuse = encodePNGToBuffer(mat.diffuseData, mat.diffuseWidth, mat.diffuseHeight, isHairMaterial);
+            mtex.diffuse = queuePNG(mat.diffuseData, mat.diffuseWidth, mat.diffuseHeight, isHairMaterial);
         }
         if (!mat.normalData.empty() && mat.normalWidth > 0 && mat.normalHeight > 0) {
-            mtex.normal = encodePNGToBuffer(mat.normalData, mat.normalWidth, mat.normalHeight, false);
+            mtex.normal = queuePNG(mat.normalData, mat.normalWidth, mat.normalHeight, false);
         }
         if (!mat.specularData.empty() && mat.specularWidth > 0 && mat.specularHeight > 0) {
-            mtex.specular = encodePNGToBuffer(mat.specularData, mat.specularWidth, mat.specularHeight, false);
+            mtex.specular = queuePNG(mat.specularData, mat.specularWidth, mat.specularHeight, false);
         }
         if (!mat.tintData.empty() && mat.tintWidth > 0 && mat.tintHeight > 0) {
-            mtex.tint = encodePNGToBuffer(mat.tintData, mat.tintWidth, mat.tintHeight, false);
+            mtex.tint = queuePNG(mat.tintData, mat.tintWidth, mat.tintHeight, false);
         }
         materialTextures.push_back(mtex);
     }
+    encodePNGBatch(pngJobs, options.pngLevel);
+    for (auto& mtex : materialTextures) {
+        mtex.diffuse = appendPNGToBuffer(mtex.diffuse);
+        mtex.normal = appendPNGToBuffer(mtex.normal);
+        mtex.specular = appendPNGToBuffer(mtex.specular);
+        mtex.tint = appendPNGToBuffer(mtex.tint);
+    }
     padTo4(binBuffer);
     json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"HavenTools\"},";
     json += "\"scene\":0,\"scenes\":[{\"nodes\":[0]}],";
@@ -958,70 +911,14 @@ bool exportToFBX(const Model& model, const std::vector<Animation>& animations, c
     std::vector<TextureEntry> textureEntries;
     struct MaterialTexIndices { int diffuse = -1; int normal = -1; int specular = -1; int tint = -1; };
     std::vector<MaterialTexIndices> materialTexIndices(model.materials.size());
-    auto encodePNG = [](const std::vector<uint8_t>& rgba, int w, int h, bool forceOpaqueAlpha) -> std::vector<uint8_t> {
-        std::vector<uint8_t> png;
-        std::vector<uint8_t> exportData = rgba;
-        if (forceOpaqueAlpha) {
-            for (size_t i = 3; i < exportData.size(); i += 4) exportData[i] = 255;
-        }
-        uint32_t crc_table[256];
-        for (int n = 0; n < 256; n++) {
-            uint32_t c = n;
-            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
-            crc_table[n] = c;
-        }
-        auto crc32 = [&](const uint8_t* data, size_t len) {
-            uint32_t c = 0xffffffff;
-            for (size_t i = 0; i < len; i++) c = crc_table[(c ^ data[i]) & 0xff] ^ (c >> 8);
-            return c ^ 0xffffffff;
-        };
-        auto write32be = [](std::vector<uint8_t>& v, uint32_t val) {
-            v.push_back((val >> 24) & 0xff); v.push_back((val >> 16) & 0xff);
-            v.push_back((val >> 8) & 0xff); v.push_back(val & 0xff);
-        };
-        auto writeChunk = [&](const char* type, const std::vector<uint8_t>& data) {
-            write32be(png, (uint32_t)data.size());
-            png.insert(png.end(), type, type + 4);
-            png.insert(png.end(), data.begin(), data.end());
-            std::vector<uint8_t> forCrc(type, type + 4);
-            forCrc.insert(forCrc.end(), data.begin(), data.end());
-            write32be(png, crc32(forCrc.data(), forCrc.size()));
-        };
-        png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
-        std::vector<uint8_t> ihdr(13);
-        ihdr[0] = (w >> 24) & 0xff; ihdr[1] = (w >> 16) & 0xff; ihdr[2] = (w >> 8) & 0xff; ihdr[3] = w & 0xff;
-        ihdr[4] = (h >> 24) & 0xff; ihdr[5] = (h >> 16) & 0xff; ihdr[6] = (h >> 8) & 0xff; ihdr[7] = h & 0xff;
-        ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
-        writeChunk("IHDR", ihdr);
-        std::vector<uint8_t> raw;
-        for (int y = 0; y < h; y++) {
-            raw.push_back(0);
-            raw.insert(raw.end(), exportData.begin() + y * w * 4, exportData.begin() + (y + 1) * w * 4);
-        }
-        std::vector<uint8_t> deflated;
-        deflated.push_back(0x78); deflated.push_back(0x01);
-        size_t pos = 0;
-        while (pos < raw.size()) {
-            size_t remain = raw.size() - pos;
-            size_t blockLen = remain > 65535 ? 65535 : remain;
-            bool last = (pos + blockLen >= raw.size());
-            deflated.push_back(last ? 1 : 0);
-            deflated.push_back(blockLen & 0xff); deflated.push_back((blockLen >> 8) & 0xff);
-            deflated.push_back(~blockLen & 0xff); deflated.push_back((~blockLen >> 8) & 0xff);
-            deflated.insert(deflated.end(), raw.begin() + pos, raw.begin() + pos + blockLen);
-            pos += blockLen;
-        }
-        uint32_t adler = 1;
-        for (size_t i = 0; i < raw.size(); i++) {
-            uint32_t s1 = adler & 0xffff, s2 = (adler >> 16) & 0xffff;
-            s1 = (s1 + raw[i]) % 65521; s2 = (s2 + s1) % 65521;
-            adler = (s2 << 16) | s1;
-        }
-        deflated.push_back((adler >> 24) & 0xff); deflated.push_back((adler >> 16) & 0xff);
-        deflated.push_back((adler >> 8) & 0xff); deflated.push_back(adler & 0xff);
-        writeChunk("IDAT", deflated);
-        writeChunk("IEND", {});
-        return png;
+    std::vector<PNGEncodeJob> pngJobs;
+    auto queuePNG = [&](const std::vector<uint8_t>& rgba, int w, int h, bool forceOpaqueAlpha) {
+        PNGEncodeJob job;
+        job.rgba = &rgba;
+        job.width = w;
+        job.height = h;
+        job.forceOpaqueAlpha = forceOpaqueAlpha;
+        pngJobs.push_back(std::move(job));
     };
     for (size_t mi = 0; mi < model.materials.size(); mi++) {
         const auto& mat = model.materials[mi];
@@ -1037,7 +934,7 @@ bool exportToFBX(const Model& model, const std::vector<Animation>& animations, c
             te.materialIndex = (int)mi;
             te.type = TexType::Diffuse;
             te.suffix = "_d";
-            te.pngData = encodePNG(mat.diffuseData, mat.diffuseWidth, mat.diffuseHeight, isHairMaterial);
+            queuePNG(mat.diffuseData, mat.diffuseWidth, mat.diffuseHeight, isHairMaterial);
             materialTexIndices[mi].diffuse = (int)textureEntries.size();
             textureEntries.push_back(std::move(te));
         }
@@ -1046,7 +943,7 @@ bool exportToFBX(const Model& model, const std::vector<Animation>& animations, c
             te.materialIndex = (int)mi;
             te.type = TexType::Normal;
             te.suffix = "_n";
-            te.pngData = encodePNG(mat.normalData, mat.normalWidth, mat.normalHeight, false);
+            queuePNG(mat.normalData, mat.normalWidth, mat.normalHeight, false);
             materialTexIndices[mi].normal = (int)textureEntries.size();
             textureEntries.push_back(std::move(te));
         }
@@ -1055,7 +952,7 @@ bool exportToFBX(const Model& model, const std::vector<Animation>& animations, c
             te.materialIndex = (int)mi;
             te.type = TexType::Specular;
             te.suffix = "_s";
-            te.pngData = encodePNG(mat.specularData, mat.specularWidth, mat.specularHeight, false);
+            queuePNG(mat.specularData, mat.specularWidth, mat.specularHeight, false);
             materialTexIndices[mi].specular = (int)textureEntries.size();
             textureEntries.push_back(std::move(te));
         }
@@ -1064,11 +961,14 @@ bool exportToFBX(const Model& model, const std::vector<Animation>& animations, c
             te.materialIndex = (int)mi;
             te.type = TexType::Tint;
             te.suffix = "_t";
-            te.pngData = encodePNG(mat.tintData, mat.tintWidth, mat.tintHeight, false);
+            queuePNG(mat.tintData, mat.tintWidth, mat.tintHeight, false);
             materialTexIndices[mi].tint = (int)textureEntries.size();
             textureEntries.push_back(std::move(te));
         }
     }
+    encodePNGBatch(pngJobs, options.pngLevel);
+    for (size_t i = 0; i < textureEntries.size(); i++)
+        textureEntries[i].pngData = std::move(pngJobs[i].png);
     struct AnimExportData {
         std::string name;
         float duration;
@@ -1725,68 +1625,10 @@ bool exportToFBX(const Model& model, const std::vector<Animation>& animations, c
     return out.good();
 }
 
-bool saveRGBAToPNG(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height) {
+bool saveRGBAToPNG(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height, int level) {
     if (rgba.empty() || width <= 0 || height <= 0) return false;
     std::vector<uint8_t> png;
-    uint32_t crc_table[256];
-    for (int n = 0; n < 256; n++) {
-        uint32_t c = n;
-        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
-        crc_table[n] = c;
-    }
-    auto crc32 = [&](const uint8_t* data, size_t len) {
-        uint32_t c = 0xffffffff;
-        for (size_t i = 0; i < len; i++) c = crc_table[(c ^ data[i]) & 0xff] ^ (c >> 8);
-        return c ^ 0xffffffff;
-    };
-    auto write32be = [](std::vector<uint8_t>& v, uint32_t val) {
-        v.push_back((val >> 24) & 0xff); v.push_back((val >> 16) & 0xff);
-        v.push_back((val >> 8) & 0xff); v.push_back(val & 0xff);
-    };
-    auto writeChunk = [&](const char* type, const std::vector<uint8_t>& data) {
-        write32be(png, (uint32_t)data.size());
-        png.insert(png.end(), type, type + 4);
-        png.insert(png.end(), data.begin(), data.end());
-        std::vector<uint8_t> forCrc(type, type + 4);
-        forCrc.insert(forCrc.end(), data.begin(), data.end());
-        write32be(png, crc32(forCrc.data(), forCrc.size()));
-    };
-    png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
-    std::vector<uint8_t> ihdr(13);
-    ihdr[0] = (width >> 24) & 0xff; ihdr[1] = (width >> 16) & 0xff;
-    ihdr[2] = (width >> 8) & 0xff; ihdr[3] = width & 0xff;
-    ihdr[4] = (height >> 24) & 0xff; ihdr[5] = (height >> 16) & 0xff;
-    ihdr[6] = (height >> 8) & 0xff; ihdr[7] = height & 0xff;
-    ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
-    writeChunk("IHDR", ihdr);
-    std::vector<uint8_t> raw;
-    for (int y = 0; y < height; y++) {
-        raw.push_back(0);
-        raw.insert(raw.end(), rgba.begin() + y * width * 4, rgba.begin() + (y + 1) * width * 4);
-    }
-    std::vector<uint8_t> deflated;
-    deflated.push_back(0x78); deflated.push_back(0x01);
-    size_t pos = 0;
-    while (pos < raw.size()) {
-        size_t remain = raw.size() - pos;
-        size_t blockLen = remain > 65535 ? 65535 : remain;
-        bool last = (pos + blockLen >= raw.size());
-        deflated.push_back(last ? 1 : 0);
-        deflated.push_back(blockLen & 0xff); deflated.push_back((blockLen >> 8) & 0xff);
-        deflated.push_back(~blockLen & 0xff); deflated.push_back((~blockLen >> 8) & 0xff);
-        deflated.insert(deflated.end(), raw.begin() + pos, raw.begin() + pos + blockLen);
-        pos += blockLen;
-    }
-    uint32_t adler = 1;
-    for (size_t i = 0; i < raw.size(); i++) {
-        uint32_t s1 = adler & 0xffff, s2 = (adler >> 16) & 0xffff;
-        s1 = (s1 + raw[i]) % 65521; s2 = (s2 + s1) % 65521;
-        adler = (s2 << 16) | s1;
-    }
-    deflated.push_back((adler >> 24) & 0xff); deflated.push_back((adler >> 16) & 0xff);
-    deflated.push_back((adler >> 8) & 0xff); deflated.push_back(adler & 0xff);
-    writeChunk("IDAT", deflated);
-    writeChunk("IEND", {});
+    if (!encodePNG(rgba, width, height, png, level)) return false;
     std::ofstream f(path, std::ios::binary);
     if (!f) return false;
     f.write(reinterpret_cast<const char*>(png.data()), png.size());
@@ -16,7 +16,8 @@ struct ExportOptions {
     float tintZone2[3] = {1.0f, 1.0f, 1.0f};
     float tintZone3[3] = {1.0f, 1.0f, 1.0f};
     float fbxScale = 1.0f;
+    int pngLevel = 6;
 };
 bool exportToGLB(const Model& model, const std::vector<Animation>& animations, const std::string& outputPath, const ExportOptions& options = {});
 bool exportToFBX(const Model& model, const std::vector<Animation>& animations, const std::string& outputPath, const ExportOptions& options = {});
-bool saveRGBAToPNG(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height);
\ No newline at end of file
+bool saveRGBAToPNG(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height, int level = 6);
\ No newline at end of file
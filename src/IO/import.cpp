@@ -1436,68 +1436,10 @@ bool DAOImporter::RepackERF(const std::string& erfPath, const std::map<std::stri
     if (!fs::exists(erfPath)) {
         return false;
     }
-    std::vector<uint8_t> erfData;
-    {
-        std::ifstream in(erfPath, std::ios::binary | std::ios::ate);
-        if (!in) return false;
-        size_t size = in.tellg();
-        in.seekg(0);
-        erfData.resize(size);
-        in.read(reinterpret_cast<char*>(erfData.data()), size);
-    }
-    if (erfData.size() < 32) return false;
-    auto readU32 = [&](size_t offset) -> uint32_t {
-        if (offset + 4 > erfData.size()) return 0;
-        return *reinterpret_cast<uint32_t*>(&erfData[offset]);
-    };
-    auto readUtf16String = [&](size_t offset, size_t charCount) -> std::string {
-        std::string result;
-        for (size_t i = 0; i < charCount; ++i) {
-            size_t pos = offset + i * 2;
-            if (pos + 2 > erfData.size()) break;
-            uint16_t ch = *reinterpret_cast<uint16_t*>(&erfData[pos]);
-            if (ch == 0) break;
-            if (ch < 128) result += static_cast<char>(ch);
-        }
-        return result;
-    };
-    std::string magic = readUtf16String(0, 4);
-    std::string version = readUtf16String(8, 4);
-    if (magic != "ERF ") {
-        return false;
-    }
-    ERFVersion erfVer = ERFVersion::Unknown;
-    if (version == "V2.0") erfVer = ERFVersion::V2_0;
-    else if (version == "V2.2") erfVer = ERFVersion::V2_2;
-    if (erfVer != ERFVersion::V2_0 && erfVer != ERFVersion::V2_2) {
+    ERFFile erf;
+    if (!erf.open(erfPath) || !erf.isWritable()) {
         return false;
     }
-    uint32_t fileCount = readU32(16);
-    uint32_t year = readU32(20);
-    uint32_t day = readU32(24);
-    uint32_t unknown = readU32(28);
-    struct FileEntry { std::string name; uint32_t offset; uint32_t size; };
-    std::vector<FileEntry> entries;
-    size_t tableOffset = 32;
-    for (uint32_t i = 0; i < fileCount; ++i) {
-        size_t entryOff = tableOffset + i * 72;
-        if (entryOff + 72 > erfData.size()) break;
-        FileEntry e;
-        e.name = readUtf16String(entryOff, 32);
-        e.offset = readU32(entryOff + 64);
-        e.size = readU32(entryOff + 68);
-        entries.push_back(e);
-    }
-    for (const auto& [name, data] : newFiles) {
-        std::string lowerName = ToLower(name);
-        bool found = false;
-        for (auto& e : entries) {
-            if (ToLower(e.name) == lowerName) { found = true; break; }
-        }
-        if (!found) {
-            entries.push_back({name, 0, static_cast<uint32_t>(data.size())});
-        }
-    }
     fs::path backupDir = fs::current_path() / "backups";
     fs::create_directories(backupDir);
     fs::path backupPath = backupDir / (fs::path(erfPath).filename().string() + ".bak");
@@ -1506,62 +1448,7 @@ bool DAOImporter::RepackERF(const std::string& erfPath, const std::map<std::stri
         if (m_backupCallback) doBackup = m_backupCallback(fs::path(erfPath).filename().string(), backupDir.string());
         if (doBackup) fs::copy_file(erfPath, backupPath);
     }
-    std::vector<uint8_t> newErfData;
-    auto writeU16 = [&](uint16_t v) {
-        newErfData.push_back(v & 0xFF);
-        newErfData.push_back((v >> 8) & 0xFF);
-    };
-    auto writeU32 = [&](uint32_t v) {
-        newErfData.push_back(v & 0xFF);
-        newErfData.push_back((v >> 8) & 0xFF);
-        newErfData.push_back((v >> 16) & 0xFF);
-        newErfData.push_back((v >> 24) & 0xFF);
-    };
-    auto writeUtf16Fixed = [&](const std::string& str, size_t charCount) {
-        for (size_t i = 0; i < charCount; ++i) {
-            writeU16(i < str.size() ? static_cast<uint16_t>(static_cast<unsigned char>(str[i])) : 0);
-        }
-    };
-    writeUtf16Fixed("ERF ", 4);
-    writeUtf16Fixed(version, 4);
-    writeU32(static_cast<uint32_t>(entries.size()));
-    writeU32(year);
-    writeU32(day);
-    writeU32(unknown);
-    size_t tableStart = newErfData.size();
-    size_t dataStart = tableStart + entries.size() * 72;
-    while (dataStart % 16 != 0) dataStart++;
-    newErfData.resize(dataStart, 0);
-    std::vector<std::pair<uint32_t, uint32_t>> offsets;
-    for (auto& e : entries) {
-        uint32_t offset = static_cast<uint32_t>(newErfData.size());
-        uint32_t size = 0;
-        std::string lowerName = ToLower(e.name);
-        auto it = std::find_if(newFiles.begin(), newFiles.end(),
-            [&](const auto& p) { return ToLower(p.first) == lowerName; });
-        if (it != newFiles.end()) {
-            size = static_cast<uint32_t>(it->second.size());
-            newErfData.insert(newErfData.end(), it->second.begin(), it->second.end());
-        } else {
-            size = e.size;
-            if (e.offset + e.size <= erfData.size()) {
-                newErfData.insert(newErfData.end(), erfData.begin() + e.offset, erfData.begin() + e.offset + e.size);
-            }
-        }
-        offsets.push_back({offset, size});
-    }
-    for (size_t i = 0; i < entries.size(); ++i) {
-        size_t entryOff = tableStart + i * 72;
-        for (size_t c = 0; c < 32; ++c) {
-            uint16_t ch = c < entries[i].name.size() ? static_cast<uint16_t>(static_cast<unsigned char>(entries[i].name[c])) : 0;
-            newErfData[entryOff + c * 2] = ch & 0xFF;
-            newErfData[entryOff + c * 2 + 1] = (ch >> 8) & 0xFF;
-        }
-        memcpy(&newErfData[entryOff + 64], &offsets[i].first, 4);
-        memcpy(&newErfData[entryOff + 68], &offsets[i].second, 4);
-    }
-    std::ofstream out(erfPath, std::ios::binary);
-    if (!out) return false;
-    out.write(reinterpret_cast<char*>(newErfData.data()), newErfData.size());
-    return true;
+    // Only the new payloads and the changed TOC records are written; the
+    // rest of the archive stays where it is.
+    return erf.patchEntries(newFiles);
 }
\ No newline at end of file
@@ -80,7 +80,7 @@ struct TerrainMatExport {
 static std::vector<TerrainMatExport> exportTerrainTextures(
     AppState& state, Model& terrainModel, const std::string& modelsDir)
 {
-    state.textureErfIndex.build(state.textureErfs);
+    syncErfPackages(state);
 
     std::vector<TerrainMatExport> result;
     std::set<std::string> exported;
@@ -465,9 +465,7 @@ void tickLevelExport(AppState& state) {
             state.currentModel = Model();
             state.hasModel = false;
 
-            state.modelErfIndex.build(state.modelErfs);
-            state.materialErfIndex.build(state.materialErfs);
-            state.textureErfIndex.build(state.textureErfs);
+            syncErfPackages(state);
 
             for (int gi = 0; gi < (int)s_propGroups.size(); gi++) {
                 auto& group = s_propGroups[gi].second;
@@ -481,7 +479,6 @@ void tickLevelExport(AppState& state) {
             s_propModel = std::move(state.currentModel);
             state.currentModel = std::move(savedModel);
             state.hasModel = savedHas;
-            clearErfIndices();
             s_propModelBuilt = true;
         }
 
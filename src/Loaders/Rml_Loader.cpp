@@ -21,7 +21,7 @@ bool parseRML(const std::vector<uint8_t>& data, RMLData& outData) {
     if (magic != "GFF V4.0") return false;
 
     GFFFile gff;
-    if (!gff.load(data)) return false;
+    if (!gff.loadBorrowed(data)) return false;
     if (gff.structs().empty()) return false;
 
     outData.roomPosX = 0; outData.roomPosY = 0; outData.roomPosZ = 0;
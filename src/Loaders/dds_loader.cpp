@@ -436,75 +436,3 @@ bool decodeTGAToRGBA(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgb
     }
     return true;
 }
-
-void encodePNG(const std::vector<uint8_t>& rgba, int w, int h, std::vector<uint8_t>& png) {
-    uint32_t crc_table[256];
-    for (int n = 0; n < 256; n++) {
-        uint32_t c = n;
-        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
-        crc_table[n] = c;
-    }
-    auto crc32 = [&](const uint8_t* data, size_t len) {
-        uint32_t c = 0xffffffff;
-        for (size_t i = 0; i < len; i++) c = crc_table[(c ^ data[i]) & 0xff] ^ (c >> 8);
-        return c ^ 0xffffffff;
-    };
-    auto write32be = [](std::vector<uint8_t>& v, uint32_t val) {
-        v.push_back((val >> 24) & 0xff); v.push_back((val >> 16) & 0xff);
-        v.push_back((val >> 8) & 0xff); v.push_back(val & 0xff);
-    };
-    auto writeChunk = [&](const char* type, const std::vector<uint8_t>& data) {
-        write32be(png, (uint32_t)data.size());
-        png.insert(png.end(), type, type + 4);
-        png.insert(png.end(), data.begin(), data.end());
-        std::vector<uint8_t> forCrc(type, type + 4);
-        forCrc.insert(forCrc.end(), data.begin(), data.end());
-        write32be(png, crc32(forCrc.data(), forCrc.size()));
-    };
-
-    png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
-
-    std::vector<uint8_t> ihdr(13);
-    ihdr[0] = (w >> 24) & 0xff; ihdr[1] = (w >> 16) & 0xff; ihdr[2] = (w >> 8) & 0xff; ihdr[3] = w & 0xff;
-    ihdr[4] = (h >> 24) & 0xff; ihdr[5] = (h >> 16) & 0xff; ihdr[6] = (h >> 8) & 0xff; ihdr[7] = h & 0xff;
-    ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
-    writeChunk("IHDR", ihdr);
-
-    std::vector<uint8_t> raw;
-    for (int y = 0; y < h; y++) {
-        raw.push_back(0);
-        raw.insert(raw.end(), rgba.begin() + y * w * 4, rgba.begin() + (y + 1) * w * 4);
-    }
-
-    std::vector<uint8_t> deflated;
-    deflated.push_back(0x78); deflated.push_back(0x01);
-
-    size_t pos = 0;
-    while (pos < raw.size()) {
-        size_t remain = raw.size() - pos;
-        size_t blockLen = remain > 65535 ? 65535 : remain;
-        bool last = (pos + blockLen >= raw.size());
-        deflated.push_back(last ? 1 : 0);
-        deflated.push_back(blockLen & 0xff);
-        deflated.push_back((blockLen >> 8) & 0xff);
-        deflated.push_back(~blockLen & 0xff);
-        deflated.push_back((~blockLen >> 8) & 0xff);
-        deflated.insert(deflated.end(), raw.begin() + pos, raw.begin() + pos + blockLen);
-        pos += blockLen;
-    }
-
-    uint32_t adler = 1;
-    for (size_t i = 0; i < raw.size(); i++) {
-        uint32_t s1 = adler & 0xffff, s2 = (adler >> 16) & 0xffff;
-        s1 = (s1 + raw[i]) % 65521;
-        s2 = (s2 + s1) % 65521;
-        adler = (s2 << 16) | s1;
-    }
-    deflated.push_back((adler >> 24) & 0xff);
-    deflated.push_back((adler >> 16) & 0xff);
-    deflated.push_back((adler >> 8) & 0xff);
-    deflated.push_back(adler & 0xff);
-
-    writeChunk("IDAT", deflated);
-    writeChunk("IEND", {});
-}
\ No newline at end of file
@@ -1,12 +1,12 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include "png_encoder.h"
 
 bool decodeDDSToRGBA(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgba, int& width, int& height);
 bool decodeTGAToRGBA(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgba, int& width, int& height);
 bool decodeXDSToRGBA(const std::vector<uint8_t>& data, std::vector<uint8_t>& rgba, int& width, int& height);
 bool isXDS(const std::vector<uint8_t>& data);
-void encodePNG(const std::vector<uint8_t>& rgba, int width, int height, std::vector<uint8_t>& png);
 bool isDDSCubemap(const std::vector<uint8_t>& data);
 bool decodeDDSCubemapFaces(const std::vector<uint8_t>& data, std::vector<uint8_t> faces[6], int& faceSize);
 
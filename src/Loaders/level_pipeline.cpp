@@ -0,0 +1,822 @@
+#include "level_pipeline.h"
+#include "mmh_loader.h"
+#include "dds_loader.h"
+#include "rml_loader.h"
+#include "resource_locator.h"
+#include "parallel.h"
+#include "Shaders/d3d_context.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static std::string toLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(), ::tolower);
+    return s;
+}
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+static std::string stripExt(const std::string& s) {
+    size_t d = s.rfind('.');
+    return d != std::string::npos ? s.substr(0, d) : s;
+}
+
+// Merge every placed instance of the same object into one combined mesh: meshes
+// that share an object identity (mesh name) and material are concatenated, so e.g.
+// 150 instances of a tree become a single mesh / draw call per submesh+material
+// instead of 150. Applies to all level objects (props and trees). Vertices are
+// already baked to world space at placement, so this is a straight concatenation.
+static void mergeLevelInstances(Model& model) {
+    std::vector<Mesh> out;
+    out.reserve(model.meshes.size());
+    std::unordered_map<std::string, int> keyToOut;
+    for (auto& mesh : model.meshes) {
+        if (mesh.vertices.empty() || mesh.indices.empty()) continue;
+        std::string key = mesh.name + "##" + std::to_string(mesh.materialIndex);
+        auto it = keyToOut.find(key);
+        if (it == keyToOut.end()) {
+            keyToOut[key] = (int)out.size();
+            out.push_back(std::move(mesh));
+        } else {
+            Mesh& dst = out[(size_t)it->second];
+            uint32_t base = (uint32_t)dst.vertices.size();
+            uint32_t idxBase = (uint32_t)dst.indices.size();
+            dst.vertices.insert(dst.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            dst.indices.reserve(dst.indices.size() + mesh.indices.size());
+            for (uint32_t idx : mesh.indices) dst.indices.push_back(base + idx);
+            for (const auto& r : mesh.instanceRanges)
+                dst.instanceRanges.push_back({ idxBase + r.firstIndex, r.indexCount, r.instanceId });
+        }
+    }
+    Parallel::forRange(out.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) out[i].calculateBounds();
+    });
+    model.meshes = std::move(out);
+}
+
+// Tree textures live next to the .spt more often than not, but env trees
+// borrow from the level's other archives, so those are searched after it.
+static std::vector<uint8_t> readTreeTexture(AppState& state, const std::string& key, const std::string& archivePath) {
+    std::string keyLower = toLower(key);
+    const std::string cands[] = { keyLower, keyLower + ".dds", keyLower + ".xds", keyLower + ".tga" };
+    if (auto erf = openSharedERF(archivePath)) {
+        for (const auto& te : erf->entries()) {
+            std::string el = toLower(te.name);
+            for (const auto& c : cands) {
+                if (el != c) continue;
+                std::vector<uint8_t> data = erf->readEntry(te);
+                if (!data.empty()) return data;
+            }
+        }
+    }
+    const void* packages[] = { &state.textureErfs, &state.modelErfs, &state.materialErfs, &state.currentErf };
+    for (const void* package : packages) {
+        for (const auto& c : cands) {
+            ResourceRef ref = ResourceLocator::find(c, ResourceLocator::Match::Exact, package);
+            if (!ref) continue;
+            std::vector<uint8_t> data = ref.read();
+            if (!data.empty()) return data;
+        }
+    }
+    return {};
+}
+
+LevelPipeline::~LevelPipeline() {
+    m_cancel = true;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+    }
+    m_queueSpace.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+}
+
+const char* LevelPipeline::stageLabel() const {
+    switch (stage()) {
+        case Scanning:  return "Scanning level data...";
+        case Terrain:   return "Loading terrain...";
+        case Props:     return "Loading props...";
+        case Trees:     return "Loading trees...";
+        case Materials: return "Loading materials & textures...";
+        case Merging:   return "Merging instances...";
+        case Uploading: return "Uploading textures...";
+        case Cancelled: return "Cancelled";
+        default:        return "";
+    }
+}
+
+void LevelPipeline::setStage(Stage stage, int total) {
+    m_done = 0;
+    m_total = total;
+    m_stage = stage;
+}
+
+void LevelPipeline::start(AppState& state, bool headless) {
+    if (active()) cancel();
+    m_state = &state;
+    m_headless = headless;
+    m_cancel = false;
+    m_workerDone = false;
+    m_uploads.clear();
+    m_textures.clear();
+    m_textureIndex.clear();
+    m_level = Model();
+    m_terrainMaterials = 0;
+    m_timings = Timings();
+    m_load = AppState::LevelLoadState();
+    m_load.arlTreeNames = state.levelLoad.arlTreeNames;
+    setStage(Scanning, 0);
+    m_thread = std::thread(&LevelPipeline::run, this);
+}
+
+void LevelPipeline::cancel() {
+    m_cancel = true;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+    }
+    m_queueSpace.notify_all();
+    if (m_thread.joinable()) m_thread.join();
+    for (const auto& job : m_textures)
+        if (job.texId != 0) destroyTexture(job.texId);
+    m_textures.clear();
+    m_textureIndex.clear();
+    m_uploads.clear();
+    m_level = Model();
+    m_load = AppState::LevelLoadState();
+    m_stage = Cancelled;
+}
+
+void LevelPipeline::wait() {
+    if (m_thread.joinable()) m_thread.join();
+}
+
+void LevelPipeline::run() {
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    auto mark = started;
+    auto lap = [&](double& slot) {
+        auto now = Clock::now();
+        slot = std::chrono::duration<double, std::milli>(now - mark).count();
+        mark = now;
+    };
+
+    scan();
+    lap(m_timings.scan);
+    if (!cancelled()) { loadTerrain(); lap(m_timings.terrain); }
+    if (!cancelled()) { loadProps(); lap(m_timings.props); }
+    if (!cancelled()) { loadTrees(); lap(m_timings.trees); }
+    if (!cancelled()) { loadMaterials(); lap(m_timings.materials); }
+    if (!cancelled()) {
+        setStage(Merging, 0);
+        mergeLevelInstances(m_level);  // combine identical-object instances into one mesh each
+        lap(m_timings.merge);
+    }
+    m_timings.total = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    if (!cancelled()) setStage(m_headless ? Finished : Uploading, (int)m_uploads.size());
+    m_workerDone = true;
+}
+
+void LevelPipeline::scan() {
+    AppState& state = *m_state;
+    auto& ll = m_load;
+
+    // Map every .msh entry to its (uncompressed) size so we can tell a
+    // genuine LOD variant from a chunk tile. A real LOD (X_1/2/3.msh) is
+    // smaller than its base X_0.msh; chunk tiles named *_1/_2/_3 either
+    // have no _0 sibling or are the same size as it, and must be loaded.
+    std::unordered_map<std::string, uint32_t> mshSize;
+    if (state.currentErf) {
+        for (size_t i = 0; i < state.rimEntries.size(); i++) {
+            std::string nl = toLower(state.rimEntries[i].name);
+            if (nl.size() < 4 || !endsWith(nl, ".msh")) continue;
+            size_t ei = state.rimEntries[i].entryIdx;
+            if (ei < state.currentErf->entries().size())
+                mshSize[nl] = state.currentErf->entries()[ei].length;
+        }
+    }
+    for (size_t i = 0; i < state.rimEntries.size(); i++) {
+        std::string nameLower = toLower(state.rimEntries[i].name);
+        if (nameLower.size() < 4 || !endsWith(nameLower, ".msh")) continue;
+
+        size_t lastUnderscore = nameLower.rfind('_');
+        if (lastUnderscore != std::string::npos && lastUnderscore + 1 < nameLower.size() - 4) {
+            std::string lodStr = nameLower.substr(lastUnderscore + 1, nameLower.size() - 4 - lastUnderscore - 1);
+            if (lodStr == "1" || lodStr == "2" || lodStr == "3") {
+                std::string lod0 = nameLower.substr(0, lastUnderscore + 1) + "0.msh";
+                auto it0 = mshSize.find(lod0);
+                auto itN = mshSize.find(nameLower);
+                if (it0 != mshSize.end() && itN != mshSize.end() && itN->second < it0->second)
+                    continue;   // genuine LOD variant (smaller than its LOD0) -> skip
+            }
+        }
+        ll.terrainQueue.push_back(i);
+    }
+
+    // The open rim first, then its siblings in directory order.
+    std::vector<std::shared_ptr<ERFFile>> rims;
+    std::vector<bool> rimIsGpu;
+    if (auto rim = openSharedERF(state.currentRIMPath)) {
+        rims.push_back(rim);
+        rimIsGpu.push_back(false);
+    }
+    std::error_code ec;
+    fs::path rimDir = fs::path(state.currentRIMPath).parent_path();
+    if (fs::is_directory(rimDir, ec)) {
+        for (const auto& de : fs::directory_iterator(rimDir, ec)) {
+            if (!de.is_regular_file()) continue;
+            std::string fnl = toLower(de.path().filename().string());
+            if (!endsWith(fnl, ".rim") || de.path().string() == state.currentRIMPath) continue;
+            if (auto rim = openSharedERF(de.path().string())) {
+                rims.push_back(rim);
+                rimIsGpu.push_back(fnl.find(".gpu.rim") != std::string::npos);
+            }
+        }
+    }
+
+    // Every room layout in every rim parses independently.
+    struct RmlTask { const ERFFile* rim; const ERFEntry* entry; };
+    std::vector<RmlTask> rmlTasks;
+    for (const auto& rim : rims)
+        for (const auto& entry : rim->entries())
+            if (endsWith(toLower(entry.name), ".rml")) rmlTasks.push_back({ rim.get(), &entry });
+    setStage(Scanning, (int)rmlTasks.size());
+
+    std::vector<std::vector<AppState::PropWork>> rmlProps(rmlTasks.size());
+    std::vector<std::vector<AppState::SptWork>> rmlTrees(rmlTasks.size());
+    Parallel::forRange(rmlTasks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end && !cancelled(); t++) {
+            std::vector<uint8_t> rmlData = rmlTasks[t].rim->readEntry(*rmlTasks[t].entry);
+            RMLData rml;
+            if (!rmlData.empty() && parseRML(rmlData, rml)) {
+                for (const auto& prop : rml.props) {
+                    std::string name = prop.modelFile.empty() ? prop.modelName : prop.modelFile;
+                    if (name.empty()) continue;
+                    std::string nameLow = toLower(name);
+                    size_t lastUs = nameLow.rfind('_');
+                    if (lastUs != std::string::npos && lastUs + 1 < nameLow.size()) {
+                        std::string suffix = nameLow.substr(lastUs + 1);
+                        if (suffix == "1" || suffix == "2" || suffix == "3") continue;
+                    }
+                    AppState::PropWork pw;
+                    pw.modelName = name;
+                    pw.px = rml.roomPosX + prop.posX;
+                    pw.py = rml.roomPosY + prop.posY;
+                    pw.pz = rml.roomPosZ + prop.posZ;
+                    pw.qx = prop.orientX; pw.qy = prop.orientY;
+                    pw.qz = prop.orientZ; pw.qw = prop.orientW;
+                    pw.scale = prop.scale;
+                    rmlProps[t].push_back(pw);
+                }
+                for (const auto& si : rml.sptInstances) {
+                    AppState::SptWork sw;
+                    sw.treeId = si.treeId;
+                    sw.px = rml.roomPosX + si.posX;
+                    sw.py = rml.roomPosY + si.posY;
+                    sw.pz = rml.roomPosZ + si.posZ;
+                    sw.qx = si.orientX; sw.qy = si.orientY;
+                    sw.qz = si.orientZ; sw.qw = si.orientW;
+                    sw.scale = si.scale;
+                    rmlTrees[t].push_back(sw);
+                }
+            }
+            m_done++;
+        }
+    });
+    if (cancelled()) return;
+    for (size_t t = 0; t < rmlTasks.size(); t++) {
+        ll.propQueue.insert(ll.propQueue.end(), rmlProps[t].begin(), rmlProps[t].end());
+        ll.sptQueue.insert(ll.sptQueue.end(), rmlTrees[t].begin(), rmlTrees[t].end());
+    }
+
+    // Source the level's trees from its RIM files (the .spt live inside the
+    // area RIMs). Keyed by full stem; falls back to speedtreetools.erf if
+    // that shared library exists.
+    std::map<std::string, std::string> sptLowerToActual;
+    auto scanForSpt = [&](const ERFFile& arc, const std::string& archivePath) {
+        for (const auto& entry : arc.entries()) {
+            std::string eLower = toLower(entry.name);
+            if (eLower.size() > 4 && endsWith(eLower, ".spt")) {
+                ll.sptFileToErf[entry.name] = archivePath;
+                sptLowerToActual[eLower.substr(0, eLower.size() - 4)] = entry.name;
+            }
+        }
+    };
+    for (size_t r = 0; r < rims.size(); r++)
+        if (!rimIsGpu[r]) scanForSpt(*rims[r], rims[r]->path());
+    for (const auto& erfPath : state.erfFiles) {
+        if (toLower(fs::path(erfPath).filename().string()) != "speedtreetools.erf") continue;
+        if (auto arc = openSharedERF(erfPath)) scanForSpt(*arc, erfPath);
+        break;
+    }
+
+    // The ARL tree list is indexed by the RML tree ids; its names may or may
+    // not carry the area prefix the .spt files use.
+    std::string rimStemLower = toLower(fs::path(state.currentRIMPath).stem().string());
+    std::string rimPrefix = rimStemLower + "_";
+    for (int i = 0; i < (int)ll.arlTreeNames.size(); i++) {
+        if (ll.arlTreeNames[i].empty()) continue;
+        std::string treeNameLower = toLower(ll.arlTreeNames[i]);
+        std::string stripped = treeNameLower;
+        if (stripped.size() > rimPrefix.size() && stripped.compare(0, rimPrefix.size(), rimPrefix) == 0)
+            stripped = stripped.substr(rimPrefix.size());
+        auto it = sptLowerToActual.find(stripped);
+        if (it == sptLowerToActual.end())
+            it = sptLowerToActual.find(treeNameLower);
+        if (it == sptLowerToActual.end())
+            it = sptLowerToActual.find(rimPrefix + stripped);
+        if (it != sptLowerToActual.end())
+            ll.sptIdToFile[i] = it->second;
+    }
+
+    ll.totalProps = (int)ll.propQueue.size();
+
+    {
+        std::set<uint64_t> seen;
+        std::vector<AppState::SptWork> deduped;
+        deduped.reserve(ll.sptQueue.size());
+        for (const auto& sw : ll.sptQueue) {
+            uint32_t hx = *reinterpret_cast<const uint32_t*>(&sw.px);
+            uint32_t hy = *reinterpret_cast<const uint32_t*>(&sw.py);
+            uint32_t hz = *reinterpret_cast<const uint32_t*>(&sw.pz);
+            uint64_t key = ((uint64_t)(hx ^ (hy << 16) ^ (hz >> 3)) << 32) | (uint32_t)sw.treeId;
+            if (seen.insert(key).second)
+                deduped.push_back(sw);
+        }
+        ll.sptQueue = std::move(deduped);
+    }
+
+    ll.totalSpt = (int)ll.sptQueue.size();
+
+    std::sort(ll.propQueue.begin(), ll.propQueue.end(),
+        [](const AppState::PropWork& a, const AppState::PropWork& b) {
+            return a.modelName < b.modelName;
+        });
+}
+
+void LevelPipeline::loadTerrain() {
+    AppState& state = *m_state;
+    auto& ll = m_load;
+    ll.totalTerrain = (int)ll.terrainQueue.size();
+    setStage(Terrain, ll.totalTerrain);
+    if (!state.currentErf) return;
+
+    const auto& entries = state.currentErf->entries();
+    std::vector<Model> chunks(ll.terrainQueue.size());
+    std::vector<const ERFEntry*> chunkEntries(chunks.size(), nullptr);
+    std::vector<char> decoded(chunks.size(), 0);
+    Parallel::forRange(chunks.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !cancelled(); i++) {
+            size_t rimIdx = ll.terrainQueue[i];
+            if (rimIdx < state.rimEntries.size() && state.rimEntries[rimIdx].entryIdx < entries.size()) {
+                chunkEntries[i] = &entries[state.rimEntries[rimIdx].entryIdx];
+                decoded[i] = decodeTerrainEntry(state, *chunkEntries[i], chunks[i]);
+            }
+            m_done++;
+        }
+    });
+    if (cancelled()) return;
+
+    std::vector<std::string> materialNames;
+    std::set<std::string> known;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (!decoded[i]) continue;
+        Model& chunk = chunks[i];
+        std::set<std::string> newMaterials;
+        for (const auto& mesh : chunk.meshes)
+            if (!mesh.materialName.empty() && !known.count(mesh.materialName))
+                newMaterials.insert(mesh.materialName);
+        for (const auto& name : newMaterials) {
+            known.insert(name);
+            materialNames.push_back(name);
+        }
+
+        // Terrain chunks whose meshes all sit at the world origin (X~0, Y~0)
+        // are local-space and have no placement in the rim's layout, so every
+        // chunk piles onto the origin (the "terrain stack"). Drop them; world-
+        // space terrain (placed away from the origin) loads normally.
+        bool unplaced = !chunk.meshes.empty();
+        for (auto& mesh : chunk.meshes) {
+            mesh.calculateBounds();
+            auto c = mesh.center();
+            if (c[0] > 1.0f || c[0] < -1.0f || c[1] > 1.0f || c[1] < -1.0f) { unplaced = false; break; }
+        }
+        if (unplaced) continue;
+
+        ll.terrainLoaded++;
+        std::string displayName = stripExt(chunkEntries[i]->name);
+        for (auto& mesh : chunk.meshes) {
+            if (mesh.name.empty()) mesh.name = displayName;
+            m_level.meshes.push_back(std::move(mesh));
+        }
+    }
+
+    // Terrain materials come first and keep their pixels for the terrain
+    // tools, as they always have.
+    std::vector<Material> materials(materialNames.size());
+    Parallel::forRange(materials.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) materials[i] = loadLevelMaterial(state, materialNames[i], false);
+    });
+    for (auto& mat : materials) m_level.materials.push_back(std::move(mat));
+    m_terrainMaterials = (int)m_level.materials.size();
+}
+
+void LevelPipeline::loadProps() {
+    AppState& state = *m_state;
+    auto& ll = m_load;
+
+    // One decode per distinct model; every placement copies it.
+    std::unordered_map<std::string, size_t> modelIndex;
+    std::vector<std::string> modelNames;
+    std::vector<size_t> propModel(ll.propQueue.size());
+    for (size_t i = 0; i < ll.propQueue.size(); i++) {
+        auto res = modelIndex.emplace(toLower(ll.propQueue[i].modelName), modelNames.size());
+        if (res.second) modelNames.push_back(ll.propQueue[i].modelName);
+        propModel[i] = res.first->second;
+    }
+    setStage(Props, (int)modelNames.size());
+
+    std::vector<Model> models(modelNames.size());
+    std::vector<char> found(modelNames.size(), 0);
+    Parallel::forRange(models.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !cancelled(); i++) {
+            found[i] = decodePropModel(state, modelNames[i], models[i]);
+            m_done++;
+        }
+    });
+    if (cancelled()) return;
+
+    std::vector<std::vector<Mesh>> placed(ll.propQueue.size());
+    Parallel::forRange(placed.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!found[propModel[i]]) continue;
+            const auto& pw = ll.propQueue[i];
+            Model instance = models[propModel[i]];
+            transformModelVertices(instance, pw.px, pw.py, pw.pz, pw.qx, pw.qy, pw.qz, pw.qw, pw.scale);
+            for (auto& mesh : instance.meshes) {
+                // Tag with the model name so every instance of this prop shares an identity
+                // (for instance-merging and whole-object selection) and different props
+                // never collide on a generic submesh name.
+                mesh.name = pw.modelName + "::" + mesh.name;
+                mesh.objectId = pw.modelName;
+            }
+            placed[i] = std::move(instance.meshes);
+        }
+    });
+
+    for (size_t i = 0; i < placed.size(); i++) {
+        if (!found[propModel[i]]) continue;
+        ll.propsLoaded++;
+        int instId = ll.nextInstanceId++;
+        for (auto& mesh : placed[i]) {
+            mesh.instanceRanges = { { 0u, (uint32_t)mesh.indices.size(), instId } };
+            m_level.meshes.push_back(std::move(mesh));
+        }
+    }
+}
+
+void LevelPipeline::loadTrees() {
+    AppState& state = *m_state;
+    auto& ll = m_load;
+    setStage(Trees, (int)ll.sptIdToFile.size());
+    if (ll.sptFileToErf.empty() || ll.sptIdToFile.empty()) return;
+
+    auto findArchive = [&](const std::string& sptFile) -> std::string {
+        auto it = ll.sptFileToErf.find(sptFile);
+        return it != ll.sptFileToErf.end() ? it->second : std::string();
+    };
+
+    // The SpeedTree runtime keeps global state and only loads from a file, so
+    // tree models are computed one at a time here rather than on the pool.
+    std::map<int32_t, SptModel> trees;
+    for (const auto& [treeId, fileName] : ll.sptIdToFile) {
+        if (cancelled()) return;
+        m_done++;
+        auto erf = openSharedERF(findArchive(fileName));
+        if (!erf) continue;
+        for (const auto& entry : erf->entries()) {
+            if (entry.name != fileName) continue;
+            auto sptData = erf->readEntry(entry);
+            if (!sptData.empty()) {
+                std::string tempDir;
+                #ifdef _WIN32
+                char tmp[MAX_PATH]; GetTempPathA(MAX_PATH, tmp); tempDir = tmp;
+                #else
+                tempDir = "/tmp/";
+                #endif
+                std::string tempSpt = tempDir + "haven_level_temp.spt";
+                { std::ofstream f(tempSpt, std::ios::binary);
+                  f.write((char*)sptData.data(), sptData.size()); }
+                SptModel model;
+                if (loadSptModel(tempSpt, model)) {
+                    extractSptTextures(sptData, model);
+                    trees[treeId] = std::move(model);
+                }
+                #ifdef _WIN32
+                DeleteFileA(tempSpt.c_str());
+                #else
+                remove(tempSpt.c_str());
+                #endif
+            }
+            break;
+        }
+    }
+    if (trees.empty()) return;
+
+    struct TreeMaterials { std::string baseName; int branch; int composite; };
+    std::map<int32_t, TreeMaterials> treeMaterials;
+    auto materialFor = [&](const std::string& key, const std::string& texName, const std::string& archive) -> int {
+        for (int mi = 0; mi < (int)m_level.materials.size(); mi++)
+            if (m_level.materials[mi].diffuseMap == key) return mi;
+        Material mat;
+        mat.name = key;
+        mat.diffuseMap = key;
+        mat.opacity = 1.0f;
+        int idx = (int)m_level.materials.size();
+        m_level.materials.push_back(std::move(mat));
+        requestTexture(idx, Diffuse, texName, true, archive);
+        return idx;
+    };
+    for (const auto& [treeId, treeModel] : trees) {
+        const std::string& fileName = ll.sptIdToFile[treeId];
+        std::string archive = findArchive(fileName);
+        TreeMaterials tm;
+        tm.baseName = stripExt(fileName);
+        std::string branchKey = treeModel.branchTexture.empty() ? tm.baseName : stripExt(treeModel.branchTexture);
+        tm.branch = materialFor(branchKey, branchKey, archive);
+        // composite filename comes from the map bank; fall back to the guess
+        std::string diffuseKey = tm.baseName + "_diffuse";
+        tm.composite = materialFor(diffuseKey, treeModel.compositeTexture.empty() ? diffuseKey
+                                                                                  : treeModel.compositeTexture, archive);
+        treeMaterials[treeId] = tm;
+    }
+
+    // Instance ids follow queue order, so hand them out before fanning out.
+    std::vector<int> instIds(ll.sptQueue.size(), -1);
+    for (size_t i = 0; i < ll.sptQueue.size(); i++)
+        if (trees.count(ll.sptQueue[i].treeId)) instIds[i] = ll.nextInstanceId++;
+
+    const char* typeNames[] = {"Branch", "Frond", "LeafCard", "LeafMesh"};
+    std::vector<std::vector<Mesh>> placed(ll.sptQueue.size());
+    Parallel::forRange(placed.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (instIds[i] < 0) continue;
+            const auto& sw = ll.sptQueue[i];
+            const SptModel& tree = trees.find(sw.treeId)->second;
+            const TreeMaterials& tm = treeMaterials.find(sw.treeId)->second;
+
+            float qx = sw.qx, qy = sw.qy, qz = sw.qz, qw = sw.qw;
+            float qlen = std::sqrt(qx*qx + qy*qy + qz*qz + qw*qw);
+            if (qlen > 0.00001f) { qx/=qlen; qy/=qlen; qz/=qlen; qw/=qlen; }
+
+            for (const auto& sm : tree.submeshes) {
+                if (sm.vertexCount() == 0) continue;
+
+                Mesh mesh;
+                mesh.name = tm.baseName + "_" + typeNames[(int)sm.type];
+                mesh.objectId = tm.baseName;
+                bool branch = sm.type == SptSubmeshType::Branch;
+                mesh.materialIndex = branch ? tm.branch : tm.composite;
+                mesh.materialName = m_level.materials[mesh.materialIndex].name;
+                mesh.alphaTest = !branch;
+
+                uint32_t nv = sm.vertexCount();
+                mesh.vertices.resize(nv);
+                for (uint32_t vi = 0; vi < nv; vi++) {
+                    float lx = sm.positions[vi*3+0] * sw.scale;
+                    float ly = sm.positions[vi*3+1] * sw.scale;
+                    float lz = sm.positions[vi*3+2] * sw.scale;
+                    float tx = 2.0f*(qy*lz - qz*ly);
+                    float ty = 2.0f*(qz*lx - qx*lz);
+                    float tz = 2.0f*(qx*ly - qy*lx);
+
+                    auto& v = mesh.vertices[vi];
+                    v.x = lx + qw*tx + (qy*tz - qz*ty) + sw.px;
+                    v.y = ly + qw*ty + (qz*tx - qx*tz) + sw.py;
+                    v.z = lz + qw*tz + (qx*ty - qy*tx) + sw.pz;
+
+                    float nx = sm.normals[vi*3+0];
+                    float ny = sm.normals[vi*3+1];
+                    float nz = sm.normals[vi*3+2];
+                    float tnx = 2.0f*(qy*nz - qz*ny);
+                    float tny = 2.0f*(qz*nx - qx*nz);
+                    float tnz = 2.0f*(qx*ny - qy*nx);
+                    v.nx = nx + qw*tnx + (qy*tnz - qz*tny);
+                    v.ny = ny + qw*tny + (qz*tnx - qx*tnz);
+                    v.nz = nz + qw*tnz + (qx*tny - qy*tnx);
+                    v.u = sm.texcoords[vi*2+0];
+                    v.v = sm.texcoords[vi*2+1];
+                }
+                mesh.indices = sm.indices;
+                mesh.instanceRanges = { { 0u, (uint32_t)sm.indices.size(), instIds[i] } };
+                mesh.calculateBounds();
+                placed[i].push_back(std::move(mesh));
+            }
+        }
+    });
+
+    for (size_t i = 0; i < placed.size(); i++) {
+        if (instIds[i] < 0) continue;
+        ll.sptLoaded++;
+        for (auto& mesh : placed[i]) m_level.meshes.push_back(std::move(mesh));
+    }
+}
+
+void LevelPipeline::requestTexture(int material, TexSlot slot, const std::string& name, bool keepData,
+                                   const std::string& treeArchive) {
+    std::string key = toLower(name) + "|" + treeArchive;
+    auto res = m_textureIndex.emplace(key, m_textures.size());
+    if (res.second) {
+        TextureJob job;
+        job.name = name;
+        job.treeArchive = treeArchive;
+        m_textures.push_back(std::move(job));
+    }
+    TextureJob& job = m_textures[res.first->second];
+    job.keepData = job.keepData || keepData;
+    job.targets.push_back({ material, slot, keepData });
+}
+
+void LevelPipeline::decodeTexture(TextureJob& job) {
+    AppState& state = *m_state;
+    bool tree = !job.treeArchive.empty();
+    std::vector<uint8_t> data = tree ? readTreeTexture(state, job.name, job.treeArchive)
+                                     : readLevelTexture(state, job.name);
+    if (data.empty()) {
+        std::cout << "[LEVEL] MISSING texture: " << job.name << std::endl;
+        return;
+    }
+    bool dds = data.size() > 4 && data[0] == 'D' && data[1] == 'D' && data[2] == 'S' && data[3] == ' ';
+    if (isXDS(data)) {
+        if (!decodeXDSToRGBA(data, job.rgba, job.width, job.height)) job.rgba.clear();
+    } else if (tree && !dds) {
+        if (!decodeTGAToRGBA(data, job.rgba, job.width, job.height)) job.rgba.clear();
+    } else {
+        // DDS goes to the GPU still block-compressed; only copies kept on
+        // the CPU are expanded.
+        if (job.keepData && !decodeDDSToRGBA(data, job.rgba, job.width, job.height)) job.rgba.clear();
+        job.dds = std::move(data);
+    }
+}
+
+void LevelPipeline::loadMaterials() {
+    AppState& state = *m_state;
+
+    std::unordered_map<std::string, int> matIndex;
+    for (int i = 0; i < (int)m_level.materials.size(); i++)
+        matIndex.emplace(m_level.materials[i].name, i);
+
+    std::set<std::string> newMaterials;
+    for (const auto& mesh : m_level.meshes)
+        if (!mesh.materialName.empty() && !matIndex.count(mesh.materialName))
+            newMaterials.insert(mesh.materialName);
+    std::vector<std::string> names(newMaterials.begin(), newMaterials.end());
+    std::vector<Material> materials(names.size());
+    Parallel::forRange(materials.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) materials[i] = loadLevelMaterial(state, names[i], true);
+    });
+    for (auto& mat : materials) {
+        matIndex.emplace(mat.name, (int)m_level.materials.size());
+        m_level.materials.push_back(std::move(mat));
+    }
+
+    for (auto& mesh : m_level.meshes) {
+        if (mesh.materialName.empty()) continue;
+        auto it = matIndex.find(mesh.materialName);
+        mesh.materialIndex = it != matIndex.end() ? it->second : -1;
+    }
+
+    std::set<std::pair<int, int>> requested;
+    for (const auto& job : m_textures)
+        for (const auto& target : job.targets) requested.insert({ target.material, (int)target.slot });
+    for (int i = 0; i < (int)m_level.materials.size(); i++) {
+        Material& mat = m_level.materials[i];
+        if (mat.isWater) resolveLevelWaterMaterial(m_level, i);
+        bool keep = i < m_terrainMaterials;
+        auto want = [&](const std::string& map, uint32_t texId, TexSlot slot, bool keepData) {
+            if (map.empty() || texId != 0 || requested.count({ i, (int)slot })) return;
+            requestTexture(i, slot, map, keepData);
+        };
+        want(mat.diffuseMap, mat.diffuseTexId, Diffuse, keep);
+        want(mat.normalMap, mat.normalTexId, Normal, keep);
+        want(mat.specularMap, mat.specularTexId, Specular, keep);
+        want(mat.tintMap, mat.tintTexId, Tint, keep);
+        if (mat.isTerrain) {
+            want(mat.maskVMap, mat.maskVTexId, MaskV, false);
+            want(mat.maskAMap, mat.maskATexId, MaskA, false);
+            want(mat.maskA2Map, mat.maskA2TexId, MaskA2, false);
+            want(mat.reliefMap, mat.reliefTexId, Relief, false);
+        }
+    }
+
+    // Decoding runs ahead of the render thread by at most the queue depth,
+    // so only a handful of decoded images that are not kept ever wait in memory.
+    setStage(Materials, (int)m_textures.size());
+    Parallel::forRange(m_textures.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end && !cancelled(); i++) {
+            TextureJob& job = m_textures[i];
+            decodeTexture(job);
+            m_done++;
+            if (m_headless || (job.dds.empty() && job.rgba.empty())) continue;
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_queueSpace.wait(lock, [&] { return m_uploads.size() < UPLOAD_QUEUE_DEPTH || cancelled(); });
+            if (cancelled()) return;
+            m_uploads.push_back(i);
+        }
+    });
+}
+
+bool LevelPipeline::pumpUploads(double budgetMs) {
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    for (;;) {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            if (m_uploads.empty()) return m_workerDone;
+            index = m_uploads.front();
+            m_uploads.pop_front();
+        }
+        m_queueSpace.notify_one();
+
+        TextureJob& job = m_textures[index];
+        job.texId = job.dds.empty() ? createTexture2D(job.rgba.data(), job.width, job.height)
+                                    : createTextureFromDDS(job.dds);
+        std::vector<uint8_t>().swap(job.dds);
+        if (!job.keepData) std::vector<uint8_t>().swap(job.rgba);
+
+        if (std::chrono::duration<double, std::milli>(Clock::now() - started).count() >= budgetMs)
+            return false;
+    }
+}
+
+void LevelPipeline::applyTextures() {
+    for (auto& job : m_textures) {
+        for (const auto& target : job.targets) {
+            Material& mat = m_level.materials[target.material];
+            std::vector<uint8_t>* data = nullptr;
+            int* width = nullptr;
+            int* height = nullptr;
+            switch (target.slot) {
+                case Diffuse:
+                    mat.diffuseTexId = job.texId;
+                    data = &mat.diffuseData; width = &mat.diffuseWidth; height = &mat.diffuseHeight;
+                    break;
+                case Normal:
+                    mat.normalTexId = job.texId;
+                    data = &mat.normalData; width = &mat.normalWidth; height = &mat.normalHeight;
+                    break;
+                case Specular:
+                    mat.specularTexId = job.texId;
+                    data = &mat.specularData; width = &mat.specularWidth; height = &mat.specularHeight;
+                    break;
+                case Tint:
+                    mat.tintTexId = job.texId;
+                    data = &mat.tintData; width = &mat.tintWidth; height = &mat.tintHeight;
+                    break;
+                case MaskV:  mat.maskVTexId = job.texId; break;
+                case MaskA:  mat.maskATexId = job.texId; break;
+                case MaskA2: mat.maskA2TexId = job.texId; break;
+                case Relief: mat.reliefTexId = job.texId; break;
+            }
+            if (target.keepData && data && !job.rgba.empty()) {
+                *data = job.rgba;
+                *width = job.width;
+                *height = job.height;
+            }
+        }
+        std::vector<uint8_t>().swap(job.rgba);
+    }
+    for (auto& mat : m_level.materials) {
+        if (!mat.isTerrain) continue;
+        mat.paletteTexId = mat.diffuseTexId;
+        mat.palNormalTexId = mat.normalTexId;
+    }
+}
+
+void LevelPipeline::take(Model& level, AppState::LevelLoadState& load) {
+    wait();
+    applyTextures();
+    level = std::move(m_level);
+    load = std::move(m_load);
+    m_level = Model();
+    m_load = AppState::LevelLoadState();
+    m_textures.clear();
+    m_textureIndex.clear();
+    m_stage = Finished;
+}
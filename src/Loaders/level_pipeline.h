@@ -0,0 +1,113 @@
+#pragma once
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Loads a level area off the UI thread. start() takes the archives the UI
+// already opened into AppState and runs the scan, terrain, prop, tree and
+// material stages on a worker thread, fanning each one out over the worker
+// pool into a private Model. Decoded textures come back through a small
+// bounded queue, so the render thread only does the GPU uploads and never
+// sees a half-built level.
+class LevelPipeline {
+public:
+    enum Stage { Idle, Scanning, Terrain, Props, Trees, Materials, Merging, Uploading, Finished, Cancelled };
+
+    // Wall-clock milliseconds per stage, filled in as the worker goes.
+    struct Timings {
+        double scan = 0, terrain = 0, props = 0, trees = 0, materials = 0, merge = 0, total = 0;
+    };
+
+    ~LevelPipeline();
+
+    // state.levelLoad.arlTreeNames and the archive sets (currentErf,
+    // rimEntries, texture/model/material ERFs, erfFiles) must be ready and
+    // stay untouched until the pipeline is taken or cancelled. A headless
+    // pipeline decodes everything but queues no uploads, so it can be timed
+    // without a device; texture ids in its model stay 0.
+    void start(AppState& state, bool headless = false);
+
+    // Stops the worker, waits for it and releases any textures it had
+    // uploaded. Render thread only.
+    void cancel();
+
+    bool active() const { return m_thread.joinable(); }
+    Stage stage() const { return (Stage)m_stage.load(); }
+    const char* stageLabel() const;
+    int itemsDone() const { return m_done.load(); }
+    int itemsTotal() const { return m_total.load(); }
+
+    // Render thread. Creates textures for queued uploads until budgetMs has
+    // passed; returns true once the worker has finished and the queue is
+    // empty, i.e. take() is ready.
+    bool pumpUploads(double budgetMs);
+
+    // Headless: blocks until the worker has finished.
+    void wait();
+
+    // Hands over the loaded level with its texture ids applied, plus the
+    // work lists and counters the export code reads later.
+    void take(Model& level, AppState::LevelLoadState& load);
+
+    const Timings& timings() const { return m_timings; }
+
+private:
+    enum TexSlot { Diffuse, Normal, Specular, Tint, MaskV, MaskA, MaskA2, Relief };
+    struct TextureTarget {
+        int material;
+        TexSlot slot;
+        bool keepData;
+    };
+    struct TextureJob {
+        std::string name;
+        std::string treeArchive;   // set for SpeedTree textures, searched first
+        bool keepData = false;
+        std::vector<TextureTarget> targets;
+        std::vector<uint8_t> dds;  // uploaded as-is when set
+        std::vector<uint8_t> rgba;
+        int width = 0, height = 0;
+        uint32_t texId = 0;
+    };
+
+    void run();
+    void setStage(Stage stage, int total);
+    bool cancelled() const { return m_cancel.load(std::memory_order_relaxed); }
+    void scan();
+    void loadTerrain();
+    void loadProps();
+    void loadTrees();
+    void loadMaterials();
+    void decodeTexture(TextureJob& job);
+    void requestTexture(int material, TexSlot slot, const std::string& name, bool keepData,
+                        const std::string& treeArchive = std::string());
+    void applyTextures();
+
+    AppState* m_state = nullptr;
+    bool m_headless = false;
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<int> m_stage{Idle};
+    std::atomic<int> m_done{0};
+    std::atomic<int> m_total{0};
+    Timings m_timings;
+
+    // Worker-owned until the worker finishes.
+    Model m_level;
+    AppState::LevelLoadState m_load;
+    int m_terrainMaterials = 0;
+    std::vector<TextureJob> m_textures;
+    std::unordered_map<std::string, size_t> m_textureIndex;
+
+    // Indices into m_textures waiting for the render thread.
+    static const size_t UPLOAD_QUEUE_DEPTH = 16;
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueSpace;
+    std::deque<size_t> m_uploads;
+    bool m_workerDone = false;
+};
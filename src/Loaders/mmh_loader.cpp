@@ -17,21 +17,16 @@ Material parseMAO(const std::string& maoContent, const std::string& materialName
     Material mat;
     mat.name = materialName;
 
-    std::vector<uint8_t> rawBytes(maoContent.begin(), maoContent.end());
-    if (rawBytes.size() >= 8 && GFF32::GFF32File::isGFF32(rawBytes)) {
-        GFF32::GFF32File gff32;
-        if (gff32.load(rawBytes) && gff32.root()) {
-            const auto& root = *gff32.root();
-
-            for (const auto& fieldName : root.fieldOrder) {
-                auto it = root.fields.find(fieldName);
-                if (it == root.fields.end()) continue;
-                const auto& field = it->second;
-                if (field.typeId != GFF32::TypeID::ExoString &&
-                    field.typeId != GFF32::TypeID::ResRef) continue;
-                const std::string* valPtr = std::get_if<std::string>(&field.value);
-                if (!valPtr) continue;
-                std::string valLower = *valPtr;
+    const uint8_t* rawBytes = reinterpret_cast<const uint8_t*>(maoContent.data());
+    if (maoContent.size() >= 8 && GFF32::GFF32File::isGFF32(rawBytes, maoContent.size())) {
+        GFF32::FlatFile gff32;
+        if (gff32.load(rawBytes, maoContent.size()) && gff32.root()) {
+            const GFF32::FlatStruct root = gff32.root();
+
+            for (GFF32::FlatField field : root) {
+                if (field.typeId() != GFF32::TypeID::ExoString &&
+                    field.typeId() != GFF32::TypeID::ResRef) continue;
+                std::string valLower(field.asString());
                 std::transform(valLower.begin(), valLower.end(), valLower.begin(), ::tolower);
                 if (valLower.find("terrain.mat") != std::string::npos ||
                     valLower.find("terrain_low.mat") != std::string::npos) {
@@ -46,17 +41,12 @@ Material parseMAO(const std::string& maoContent, const std::string& materialName
                 }
             }
 
-            for (const auto& fieldName : root.fieldOrder) {
-                auto it = root.fields.find(fieldName);
-                if (it == root.fields.end()) continue;
-                const auto& field = it->second;
-
-                if (field.typeId == GFF32::TypeID::ExoString ||
-                    field.typeId == GFF32::TypeID::ResRef) {
-                    const std::string* valPtr = std::get_if<std::string>(&field.value);
-                    if (!valPtr || valPtr->empty()) continue;
-                    std::string resName = *valPtr;
-                    std::string labelLower = fieldName;
+            for (GFF32::FlatField field : root) {
+                if (field.typeId() == GFF32::TypeID::ExoString ||
+                    field.typeId() == GFF32::TypeID::ResRef) {
+                    if (field.asString().empty()) continue;
+                    std::string resName(field.asString());
+                    std::string labelLower(field.label());
                     std::transform(labelLower.begin(), labelLower.end(), labelLower.begin(), ::tolower);
                     std::string resLower = resName;
                     std::transform(resLower.begin(), resLower.end(), resLower.begin(), ::tolower);
@@ -128,23 +118,17 @@ Material parseMAO(const std::string& maoContent, const std::string& materialName
                     }
                 }
 
-                if ((mat.isTerrain || mat.isWater) && field.typeId == GFF32::TypeID::Structure) {
-                    std::string labelLower = fieldName;
+                if ((mat.isTerrain || mat.isWater) && field.typeId() == GFF32::TypeID::Structure) {
+                    std::string labelLower(field.label());
                     std::transform(labelLower.begin(), labelLower.end(), labelLower.begin(), ::tolower);
-                    const auto* structPtr = std::get_if<GFF32::StructurePtr>(&field.value);
-                    if (!structPtr || !*structPtr) continue;
-                    const auto& st = **structPtr;
+                    const GFF32::FlatStruct st = field.asStruct();
+                    if (!st) continue;
 
-                    auto extractFloats = [&](const GFF32::Structure& s, float* out, int maxCount) {
+                    auto extractFloats = [&](const GFF32::FlatStruct& s, float* out, int maxCount) {
                         int idx = 0;
-                        for (const auto& fn : s.fieldOrder) {
+                        for (GFF32::FlatField f : s) {
                             if (idx >= maxCount) break;
-                            auto fit = s.fields.find(fn);
-                            if (fit == s.fields.end()) continue;
-                            if (fit->second.typeId == GFF32::TypeID::FLOAT) {
-                                const float* fp = std::get_if<float>(&fit->second.value);
-                                if (fp) out[idx] = *fp;
-                            }
+                            if (f.typeId() == GFF32::TypeID::FLOAT) out[idx] = f.asFloat();
                             idx++;
                         }
                     };
@@ -156,17 +140,15 @@ Material parseMAO(const std::string& maoContent, const std::string& materialName
                     } else if (labelLower.find("mml_muvscalevalues") != std::string::npos) {
                         float uvMatrix[16] = {};
                         int floatIdx = 0;
-                        for (const auto& fn : st.fieldOrder) {
-                            auto fit = st.fields.find(fn);
-                            if (fit == st.fields.end()) continue;
-                            if (fit->second.typeId == GFF32::TypeID::FLOAT) {
-                                const float* fp = std::get_if<float>(&fit->second.value);
-                                if (fp && floatIdx < 16) uvMatrix[floatIdx] = *fp;
+                        for (GFF32::FlatField f : st) {
+                            if (f.typeId() == GFF32::TypeID::FLOAT) {
+                                if (floatIdx < 16) uvMatrix[floatIdx] = f.asFloat();
                                 floatIdx++;
-                            } else if (fit->second.typeId == GFF32::TypeID::Structure) {
-                                const auto* rowPtr = std::get_if<GFF32::StructurePtr>(&fit->second.value);
-                                if (rowPtr && *rowPtr) {
-                                    extractFloats(**rowPtr, &uvMatrix[floatIdx], 4);
+                            } else if (f.typeId() == GFF32::TypeID::Structure) {
+                                const GFF32::FlatStruct row = f.asStruct();
+                                if (row) {
+                                    if (floatIdx + 4 > 16) break;
+                                    extractFloats(row, &uvMatrix[floatIdx], 4);
                                     floatIdx += 4;
                                 }
                             }
@@ -176,17 +158,15 @@ Material parseMAO(const std::string& maoContent, const std::string& materialName
                     } else if (labelLower.find("mml_mreliefscale") != std::string::npos) {
                         float relMatrix[16] = {};
                         int floatIdx = 0;
-                        for (const auto& fn : st.fieldOrder) {
-                            auto fit = st.fields.find(fn);
-                            if (fit == st.fields.end()) continue;
-                            if (fit->second.typeId == GFF32::TypeID::FLOAT) {
-                                const float* fp = std::get_if<float>(&fit->second.value);
-                                if (fp && floatIdx < 16) relMatrix[floatIdx] = *fp;
+                        for (GFF32::FlatField f : st) {
+                            if (f.typeId() == GFF32::TypeID::FLOAT) {
+                                if (floatIdx < 16) relMatrix[floatIdx] = f.asFloat();
                                 floatIdx++;
-                            } else if (fit->second.typeId == GFF32::TypeID::Structure) {
-                                const auto* rowPtr = std::get_if<GFF32::StructurePtr>(&fit->second.value);
-                                if (rowPtr && *rowPtr) {
-                                    extractFloats(**rowPtr, &relMatrix[floatIdx], 4);
+                            } else if (f.typeId() == GFF32::TypeID::Structure) {
+                                const GFF32::FlatStruct row = f.asStruct();
+                                if (row) {
+                                    if (floatIdx + 4 > 16) break;
+                                    extractFloats(row, &relMatrix[floatIdx], 4);
                                     floatIdx += 4;
                                 }
                             }
@@ -205,14 +185,9 @@ Material parseMAO(const std::string& maoContent, const std::string& materialName
             }
 
             if (mat.diffuseMap.empty()) {
-                for (const auto& fieldName : root.fieldOrder) {
-                    auto it = root.fields.find(fieldName);
-                    if (it == root.fields.end()) continue;
-                    const auto& field = it->second;
-                    if (field.typeId != GFF32::TypeID::ResRef) continue;
-                    const std::string* valPtr = std::get_if<std::string>(&field.value);
-                    if (!valPtr || valPtr->empty()) continue;
-                    mat.diffuseMap = *valPtr;
+                for (GFF32::FlatField field : root) {
+                    if (field.typeId() != GFF32::TypeID::ResRef || field.asString().empty()) continue;
+                    mat.diffuseMap = std::string(field.asString());
                     break;
                 }
             }
@@ -435,7 +410,7 @@ static void quatRotateWorld(float qx, float qy, float qz, float qw,
 
 void loadMMH(const std::vector<uint8_t>& data, Model& model) {
     GFFFile gff;
-    if (!gff.load(data)) return;
+    if (!gff.loadBorrowed(data)) return;
 
     auto normalizeQuat = [](float& x, float& y, float& z, float& w) {
         float len = std::sqrt(x*x + y*y + z*z + w*w);
@@ -12,4 +12,12 @@ void loadMMH(const std::vector<uint8_t>& data, Model& model);
 bool loadPHY(const std::vector<uint8_t>& data, Model& model);
 
 bool loadModelFromEntry(AppState& state, const ERFEntry& entry);
-void finalizeModelMaterials(AppState& state, Model& model);
\ No newline at end of file
+void finalizeModelMaterials(AppState& state, Model& model);
+// Level loading steps that create no GPU resources and touch no shared
+// caches, so the level pipeline can run them on worker threads once the
+// archive sets in state are open and synced.
+bool decodeTerrainEntry(AppState& state, const ERFEntry& entry, Model& out);
+bool decodePropModel(AppState& state, const std::string& modelName, Model& out);
+Material loadLevelMaterial(AppState& state, const std::string& matName, bool searchAllErfs);
+void resolveLevelWaterMaterial(Model& model, int matIdx);
+std::vector<uint8_t> readLevelTexture(AppState& state, const std::string& texName);
@@ -1,4 +1,5 @@
 #include "model_loader.h"
+#include "vertex_decoder.h"
 #include <cstring>
 #include <cmath>
 
@@ -40,7 +41,7 @@ float halfToFloat(uint16_t h) {
     return f;
 }
 
-void readDeclType(const std::vector<uint8_t>& data, uint32_t offset, uint32_t dataType, float* out, bool bigEndian) {
+void readDeclType(GFFBytes data, uint32_t offset, uint32_t dataType, float* out, bool bigEndian) {
     auto readFloat = [&](uint32_t pos) -> float {
         if (pos + 4 > data.size()) return 0.0f;
         float val;
@@ -150,38 +151,9 @@ void readDeclType(const std::vector<uint8_t>& data, uint32_t offset, uint32_t da
     }
 }
 
-void readBlendIndices(const std::vector<uint8_t>& data, uint32_t offset, uint32_t dataType, int* out, bool bigEndian = false) {
-    auto readByte = [&](uint32_t pos) -> uint8_t {
-        if (pos >= data.size()) return 0;
-        return data[pos];
-    };
-
-    out[0] = out[1] = out[2] = out[3] = -1;
-
-    switch (dataType) {
-        case VertexDeclType::COLOR:
-        case VertexDeclType::UBYTE4:
-        case VertexDeclType::UBYTE4N:
-            out[0] = static_cast<int>(readByte(offset));
-            out[1] = static_cast<int>(readByte(offset + 1));
-            out[2] = static_cast<int>(readByte(offset + 2));
-            out[3] = static_cast<int>(readByte(offset + 3));
-            break;
-        default:
-
-            float vals[4];
-            readDeclType(data, offset, dataType, vals, bigEndian);
-            out[0] = static_cast<int>(std::round(vals[0]));
-            out[1] = static_cast<int>(std::round(vals[1]));
-            out[2] = static_cast<int>(std::round(vals[2]));
-            out[3] = static_cast<int>(std::round(vals[3]));
-            break;
-    }
-}
-
 bool loadMSH(const std::vector<uint8_t>& data, Model& outModel) {
     GFFFile gff;
-    if (!gff.load(data)) {
+    if (!gff.loadBorrowed(data)) {
         return false;
     }
 
@@ -199,78 +171,91 @@ bool loadMSH(const std::vector<uint8_t>& data, Model& outModel) {
         return false;
     }
 
+    // Chunks (and their declarators) share a struct type, so resolve the
+    // fields once per type rather than per chunk.
+    uint32_t chunkType = UINT32_MAX;
+    GFFFieldHandle fName, fVertexSize, fVertexCount, fIndexCount, fIndexFormat, fVertexOffset, fIndexOffset, fDeclList;
+    uint32_t declType = UINT32_MAX;
+    GFFFieldHandle fUsage, fStream, fDeclOffset, fDataType, fUsageIndex;
+    VertexDecoder decoder;
+
     for (const auto& chunkRef : meshChunks) {
         Mesh mesh;
 
-        const GFFField* nameField = gff.findField(chunkRef.structIndex, GFFFieldID::NAME);
-        if (nameField && nameField->typeId == 14) {
-            mesh.name = gff.readStringByLabel(chunkRef.structIndex, GFFFieldID::NAME, chunkRef.offset);
+        if (chunkRef.structIndex != chunkType) {
+            chunkType = chunkRef.structIndex;
+            fName = gff.resolveField(chunkType, GFFFieldID::NAME);
+            fVertexSize = gff.resolveField(chunkType, GFFFieldID::VERTEX_SIZE);
+            fVertexCount = gff.resolveField(chunkType, GFFFieldID::VERTEX_COUNT);
+            fIndexCount = gff.resolveField(chunkType, GFFFieldID::INDEX_COUNT);
+            fIndexFormat = gff.resolveField(chunkType, GFFFieldID::INDEX_FORMAT);
+            fVertexOffset = gff.resolveField(chunkType, GFFFieldID::VERTEX_OFFSET);
+            fIndexOffset = gff.resolveField(chunkType, GFFFieldID::INDEX_OFFSET);
+            fDeclList = gff.resolveField(chunkType, GFFFieldID::VERTEX_DECLARATOR);
+        }
+
+        if (fName && fName.field->typeId == 14) {
+            mesh.name = gff.readString(fName, chunkRef.offset);
         }
         if (mesh.name.empty()) {
             mesh.name = "chunk_" + std::to_string(outModel.meshes.size());
         }
 
-        uint32_t vertexSize = gff.readUInt32ByLabel(chunkRef.structIndex, GFFFieldID::VERTEX_SIZE, chunkRef.offset);
-        uint32_t vertexCount = gff.readUInt32ByLabel(chunkRef.structIndex, GFFFieldID::VERTEX_COUNT, chunkRef.offset);
-        uint32_t indexCount = gff.readUInt32ByLabel(chunkRef.structIndex, GFFFieldID::INDEX_COUNT, chunkRef.offset);
-        uint32_t indexFormat = gff.readUInt32ByLabel(chunkRef.structIndex, GFFFieldID::INDEX_FORMAT, chunkRef.offset);
-        uint32_t vertexOffset = gff.readUInt32ByLabel(chunkRef.structIndex, GFFFieldID::VERTEX_OFFSET, chunkRef.offset);
-        uint32_t indexOffset = gff.readUInt32ByLabel(chunkRef.structIndex, GFFFieldID::INDEX_OFFSET, chunkRef.offset);
+        uint32_t vertexSize = gff.readUInt32(fVertexSize, chunkRef.offset);
+        uint32_t vertexCount = gff.readUInt32(fVertexCount, chunkRef.offset);
+        uint32_t indexCount = gff.readUInt32(fIndexCount, chunkRef.offset);
+        uint32_t indexFormat = gff.readUInt32(fIndexFormat, chunkRef.offset);
+        uint32_t vertexOffset = gff.readUInt32(fVertexOffset, chunkRef.offset);
+        uint32_t indexOffset = gff.readUInt32(fIndexOffset, chunkRef.offset);
 
         if (vertexCount == 0 || indexCount == 0 || vertexSize == 0) {
             continue;
         }
 
-        std::vector<GFFStructRef> declList = gff.readStructList(chunkRef.structIndex, GFFFieldID::VERTEX_DECLARATOR, chunkRef.offset);
+        std::vector<GFFStructRef> declList = gff.readStructList(fDeclList, chunkRef.offset);
 
-        VertexStreamDesc posStream = {0, 0, 0, 0, 0};
-        VertexStreamDesc normalStream = {0, 0, 0, 0, 0};
-        VertexStreamDesc texcoordStream = {0, 0, 0, 0, 0};
-        VertexStreamDesc blendWeightStream = {0, 0, 0, 0, 0};
-        VertexStreamDesc blendIndexStream = {0, 0, 0, 0, 0};
-        VertexStreamDesc colorStream = {0, 0, 0, 0, 0};
-        bool hasPos = false, hasNormal = false, hasTexcoord = false;
-        bool hasBlendWeight = false, hasBlendIndex = false, hasColor = false;
+        VertexLayout layout;
+        layout.stride = vertexSize;
+        layout.bigEndian = bigEndian;
 
         for (const auto& declRef : declList) {
-            uint32_t usage = gff.readUInt32ByLabel(declRef.structIndex, GFFFieldID::DECL_USAGE, declRef.offset);
+            if (declRef.structIndex != declType) {
+                declType = declRef.structIndex;
+                fUsage = gff.resolveField(declType, GFFFieldID::DECL_USAGE);
+                fStream = gff.resolveField(declType, GFFFieldID::DECL_STREAM);
+                fDeclOffset = gff.resolveField(declType, GFFFieldID::DECL_OFFSET);
+                fDataType = gff.resolveField(declType, GFFFieldID::DECL_DATATYPE);
+                fUsageIndex = gff.resolveField(declType, GFFFieldID::DECL_USAGE_INDEX);
+            }
+            uint32_t usage = gff.readUInt32(fUsage, declRef.offset);
 
             VertexStreamDesc desc;
-            desc.stream = gff.readUInt32ByLabel(declRef.structIndex, GFFFieldID::DECL_STREAM, declRef.offset);
-            desc.offset = gff.readUInt32ByLabel(declRef.structIndex, GFFFieldID::DECL_OFFSET, declRef.offset);
-            desc.dataType = gff.readUInt32ByLabel(declRef.structIndex, GFFFieldID::DECL_DATATYPE, declRef.offset);
+            desc.stream = gff.readUInt32(fStream, declRef.offset);
+            desc.offset = gff.readUInt32(fDeclOffset, declRef.offset);
+            desc.dataType = gff.readUInt32(fDataType, declRef.offset);
             desc.usage = usage;
-            desc.usageIndex = gff.readUInt32ByLabel(declRef.structIndex, GFFFieldID::DECL_USAGE_INDEX, declRef.offset);
-
-            if (usage == VertexUsage::POSITION && !hasPos) {
-                posStream = desc;
-                hasPos = true;
-            } else if (usage == VertexUsage::NORMAL && !hasNormal) {
-                normalStream = desc;
-                hasNormal = true;
-            } else if (usage == VertexUsage::TEXCOORD && !hasTexcoord) {
-                texcoordStream = desc;
-                hasTexcoord = true;
-            } else if (usage == VertexUsage::BLENDWEIGHT && !hasBlendWeight) {
-                blendWeightStream = desc;
-                hasBlendWeight = true;
-            } else if (usage == VertexUsage::BLENDINDICES && !hasBlendIndex) {
-                blendIndexStream = desc;
-                hasBlendIndex = true;
-            } else if (usage == VertexUsage::COLOR && !hasColor) {
-                colorStream = desc;
-                hasColor = true;
+            desc.usageIndex = gff.readUInt32(fUsageIndex, declRef.offset);
+
+            int slot = -1;
+            switch (usage) {
+                case VertexUsage::POSITION: slot = VertexLayout::Position; break;
+                case VertexUsage::NORMAL: slot = VertexLayout::Normal; break;
+                case VertexUsage::TEXCOORD: slot = VertexLayout::Texcoord; break;
+                case VertexUsage::BLENDWEIGHT: slot = VertexLayout::BlendWeight; break;
+                case VertexUsage::BLENDINDICES: slot = VertexLayout::BlendIndex; break;
+                case VertexUsage::COLOR: slot = VertexLayout::Color; break;
+            }
+            if (slot >= 0 && !layout.present[slot]) {
+                layout.streams[slot] = desc;
+                layout.present[slot] = true;
             }
         }
 
-        if (!hasPos) {
+        if (!layout.present[VertexLayout::Position]) {
             continue;
         }
 
-        mesh.hasSkinning = hasBlendWeight && hasBlendIndex;
-
-        if (mesh.hasSkinning) {
-        }
+        mesh.hasSkinning = layout.present[VertexLayout::BlendWeight] && layout.present[VertexLayout::BlendIndex];
 
         uint32_t vertexDataBase = gff.dataOffset() + vertexBufferOffset + 4 + vertexOffset;
         uint32_t indexDataBase = gff.dataOffset() + indexBufferOffset + 4;
@@ -281,65 +266,15 @@ bool loadMSH(const std::vector<uint8_t>& data, Model& outModel) {
             indexDataBase += indexOffset * 4;
         }
 
+        // Chunks in one file almost always share a declaration.
+        if (decoder.layout() != layout) decoder = VertexDecoder(layout);
+
         mesh.vertices.resize(vertexCount);
 
         double colSum[4] = {0, 0, 0, 0};
+        decoder.decode(gff.rawData(), vertexDataBase, vertexCount, mesh.vertices.data(), colSum);
 
-        for (uint32_t i = 0; i < vertexCount; i++) {
-            uint32_t baseOff = vertexDataBase + i * vertexSize;
-            float vals[4];
-
-            readDeclType(gff.rawData(), baseOff + posStream.offset, posStream.dataType, vals, bigEndian);
-            mesh.vertices[i].x = vals[0];
-            mesh.vertices[i].y = vals[1];
-            mesh.vertices[i].z = vals[2];
-
-            if (hasNormal) {
-                readDeclType(gff.rawData(), baseOff + normalStream.offset, normalStream.dataType, vals, bigEndian);
-                mesh.vertices[i].nx = vals[0];
-                mesh.vertices[i].ny = vals[1];
-                mesh.vertices[i].nz = vals[2];
-            } else {
-                mesh.vertices[i].nx = 0;
-                mesh.vertices[i].ny = 1;
-                mesh.vertices[i].nz = 0;
-            }
-
-            if (hasTexcoord) {
-                readDeclType(gff.rawData(), baseOff + texcoordStream.offset, texcoordStream.dataType, vals, bigEndian);
-                mesh.vertices[i].u = vals[0];
-                mesh.vertices[i].v = 1.0f - vals[1];
-            } else {
-                mesh.vertices[i].u = 0;
-                mesh.vertices[i].v = 0;
-            }
-
-            if (hasBlendWeight) {
-                readDeclType(gff.rawData(), baseOff + blendWeightStream.offset, blendWeightStream.dataType, vals, bigEndian);
-
-                mesh.vertices[i].boneWeights[0] = vals[0];
-                mesh.vertices[i].boneWeights[1] = vals[1];
-                mesh.vertices[i].boneWeights[2] = vals[2];
-                mesh.vertices[i].boneWeights[3] = vals[3];
-            }
-
-            if (hasBlendIndex) {
-                int indices[4];
-                readBlendIndices(gff.rawData(), baseOff + blendIndexStream.offset, blendIndexStream.dataType, indices, bigEndian);
-                mesh.vertices[i].boneIndices[0] = indices[0];
-                mesh.vertices[i].boneIndices[1] = indices[1];
-                mesh.vertices[i].boneIndices[2] = indices[2];
-                mesh.vertices[i].boneIndices[3] = indices[3];
-            }
-
-            if (hasColor) {
-                readDeclType(gff.rawData(), baseOff + colorStream.offset, colorStream.dataType, vals, bigEndian);
-                colSum[0] += vals[0]; colSum[1] += vals[1];
-                colSum[2] += vals[2]; colSum[3] += vals[3];
-            }
-        }
-
-        if (hasColor && vertexCount > 0) {
+        if (layout.present[VertexLayout::Color] && vertexCount > 0) {
             mesh.hasVertexColor = true;
             mesh.avgVertexColor[0] = (float)(colSum[0] / vertexCount);
             mesh.avgVertexColor[1] = (float)(colSum[1] / vertexCount);
@@ -348,22 +283,7 @@ bool loadMSH(const std::vector<uint8_t>& data, Model& outModel) {
         }
 
         mesh.indices.resize(indexCount);
-
-        for (uint32_t i = 0; i < indexCount; i++) {
-            if (indexFormat == 0) {
-
-                uint16_t idx;
-                std::memcpy(&idx, &gff.rawData()[indexDataBase + i * 2], 2);
-                if (bigEndian) idx = GFFFile::bswap(idx);
-                mesh.indices[i] = idx;
-            } else {
-
-                uint32_t idx;
-                std::memcpy(&idx, &gff.rawData()[indexDataBase + i * 4], 4);
-                if (bigEndian) idx = GFFFile::bswap(idx);
-                mesh.indices[i] = idx;
-            }
-        }
+        decodeIndices(gff.rawData(), indexDataBase, indexCount, indexFormat != 0, bigEndian, mesh.indices.data());
 
         mesh.calculateBounds();
         outModel.meshes.push_back(mesh);
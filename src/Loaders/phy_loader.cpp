@@ -5,6 +5,8 @@
 #include "animation.h"
 #include "Gff.h"
 #include "erf.h"
+#include "erf_cache.h"
+#include "resource_locator.h"
 #include "Shaders/d3d_context.h"
 #include "renderer.h"
 #include "terrain_loader.h"
@@ -76,7 +78,7 @@ namespace fs = std::filesystem;
 
 bool loadPHY(const std::vector<uint8_t>& data, Model& model) {
     GFFFile gff;
-    if (!gff.load(data)) return false;
+    if (!gff.loadBorrowed(data)) return false;
     auto quatMul = [](float q1x, float q1y, float q1z, float q1w,
                       float q2x, float q2y, float q2z, float q2w,
                       float& rx, float& ry, float& rz, float& rw) {
@@ -324,109 +326,68 @@ void ensureBaseErfsLoaded(AppState& state) {
 }
 
 // Forward declarations for ERF index system (defined later in file)
-struct ErfIndexEntry {
-    ERFFile* erf;
-    size_t entryIdx;
-};
-static std::unordered_map<std::string, ErfIndexEntry> s_erfIndex;
-static std::unordered_map<std::string, ErfIndexEntry> s_erfIndexNoExt;
 static bool s_erfIndexBuilt = false;
 static std::vector<std::unique_ptr<ERFFile>> s_indexedErfs;
 static std::unordered_map<std::string, uint32_t> s_texIdCache;
-static std::vector<uint8_t> readFromErfIndex(const std::string& name, std::string* sourceOut = nullptr);
+static std::vector<uint8_t> readFromErfIndex(AppState& state, const std::string& name, std::string* sourceOut = nullptr);
+
+// Unscoped lookups search the archive sets in the order the old name index
+// was filled: model, material, texture, the open archive, then the install.
+void syncErfPackages(AppState& state) {
+    ResourceLocator::setPriority(&state.modelErfs, 4);
+    ResourceLocator::setPriority(&state.materialErfs, 3);
+    ResourceLocator::setPriority(&state.textureErfs, 2);
+    ResourceLocator::setPriority(&state.currentErf, 1);
+    ResourceLocator::setPriority(&s_indexedErfs, 0);
+    ResourceLocator::syncPackage(&state.modelErfs, state.modelErfs);
+    ResourceLocator::syncPackage(&state.materialErfs, state.materialErfs);
+    ResourceLocator::syncPackage(&state.textureErfs, state.textureErfs);
+    ResourceLocator::syncPackage(&state.currentErf, &state.currentErf, state.currentErf ? 1 : 0);
+    ResourceLocator::syncPackage(&s_indexedErfs, s_indexedErfs);
+}
+
+// A name with an extension only falls back to entries with the same
+// extension (i.e. a basename match); one without falls back to any extension.
+static ResourceRef findLoose(const std::string& name, const void* package) {
+    size_t sl = name.find_last_of("/\\");
+    size_t dp = name.rfind('.');
+    bool hasExt = dp != std::string::npos && (sl == std::string::npos || dp > sl);
+    return ResourceLocator::find(name, hasExt ? ResourceLocator::Match::Basename : ResourceLocator::Match::NoExt, package);
+}
+
+static ResourceRef findInSet(const std::vector<std::unique_ptr<ERFFile>>& erfs, const std::string& name, bool loose) {
+    ResourceLocator::syncPackage(&erfs, erfs);
+    ResourceRef ref = ResourceLocator::find(name, ResourceLocator::Match::Exact, &erfs);
+    if (!ref && loose) ref = findLoose(name, &erfs);
+    return ref;
+}
+
+static ResourceRef findInCurrentErf(AppState& state, const std::string& name, bool loose) {
+    ResourceLocator::syncPackage(&state.currentErf, &state.currentErf, state.currentErf ? 1 : 0);
+    ResourceRef ref = ResourceLocator::find(name, ResourceLocator::Match::Exact, &state.currentErf);
+    if (!ref && loose) ref = findLoose(name, &state.currentErf);
+    return ref;
+}
 
 static std::vector<uint8_t> readFromModelErfs(AppState& state, const std::string& name) {
-    std::string nameLower = name;
-    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-    for (const auto& erf : state.modelErfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == nameLower) return erf->readEntry(entry);
-        }
-    }
+    if (ResourceRef ref = findInSet(state.modelErfs, name, false)) return ref.read();
     // Fallback: search the source ERF the model was loaded from
-    if (state.currentErf) {
-        std::string noExtLower = nameLower;
-        std::string nameExt;
-        size_t dp = noExtLower.rfind('.');
-        if (dp != std::string::npos) {
-            nameExt = noExtLower.substr(dp); // e.g. ".mmh"
-            noExtLower = noExtLower.substr(0, dp);
-        }
-        for (const auto& entry : state.currentErf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == nameLower) return state.currentErf->readEntry(entry);
-            // No-ext fallback: only match if extensions also match
-            std::string entryNoExt = entryLower;
-            std::string entryExt;
-            size_t edp = entryNoExt.rfind('.');
-            if (edp != std::string::npos) {
-                entryExt = entryNoExt.substr(edp);
-                entryNoExt = entryNoExt.substr(0, edp);
-            }
-            if (entryNoExt == noExtLower && entryExt == nameExt) return state.currentErf->readEntry(entry);
-        }
-    }
-    return {};
+    return findInCurrentErf(state, name, true).read();
 }
 
 static std::vector<uint8_t> readFromMaterialErfs(AppState& state, const std::string& name) {
     if (s_erfIndexBuilt) {
-        auto result = readFromErfIndex(name);
+        auto result = readFromErfIndex(state, name);
         if (!result.empty()) return result;
     }
 
-    std::string nameLower = name;
-    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-    std::string noExtLower = nameLower;
-    std::string nameExt;
-    size_t dp = noExtLower.rfind('.');
-    if (dp != std::string::npos) {
-        nameExt = noExtLower.substr(dp);
-        noExtLower = noExtLower.substr(0, dp);
-    }
-
     const std::vector<std::unique_ptr<ERFFile>>* erfSets[] = {
         &state.materialErfs, &state.modelErfs, &state.textureErfs
     };
     for (const auto* erfs : erfSets) {
-        for (const auto& erf : *erfs) {
-            for (const auto& entry : erf->entries()) {
-                std::string entryLower = entry.name;
-                std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-                if (entryLower == nameLower) return erf->readEntry(entry);
-                // No-ext fallback: only match if extensions also match
-                std::string entryNoExt = entryLower;
-                std::string entryExt;
-                size_t edp = entryNoExt.rfind('.');
-                if (edp != std::string::npos) {
-                    entryExt = entryNoExt.substr(edp);
-                    entryNoExt = entryNoExt.substr(0, edp);
-                }
-                if (entryNoExt == noExtLower && entryExt == nameExt) return erf->readEntry(entry);
-            }
-        }
+        if (ResourceRef ref = findInSet(*erfs, name, true)) return ref.read();
     }
-
-    if (state.currentErf) {
-        for (const auto& entry : state.currentErf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == nameLower) return state.currentErf->readEntry(entry);
-            std::string entryNoExt = entryLower;
-            std::string entryExt;
-            size_t edp = entryNoExt.rfind('.');
-            if (edp != std::string::npos) {
-                entryExt = entryNoExt.substr(edp);
-                entryNoExt = entryNoExt.substr(0, edp);
-            }
-            if (entryNoExt == noExtLower && entryExt == nameExt) return state.currentErf->readEntry(entry);
-        }
-    }
-
-    return {};
+    return findInCurrentErf(state, name, true).read();
 }
 
 static uint32_t loadCubemapByName(AppState& state, const std::string& texName) {
@@ -437,55 +398,30 @@ static uint32_t loadCubemapByName(AppState& state, const std::string& texName) {
     if (withDds.size() < 4 || withDds.substr(withDds.size() - 4) != ".dds")
         withDds += ".dds";
 
+    auto tryRef = [&](const ResourceRef& ref) -> uint32_t {
+        if (!ref) return 0;
+        auto data = ref.read();
+        if (!data.empty() && isDDSCubemap(data))
+            return createTextureCubeFromDDS(data);
+        return 0;
+    };
+
     if (s_erfIndexBuilt) {
-        auto tryKey = [&](const std::string& key) -> uint32_t {
-            auto it = s_erfIndex.find(key);
-            if (it != s_erfIndex.end()) {
-                const auto& entries = it->second.erf->entries();
-                if (it->second.entryIdx < entries.size()) {
-                    auto data = it->second.erf->readEntry(entries[it->second.entryIdx]);
-                    if (!data.empty() && isDDSCubemap(data))
-                        return createTextureCubeFromDDS(data);
-                }
-            }
-            return 0;
-        };
-        uint32_t id = tryKey(withDds);
-        if (!id) id = tryKey(lower);
-        if (!id) {
-            std::string noext = lower;
-            size_t dp = noext.rfind('.');
-            if (dp != std::string::npos) noext = noext.substr(0, dp);
-            auto it = s_erfIndexNoExt.find(noext);
-            if (it != s_erfIndexNoExt.end()) {
-                const auto& entries = it->second.erf->entries();
-                if (it->second.entryIdx < entries.size()) {
-                    auto data = it->second.erf->readEntry(entries[it->second.entryIdx]);
-                    if (!data.empty() && isDDSCubemap(data))
-                        id = createTextureCubeFromDDS(data);
-                }
-            }
-        }
+        syncErfPackages(state);
+        uint32_t id = tryRef(ResourceLocator::find(withDds, ResourceLocator::Match::Exact));
+        if (!id) id = tryRef(ResourceLocator::find(lower, ResourceLocator::Match::Exact));
+        if (!id) id = tryRef(ResourceLocator::find(lower, ResourceLocator::Match::NoExt));
         return id;
     }
 
-    auto tryErf = [&](ERFFile& erf) -> uint32_t {
-        for (const auto& e : erf.entries()) {
-            std::string eName = e.name;
-            std::transform(eName.begin(), eName.end(), eName.begin(), ::tolower);
-            if (eName == lower || eName == withDds) {
-                auto data = erf.readEntry(e);
-                if (!data.empty() && isDDSCubemap(data)) {
-                    return createTextureCubeFromDDS(data);
-                }
-            }
-        }
-        return 0;
+    const std::vector<std::unique_ptr<ERFFile>>* erfSets[] = {
+        &state.textureErfs, &state.materialErfs, &state.modelErfs
     };
-
-    for (auto& erf : state.textureErfs)   { uint32_t id = tryErf(*erf); if (id) return id; }
-    for (auto& erf : state.materialErfs)   { uint32_t id = tryErf(*erf); if (id) return id; }
-    for (auto& erf : state.modelErfs)      { uint32_t id = tryErf(*erf); if (id) return id; }
+    for (const auto* erfs : erfSets) {
+        uint32_t id = tryRef(findInSet(*erfs, lower, false));
+        if (!id) id = tryRef(findInSet(*erfs, withDds, false));
+        if (id) return id;
+    }
 
     return 0;
 }
@@ -549,75 +485,100 @@ static uint32_t loadTextureByName(AppState& state, const std::string& texName,
         return createTextureFromDDS(texData);
     };
 
-    // Fast path: use the global ERF index if available
-    if (s_erfIndexBuilt) {
-        auto tryIndex = [&](const std::string& key) -> std::vector<uint8_t> {
-            auto it = s_erfIndex.find(key);
-            if (it != s_erfIndex.end()) {
-                const auto& entries = it->second.erf->entries();
-                if (it->second.entryIdx < entries.size())
-                    return it->second.erf->readEntry(entries[it->second.entryIdx]);
-            }
-            return {};
-        };
+    auto loadFromRef = [&](const ResourceRef& ref) -> uint32_t {
+        std::vector<uint8_t> texData = ref.read();
+        return texData.empty() ? 0 : createTextureFromAny(texData);
+    };
 
-        std::vector<uint8_t> texData = tryIndex(withDdsLower);
-        if (texData.empty()) texData = tryIndex(withXdsLower);
-        if (texData.empty()) texData = tryIndex(texNameLower);
-        if (texData.empty()) {
-            auto it = s_erfIndexNoExt.find(noExtLower);
-            if (it != s_erfIndexNoExt.end()) {
-                const auto& entries = it->second.erf->entries();
-                if (it->second.entryIdx < entries.size())
-                    texData = it->second.erf->readEntry(entries[it->second.entryIdx]);
-            }
-        }
-        if (!texData.empty()) {
-            uint32_t id = createTextureFromAny(texData);
+    // Fast path: search every indexed archive at once
+    if (s_erfIndexBuilt) {
+        syncErfPackages(state);
+        ResourceRef ref = ResourceLocator::find(withDdsLower, ResourceLocator::Match::Exact);
+        if (!ref) ref = ResourceLocator::find(withXdsLower, ResourceLocator::Match::Exact);
+        if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::Exact);
+        if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::NoExt);
+        if (ref) {
+            uint32_t id = loadFromRef(ref);
             if (id && !rgbaOut) s_texIdCache[noExtLower] = id;
             return id;
         }
         // Index had nothing — fall through to currentErf fallback below
     }
 
-    // Slow fallback: linear scan (only used if index not built yet)
-    auto tryLoadFromErf = [&](ERFFile& erf) -> uint32_t {
-        for (const auto& entry : erf.entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            std::string entryNoExt = entryLower;
-            size_t edp = entryNoExt.rfind('.');
-            if (edp != std::string::npos) entryNoExt = entryNoExt.substr(0, edp);
-            if (entryLower == texNameLower || entryLower == withDdsLower ||
-                entryLower == withXdsLower || entryNoExt == noExtLower) {
-                std::vector<uint8_t> texData = erf.readEntry(entry);
-                if (!texData.empty()) {
-                    return createTextureFromAny(texData);
-                }
-            }
-        }
-        return 0;
+    auto lookupIn = [&](const void* package) -> ResourceRef {
+        ResourceRef ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::Exact, package);
+        if (!ref) ref = ResourceLocator::find(withDdsLower, ResourceLocator::Match::Exact, package);
+        if (!ref) ref = ResourceLocator::find(withXdsLower, ResourceLocator::Match::Exact, package);
+        if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::NoExt, package);
+        return ref;
     };
 
     if (!s_erfIndexBuilt) {
         const std::vector<std::unique_ptr<ERFFile>>* erfSets[] = {
             &state.textureErfs, &state.materialErfs, &state.modelErfs
         };
-        for (int s = 0; s < 3; s++) {
-            for (const auto& erf : *erfSets[s]) {
-                uint32_t id = tryLoadFromErf(*erf);
-                if (id != 0) return id;
-            }
+        for (const auto* erfs : erfSets) {
+            ResourceLocator::syncPackage(erfs, *erfs);
+            uint32_t id = loadFromRef(lookupIn(erfs));
+            if (id != 0) return id;
         }
     }
     if (state.currentErf) {
-        uint32_t id = tryLoadFromErf(*state.currentErf);
+        ResourceLocator::syncPackage(&state.currentErf, &state.currentErf, 1);
+        uint32_t id = loadFromRef(lookupIn(&state.currentErf));
         if (id != 0) return id;
     }
 
     return 0;
 }
 
+// Same search order as loadTextureByName, but hands back the file bytes
+// instead of creating a texture, so it can run off the render thread.
+std::vector<uint8_t> readLevelTexture(AppState& state, const std::string& texName) {
+    if (texName.empty()) return {};
+    std::string texNameLower = texName;
+    std::transform(texNameLower.begin(), texNameLower.end(), texNameLower.begin(), ::tolower);
+
+    std::string noExtLower = texNameLower;
+    size_t dp = noExtLower.rfind('.');
+    if (dp != std::string::npos) noExtLower = noExtLower.substr(0, dp);
+
+    std::string withDdsLower = noExtLower + ".dds";
+    std::string withXdsLower = noExtLower + ".xds";
+
+    if (s_erfIndexBuilt) {
+        ResourceRef ref = ResourceLocator::find(withDdsLower, ResourceLocator::Match::Exact);
+        if (!ref) ref = ResourceLocator::find(withXdsLower, ResourceLocator::Match::Exact);
+        if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::Exact);
+        if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::NoExt);
+        if (ref) return ref.read();
+    }
+
+    auto lookupIn = [&](const void* package) -> ResourceRef {
+        ResourceRef ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::Exact, package);
+        if (!ref) ref = ResourceLocator::find(withDdsLower, ResourceLocator::Match::Exact, package);
+        if (!ref) ref = ResourceLocator::find(withXdsLower, ResourceLocator::Match::Exact, package);
+        if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::NoExt, package);
+        return ref;
+    };
+
+    if (!s_erfIndexBuilt) {
+        const std::vector<std::unique_ptr<ERFFile>>* erfSets[] = {
+            &state.textureErfs, &state.materialErfs, &state.modelErfs
+        };
+        for (const auto* erfs : erfSets) {
+            ResourceLocator::syncPackage(erfs, *erfs);
+            std::vector<uint8_t> data = lookupIn(erfs).read();
+            if (!data.empty()) return data;
+        }
+    }
+    if (state.currentErf) {
+        ResourceLocator::syncPackage(&state.currentErf, &state.currentErf, 1);
+        return lookupIn(&state.currentErf).read();
+    }
+    return {};
+}
+
 bool loadModelFromEntry(AppState& state, const ERFEntry& entry) {
     if (!state.currentErf) return false;
     loadTextureErfs(state);
@@ -1017,14 +978,13 @@ bool loadModelFromOverride(AppState& state, const std::string& mshPath) {
     return true;
 }
 
-bool mergeModelEntry(AppState& state, const ERFEntry& entry) {
+bool decodeTerrainEntry(AppState& state, const ERFEntry& entry, Model& tempModel) {
     if (!state.currentErf) return false;
     std::vector<uint8_t> data = state.currentErf->readEntry(entry);
     if (data.empty()) {
         std::cout << "[LEVEL] FAILED to read terrain entry: " << entry.name << std::endl;
         return false;
     }
-    Model tempModel;
     if (!loadMSH(data, tempModel)) {
         std::cout << "[LEVEL] FAILED to parse terrain MSH: " << entry.name << std::endl;
         return false;
@@ -1056,6 +1016,12 @@ bool mergeModelEntry(AppState& state, const ERFEntry& entry) {
     }
 
     applyMeshLocalTransforms(tempModel);
+    return true;
+}
+
+bool mergeModelEntry(AppState& state, const ERFEntry& entry) {
+    Model tempModel;
+    if (!decodeTerrainEntry(state, entry, tempModel)) return false;
 
     std::set<std::string> newMaterials;
     for (const auto& mesh : tempModel.meshes) {
@@ -1071,26 +1037,8 @@ bool mergeModelEntry(AppState& state, const ERFEntry& entry) {
     state.renderSettings.initMeshVisibility(state.currentModel.meshes.size());
 
 
-    for (const std::string& matName : newMaterials) {
-        std::string maoLookup = matName;
-        {
-            std::string lower = matName;
-            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-            if (lower.size() < 4 || lower.substr(lower.size() - 4) != ".mao")
-                maoLookup += ".mao";
-        }
-        std::vector<uint8_t> maoData = readFromMaterialErfs(state, maoLookup);
-        if (!maoData.empty()) {
-            std::string maoContent(maoData.begin(), maoData.end());
-            Material mat = parseMAO(maoContent, matName);
-            mat.maoContent = maoContent;
-            state.currentModel.materials.push_back(mat);
-        } else {
-            Material mat;
-            mat.name = matName;
-            state.currentModel.materials.push_back(mat);
-        }
-    }
+    for (const std::string& matName : newMaterials)
+        state.currentModel.materials.push_back(loadLevelMaterial(state, matName, false));
 
 
     for (auto& mesh : state.currentModel.meshes) {
@@ -1128,121 +1076,42 @@ bool mergeModelEntry(AppState& state, const ERFEntry& entry) {
 
 
 void buildErfIndex(AppState& state) {
-    s_erfIndex.clear();
-    s_erfIndexNoExt.clear();
+    ResourceLocator::removePackage(&s_indexedErfs);
     s_indexedErfs.clear();
     s_texIdCache.clear();
 
-    auto addToIndex = [&](ERFFile* erf, size_t entryIdx, const std::string& name) {
-        std::string key = name;
-        std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-        if (s_erfIndex.find(key) == s_erfIndex.end())
-            s_erfIndex[key] = {erf, entryIdx};
-        std::string noext = key;
-        size_t dp = noext.rfind('.');
-        if (dp != std::string::npos) noext = noext.substr(0, dp);
-        if (s_erfIndexNoExt.find(noext) == s_erfIndexNoExt.end())
-            s_erfIndexNoExt[noext] = {erf, entryIdx};
-    };
-
-    auto indexErfSet = [&](const std::vector<std::unique_ptr<ERFFile>>& erfs) {
-        for (const auto& erf : erfs) {
-            const auto& entries = erf->entries();
-            for (size_t i = 0; i < entries.size(); i++)
-                addToIndex(erf.get(), i, entries[i].name);
-        }
-    };
-
-    indexErfSet(state.modelErfs);
-    indexErfSet(state.materialErfs);
-    indexErfSet(state.textureErfs);
-
-    if (state.currentErf) {
-        const auto& entries = state.currentErf->entries();
-        for (size_t i = 0; i < entries.size(); i++)
-            addToIndex(state.currentErf.get(), i, entries[i].name);
-    }
-
     for (const auto& erfPath : state.erfFiles) {
         auto erf = std::make_unique<ERFFile>();
-        if (erf->open(erfPath) && erf->encryption() == 0) {
-            const auto& entries = erf->entries();
-            for (size_t i = 0; i < entries.size(); i++)
-                addToIndex(erf.get(), i, entries[i].name);
+        if (ERFTocCache::open(*erf, erfPath) && erf->encryption() == 0)
             s_indexedErfs.push_back(std::move(erf));
-        }
     }
+    syncErfPackages(state);
 
     s_erfIndexBuilt = true;
 }
 
-static std::vector<uint8_t> readFromErfIndex(const std::string& name, std::string* sourceOut) {
-    std::string key = name;
-    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
-
-    auto tryRead = [&](const ErfIndexEntry& entry) -> std::vector<uint8_t> {
-        const auto& entries = entry.erf->entries();
-        if (entry.entryIdx < entries.size()) {
-            if (sourceOut) {
-                namespace fs = std::filesystem;
-                *sourceOut = "indexed: " + fs::path(entry.erf->path()).filename().string();
-            }
-            return entry.erf->readEntry(entries[entry.entryIdx]);
-        }
-        return {};
-    };
+static std::vector<uint8_t> readFromErfIndex(AppState& state, const std::string& name, std::string* sourceOut) {
+    syncErfPackages(state);
 
     // Exact match (including extension) - always preferred
-    auto it = s_erfIndex.find(key);
-    if (it != s_erfIndex.end()) return tryRead(it->second);
-
-    // No-ext fallback: only use if the indexed entry has the same extension
-    std::string noext = key;
-    std::string nameExt;
-    size_t dp = noext.rfind('.');
-    if (dp != std::string::npos) {
-        nameExt = noext.substr(dp);
-        noext = noext.substr(0, dp);
-    }
-    auto it2 = s_erfIndexNoExt.find(noext);
-    if (it2 != s_erfIndexNoExt.end()) {
-        // Verify extension matches before returning
-        const auto& entries = it2->second.erf->entries();
-        if (it2->second.entryIdx < entries.size()) {
-            std::string entryName = entries[it2->second.entryIdx].name;
-            std::transform(entryName.begin(), entryName.end(), entryName.begin(), ::tolower);
-            std::string entryExt;
-            size_t edp = entryName.rfind('.');
-            if (edp != std::string::npos) entryExt = entryName.substr(edp);
-            // If we requested a specific extension, only match if extensions agree
-            // If no extension was requested (nameExt empty), allow any match
-            if (nameExt.empty() || entryExt == nameExt) {
-                return tryRead(it2->second);
-            }
-        }
-    }
+    ResourceRef ref = ResourceLocator::find(name, ResourceLocator::Match::Exact);
+    if (!ref) ref = findLoose(name, nullptr);
+    if (!ref) return {};
 
-    return {};
+    if (sourceOut) {
+        namespace fs = std::filesystem;
+        *sourceOut = "indexed: " + fs::path(ref.erf->path()).filename().string();
+    }
+    return ref.read();
 }
 
 static std::vector<uint8_t> readFromAnyErf(AppState& state, const std::string& name, std::string* sourceOut = nullptr) {
-    if (s_erfIndexBuilt) return readFromErfIndex(name, sourceOut);
-
-    std::string nameLower = name;
-    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
+    if (s_erfIndexBuilt) return readFromErfIndex(state, name, sourceOut);
 
     auto tryErfSet = [&](const std::vector<std::unique_ptr<ERFFile>>& erfs, const std::string& setName) -> std::vector<uint8_t> {
-        for (const auto& erf : erfs) {
-            for (const auto& entry : erf->entries()) {
-                std::string entryLower = entry.name;
-                std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-                if (entryLower == nameLower) {
-                    if (sourceOut) *sourceOut = setName + ": " + erf->path();
-                    return erf->readEntry(entry);
-                }
-            }
-        }
-        return {};
+        ResourceRef ref = findInSet(erfs, name, false);
+        if (ref && sourceOut) *sourceOut = setName + ": " + ref.erf->path();
+        return ref.read();
     };
 
     auto result = tryErfSet(state.modelErfs, "modelErfs");
@@ -1252,17 +1121,13 @@ static std::vector<uint8_t> readFromAnyErf(AppState& state, const std::string& n
     result = tryErfSet(state.textureErfs, "textureErfs");
     if (!result.empty()) return result;
 
-    if (state.currentErf) {
-        for (const auto& entry : state.currentErf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == nameLower) {
-                if (sourceOut) *sourceOut = "currentErf";
-                return state.currentErf->readEntry(entry);
-            }
-        }
+    if (ResourceRef ref = findInCurrentErf(state, name, false)) {
+        if (sourceOut) *sourceOut = "currentErf";
+        return ref.read();
     }
 
+    std::string nameLower = name;
+    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
     for (const auto& erfPath : state.erfFiles) {
         ERFFile erf;
         if (erf.open(erfPath) && erf.encryption() == 0) {
@@ -1292,13 +1157,13 @@ static std::vector<uint8_t> readFromModelMeshDataErfs(AppState& state, const std
         std::transform(pathLower.begin(), pathLower.end(), pathLower.begin(), ::tolower);
         if (pathLower.find("modelmeshdata") == std::string::npos &&
             pathLower.find("meshdata") == std::string::npos) continue;
-        ERFFile erf;
-        if (!erf.open(erfPath) || erf.encryption() != 0) continue;
-        for (const auto& entry : erf.entries()) {
+        auto erf = openSharedERF(erfPath);
+        if (!erf || erf->encryption() != 0) continue;
+        for (const auto& entry : erf->entries()) {
             std::string eLower = entry.name;
             std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
             if (eLower == nameLower) {
-                auto data = erf.readEntry(entry);
+                auto data = erf->readEntry(entry);
                 if (!data.empty()) {
                     std::cout << "[LEVEL] Found '" << name << "' in ModelMeshData: "
                               << fs::path(erfPath).filename().string() << std::endl;
@@ -1324,13 +1189,13 @@ static std::vector<uint8_t> readFromSiblingRims(AppState& state, const std::stri
             std::string fnameLower = dirEntry.path().filename().string();
             std::transform(fnameLower.begin(), fnameLower.end(), fnameLower.begin(), ::tolower);
             if (fnameLower.size() < 5 || fnameLower.substr(fnameLower.size() - 4) != ".rim") continue;
-            ERFFile rim;
-            if (!rim.open(dpath)) continue;
-            for (const auto& entry : rim.entries()) {
+            auto rim = openSharedERF(dpath);
+            if (!rim) continue;
+            for (const auto& entry : rim->entries()) {
                 std::string eLower = entry.name;
                 std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
                 if (eLower == nameLower) {
-                    auto data = rim.readEntry(entry);
+                    auto data = rim->readEntry(entry);
                     if (!data.empty()) {
                         std::cout << "[LEVEL] Found '" << name << "' in sibling rim: " << dirEntry.path().filename().string() << std::endl;
                         return data;
@@ -1348,126 +1213,130 @@ static std::set<std::string> s_propMissingModels;
 void clearPropCache() {
     s_propModelCache.clear();
     s_propMissingModels.clear();
-    s_erfIndex.clear();
-    s_erfIndexNoExt.clear();
+    ResourceLocator::removePackage(&s_indexedErfs);
     s_indexedErfs.clear();
     s_erfIndexBuilt = false;
     s_texIdCache.clear();
 }
 
-bool mergeModelByName(AppState& state, const std::string& modelName,
-                      float px, float py, float pz,
-                      float qx, float qy, float qz, float qw,
-                      float scale) {
-
-    std::string nameLower = modelName;
-    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-
-    if (s_propMissingModels.count(nameLower)) return false;
-
-    auto cacheIt = s_propModelCache.find(nameLower);
-    if (cacheIt == s_propModelCache.end()) {
-        std::string mshName = modelName + ".msh";
-        std::string mshSource;
-        std::vector<uint8_t> mshData = readFromAnyErf(state, mshName, &mshSource);
-        if (mshData.empty()) {
-            mshName = modelName + "_0.msh";
-            mshData = readFromAnyErf(state, mshName, &mshSource);
-        }
+bool decodePropModel(AppState& state, const std::string& modelName, Model& tempModel) {
+    std::string mshName = modelName + ".msh";
+    std::string mshSource;
+    std::vector<uint8_t> mshData = readFromAnyErf(state, mshName, &mshSource);
+    if (mshData.empty()) {
+        mshName = modelName + "_0.msh";
+        mshData = readFromAnyErf(state, mshName, &mshSource);
+    }
 
-        Model tempModel;
-        bool parsed = false;
-        if (!mshData.empty()) {
-            parsed = loadMSH(mshData, tempModel);
-            if (!parsed) {
-                std::cout << "[LEVEL] MSH FOUND BUT PARSE FAILED: " << mshName
-                          << " (" << mshData.size() << " bytes, header: ";
-                for (size_t i = 0; i < std::min(mshData.size(), (size_t)8); i++)
-                    printf("%02X ", mshData[i]);
-                std::cout << ") from [" << mshSource << "] - trying sibling rims..." << std::endl;
-                mshName = modelName + ".msh";
-                mshData = readFromSiblingRims(state, mshName);
-                if (mshData.empty()) {
-                    mshName = modelName + "_0.msh";
-                    mshData = readFromSiblingRims(state, mshName);
-                }
-                if (!mshData.empty()) {
-                    parsed = loadMSH(mshData, tempModel);
-                    if (!parsed) {
-                        std::cout << "[LEVEL] Sibling rim MSH also failed to parse: " << mshName
-                                  << " (" << mshData.size() << " bytes)" << std::endl;
-                    }
-                }
-                if (!parsed) {
-                    mshName = modelName + ".msh";
-                    mshData = readFromModelMeshDataErfs(state, mshName);
-                    if (mshData.empty()) {
-                        mshName = modelName + "_0.msh";
-                        mshData = readFromModelMeshDataErfs(state, mshName);
-                    }
-                    if (!mshData.empty()) {
-                        parsed = loadMSH(mshData, tempModel);
-                        if (!parsed) {
-                            std::cout << "[LEVEL] ModelMeshData MSH also failed to parse: " << mshName
-                                      << " (" << mshData.size() << " bytes, header: ";
-                            for (size_t i = 0; i < std::min(mshData.size(), (size_t)8); i++)
-                                printf("%02X ", mshData[i]);
-                            std::cout << ")" << std::endl;
-                        }
-                    }
-                }
-            }
-        } else {
+    bool parsed = false;
+    if (!mshData.empty()) {
+        parsed = loadMSH(mshData, tempModel);
+        if (!parsed) {
+            std::cout << "[LEVEL] MSH FOUND BUT PARSE FAILED: " << mshName
+                      << " (" << mshData.size() << " bytes, header: ";
+            for (size_t i = 0; i < std::min(mshData.size(), (size_t)8); i++)
+                printf("%02X ", mshData[i]);
+            std::cout << ") from [" << mshSource << "] - trying sibling rims..." << std::endl;
             mshName = modelName + ".msh";
             mshData = readFromSiblingRims(state, mshName);
             if (mshData.empty()) {
                 mshName = modelName + "_0.msh";
                 mshData = readFromSiblingRims(state, mshName);
             }
-            if (mshData.empty()) {
-                mshName = modelName + ".msh";
-                mshData = readFromModelMeshDataErfs(state, mshName);
-            }
-            if (mshData.empty()) {
-                mshName = modelName + "_0.msh";
-                mshData = readFromModelMeshDataErfs(state, mshName);
-            }
             if (!mshData.empty()) {
                 parsed = loadMSH(mshData, tempModel);
                 if (!parsed) {
-                    std::cout << "[LEVEL] Fallback MSH parse failed: " << mshName
+                    std::cout << "[LEVEL] Sibling rim MSH also failed to parse: " << mshName
                               << " (" << mshData.size() << " bytes)" << std::endl;
                 }
             }
+            if (!parsed) {
+                mshName = modelName + ".msh";
+                mshData = readFromModelMeshDataErfs(state, mshName);
+                if (mshData.empty()) {
+                    mshName = modelName + "_0.msh";
+                    mshData = readFromModelMeshDataErfs(state, mshName);
+                }
+                if (!mshData.empty()) {
+                    parsed = loadMSH(mshData, tempModel);
+                    if (!parsed) {
+                        std::cout << "[LEVEL] ModelMeshData MSH also failed to parse: " << mshName
+                                  << " (" << mshData.size() << " bytes, header: ";
+                        for (size_t i = 0; i < std::min(mshData.size(), (size_t)8); i++)
+                            printf("%02X ", mshData[i]);
+                        std::cout << ")" << std::endl;
+                    }
+                }
+            }
         }
-
-        if (!parsed) {
-            if (mshData.empty()) {
-                std::cout << "[LEVEL] MSH NOT FOUND: " << modelName
-                          << " (searched ERFs + sibling rims + ModelMeshData)" << std::endl;
+    } else {
+        mshName = modelName + ".msh";
+        mshData = readFromSiblingRims(state, mshName);
+        if (mshData.empty()) {
+            mshName = modelName + "_0.msh";
+            mshData = readFromSiblingRims(state, mshName);
+        }
+        if (mshData.empty()) {
+            mshName = modelName + ".msh";
+            mshData = readFromModelMeshDataErfs(state, mshName);
+        }
+        if (mshData.empty()) {
+            mshName = modelName + "_0.msh";
+            mshData = readFromModelMeshDataErfs(state, mshName);
+        }
+        if (!mshData.empty()) {
+            parsed = loadMSH(mshData, tempModel);
+            if (!parsed) {
+                std::cout << "[LEVEL] Fallback MSH parse failed: " << mshName
+                          << " (" << mshData.size() << " bytes)" << std::endl;
             }
-            s_propMissingModels.insert(nameLower);
-            return false;
         }
+    }
 
-        std::vector<std::string> mmhCandidates = {modelName + ".mmh", modelName + "a.mmh", modelName + "_0.mmh"};
-        bool mmhFound = false;
-        for (const auto& candidate : mmhCandidates) {
-            std::vector<uint8_t> mmhData = readFromAnyErf(state, candidate);
-            if (!mmhData.empty()) {
-                loadMMH(mmhData, tempModel);
-                mmhFound = true;
-                break;
-            }
+    if (!parsed) {
+        if (mshData.empty()) {
+            std::cout << "[LEVEL] MSH NOT FOUND: " << modelName
+                      << " (searched ERFs + sibling rims + ModelMeshData)" << std::endl;
         }
-        if (!mmhFound) {
-            std::cout << "[LEVEL] WARNING: no MMH found for prop: " << modelName << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> mmhCandidates = {modelName + ".mmh", modelName + "a.mmh", modelName + "_0.mmh"};
+    bool mmhFound = false;
+    for (const auto& candidate : mmhCandidates) {
+        std::vector<uint8_t> mmhData = readFromAnyErf(state, candidate);
+        if (!mmhData.empty()) {
+            loadMMH(mmhData, tempModel);
+            mmhFound = true;
+            break;
         }
+    }
+    if (!mmhFound) {
+        std::cout << "[LEVEL] WARNING: no MMH found for prop: " << modelName << std::endl;
+    }
 
-        applyMeshLocalTransforms(tempModel);
+    applyMeshLocalTransforms(tempModel);
+    return true;
+}
+
+bool mergeModelByName(AppState& state, const std::string& modelName,
+                      float px, float py, float pz,
+                      float qx, float qy, float qz, float qw,
+                      float scale) {
 
-        s_propModelCache[nameLower] = tempModel;
-        cacheIt = s_propModelCache.find(nameLower);
+    std::string nameLower = modelName;
+    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
+
+    if (s_propMissingModels.count(nameLower)) return false;
+
+    auto cacheIt = s_propModelCache.find(nameLower);
+    if (cacheIt == s_propModelCache.end()) {
+        Model tempModel;
+        if (!decodePropModel(state, modelName, tempModel)) {
+            s_propMissingModels.insert(nameLower);
+            return false;
+        }
+        cacheIt = s_propModelCache.emplace(nameLower, std::move(tempModel)).first;
     }
 
     Model instance = cacheIt->second;
@@ -1485,6 +1354,95 @@ bool mergeModelByName(AppState& state, const std::string& modelName,
     return true;
 }
 
+Material loadLevelMaterial(AppState& state, const std::string& matName, bool searchAllErfs) {
+    std::string maoLookup = matName;
+    {
+        std::string lower = matName;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower.size() < 4 || lower.substr(lower.size() - 4) != ".mao")
+            maoLookup += ".mao";
+    }
+    std::vector<uint8_t> maoData = readFromMaterialErfs(state, maoLookup);
+    if (maoData.empty() && searchAllErfs) maoData = readFromAnyErf(state, maoLookup);
+    if (!maoData.empty()) {
+        std::string maoContent(maoData.begin(), maoData.end());
+        Material mat = parseMAO(maoContent, matName);
+        mat.maoContent = maoContent;
+        return mat;
+    }
+    if (searchAllErfs)
+        std::cout << "[LEVEL] MISSING MAO for material: " << matName << " (looked up: " << maoLookup << ")" << std::endl;
+    Material mat;
+    mat.name = matName;
+    return mat;
+}
+
+void resolveLevelWaterMaterial(Model& model, int matIdx) {
+    Material& mat = model.materials[matIdx];
+    std::cout << "[WATER] Material '" << mat.name << "'" << std::endl;
+    std::cout << "[WATER]   normalMap='" << mat.normalMap << "' waterNormalMap='" << mat.waterNormalMap << "'" << std::endl;
+    std::cout << "[WATER]   diffuseMap='" << mat.diffuseMap << "' waterDecalMap='" << mat.waterDecalMap << "'" << std::endl;
+    std::cout << "[WATER]   specularMap='" << mat.specularMap << "' waterMaskMap='" << mat.waterMaskMap << "'" << std::endl;
+    if (mat.normalMap.empty() && !mat.waterNormalMap.empty())
+        mat.normalMap = mat.waterNormalMap;
+    if (mat.diffuseMap.empty() && !mat.waterDecalMap.empty())
+        mat.diffuseMap = mat.waterDecalMap;
+    if (mat.specularMap.empty() && !mat.waterMaskMap.empty())
+        mat.specularMap = mat.waterMaskMap;
+    // Water body (deep) color = average per-vertex color of the level
+    // water meshes that use this material. DA water .msh carry the tint in
+    // their COLOR vertex channel (model_loader fills avgVertexColor).
+    // (The old path read g_terrainLoader, which is cleared on level load,
+    //  so the body color always fell back to the brown default.)
+    // Only RGB is a real color; the COLOR.a channel holds wave/flow data
+    // (wild values like -13.5, 52.3), so we ignore it and keep water opaque.
+    float rSum = 0, gSum = 0, bSum = 0;
+    int count = 0;
+    for (const auto& mesh : model.meshes) {
+        if (mesh.materialIndex == matIdx && mesh.hasVertexColor &&
+            std::isfinite(mesh.avgVertexColor[0]) &&
+            std::isfinite(mesh.avgVertexColor[1]) &&
+            std::isfinite(mesh.avgVertexColor[2])) {
+            rSum += mesh.avgVertexColor[0];
+            gSum += mesh.avgVertexColor[1];
+            bSum += mesh.avgVertexColor[2];
+            count++;
+        }
+    }
+    if (count > 0) {
+        auto cl = [](float v) { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); };
+        mat.waterBodyColor[0] = cl(rSum / count);
+        mat.waterBodyColor[1] = cl(gSum / count);
+        mat.waterBodyColor[2] = cl(bSum / count);
+        mat.waterBodyColor[3] = 1.0f;  // COLOR.a is not opacity
+    }
+    {
+        const char* wtmp = getenv("TEMP");
+        std::ofstream wdbg(std::string(wtmp ? wtmp : ".") + "\\haven_water_diag.txt", std::ios::app);
+        wdbg << "[WATER] mat='" << mat.name << "'  waterMeshesWithColor=" << count << "\n";
+        wdbg << "    bodyColor (RGBA, from vertex color) = "
+             << mat.waterBodyColor[0] << ", " << mat.waterBodyColor[1] << ", "
+             << mat.waterBodyColor[2] << ", " << mat.waterBodyColor[3] << "\n";
+        wdbg << "    waterColor PSH0 (xyz=normalBlendW, w=baseAlpha) = "
+             << mat.waterColor[0] << ", " << mat.waterColor[1] << ", "
+             << mat.waterColor[2] << ", " << mat.waterColor[3] << "\n";
+        wdbg << "    waterVisual PSH1 (fresnelPow, specInt, specPow, bump) = "
+             << mat.waterVisual[0] << ", " << mat.waterVisual[1] << ", "
+             << mat.waterVisual[2] << ", " << mat.waterVisual[3] << "\n";
+        wdbg << "    normalMap='" << mat.normalMap << "'  diffuseMap='" << mat.diffuseMap << "'\n";
+    }
+    std::cout << "[WATER]   AFTER: normalMap='" << mat.normalMap << "' diffuseMap='" << mat.diffuseMap << "'" << std::endl;
+    // Do NOT fall back to Default_BlackCubemap: a black reflection cube makes
+    // the water render black at grazing angles (where fresnel->1 and the
+    // reflection dominates). "Find any cubemap" is also unreliable. Leaving the
+    // id at 0 makes the shader use its procedural sky reflection
+    // (uHasCubemap==0), which reacts to view + sun direction and looks correct.
+    if (mat.envCubemapTexId != 0)
+        std::cout << "[WATER]   using material cubemap texId=" << mat.envCubemapTexId << std::endl;
+    else
+        std::cout << "[WATER]   procedural sky reflection (no cubemap)" << std::endl;
+}
+
 void finalizeLevelMaterials(AppState& state) {
     std::set<std::string> newMaterials;
     for (const auto& mesh : state.currentModel.meshes) {
@@ -1493,28 +1451,8 @@ void finalizeLevelMaterials(AppState& state) {
         }
     }
 
-    for (const std::string& matName : newMaterials) {
-        std::string maoLookup = matName;
-        {
-            std::string lower = matName;
-            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-            if (lower.size() < 4 || lower.substr(lower.size() - 4) != ".mao")
-                maoLookup += ".mao";
-        }
-        std::vector<uint8_t> maoData = readFromMaterialErfs(state, maoLookup);
-        if (maoData.empty()) maoData = readFromAnyErf(state, maoLookup);
-        if (!maoData.empty()) {
-            std::string maoContent(maoData.begin(), maoData.end());
-            Material mat = parseMAO(maoContent, matName);
-            mat.maoContent = maoContent;
-            state.currentModel.materials.push_back(mat);
-        } else {
-            std::cout << "[LEVEL] MISSING MAO for material: " << matName << " (looked up: " << maoLookup << ")" << std::endl;
-            Material mat;
-            mat.name = matName;
-            state.currentModel.materials.push_back(mat);
-        }
-    }
+    for (const std::string& matName : newMaterials)
+        state.currentModel.materials.push_back(loadLevelMaterial(state, matName, true));
 
     for (auto& mesh : state.currentModel.meshes) {
         if (!mesh.materialName.empty())
@@ -1522,71 +1460,8 @@ void finalizeLevelMaterials(AppState& state) {
     }
 
     for (auto& mat : state.currentModel.materials) {
-        if (mat.isWater) {
-            std::cout << "[WATER] Material '" << mat.name << "'" << std::endl;
-            std::cout << "[WATER]   normalMap='" << mat.normalMap << "' waterNormalMap='" << mat.waterNormalMap << "'" << std::endl;
-            std::cout << "[WATER]   diffuseMap='" << mat.diffuseMap << "' waterDecalMap='" << mat.waterDecalMap << "'" << std::endl;
-            std::cout << "[WATER]   specularMap='" << mat.specularMap << "' waterMaskMap='" << mat.waterMaskMap << "'" << std::endl;
-            if (mat.normalMap.empty() && !mat.waterNormalMap.empty())
-                mat.normalMap = mat.waterNormalMap;
-            if (mat.diffuseMap.empty() && !mat.waterDecalMap.empty())
-                mat.diffuseMap = mat.waterDecalMap;
-            if (mat.specularMap.empty() && !mat.waterMaskMap.empty())
-                mat.specularMap = mat.waterMaskMap;
-            // Water body (deep) color = average per-vertex color of the level
-            // water meshes that use this material. DA water .msh carry the tint in
-            // their COLOR vertex channel (model_loader fills avgVertexColor).
-            // (The old path read g_terrainLoader, which is cleared on level load,
-            //  so the body color always fell back to the brown default.)
-            // Only RGB is a real color; the COLOR.a channel holds wave/flow data
-            // (wild values like -13.5, 52.3), so we ignore it and keep water opaque.
-            int matIdx = (int)(&mat - &state.currentModel.materials[0]);
-            float rSum = 0, gSum = 0, bSum = 0;
-            int count = 0;
-            for (const auto& mesh : state.currentModel.meshes) {
-                if (mesh.materialIndex == matIdx && mesh.hasVertexColor &&
-                    std::isfinite(mesh.avgVertexColor[0]) &&
-                    std::isfinite(mesh.avgVertexColor[1]) &&
-                    std::isfinite(mesh.avgVertexColor[2])) {
-                    rSum += mesh.avgVertexColor[0];
-                    gSum += mesh.avgVertexColor[1];
-                    bSum += mesh.avgVertexColor[2];
-                    count++;
-                }
-            }
-            if (count > 0) {
-                auto cl = [](float v) { return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v); };
-                mat.waterBodyColor[0] = cl(rSum / count);
-                mat.waterBodyColor[1] = cl(gSum / count);
-                mat.waterBodyColor[2] = cl(bSum / count);
-                mat.waterBodyColor[3] = 1.0f;  // COLOR.a is not opacity
-            }
-            {
-                const char* wtmp = getenv("TEMP");
-                std::ofstream wdbg(std::string(wtmp ? wtmp : ".") + "\\haven_water_diag.txt", std::ios::app);
-                wdbg << "[WATER] mat='" << mat.name << "'  waterMeshesWithColor=" << count << "\n";
-                wdbg << "    bodyColor (RGBA, from vertex color) = "
-                     << mat.waterBodyColor[0] << ", " << mat.waterBodyColor[1] << ", "
-                     << mat.waterBodyColor[2] << ", " << mat.waterBodyColor[3] << "\n";
-                wdbg << "    waterColor PSH0 (xyz=normalBlendW, w=baseAlpha) = "
-                     << mat.waterColor[0] << ", " << mat.waterColor[1] << ", "
-                     << mat.waterColor[2] << ", " << mat.waterColor[3] << "\n";
-                wdbg << "    waterVisual PSH1 (fresnelPow, specInt, specPow, bump) = "
-                     << mat.waterVisual[0] << ", " << mat.waterVisual[1] << ", "
-                     << mat.waterVisual[2] << ", " << mat.waterVisual[3] << "\n";
-                wdbg << "    normalMap='" << mat.normalMap << "'  diffuseMap='" << mat.diffuseMap << "'\n";
-            }
-            std::cout << "[WATER]   AFTER: normalMap='" << mat.normalMap << "' diffuseMap='" << mat.diffuseMap << "'" << std::endl;
-            // Do NOT fall back to Default_BlackCubemap: a black reflection cube makes
-            // the water render black at grazing angles (where fresnel->1 and the
-            // reflection dominates). "Find any cubemap" is also unreliable. Leaving the
-            // id at 0 makes the shader use its procedural sky reflection
-            // (uHasCubemap==0), which reacts to view + sun direction and looks correct.
-            if (mat.envCubemapTexId != 0)
-                std::cout << "[WATER]   using material cubemap texId=" << mat.envCubemapTexId << std::endl;
-            else
-                std::cout << "[WATER]   procedural sky reflection (no cubemap)" << std::endl;
-        }
+        if (mat.isWater)
+            resolveLevelWaterMaterial(state.currentModel, (int)(&mat - &state.currentModel.materials[0]));
         if (!mat.diffuseMap.empty() && mat.diffuseTexId == 0)
             mat.diffuseTexId = loadTextureByName(state, mat.diffuseMap, nullptr, nullptr, nullptr);
         if (!mat.normalMap.empty() && mat.normalTexId == 0)
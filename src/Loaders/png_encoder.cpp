@@ -0,0 +1,204 @@
+#include "png_encoder.h"
+#include "parallel.h"
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+
+// Filtered data per strip. Big enough that the 32K dictionary priming and
+// per-stream setup are noise, small enough to keep a few workers busy on a
+// single 1024x1024 texture.
+static const size_t STRIP_BYTES = 1 << 20;
+static const size_t WINDOW_BYTES = 32768;
+
+static void write32be(std::vector<uint8_t>& v, uint32_t val) {
+    v.push_back((val >> 24) & 0xff); v.push_back((val >> 16) & 0xff);
+    v.push_back((val >> 8) & 0xff); v.push_back(val & 0xff);
+}
+
+static void writeChunk(std::vector<uint8_t>& png, const char* type, const uint8_t* data, size_t len) {
+    write32be(png, (uint32_t)len);
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    if (len) png.insert(png.end(), data, data + len);
+    // zlib's crc32 is the sliced table-driven one.
+    write32be(png, (uint32_t)crc32(0L, png.data() + start, (uInt)(len + 4)));
+}
+
+static inline uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    if (pb <= pc) return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+// Residual bytes read as signed; the usual libpng heuristic.
+static inline uint32_t residualCost(const uint8_t* row, size_t n) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += row[i] < 128 ? row[i] : 256 - row[i];
+    return sum;
+}
+
+// Writes the filter byte and the filtered row to out (rowBytes + 1 bytes).
+// prev is an all-zero row for the first scanline.
+static void filterRow(const uint8_t* cur, const uint8_t* prev, size_t rowBytes, bool adaptive,
+                      uint8_t* out, uint8_t* scratch) {
+    if (!adaptive) {
+        out[0] = 0;
+        memcpy(out + 1, cur, rowBytes);
+        return;
+    }
+    const size_t bpp = 4;
+    uint8_t* cand[4] = { scratch, scratch + rowBytes, scratch + rowBytes * 2, scratch + rowBytes * 3 };
+    for (size_t i = 0; i < rowBytes; i++) {
+        int a = i >= bpp ? cur[i - bpp] : 0;
+        int b = prev[i];
+        int c = i >= bpp ? prev[i - bpp] : 0;
+        cand[0][i] = (uint8_t)(cur[i] - a);
+        cand[1][i] = (uint8_t)(cur[i] - b);
+        cand[2][i] = (uint8_t)(cur[i] - ((a + b) >> 1));
+        cand[3][i] = (uint8_t)(cur[i] - paeth(a, b, c));
+    }
+    int best = 0;
+    uint32_t bestCost = residualCost(cur, rowBytes);
+    for (int f = 0; f < 4; f++) {
+        uint32_t cost = residualCost(cand[f], rowBytes);
+        if (cost < bestCost) { bestCost = cost; best = f + 1; }
+    }
+    out[0] = (uint8_t)best;
+    memcpy(out + 1, best == 0 ? cur : cand[best - 1], rowBytes);
+}
+
+static bool deflateStrip(const uint8_t* data, size_t len, const uint8_t* dict, size_t dictLen,
+                         bool last, int level, bool filtered, std::vector<uint8_t>& out) {
+    z_stream zs = {};
+    // Run-length matching on filtered rows gets most of the way to level 6 at
+    // several times the speed, so it is what the fast level means here.
+    int strategy = level == PNG_LEVEL_FAST ? Z_RLE : filtered ? Z_FILTERED : Z_DEFAULT_STRATEGY;
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+        return false;
+    if (dictLen && deflateSetDictionary(&zs, dict, (uInt)dictLen) != Z_OK) {
+        deflateEnd(&zs);
+        return false;
+    }
+    // deflateBound covers Z_FINISH; a sync flush adds at most an empty stored block.
+    out.resize(deflateBound(&zs, (uLong)len) + 16);
+    zs.next_in = const_cast<Bytef*>(data);
+    zs.avail_in = (uInt)len;
+    zs.next_out = out.data();
+    zs.avail_out = (uInt)out.size();
+    int ret = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+    bool ok = last ? ret == Z_STREAM_END : (ret == Z_OK && zs.avail_in == 0);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ok;
+}
+
+bool encodePNG(const uint8_t* rgba, size_t rgbaSize, int w, int h, std::vector<uint8_t>& png,
+               int level, bool forceOpaqueAlpha) {
+    png.clear();
+    if (!rgba || w <= 0 || h <= 0) return false;
+    const size_t rowBytes = (size_t)w * 4;
+    const size_t lineBytes = rowBytes + 1;
+    if (rgbaSize / rowBytes < (size_t)h) return false;
+    level = std::max(0, std::min(9, level));
+    const bool adaptive = level > 0;
+
+    const size_t stripRows = std::max<size_t>(1, STRIP_BYTES / lineBytes);
+    const size_t strips = ((size_t)h + stripRows - 1) / stripRows;
+    std::vector<uint8_t> filtered((size_t)h * lineBytes);
+    std::vector<std::vector<uint8_t>> compressed(strips);
+    std::vector<uLong> adlers(strips);
+
+    // Filtering only looks at source rows, so every strip can go at once; the
+    // compress pass below needs the previous strip's filtered bytes.
+    Parallel::forRange(strips, 1, [&](size_t begin, size_t end) {
+        std::vector<uint8_t> scratch(rowBytes * 4);
+        std::vector<uint8_t> rows(forceOpaqueAlpha ? rowBytes * 2 : 0);
+        std::vector<uint8_t> zero(rowBytes, 0);
+        for (size_t s = begin; s < end; s++) {
+            size_t y0 = s * stripRows, y1 = std::min((size_t)h, y0 + stripRows);
+            auto sourceRow = [&](size_t y, int slot) -> const uint8_t* {
+                const uint8_t* src = rgba + y * rowBytes;
+                if (!forceOpaqueAlpha) return src;
+                uint8_t* dst = rows.data() + slot * rowBytes;
+                memcpy(dst, src, rowBytes);
+                for (size_t i = 3; i < rowBytes; i += 4) dst[i] = 255;
+                return dst;
+            };
+            int curSlot = 0;
+            const uint8_t* prev = y0 > 0 ? sourceRow(y0 - 1, 1) : zero.data();
+            for (size_t y = y0; y < y1; y++) {
+                const uint8_t* cur = sourceRow(y, curSlot);
+                filterRow(cur, prev, rowBytes, adaptive, &filtered[y * lineBytes], scratch.data());
+                prev = cur;
+                curSlot ^= 1;
+            }
+        }
+    });
+
+    std::atomic<bool> failed{false};
+    Parallel::forRange(strips, 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++) {
+            size_t start = s * stripRows * lineBytes;
+            size_t len = std::min(filtered.size(), start + stripRows * lineBytes) - start;
+            size_t dictLen = std::min(start, WINDOW_BYTES);
+            adlers[s] = adler32(1L, &filtered[start], (uInt)len);
+            if (!deflateStrip(&filtered[start], len, &filtered[start - dictLen], dictLen,
+                              s + 1 == strips, level, adaptive, compressed[s]))
+                failed = true;
+        }
+    });
+    if (failed) return false;
+
+    uLong adler = adlers[0];
+    size_t idatSize = 6;
+    for (size_t s = 0; s < strips; s++) {
+        if (s > 0) {
+            size_t len = std::min(filtered.size(), (s + 1) * stripRows * lineBytes) - s * stripRows * lineBytes;
+            adler = adler32_combine(adler, adlers[s], (z_off_t)len);
+        }
+        idatSize += compressed[s].size();
+    }
+
+    std::vector<uint8_t> idat;
+    idat.reserve(idatSize);
+    // zlib header: 32K window, FLEVEL matching the level, FCHECK making it a multiple of 31.
+    uint8_t flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    uint8_t cmf = 0x78, flg = (uint8_t)(flevel << 6);
+    flg += (31 - ((cmf << 8) | flg) % 31) % 31;
+    idat.push_back(cmf);
+    idat.push_back(flg);
+    for (const auto& c : compressed) idat.insert(idat.end(), c.begin(), c.end());
+    write32be(idat, (uint32_t)adler);
+
+    uint8_t ihdr[13];
+    ihdr[0] = (w >> 24) & 0xff; ihdr[1] = (w >> 16) & 0xff; ihdr[2] = (w >> 8) & 0xff; ihdr[3] = w & 0xff;
+    ihdr[4] = (h >> 24) & 0xff; ihdr[5] = (h >> 16) & 0xff; ihdr[6] = (h >> 8) & 0xff; ihdr[7] = h & 0xff;
+    ihdr[8] = 8; ihdr[9] = 6; ihdr[10] = 0; ihdr[11] = 0; ihdr[12] = 0;
+
+    png.reserve(8 + 25 + idat.size() + 12 + 12);
+    png = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+    writeChunk(png, "IHDR", ihdr, sizeof(ihdr));
+    writeChunk(png, "IDAT", idat.data(), idat.size());
+    writeChunk(png, "IEND", nullptr, 0);
+    return true;
+}
+
+bool encodePNG(const std::vector<uint8_t>& rgba, int w, int h, std::vector<uint8_t>& png, int level) {
+    return encodePNG(rgba.data(), rgba.size(), w, h, png, level, false);
+}
+
+void encodePNGBatch(std::vector<PNGEncodeJob>& jobs, int level) {
+    // One image per task; strips inside an image run inline on that worker.
+    Parallel::forRange(jobs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            PNGEncodeJob& job = jobs[i];
+            if (!job.rgba) { job.png.clear(); continue; }
+            encodePNG(job.rgba->data(), job.rgba->size(), job.width, job.height, job.png,
+                      level, job.forceOpaqueAlpha);
+        }
+    });
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// zlib compression levels for the PNG writer. Level 0 stores the image data
+// uncompressed and PNG_LEVEL_FAST switches zlib to run-length matching.
+const int PNG_LEVEL_STORE = 0;
+const int PNG_LEVEL_FAST = 1;
+const int PNG_LEVEL_DEFAULT = 6;
+const int PNG_LEVEL_BEST = 9;
+
+// Encodes 8-bit RGBA as a PNG. Each scanline gets the filter that minimises
+// its sum of absolute residuals, then the image is deflated with zlib. Large
+// images are filtered and compressed in strips on the worker pool; strips are
+// primed with the previous strip's window so the output stays a single
+// ordinary zlib stream. Returns false (and leaves png empty) if rgba is
+// smaller than width * height * 4.
+bool encodePNG(const uint8_t* rgba, size_t rgbaSize, int width, int height, std::vector<uint8_t>& png,
+               int level = PNG_LEVEL_DEFAULT, bool forceOpaqueAlpha = false);
+bool encodePNG(const std::vector<uint8_t>& rgba, int width, int height, std::vector<uint8_t>& png,
+               int level = PNG_LEVEL_DEFAULT);
+
+struct PNGEncodeJob {
+    const std::vector<uint8_t>* rgba = nullptr;
+    int width = 0;
+    int height = 0;
+    bool forceOpaqueAlpha = false;
+    std::vector<uint8_t> png;
+};
+
+// Encodes independent images concurrently, one job per pool task.
+void encodePNGBatch(std::vector<PNGEncodeJob>& jobs, int level = PNG_LEVEL_DEFAULT);
@@ -169,24 +169,19 @@ void TerrainLoader::computeBounds() {
 bool TerrainLoader::loadFromERF(ERFFile& erf, const std::string& anyTmshName) {
     clear();
 
-    std::vector<std::string> tmshFiles, watFiles, tcwFiles;
+    std::vector<const ERFEntry*> tmshFiles, watFiles, tcwFiles;
     for (const auto& e : erf.entries()) {
-        std::string name = e.name;
-        std::string lower = name;
+        std::string lower = e.name;
         std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-        if (isTerrain(lower)) tmshFiles.push_back(name);
-        else if (isWaterFile(lower)) watFiles.push_back(name);
-        else if (isColwallFile(lower)) tcwFiles.push_back(name);
+        if (isTerrain(lower)) tmshFiles.push_back(&e);
+        else if (isWaterFile(lower)) watFiles.push_back(&e);
+        else if (isColwallFile(lower)) tcwFiles.push_back(&e);
     }
-    std::sort(tmshFiles.begin(), tmshFiles.end());
-    std::sort(watFiles.begin(), watFiles.end());
-
-    for (const auto& fn : tmshFiles) {
-        const ERFEntry* entry = nullptr;
-        for (const auto& e : erf.entries())
-            if (e.name == fn) { entry = &e; break; }
-        if (!entry) continue;
+    auto byName = [](const ERFEntry* a, const ERFEntry* b) { return a->name < b->name; };
+    std::sort(tmshFiles.begin(), tmshFiles.end(), byName);
+    std::sort(watFiles.begin(), watFiles.end(), byName);
 
+    for (const ERFEntry* entry : tmshFiles) {
         std::vector<uint8_t> data = erf.readEntry(*entry);
         if (data.empty()) continue;
 
@@ -195,12 +190,7 @@ bool TerrainLoader::loadFromERF(ERFFile& erf, const std::string& anyTmshName) {
             m_terrain.sectors.push_back(std::move(sector));
     }
 
-    for (const auto& fn : watFiles) {
-        const ERFEntry* entry = nullptr;
-        for (const auto& e : erf.entries())
-            if (e.name == fn) { entry = &e; break; }
-        if (!entry) continue;
-
+    for (const ERFEntry* entry : watFiles) {
         std::vector<uint8_t> data = erf.readEntry(*entry);
         if (data.empty()) continue;
 
@@ -209,12 +199,7 @@ bool TerrainLoader::loadFromERF(ERFFile& erf, const std::string& anyTmshName) {
             m_terrain.water.push_back(std::move(wm));
     }
 
-    for (const auto& fn : tcwFiles) {
-        const ERFEntry* entry = nullptr;
-        for (const auto& e : erf.entries())
-            if (e.name == fn) { entry = &e; break; }
-        if (!entry) continue;
-
+    for (const ERFEntry* entry : tcwFiles) {
         std::vector<uint8_t> data = erf.readEntry(*entry);
         if (data.empty()) continue;
 
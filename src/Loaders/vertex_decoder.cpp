@@ -0,0 +1,319 @@
+#include "vertex_decoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_DECODER_SSE2 1
+#include <emmintrin.h>
+#endif
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+    if (stride != other.stride || bigEndian != other.bigEndian) return false;
+    for (int i = 0; i < SlotCount; i++) {
+        if (present[i] != other.present[i]) return false;
+        if (!present[i]) continue;
+        if (streams[i].offset != other.streams[i].offset || streams[i].dataType != other.streams[i].dataType)
+            return false;
+    }
+    return true;
+}
+
+static uint32_t declTypeSize(uint32_t dataType) {
+    switch (dataType) {
+        case VertexDeclType::FLOAT1: return 4;
+        case VertexDeclType::FLOAT2: return 8;
+        case VertexDeclType::FLOAT3: return 12;
+        case VertexDeclType::FLOAT4: return 16;
+        case VertexDeclType::COLOR:
+        case VertexDeclType::UBYTE4:
+        case VertexDeclType::UBYTE4N:
+        case VertexDeclType::SHORT2:
+        case VertexDeclType::SHORT2N:
+        case VertexDeclType::USHORT2N:
+        case VertexDeclType::FLOAT16_2: return 4;
+        case VertexDeclType::SHORT4:
+        case VertexDeclType::SHORT4N:
+        case VertexDeclType::USHORT4N:
+        case VertexDeclType::FLOAT16_4: return 8;
+        default: return 0;
+    }
+}
+
+static bool isByteDeclType(uint32_t dataType) {
+    return dataType == VertexDeclType::COLOR || dataType == VertexDeclType::UBYTE4 ||
+           dataType == VertexDeclType::UBYTE4N;
+}
+
+using DecodeFn = void (*)(const uint8_t* src, uint32_t stride, uint32_t count, float* out);
+
+static void decodeZero(const uint8_t*, uint32_t, uint32_t count, float* out) {
+    std::memset(out, 0, sizeof(float) * 4 * count);
+}
+
+#ifdef VERTEX_DECODER_SSE2
+
+static inline __m128i load32(const uint8_t* p) {
+    int32_t v;
+    std::memcpy(&v, p, 4);
+    return _mm_cvtsi32_si128(v);
+}
+
+static inline __m128i load64(const uint8_t* p) {
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+}
+
+static inline __m128i bswap16x8(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static inline __m128i bswap32x4(__m128i v) {
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return bswap16x8(v);
+}
+
+// Four halves (low 64 bits) to floats. Rebiasing by a multiply handles
+// denormals exactly; Inf/NaN get their exponent forced and keep the
+// mantissa, matching halfToFloat bit for bit.
+static inline __m128 halfToFloat4(__m128i h) {
+    const __m128i noSign = _mm_set1_epi32(0x7FFF);
+    const __m128 rebias = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    const __m128i maxFinite = _mm_set1_epi32(0x7BFF);
+    const __m128i infNanExp = _mm_set1_epi32(255 << 23);
+
+    __m128i h32 = _mm_unpacklo_epi16(h, _mm_setzero_si128());
+    __m128i expMant = _mm_and_si128(h32, noSign);
+    __m128i sign = _mm_slli_epi32(_mm_xor_si128(h32, expMant), 16);
+    __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)), rebias);
+    __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(expMant, maxFinite), infNanExp);
+    return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNan)));
+}
+
+static inline __m128i signExtend16(__m128i v) {
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline __m128i zeroExtend16(__m128i v) {
+    return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+}
+
+// One element as four floats; lanes past the element's components are 0.
+template<uint32_t Type, bool BigEndian>
+static inline __m128 loadElement(const uint8_t* p) {
+    using namespace VertexDeclType;
+    if constexpr (Type == FLOAT1 || Type == FLOAT2 || Type == FLOAT3 || Type == FLOAT4) {
+        __m128i v;
+        if constexpr (Type == FLOAT1) v = load32(p);
+        else if constexpr (Type == FLOAT2) v = load64(p);
+        else if constexpr (Type == FLOAT3) v = _mm_unpacklo_epi64(load64(p), load32(p + 8));
+        else v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if constexpr (BigEndian) v = bswap32x4(v);
+        return _mm_castsi128_ps(v);
+    } else if constexpr (Type == COLOR || Type == UBYTE4 || Type == UBYTE4N) {
+        __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_unpacklo_epi16(_mm_unpacklo_epi8(load32(p), zero), zero);
+        return _mm_div_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(255.0f));
+    } else {
+        constexpr bool four = Type == SHORT4 || Type == SHORT4N || Type == USHORT4N || Type == FLOAT16_4;
+        __m128i v = four ? load64(p) : load32(p);
+        if constexpr (BigEndian) v = bswap16x8(v);
+        if constexpr (Type == FLOAT16_2 || Type == FLOAT16_4) return halfToFloat4(v);
+        if constexpr (Type == SHORT2 || Type == SHORT4) return _mm_cvtepi32_ps(signExtend16(v));
+        if constexpr (Type == SHORT2N || Type == SHORT4N)
+            return _mm_div_ps(_mm_cvtepi32_ps(signExtend16(v)), _mm_set1_ps(32767.0f));
+        return _mm_div_ps(_mm_cvtepi32_ps(zeroExtend16(v)), _mm_set1_ps(65535.0f));
+    }
+}
+
+template<uint32_t Type, bool BigEndian>
+static void decodeElements(const uint8_t* src, uint32_t stride, uint32_t count, float* out) {
+    for (uint32_t i = 0; i < count; i++, src += stride, out += 4)
+        _mm_storeu_ps(out, loadElement<Type, BigEndian>(src));
+}
+
+template<bool BigEndian>
+static DecodeFn elementFnFor(uint32_t dataType) {
+    using namespace VertexDeclType;
+    switch (dataType) {
+        case FLOAT1: return decodeElements<FLOAT1, BigEndian>;
+        case FLOAT2: return decodeElements<FLOAT2, BigEndian>;
+        case FLOAT3: return decodeElements<FLOAT3, BigEndian>;
+        case FLOAT4: return decodeElements<FLOAT4, BigEndian>;
+        case COLOR:
+        case UBYTE4:
+        case UBYTE4N: return decodeElements<UBYTE4N, BigEndian>;
+        case SHORT2: return decodeElements<SHORT2, BigEndian>;
+        case SHORT4: return decodeElements<SHORT4, BigEndian>;
+        case SHORT2N: return decodeElements<SHORT2N, BigEndian>;
+        case SHORT4N: return decodeElements<SHORT4N, BigEndian>;
+        case USHORT2N: return decodeElements<USHORT2N, BigEndian>;
+        case USHORT4N: return decodeElements<USHORT4N, BigEndian>;
+        case FLOAT16_2: return decodeElements<FLOAT16_2, BigEndian>;
+        case FLOAT16_4: return decodeElements<FLOAT16_4, BigEndian>;
+        default: return decodeZero;
+    }
+}
+
+#endif
+
+VertexDecoder::VertexDecoder(const VertexLayout& layout) : m_layout(layout) {
+    for (int slot = 0; slot < VertexLayout::SlotCount; slot++) {
+        if (!layout.present[slot]) continue;
+        uint32_t dataType = layout.streams[slot].dataType;
+        Element& el = m_elements[slot];
+        el.size = declTypeSize(dataType);
+        if (el.size == 0) {
+            el.fn = decodeZero;
+            continue;
+        }
+#ifdef VERTEX_DECODER_SSE2
+        el.fn = layout.bigEndian ? elementFnFor<true>(dataType) : elementFnFor<false>(dataType);
+#endif
+    }
+}
+
+void VertexDecoder::decode(GFFBytes data, uint64_t offset, uint32_t count,
+                           Vertex* out, double colorSum[4]) const {
+    const uint32_t kBatch = 256;
+    float tmp[kBatch * 4];
+    const uint32_t stride = m_layout.stride;
+    const uint64_t size = data.size();
+
+    // Vertices [0, safe[slot]) have the whole element inside the buffer and
+    // take the batch routine; the rest go through readDeclType.
+    uint32_t safe[VertexLayout::SlotCount] = {};
+    for (int slot = 0; slot < VertexLayout::SlotCount; slot++) {
+        const Element& el = m_elements[slot];
+        if (!m_layout.present[slot] || !el.fn) continue;
+        uint64_t first = offset + m_layout.streams[slot].offset;
+        if (first + el.size > size) continue;
+        uint64_t n = stride ? (size - first - el.size) / stride + 1 : count;
+        safe[slot] = static_cast<uint32_t>(std::min<uint64_t>(n, count));
+    }
+
+    auto fill = [&](int slot, uint32_t first, uint32_t n) {
+        const VertexStreamDesc& desc = m_layout.streams[slot];
+        uint64_t pos = offset + static_cast<uint64_t>(first) * stride + desc.offset;
+        uint32_t fast = first < safe[slot] ? std::min(n, safe[slot] - first) : 0;
+        if (fast) m_elements[slot].fn(data.data() + pos, stride, fast, tmp);
+        for (uint32_t i = fast; i < n; i++) {
+            uint32_t at = static_cast<uint32_t>(pos + static_cast<uint64_t>(i) * stride);
+            readDeclType(data, at, desc.dataType, tmp + i * 4, m_layout.bigEndian);
+        }
+    };
+
+    for (uint32_t first = 0; first < count; first += kBatch) {
+        uint32_t n = std::min(kBatch, count - first);
+        Vertex* v = out + first;
+
+        if (m_layout.present[VertexLayout::Position]) {
+            fill(VertexLayout::Position, first, n);
+            for (uint32_t i = 0; i < n; i++) {
+                v[i].x = tmp[i * 4];
+                v[i].y = tmp[i * 4 + 1];
+                v[i].z = tmp[i * 4 + 2];
+            }
+        } else {
+            for (uint32_t i = 0; i < n; i++) v[i].x = v[i].y = v[i].z = 0.0f;
+        }
+
+        if (m_layout.present[VertexLayout::Normal]) {
+            fill(VertexLayout::Normal, first, n);
+            for (uint32_t i = 0; i < n; i++) {
+                v[i].nx = tmp[i * 4];
+                v[i].ny = tmp[i * 4 + 1];
+                v[i].nz = tmp[i * 4 + 2];
+            }
+        } else {
+            for (uint32_t i = 0; i < n; i++) {
+                v[i].nx = 0.0f;
+                v[i].ny = 1.0f;
+                v[i].nz = 0.0f;
+            }
+        }
+
+        if (m_layout.present[VertexLayout::Texcoord]) {
+            fill(VertexLayout::Texcoord, first, n);
+            for (uint32_t i = 0; i < n; i++) {
+                v[i].u = tmp[i * 4];
+                v[i].v = 1.0f - tmp[i * 4 + 1];
+            }
+        } else {
+            for (uint32_t i = 0; i < n; i++) v[i].u = v[i].v = 0.0f;
+        }
+
+        if (m_layout.present[VertexLayout::BlendWeight]) {
+            fill(VertexLayout::BlendWeight, first, n);
+            for (uint32_t i = 0; i < n; i++)
+                std::memcpy(v[i].boneWeights, tmp + i * 4, sizeof(float) * 4);
+        }
+
+        if (m_layout.present[VertexLayout::BlendIndex]) {
+            const VertexStreamDesc& desc = m_layout.streams[VertexLayout::BlendIndex];
+            if (isByteDeclType(desc.dataType)) {
+                // Byte indices are used as-is, not normalized.
+                uint64_t pos = offset + static_cast<uint64_t>(first) * stride + desc.offset;
+                for (uint32_t i = 0; i < n; i++, pos += stride) {
+                    if (pos + 4 <= size) {
+                        const uint8_t* b = data.data() + pos;
+                        for (int k = 0; k < 4; k++) v[i].boneIndices[k] = b[k];
+                    } else {
+                        for (int k = 0; k < 4; k++) v[i].boneIndices[k] = pos + k < size ? data[pos + k] : 0;
+                    }
+                }
+            } else {
+                fill(VertexLayout::BlendIndex, first, n);
+                for (uint32_t i = 0; i < n; i++)
+                    for (int k = 0; k < 4; k++)
+                        v[i].boneIndices[k] = static_cast<int>(std::round(tmp[i * 4 + k]));
+            }
+        }
+
+        if (m_layout.present[VertexLayout::Color] && colorSum) {
+            fill(VertexLayout::Color, first, n);
+            for (uint32_t i = 0; i < n; i++)
+                for (int k = 0; k < 4; k++) colorSum[k] += tmp[i * 4 + k];
+        }
+    }
+}
+
+void decodeIndices(GFFBytes data, uint64_t offset, uint32_t count,
+                   bool index32, bool bigEndian, uint32_t* out) {
+    const uint32_t width = index32 ? 4 : 2;
+    uint64_t avail = offset < data.size() ? (data.size() - offset) / width : 0;
+    uint32_t n = static_cast<uint32_t>(std::min<uint64_t>(avail, count));
+    const uint8_t* src = n ? data.data() + offset : nullptr;
+    uint32_t i = 0;
+
+    if (index32) {
+        if (n) std::memcpy(out, src, static_cast<size_t>(n) * 4);
+        if (bigEndian) {
+#ifdef VERTEX_DECODER_SSE2
+            for (; i + 4 <= n; i += 4) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), bswap32x4(v));
+            }
+#endif
+            for (; i < n; i++) out[i] = GFFFile::bswap(out[i]);
+        }
+    } else {
+#ifdef VERTEX_DECODER_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+            if (bigEndian) v = bswap16x8(v);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi16(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(v, zero));
+        }
+#endif
+        for (; i < n; i++) {
+            uint16_t idx;
+            std::memcpy(&idx, src + i * 2, 2);
+            if (bigEndian) idx = GFFFile::bswap(idx);
+            out[i] = idx;
+        }
+    }
+
+    for (uint32_t j = n; j < count; j++) out[j] = 0;
+}
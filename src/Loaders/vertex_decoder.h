@@ -0,0 +1,53 @@
+#pragma once
+#include "Mesh.h"
+#include "model_loader.h"
+#include <vector>
+#include <cstdint>
+
+// The attributes loadMSH pulls out of a vertex declaration, plus the stride
+// and byte order of the buffer they live in.
+struct VertexLayout {
+    enum Slot { Position, Normal, Texcoord, BlendWeight, BlendIndex, Color, SlotCount };
+
+    uint32_t stride = 0;
+    bool bigEndian = false;
+    VertexStreamDesc streams[SlotCount] = {};
+    bool present[SlotCount] = {};
+
+    bool operator==(const VertexLayout& other) const;
+    bool operator!=(const VertexLayout& other) const { return !(*this == other); }
+};
+
+// A vertex declaration compiled into one specialized batch routine per
+// element (data type x byte order), so the per-vertex loop does no type
+// switching and converts whole elements at once with SSE2. Vertices whose
+// element runs past the end of the buffer fall back to readDeclType, which
+// zero-fills out-of-range components exactly as before.
+class VertexDecoder {
+public:
+    VertexDecoder() = default;
+    explicit VertexDecoder(const VertexLayout& layout);
+
+    const VertexLayout& layout() const { return m_layout; }
+
+    // Decodes count vertices starting at data[offset] into out. Missing
+    // attributes get loadMSH's defaults (normal +Y, zero UVs). The COLOR
+    // channel isn't stored per vertex; it is summed into colorSum instead.
+    void decode(GFFBytes data, uint64_t offset, uint32_t count,
+                Vertex* out, double colorSum[4]) const;
+
+private:
+    using ElementFn = void (*)(const uint8_t* src, uint32_t stride, uint32_t count, float* out);
+
+    struct Element {
+        ElementFn fn = nullptr;
+        uint32_t size = 0;
+    };
+
+    VertexLayout m_layout;
+    Element m_elements[VertexLayout::SlotCount];
+};
+
+// Bulk 16/32-bit index decode. Indices past the end of the buffer read as 0.
+void decodeIndices(GFFBytes data, uint64_t offset, uint32_t count,
+                   bool index32, bool bigEndian, uint32_t* out);
@@ -3,6 +3,7 @@
 #include "erf.h"
 #include <algorithm>
 #include <set>
+#include <unordered_map>
 #include <cmath>
 void decompressQuat(uint32_t quat32, uint32_t quat64, uint16_t quat48, int quality,
                     float& outX, float& outY, float& outZ, float& outW) {
@@ -57,7 +58,7 @@ Animation loadANI(const std::vector<uint8_t>& data, const std::string& filename)
     anim.filename = filename;
     if (data.size() < 16) return anim;
     GFFFile gff;
-    if (!gff.load(data)) {
+    if (!gff.loadBorrowed(data)) {
         return anim;
     }
     anim.name = gff.readStringByLabel(0, 4007, 0);
@@ -70,21 +71,26 @@ Animation loadANI(const std::vector<uint8_t>& data, const std::string& filename)
     if (anim.duration <= 0) anim.duration = 1.0f;
     std::vector<GFFStructRef> nodeList = gff.readStructList(0, 4005, 0);
     int tracksWithKeyframes = 0;
+    // Keyframe structs share a handful of types; resolve their fields once per type.
+    uint32_t kfType = UINT32_MAX;
+    const GFFField* timeField = nullptr;
+    const GFFField* d0 = nullptr;
+    const GFFField* d1 = nullptr;
+    const GFFField* d2 = nullptr;
     for (const auto& nodeRef : nodeList) {
         AnimTrack track;
-        std::string fullName = gff.readStringByLabel(nodeRef.structIndex, 4000, nodeRef.offset);
-        track.boneName = fullName;
-        if (!track.boneName.empty()) {
+        std::string_view fullName = gff.readStringViewByLabel(nodeRef.structIndex, 4000, nodeRef.offset);
+        if (!fullName.empty()) {
             // PC path: name is a string like "root_rotation" or "root_translation"
-            if (track.boneName.find("_rotation") != std::string::npos) {
+            size_t suffix;
+            if ((suffix = fullName.find("_rotation")) != std::string_view::npos) {
                 track.isRotation = true;
-                track.boneName = track.boneName.substr(0, track.boneName.find("_rotation"));
-            } else if (track.boneName.find("_translation") != std::string::npos) {
+            } else if ((suffix = fullName.find("_translation")) != std::string_view::npos) {
                 track.isTranslation = true;
-                track.boneName = track.boneName.substr(0, track.boneName.find("_translation"));
             } else {
                 continue;
             }
+            track.boneName = std::string(fullName.substr(0, suffix));
         } else {
             // X360 path: label 4000 is uint32 hash, not ECString
             const GFFField* nameField = gff.findField(nodeRef.structIndex, 4000);
@@ -152,14 +158,17 @@ Animation loadANI(const std::vector<uint8_t>& data, const std::string& filename)
         std::vector<GFFStructRef> keyframes = gff.readStructList(data1.structIndex, 4004, data1.offset);
         for (const auto& kfRef : keyframes) {
             AnimKeyframe kf;
-            const GFFField* timeField = gff.findField(kfRef.structIndex, 4035);
+            if (kfRef.structIndex != kfType) {
+                kfType = kfRef.structIndex;
+                timeField = gff.resolveField(kfType, 4035).field;
+                d0 = gff.resolveField(kfType, 4036).field;
+                d1 = gff.resolveField(kfType, 4037).field;
+                d2 = gff.resolveField(kfType, 4038).field;
+            }
             if (timeField) {
                 uint16_t timeVal = gff.readUInt16At(gff.dataOffset() + timeField->dataOffset + kfRef.offset);
                 kf.time = (float)timeVal / 65535.0f * anim.duration;
             }
-            const GFFField* d0 = gff.findField(kfRef.structIndex, 4036);
-            const GFFField* d1 = gff.findField(kfRef.structIndex, 4037);
-            const GFFField* d2 = gff.findField(kfRef.structIndex, 4038);
             if (track.isRotation && d0) {
                 uint32_t off = gff.dataOffset() + d0->dataOffset + kfRef.offset;
                 if (target == 2) {
@@ -227,9 +236,9 @@ void findAnimationsForModel(AppState& state, const std::string& modelBaseName) {
         }
 
         for (const auto& erfPath : state.erfFiles) {
-            ERFFile erf;
-            if (erf.open(erfPath)) {
-                for (const auto& entry : erf.entries()) {
+            auto erf = openSharedERF(erfPath);
+            if (erf) {
+                for (const auto& entry : erf->entries()) {
                     if (isAnimFile(entry.name)) {
                         std::string entryLower = entry.name;
                         std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
@@ -256,9 +265,9 @@ void findAnimationsForModel(AppState& state, const std::string& modelBaseName) {
         }
 
         for (const auto& erfPath : state.erfFiles) {
-            ERFFile erf;
-            if (erf.open(erfPath)) {
-                for (const auto& entry : erf.entries()) {
+            auto erf = openSharedERF(erfPath);
+            if (erf) {
+                for (const auto& entry : erf->entries()) {
                     if (isAnimFile(entry.name)) {
                         std::string entryLower = entry.name;
                         std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
@@ -290,70 +299,205 @@ void dumpAllAnimFileNames(const AppState& state) {
     for (const auto& name : allAnis) {
     }
 }
-void applyAnimation(Model& model, const Animation& anim, float time, const std::vector<Bone>& basePose) {
-    if (anim.tracks.empty()) return;
-    if (basePose.empty() || basePose.size() != model.skeleton.bones.size()) return;
+static void quatRotate(float qx, float qy, float qz, float qw,
+                       float vx, float vy, float vz,
+                       float& ox, float& oy, float& oz) {
+    float tx = 2.0f * (qy * vz - qz * vy);
+    float ty = 2.0f * (qz * vx - qx * vz);
+    float tz = 2.0f * (qx * vy - qy * vx);
+    ox = vx + qw * tx + (qy * tz - qz * ty);
+    oy = vy + qw * ty + (qz * tx - qx * tz);
+    oz = vz + qw * tz + (qx * ty - qy * tx);
+}
+
+static void quatMul(float q1x, float q1y, float q1z, float q1w,
+                    float q2x, float q2y, float q2z, float q2w,
+                    float& rx, float& ry, float& rz, float& rw) {
+    rw = q1w*q2w - q1x*q2x - q1y*q2y - q1z*q2z;
+    rx = q1w*q2x + q1x*q2w + q1y*q2z - q1z*q2y;
+    ry = q1w*q2y - q1x*q2z + q1y*q2w + q1z*q2x;
+    rz = q1w*q2z + q1x*q2y - q1y*q2x + q1z*q2w;
+}
 
-    static std::string lastModelName;
-    std::string modelName = model.skeleton.bones.empty() ? "" : model.skeleton.bones[0].name;
-    if (modelName != lastModelName) {
-        lastModelName = modelName;
-        for (size_t i = 0; i < model.skeleton.bones.size() && i < 10; i++) {
-            const auto& b = model.skeleton.bones[i];
+// Parents before children. Bones that never become reachable from a root
+// (parent cycles, bad parent indices) go last in index order.
+static std::vector<int> boneEvaluationOrder(const std::vector<Bone>& bones) {
+    const int count = (int)bones.size();
+    std::vector<int> firstChild(count, -1), nextSibling(count, -1);
+    for (int i = count - 1; i >= 0; i--) {
+        int parent = bones[i].parentIndex;
+        if (parent >= 0 && parent < count) {
+            nextSibling[i] = firstChild[parent];
+            firstChild[parent] = i;
         }
     }
 
-    for (size_t i = 0; i < model.skeleton.bones.size(); i++) {
-        model.skeleton.bones[i].posX = basePose[i].posX;
-        model.skeleton.bones[i].posY = basePose[i].posY;
-        model.skeleton.bones[i].posZ = basePose[i].posZ;
-        model.skeleton.bones[i].rotX = basePose[i].rotX;
-        model.skeleton.bones[i].rotY = basePose[i].rotY;
-        model.skeleton.bones[i].rotZ = basePose[i].rotZ;
-        model.skeleton.bones[i].rotW = basePose[i].rotW;
+    std::vector<int> order;
+    order.reserve(count);
+    std::vector<bool> placed(count, false);
+    for (int i = 0; i < count; i++) {
+        if (bones[i].parentIndex >= 0) continue;
+        order.push_back(i);
+        placed[i] = true;
     }
+    for (size_t head = 0; head < order.size(); head++) {
+        for (int c = firstChild[order[head]]; c >= 0; c = nextSibling[c]) {
+            order.push_back(c);
+            placed[c] = true;
+        }
+    }
+    for (int i = 0; i < count; i++)
+        if (!placed[i]) order.push_back(i);
+    return order;
+}
 
-    auto quatRotate = [](float qx, float qy, float qz, float qw,
-                         float vx, float vy, float vz,
-                         float& ox, float& oy, float& oz) {
-        float tx = 2.0f * (qy * vz - qz * vy);
-        float ty = 2.0f * (qz * vx - qx * vz);
-        float tz = 2.0f * (qx * vy - qy * vx);
-        ox = vx + qw * tx + (qy * tz - qz * ty);
-        oy = vy + qw * ty + (qz * tx - qx * tz);
-        oz = vz + qw * tz + (qx * ty - qy * tx);
-    };
+static void evaluateWorldTransforms(std::vector<Bone>& bones, const std::vector<int>& order) {
+    for (int idx : order) {
+        Bone& bone = bones[idx];
+        if (bone.parentIndex < 0 || bone.parentIndex >= (int)bones.size()) {
+            bone.worldPosX = bone.posX;
+            bone.worldPosY = bone.posY;
+            bone.worldPosZ = bone.posZ;
+            bone.worldRotX = bone.rotX;
+            bone.worldRotY = bone.rotY;
+            bone.worldRotZ = bone.rotZ;
+            bone.worldRotW = bone.rotW;
+        } else {
+            const Bone& parent = bones[bone.parentIndex];
+            float rx, ry, rz;
+            quatRotate(parent.worldRotX, parent.worldRotY, parent.worldRotZ, parent.worldRotW,
+                       bone.posX, bone.posY, bone.posZ, rx, ry, rz);
+            bone.worldPosX = parent.worldPosX + rx;
+            bone.worldPosY = parent.worldPosY + ry;
+            bone.worldPosZ = parent.worldPosZ + rz;
+            quatMul(parent.worldRotX, parent.worldRotY, parent.worldRotZ, parent.worldRotW,
+                    bone.rotX, bone.rotY, bone.rotZ, bone.rotW,
+                    bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW);
+        }
+    }
+}
 
-    auto quatMul = [](float q1x, float q1y, float q1z, float q1w,
-                      float q2x, float q2y, float q2z, float q2w,
-                      float& rx, float& ry, float& rz, float& rw) {
-        rw = q1w*q2w - q1x*q2x - q1y*q2y - q1z*q2z;
-        rx = q1w*q2x + q1x*q2w + q1y*q2z - q1z*q2y;
-        ry = q1w*q2y - q1x*q2z + q1y*q2w + q1z*q2x;
-        rz = q1w*q2z + q1x*q2y - q1y*q2x + q1z*q2w;
+int resolveAnimTracks(Animation& anim, const Skeleton& skeleton) {
+    auto normalize = [](const std::string& s) {
+        std::string result;
+        for (char c : s) {
+            if (c != '_') result += std::tolower(c);
+        }
+        return result;
     };
+    std::unordered_map<std::string, int> exact, folded;
+    for (int i = (int)skeleton.bones.size() - 1; i >= 0; i--) {
+        exact[skeleton.bones[i].name] = i;
+        folded[normalize(skeleton.bones[i].name)] = i;
+    }
+    int matched = 0;
+    for (auto& track : anim.tracks) {
+        auto it = exact.find(track.boneName);
+        if (it != exact.end()) {
+            track.boneIndex = it->second;
+        } else {
+            auto ft = folded.find(normalize(track.boneName));
+            track.boneIndex = ft != folded.end() ? ft->second : -1;
+        }
+        if (track.boneIndex >= 0) matched++;
+    }
+    return matched;
+}
 
+static uint64_t bindingSignature(const Animation& anim, const Skeleton& skeleton) {
+    uint64_t h = 14695981039346656037ull;
+    auto mix = [&h](uint64_t v) { h = (h ^ v) * 1099511628211ull; };
+    mix((uint64_t)(uintptr_t)anim.tracks.data());
+    mix(anim.tracks.size());
     for (const auto& track : anim.tracks) {
-        if (track.boneIndex < 0 || track.boneIndex >= (int)model.skeleton.bones.size()) continue;
+        mix((uint64_t)(uintptr_t)track.keyframes.data());
+        mix(track.keyframes.size());
+        mix((uint64_t)(int64_t)track.boneIndex);
+        mix((track.isRotation ? 1 : 0) | (track.isTranslation ? 2 : 0));
+    }
+    mix((uint64_t)(uintptr_t)skeleton.bones.data());
+    mix(skeleton.bones.size());
+    for (const auto& bone : skeleton.bones)
+        mix((uint64_t)(int64_t)bone.parentIndex);
+    return h;
+}
+
+void PreparedAnimation::bind(const Animation& anim, const Skeleton& skeleton) {
+    m_anim = &anim;
+    m_signature = bindingSignature(anim, skeleton);
+    m_channels.clear();
+    m_channels.reserve(anim.tracks.size());
+    for (const auto& track : anim.tracks) {
+        if (track.boneIndex < 0 || track.boneIndex >= (int)skeleton.bones.size()) continue;
         if (track.keyframes.empty()) continue;
+        if (!track.isRotation && !track.isTranslation) continue;
+        if (!track.isRotation) {
+            // The god/gob root-motion bones keep their bind position.
+            std::string boneNameLower = skeleton.bones[track.boneIndex].name;
+            std::transform(boneNameLower.begin(), boneNameLower.end(), boneNameLower.begin(), ::tolower);
+            if (boneNameLower == "god" || boneNameLower == "gob") continue;
+        }
+        m_channels.push_back({&track, track.boneIndex, track.isRotation, 0});
+    }
+    m_order = boneEvaluationOrder(skeleton.bones);
+}
+
+bool PreparedAnimation::isBoundTo(const Animation& anim, const Skeleton& skeleton) const {
+    return m_anim == &anim && m_signature == bindingSignature(anim, skeleton);
+}
+
+// First keyframe at or after time, searched from the previous sample.
+// Playback moves the cursor a step or two per frame; longer jumps and
+// scrubbing backwards binary-search.
+static size_t seekKeyframe(const std::vector<AnimKeyframe>& keyframes, size_t cursor, float time) {
+    auto before = [](const AnimKeyframe& kf, float t) { return kf.time < t; };
+    size_t count = keyframes.size();
+    if (cursor > count) cursor = 0;
+    if (cursor > 0 && keyframes[cursor - 1].time >= time)
+        return std::lower_bound(keyframes.begin(), keyframes.begin() + cursor, time, before) - keyframes.begin();
+    for (int step = 0; cursor < count && keyframes[cursor].time < time; cursor++) {
+        if (++step == 8)
+            return std::lower_bound(keyframes.begin() + cursor, keyframes.end(), time, before) - keyframes.begin();
+    }
+    return cursor;
+}
+
+void PreparedAnimation::apply(Skeleton& skeleton, float time, const std::vector<Bone>& basePose) {
+    auto& bones = skeleton.bones;
+    for (size_t i = 0; i < bones.size(); i++) {
+        bones[i].posX = basePose[i].posX;
+        bones[i].posY = basePose[i].posY;
+        bones[i].posZ = basePose[i].posZ;
+        bones[i].rotX = basePose[i].rotX;
+        bones[i].rotY = basePose[i].rotY;
+        bones[i].rotZ = basePose[i].rotZ;
+        bones[i].rotW = basePose[i].rotW;
+    }
+
+    for (auto& channel : m_channels) {
+        const auto& keyframes = channel.track->keyframes;
+        channel.cursor = seekKeyframe(keyframes, channel.cursor, time);
 
-        size_t k0 = 0, k1 = 0;
-        for (size_t i = 0; i < track.keyframes.size(); i++) {
-            if (track.keyframes[i].time <= time) k0 = i;
-            if (track.keyframes[i].time >= time) { k1 = i; break; }
-            k1 = i;
+        size_t k0, k1;
+        if (channel.cursor == keyframes.size()) {
+            k0 = k1 = keyframes.size() - 1;
+        } else if (channel.cursor == 0 || keyframes[channel.cursor].time == time) {
+            k0 = k1 = channel.cursor;
+        } else {
+            k0 = channel.cursor - 1;
+            k1 = channel.cursor;
         }
 
         float t = 0.0f;
-        if (k0 != k1 && track.keyframes[k1].time != track.keyframes[k0].time) {
-            t = (time - track.keyframes[k0].time) / (track.keyframes[k1].time - track.keyframes[k0].time);
+        if (k0 != k1 && keyframes[k1].time != keyframes[k0].time) {
+            t = (time - keyframes[k0].time) / (keyframes[k1].time - keyframes[k0].time);
         }
 
-        const AnimKeyframe& kf0 = track.keyframes[k0];
-        const AnimKeyframe& kf1 = track.keyframes[k1];
-        Bone& bone = model.skeleton.bones[track.boneIndex];
+        const AnimKeyframe& kf0 = keyframes[k0];
+        const AnimKeyframe& kf1 = keyframes[k1];
+        Bone& bone = bones[channel.bone];
 
-        if (track.isRotation) {
+        if (channel.rotation) {
             float dot = kf0.x*kf1.x + kf0.y*kf1.y + kf0.z*kf1.z + kf0.w*kf1.w;
             float sign = (dot < 0) ? -1.0f : 1.0f;
             float rx = kf0.x * (1-t) + kf1.x * sign * t;
@@ -366,134 +510,30 @@ void applyAnimation(Model& model, const Animation& anim, float time, const std::
             bone.rotY = ry;
             bone.rotZ = rz;
             bone.rotW = rw;
-        }
-        else if (track.isTranslation) {
-            std::string boneName = model.skeleton.bones[track.boneIndex].name;
-            std::string boneNameLower = boneName;
-            std::transform(boneNameLower.begin(), boneNameLower.end(), boneNameLower.begin(), ::tolower);
-            if (boneNameLower == "god" || boneNameLower == "gob") {
-                continue;
-            }
+        } else {
             float tx = kf0.x * (1-t) + kf1.x * t;
             float ty = kf0.y * (1-t) + kf1.y * t;
             float tz = kf0.z * (1-t) + kf1.z * t;
 
-            const Bone& base = basePose[track.boneIndex];
+            const Bone& base = basePose[channel.bone];
             bone.posX = base.posX + tx;
             bone.posY = base.posY + ty;
             bone.posZ = base.posZ + tz;
         }
     }
 
-    std::vector<int> processingOrder;
-    std::vector<bool> processed(model.skeleton.bones.size(), false);
-    while (processingOrder.size() < model.skeleton.bones.size()) {
-        bool addedAny = false;
-        for (size_t i = 0; i < model.skeleton.bones.size(); i++) {
-            if (processed[i]) continue;
-            const Bone& bone = model.skeleton.bones[i];
-            if (bone.parentIndex < 0 || processed[bone.parentIndex]) {
-                processingOrder.push_back((int)i);
-                processed[i] = true;
-                addedAny = true;
-            }
-        }
-        if (!addedAny) {
-            for (size_t i = 0; i < model.skeleton.bones.size(); i++) {
-                if (!processed[i]) {
-                    processingOrder.push_back((int)i);
-                    processed[i] = true;
-                }
-            }
-            break;
-        }
-    }
+    evaluateWorldTransforms(bones, m_order);
+}
 
-    for (int boneIdx : processingOrder) {
-        Bone& bone = model.skeleton.bones[boneIdx];
-        if (bone.parentIndex < 0) {
-            bone.worldPosX = bone.posX;
-            bone.worldPosY = bone.posY;
-            bone.worldPosZ = bone.posZ;
-            bone.worldRotX = bone.rotX;
-            bone.worldRotY = bone.rotY;
-            bone.worldRotZ = bone.rotZ;
-            bone.worldRotW = bone.rotW;
-        } else {
-            const Bone& parent = model.skeleton.bones[bone.parentIndex];
-            float rotatedX, rotatedY, rotatedZ;
-            quatRotate(parent.worldRotX, parent.worldRotY, parent.worldRotZ, parent.worldRotW,
-                       bone.posX, bone.posY, bone.posZ,
-                       rotatedX, rotatedY, rotatedZ);
-            bone.worldPosX = parent.worldPosX + rotatedX;
-            bone.worldPosY = parent.worldPosY + rotatedY;
-            bone.worldPosZ = parent.worldPosZ + rotatedZ;
-            quatMul(parent.worldRotX, parent.worldRotY, parent.worldRotZ, parent.worldRotW,
-                    bone.rotX, bone.rotY, bone.rotZ, bone.rotW,
-                    bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW);
-        }
-    }
+void applyAnimation(Model& model, const Animation& anim, float time, const std::vector<Bone>& basePose) {
+    static PreparedAnimation s_playback;
+    if (anim.tracks.empty()) return;
+    if (basePose.empty() || basePose.size() != model.skeleton.bones.size()) return;
+
+    if (!s_playback.isBoundTo(anim, model.skeleton)) s_playback.bind(anim, model.skeleton);
+    s_playback.apply(model.skeleton, time, basePose);
 }
 
 void computeBoneWorldTransforms(Model& model) {
-    auto quatRotate = [](float qx, float qy, float qz, float qw,
-                         float vx, float vy, float vz,
-                         float& ox, float& oy, float& oz) {
-        float tx = 2.0f * (qy * vz - qz * vy);
-        float ty = 2.0f * (qz * vx - qx * vz);
-        float tz = 2.0f * (qx * vy - qy * vx);
-        ox = vx + qw * tx + (qy * tz - qz * ty);
-        oy = vy + qw * ty + (qz * tx - qx * tz);
-        oz = vz + qw * tz + (qx * ty - qy * tx);
-    };
-    auto quatMul = [](float q1x, float q1y, float q1z, float q1w,
-                      float q2x, float q2y, float q2z, float q2w,
-                      float& rx, float& ry, float& rz, float& rw) {
-        rw = q1w*q2w - q1x*q2x - q1y*q2y - q1z*q2z;
-        rx = q1w*q2x + q1x*q2w + q1y*q2z - q1z*q2y;
-        ry = q1w*q2y - q1x*q2z + q1y*q2w + q1z*q2x;
-        rz = q1w*q2z + q1x*q2y - q1y*q2x + q1z*q2w;
-    };
-    std::vector<int> order;
-    std::vector<bool> done(model.skeleton.bones.size(), false);
-    while (order.size() < model.skeleton.bones.size()) {
-        bool any = false;
-        for (size_t i = 0; i < model.skeleton.bones.size(); i++) {
-            if (done[i]) continue;
-            if (model.skeleton.bones[i].parentIndex < 0 || done[model.skeleton.bones[i].parentIndex]) {
-                order.push_back((int)i);
-                done[i] = true;
-                any = true;
-            }
-        }
-        if (!any) {
-            for (size_t i = 0; i < model.skeleton.bones.size(); i++) {
-                if (!done[i]) { order.push_back((int)i); done[i] = true; }
-            }
-            break;
-        }
-    }
-    for (int idx : order) {
-        Bone& bone = model.skeleton.bones[idx];
-        if (bone.parentIndex < 0) {
-            bone.worldPosX = bone.posX;
-            bone.worldPosY = bone.posY;
-            bone.worldPosZ = bone.posZ;
-            bone.worldRotX = bone.rotX;
-            bone.worldRotY = bone.rotY;
-            bone.worldRotZ = bone.rotZ;
-            bone.worldRotW = bone.rotW;
-        } else {
-            const Bone& parent = model.skeleton.bones[bone.parentIndex];
-            float rx, ry, rz;
-            quatRotate(parent.worldRotX, parent.worldRotY, parent.worldRotZ, parent.worldRotW,
-                       bone.posX, bone.posY, bone.posZ, rx, ry, rz);
-            bone.worldPosX = parent.worldPosX + rx;
-            bone.worldPosY = parent.worldPosY + ry;
-            bone.worldPosZ = parent.worldPosZ + rz;
-            quatMul(parent.worldRotX, parent.worldRotY, parent.worldRotZ, parent.worldRotW,
-                    bone.rotX, bone.rotY, bone.rotZ, bone.rotW,
-                    bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW);
-        }
-    }
-}
\ No newline at end of file
+    evaluateWorldTransforms(model.skeleton.bones, boneEvaluationOrder(model.skeleton.bones));
+}
@@ -10,6 +10,39 @@ void findAnimationsForModel(AppState& state, const std::string& baseName);
 
 void resolveX360AnimHashes(Animation& anim, const Skeleton& skeleton);
 
+// Sets each track's boneIndex: exact bone name first, then the name folded
+// to lowercase with underscores dropped. Returns the number of tracks matched.
+int resolveAnimTracks(Animation& anim, const Skeleton& skeleton);
+
+// An Animation bound to a Skeleton for repeated sampling. Binding resolves
+// tracks to bones and works out the parent-before-child evaluation order
+// once; each track keeps a keyframe cursor, so playback and scrubbing find
+// the surrounding keyframes in amortized O(1) instead of scanning from the
+// start. Holds pointers into the Animation, which must outlive the binding.
+class PreparedAnimation {
+public:
+    void bind(const Animation& anim, const Skeleton& skeleton);
+    // Cheap check (no string work) that anim/skeleton still match the binding.
+    bool isBoundTo(const Animation& anim, const Skeleton& skeleton) const;
+
+    // Poses skeleton at time on top of basePose and updates world transforms.
+    void apply(Skeleton& skeleton, float time, const std::vector<Bone>& basePose);
+
+private:
+    struct Channel {
+        const AnimTrack* track;
+        int bone;
+        bool rotation;
+        size_t cursor;
+    };
+
+    std::vector<Channel> m_channels;
+    std::vector<int> m_order;
+    const Animation* m_anim = nullptr;
+    uint64_t m_signature = 0;
+};
+
+// Binds anim on first use (and whenever anim or the skeleton changes).
 void applyAnimation(Model& model, const Animation& anim, float time, const std::vector<Bone>& basePose);
 
 void computeBoneWorldTransforms(Model& model);
@@ -1,10 +1,12 @@
 #include "renderer.h"
+#include "skinning.h"
 #include "Shaders/shader.h"
 #include "Shaders/d3d_context.h"
 #include <cmath>
 #include <cstring>
 #include <algorithm>
 #include <vector>
+#include <unordered_map>
 #include <chrono>
 #include "terrain_loader.h"
 
@@ -639,107 +641,6 @@ static void renderLevelStatic(const Model& model, const float* mvp, const float*
     d3d.context->PSSetShaderResources(0, 10, nullSRVs);
 }
 
-inline void quatRotate(float qx, float qy, float qz, float qw,
-                       float vx, float vy, float vz,
-                       float& ox, float& oy, float& oz) {
-    float tx = 2.0f * (qy * vz - qz * vy);
-    float ty = 2.0f * (qz * vx - qx * vz);
-    float tz = 2.0f * (qx * vy - qy * vx);
-    ox = vx + qw * tx + (qy * tz - qz * ty);
-    oy = vy + qw * ty + (qz * tx - qx * tz);
-    oz = vz + qw * tz + (qx * ty - qy * tx);
-}
-
-void buildSkinningCache(Mesh& mesh, const Model& model) {
-    if (mesh.skinningCacheBuilt) return;
-    const auto& boneIndexArray = model.boneIndexArray;
-    const auto& skeleton = model.skeleton;
-    int maxBoneIdx = -1;
-    for (const auto& v : mesh.vertices) {
-        for (int i = 0; i < 4; i++) {
-            if (v.boneWeights[i] > 0.0001f && v.boneIndices[i] > maxBoneIdx)
-                maxBoneIdx = v.boneIndices[i];
-        }
-    }
-    if (maxBoneIdx < 0) { mesh.skinningCacheBuilt = true; return; }
-
-    mesh.skinningBoneMap.resize(maxBoneIdx + 1, -1);
-    for (int meshLocalIdx = 0; meshLocalIdx <= maxBoneIdx; meshLocalIdx++) {
-        int globalBoneIdx;
-        if (!mesh.bonesUsed.empty()) {
-            if (meshLocalIdx >= (int)mesh.bonesUsed.size()) continue;
-            globalBoneIdx = mesh.bonesUsed[meshLocalIdx];
-        } else {
-            globalBoneIdx = meshLocalIdx;
-        }
-        if (globalBoneIdx < 0 || globalBoneIdx >= (int)boneIndexArray.size()) continue;
-        const std::string& boneName = boneIndexArray[globalBoneIdx];
-        if (boneName.empty()) continue;
-        for (size_t j = 0; j < skeleton.bones.size(); j++) {
-            std::string skelBoneLower = skeleton.bones[j].name;
-            std::string targetLower = boneName;
-            std::transform(skelBoneLower.begin(), skelBoneLower.end(), skelBoneLower.begin(), ::tolower);
-            std::transform(targetLower.begin(), targetLower.end(), targetLower.begin(), ::tolower);
-            if (skelBoneLower == targetLower) {
-                mesh.skinningBoneMap[meshLocalIdx] = (int)j;
-                break;
-            }
-        }
-    }
-    mesh.skinningCacheBuilt = true;
-}
-
-void transformVertexBySkeleton(const Vertex& v, const Mesh& mesh, const Model& model,
-                               float& outX, float& outY, float& outZ,
-                               float& outNX, float& outNY, float& outNZ) {
-    const auto& skeleton = model.skeleton;
-    const auto& skinningMap = mesh.skinningBoneMap;
-    float totalWeight = 0;
-    float finalX = 0, finalY = 0, finalZ = 0;
-    float finalNX = 0, finalNY = 0, finalNZ = 0;
-    for (int i = 0; i < 4; i++) {
-        float weight = v.boneWeights[i];
-        if (weight < 0.0001f) continue;
-        int meshLocalIdx = v.boneIndices[i];
-        if (meshLocalIdx < 0 || meshLocalIdx >= (int)skinningMap.size()) continue;
-        int skelIdx = skinningMap[meshLocalIdx];
-        if (skelIdx < 0) continue;
-        const auto& bone = skeleton.bones[skelIdx];
-
-        float bx, by, bz, bnx, bny, bnz;
-        if (mesh.skipInvBind) {
-            bx = v.x; by = v.y; bz = v.z;
-            bnx = v.nx; bny = v.ny; bnz = v.nz;
-        } else {
-            quatRotate(bone.invBindRotX, bone.invBindRotY, bone.invBindRotZ, bone.invBindRotW,
-                       v.x, v.y, v.z, bx, by, bz);
-            bx += bone.invBindPosX; by += bone.invBindPosY; bz += bone.invBindPosZ;
-            quatRotate(bone.invBindRotX, bone.invBindRotY, bone.invBindRotZ, bone.invBindRotW,
-                       v.nx, v.ny, v.nz, bnx, bny, bnz);
-        }
-
-        float wx, wy, wz;
-        quatRotate(bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW,
-                   bx, by, bz, wx, wy, wz);
-        wx += bone.worldPosX; wy += bone.worldPosY; wz += bone.worldPosZ;
-        float wnx, wny, wnz;
-        quatRotate(bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW,
-                   bnx, bny, bnz, wnx, wny, wnz);
-        finalX += wx * weight; finalY += wy * weight; finalZ += wz * weight;
-        finalNX += wnx * weight; finalNY += wny * weight; finalNZ += wnz * weight;
-        totalWeight += weight;
-    }
-    if (totalWeight > 0.0001f) {
-        outX = finalX / totalWeight; outY = finalY / totalWeight; outZ = finalZ / totalWeight;
-        float len = sqrtf(finalNX*finalNX + finalNY*finalNY + finalNZ*finalNZ);
-        if (len > 0.0001f) { outNX = finalNX/len; outNY = finalNY/len; outNZ = finalNZ/len; }
-        else { outNX = v.nx; outNY = v.ny; outNZ = v.nz; }
-    } else {
-        outX = v.x; outY = v.y; outZ = v.z;
-        outNX = v.nx; outNY = v.ny; outNZ = v.nz;
-    }
-}
-
 static void flushLines(const float* mvp) {
     if (s_lineBatch.empty()) return;
     D3DContext& d3d = getD3DContext();
@@ -1034,6 +935,10 @@ void renderModel(Model& model, const Camera& camera, const RenderSettings& setti
 
         bool useShaders = !settings.wireframe && settings.showTextures;
 
+        // The pose is fixed for the frame, so every skinned mesh shares one palette.
+        static SkinPalette s_skinPalette;
+        if (animating) s_skinPalette.build(model.skeleton);
+
         for (int pass = 0; pass < 2; pass++) {
             for (size_t meshIdx = 0; meshIdx < model.meshes.size(); meshIdx++) {
                 if (meshIdx < settings.meshVisible.size() && settings.meshVisible[meshIdx] == 0) continue;
@@ -1261,12 +1166,10 @@ void renderModel(Model& model, const Camera& camera, const RenderSettings& setti
                 std::vector<ModelVertex> vertData(mesh.vertices.size());
                 for (size_t vi = 0; vi < mesh.vertices.size(); vi++) {
                     const Vertex& v = mesh.vertices[vi];
-                    float px = v.x, py = v.y, pz = v.z;
-                    float nx = v.nx, ny = v.ny, nz = v.nz;
-                    if (animating && mesh.hasSkinning)
-                        transformVertexBySkeleton(v, mesh, model, px, py, pz, nx, ny, nz);
-                    vertData[vi] = { px, py, pz, nx, ny, nz, v.u, 1.0f - v.v };
+                    vertData[vi] = { v.x, v.y, v.z, v.nx, v.ny, v.nz, v.u, 1.0f - v.v };
                 }
+                if (animating && mesh.hasSkinning && !vertData.empty())
+                    skinMesh(mesh, s_skinPalette, &vertData[0].x, sizeof(ModelVertex));
 
                 s_modelBuffer.update(d3d.context, vertData.data(), (uint32_t)vertData.size());
 
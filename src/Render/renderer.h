@@ -1,6 +1,7 @@
 #pragma once
 #include "types.h"
 #include "Mesh.h"
+#include "skinning.h"
 
 void initRenderer();
 void cleanupRenderer();
@@ -9,8 +10,6 @@ void bakeLevelBuffers(Model& model);
 void destroyLevelBuffers();
 bool isLevelBaked();
 
-void buildSkinningCache(Mesh& mesh, const Model& model);
-
 void renderModel(Model& model, const Camera& camera, const RenderSettings& settings,
                  int width, int height, bool animating = false, int selectedBone = -1,
                  int selectedChunk = -1, const EnvironmentSettings* envSettings = nullptr,
@@ -21,8 +20,4 @@ void destroySkyDome();
 void drawSolidSphere(float radius, int slices, int stacks);
 void drawSolidCapsule(float radius, float height, int slices, int stacks);
 
-void transformVertexBySkeleton(const Vertex& v, const Mesh& mesh, const Model& model,
-                               float& outX, float& outY, float& outZ,
-                               float& outNX, float& outNY, float& outNZ);
-
 inline void loadGLExtensions() {}
\ No newline at end of file
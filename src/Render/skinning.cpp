@@ -0,0 +1,222 @@
+#include "skinning.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SKINNING_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static void quatRotate(float qx, float qy, float qz, float qw,
+                       float vx, float vy, float vz,
+                       float& ox, float& oy, float& oz) {
+    float tx = 2.0f * (qy * vz - qz * vy);
+    float ty = 2.0f * (qz * vx - qx * vz);
+    float tz = 2.0f * (qx * vy - qy * vx);
+    ox = vx + qw * tx + (qy * tz - qz * ty);
+    oy = vy + qw * ty + (qz * tx - qx * tz);
+    oz = vz + qw * tz + (qx * ty - qy * tx);
+}
+
+void buildSkinningCache(Mesh& mesh, const Model& model) {
+    if (mesh.skinningCacheBuilt) return;
+    const auto& boneIndexArray = model.boneIndexArray;
+    const auto& skeleton = model.skeleton;
+    int maxBoneIdx = -1;
+    for (const auto& v : mesh.vertices) {
+        for (int i = 0; i < 4; i++) {
+            if (v.boneWeights[i] > 0.0001f && v.boneIndices[i] > maxBoneIdx)
+                maxBoneIdx = v.boneIndices[i];
+        }
+    }
+    if (maxBoneIdx < 0) { mesh.skinningCacheBuilt = true; return; }
+
+    mesh.skinningBoneMap.resize(maxBoneIdx + 1, -1);
+    std::unordered_map<std::string, int> skelByName;
+    skelByName.reserve(skeleton.bones.size());
+    for (size_t j = 0; j < skeleton.bones.size(); j++) {
+        std::string lower = skeleton.bones[j].name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        skelByName.emplace(std::move(lower), (int)j);
+    }
+    for (int meshLocalIdx = 0; meshLocalIdx <= maxBoneIdx; meshLocalIdx++) {
+        int globalBoneIdx;
+        if (!mesh.bonesUsed.empty()) {
+            if (meshLocalIdx >= (int)mesh.bonesUsed.size()) continue;
+            globalBoneIdx = mesh.bonesUsed[meshLocalIdx];
+        } else {
+            globalBoneIdx = meshLocalIdx;
+        }
+        if (globalBoneIdx < 0 || globalBoneIdx >= (int)boneIndexArray.size()) continue;
+        const std::string& boneName = boneIndexArray[globalBoneIdx];
+        if (boneName.empty()) continue;
+        std::string targetLower = boneName;
+        std::transform(targetLower.begin(), targetLower.end(), targetLower.begin(), ::tolower);
+        auto it = skelByName.find(targetLower);
+        if (it != skelByName.end())
+            mesh.skinningBoneMap[meshLocalIdx] = it->second;
+    }
+    mesh.skinningCacheBuilt = true;
+}
+
+void transformVertexBySkeleton(const Vertex& v, const Mesh& mesh, const Model& model,
+                               float& outX, float& outY, float& outZ,
+                               float& outNX, float& outNY, float& outNZ) {
+    const auto& skeleton = model.skeleton;
+    const auto& skinningMap = mesh.skinningBoneMap;
+    float totalWeight = 0;
+    float finalX = 0, finalY = 0, finalZ = 0;
+    float finalNX = 0, finalNY = 0, finalNZ = 0;
+    for (int i = 0; i < 4; i++) {
+        float weight = v.boneWeights[i];
+        if (weight < 0.0001f) continue;
+        int meshLocalIdx = v.boneIndices[i];
+        if (meshLocalIdx < 0 || meshLocalIdx >= (int)skinningMap.size()) continue;
+        int skelIdx = skinningMap[meshLocalIdx];
+        if (skelIdx < 0) continue;
+        const auto& bone = skeleton.bones[skelIdx];
+
+        float bx, by, bz, bnx, bny, bnz;
+        if (mesh.skipInvBind) {
+            bx = v.x; by = v.y; bz = v.z;
+            bnx = v.nx; bny = v.ny; bnz = v.nz;
+        } else {
+            quatRotate(bone.invBindRotX, bone.invBindRotY, bone.invBindRotZ, bone.invBindRotW,
+                       v.x, v.y, v.z, bx, by, bz);
+            bx += bone.invBindPosX; by += bone.invBindPosY; bz += bone.invBindPosZ;
+            quatRotate(bone.invBindRotX, bone.invBindRotY, bone.invBindRotZ, bone.invBindRotW,
+                       v.nx, v.ny, v.nz, bnx, bny, bnz);
+        }
+
+        float wx, wy, wz;
+        quatRotate(bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW,
+                   bx, by, bz, wx, wy, wz);
+        wx += bone.worldPosX; wy += bone.worldPosY; wz += bone.worldPosZ;
+        float wnx, wny, wnz;
+        quatRotate(bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW,
+                   bnx, bny, bnz, wnx, wny, wnz);
+        finalX += wx * weight; finalY += wy * weight; finalZ += wz * weight;
+        finalNX += wnx * weight; finalNY += wny * weight; finalNZ += wnz * weight;
+        totalWeight += weight;
+    }
+    if (totalWeight > 0.0001f) {
+        outX = finalX / totalWeight; outY = finalY / totalWeight; outZ = finalZ / totalWeight;
+        float len = sqrtf(finalNX*finalNX + finalNY*finalNY + finalNZ*finalNZ);
+        if (len > 0.0001f) { outNX = finalNX/len; outNY = finalNY/len; outNZ = finalNZ/len; }
+        else { outNX = v.nx; outNY = v.ny; outNZ = v.nz; }
+    } else {
+        outX = v.x; outY = v.y; outZ = v.z;
+        outNX = v.nx; outNY = v.ny; outNZ = v.nz;
+    }
+}
+
+// quatRotate is linear in v, so rotating the basis vectors gives its exact
+// matrix, unnormalized quaternions included.
+static void quatColumns(float qx, float qy, float qz, float qw, float cols[3][3]) {
+    quatRotate(qx, qy, qz, qw, 1, 0, 0, cols[0][0], cols[0][1], cols[0][2]);
+    quatRotate(qx, qy, qz, qw, 0, 1, 0, cols[1][0], cols[1][1], cols[1][2]);
+    quatRotate(qx, qy, qz, qw, 0, 0, 1, cols[2][0], cols[2][1], cols[2][2]);
+}
+
+void SkinPalette::build(const Skeleton& skeleton) {
+    size_t count = skeleton.bones.size();
+    bind.assign(count * 16, 0.0f);
+    world.assign(count * 16, 0.0f);
+    for (size_t i = 0; i < count; i++) {
+        const Bone& bone = skeleton.bones[i];
+        float w[3][3], ib[3][3];
+        quatColumns(bone.worldRotX, bone.worldRotY, bone.worldRotZ, bone.worldRotW, w);
+        quatColumns(bone.invBindRotX, bone.invBindRotY, bone.invBindRotZ, bone.invBindRotW, ib);
+
+        float* wm = &world[i * 16];
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++) wm[c * 4 + r] = w[c][r];
+        wm[12] = bone.worldPosX;
+        wm[13] = bone.worldPosY;
+        wm[14] = bone.worldPosZ;
+
+        // world(invBind(v) + invBindPos) + worldPos
+        float* bm = &bind[i * 16];
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++)
+                bm[c * 4 + r] = w[0][r] * ib[c][0] + w[1][r] * ib[c][1] + w[2][r] * ib[c][2];
+        for (int r = 0; r < 3; r++)
+            bm[12 + r] = w[0][r] * bone.invBindPosX + w[1][r] * bone.invBindPosY + w[2][r] * bone.invBindPosZ + wm[12 + r];
+    }
+}
+
+static void skinRange(const Mesh& mesh, const float* palette, size_t boneCount,
+                      size_t begin, size_t end, char* out, size_t outStride) {
+    const auto& map = mesh.skinningBoneMap;
+    const int mapSize = (int)map.size();
+
+    for (size_t vi = begin; vi < end; vi++) {
+        const Vertex& v = mesh.vertices[vi];
+        float result[8];
+
+#ifdef SKINNING_SSE2
+        __m128 c0 = _mm_setzero_ps(), c1 = c0, c2 = c0, c3 = c0;
+#else
+        float m[16] = {};
+#endif
+        float totalWeight = 0;
+        for (int i = 0; i < 4; i++) {
+            float weight = v.boneWeights[i];
+            if (weight < 0.0001f) continue;
+            int local = v.boneIndices[i];
+            if (local < 0 || local >= mapSize) continue;
+            int skel = map[local];
+            if (skel < 0 || (size_t)skel >= boneCount) continue;
+            const float* bm = palette + (size_t)skel * 16;
+#ifdef SKINNING_SSE2
+            __m128 w = _mm_set1_ps(weight);
+            c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(bm), w));
+            c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(bm + 4), w));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(bm + 8), w));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(bm + 12), w));
+#else
+            for (int k = 0; k < 16; k++) m[k] += bm[k] * weight;
+#endif
+            totalWeight += weight;
+        }
+
+        if (totalWeight > 0.0001f) {
+#ifdef SKINNING_SSE2
+            __m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.x)), _mm_mul_ps(c1, _mm_set1_ps(v.y))),
+                                  _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(v.z)), c3));
+            __m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v.nx)), _mm_mul_ps(c1, _mm_set1_ps(v.ny))),
+                                  _mm_mul_ps(c2, _mm_set1_ps(v.nz)));
+            p = _mm_div_ps(p, _mm_set1_ps(totalWeight));
+            _mm_storeu_ps(result, p);
+            _mm_storeu_ps(result + 4, n);
+            float nx = result[4], ny = result[5], nz = result[6];
+#else
+            for (int r = 0; r < 3; r++)
+                result[r] = (m[r] * v.x + m[4 + r] * v.y + m[8 + r] * v.z + m[12 + r]) / totalWeight;
+            float nx = m[0] * v.nx + m[4] * v.ny + m[8] * v.nz;
+            float ny = m[1] * v.nx + m[5] * v.ny + m[9] * v.nz;
+            float nz = m[2] * v.nx + m[6] * v.ny + m[10] * v.nz;
+#endif
+            float len = sqrtf(nx*nx + ny*ny + nz*nz);
+            if (len > 0.0001f) { result[3] = nx/len; result[4] = ny/len; result[5] = nz/len; }
+            else { result[3] = v.nx; result[4] = v.ny; result[5] = v.nz; }
+        } else {
+            result[0] = v.x; result[1] = v.y; result[2] = v.z;
+            result[3] = v.nx; result[4] = v.ny; result[5] = v.nz;
+        }
+        std::memcpy(out + vi * outStride, result, sizeof(float) * 6);
+    }
+}
+
+void skinMesh(const Mesh& mesh, const SkinPalette& palette, float* out, size_t outStride) {
+    const float* bones = mesh.skipInvBind ? palette.world.data() : palette.bind.data();
+    size_t boneCount = palette.boneCount();
+    char* base = reinterpret_cast<char*>(out);
+    // Below a couple of thousand vertices the hand-off costs more than it saves.
+    Parallel::forRange(mesh.vertices.size(), 2048, [&](size_t begin, size_t end) {
+        skinRange(mesh, bones, boneCount, begin, end, base, outStride);
+    });
+}
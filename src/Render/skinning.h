@@ -0,0 +1,33 @@
+#pragma once
+#include "Mesh.h"
+#include <vector>
+#include <cstddef>
+
+// Maps the mesh's bone indices to skeleton bones by name, once per mesh.
+void buildSkinningCache(Mesh& mesh, const Model& model);
+
+// Reference per-vertex skinning: blends up to four influences with
+// quaternion rotations. skinMesh gives the same results in bulk.
+void transformVertexBySkeleton(const Vertex& v, const Mesh& mesh, const Model& model,
+                               float& outX, float& outY, float& outZ,
+                               float& outNX, float& outNY, float& outNZ);
+
+// Per-frame bone palette. Each skeleton bone gets its posed transform as a
+// 3x4 matrix stored as four padded columns (x, y, z axes, then translation),
+// so a vertex blends up to four of them with plain multiply-adds instead of
+// four pairs of quaternion rotations.
+struct SkinPalette {
+    std::vector<float> bind;    // world * inverse bind, 16 floats per bone
+    std::vector<float> world;   // world only, for meshes with skipInvBind
+
+    // Call once per frame after the pose (world transforms) is final.
+    void build(const Skeleton& skeleton);
+    size_t boneCount() const { return bind.size() / 16; }
+};
+
+// Skins every vertex of mesh against palette and writes the position and
+// normal (six consecutive floats) to out, advancing outStride bytes per
+// vertex. Same results as transformVertexBySkeleton, which stays as the
+// per-vertex reference; large meshes are split across the worker pool.
+// mesh.skinningBoneMap must already be built.
+void skinMesh(const Mesh& mesh, const SkinPalette& palette, float* out, size_t outStride);
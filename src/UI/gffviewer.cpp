@@ -84,35 +84,7 @@ static std::string gff4StructTypeDesc(const GFFFile& gff, uint32_t structIndex,
 }
 
 static std::string readGffString(const GFFFile& gff, uint32_t address) {
-    if (address == 0xFFFFFFFF) return "";
-    const auto& cache = gff.stringCache();
-    if (gff.isV41()) {
-        if (address < cache.size()) return cache[address];
-        return "";
-    }
-    const auto& raw = gff.rawData();
-    uint32_t strPos = gff.dataOffset() + address;
-    if (strPos + 4 > raw.size()) {
-        return "";
-    }
-    uint32_t length = gff.readUInt32At(strPos);
-    strPos += 4;
-    std::string result;
-    for (uint32_t i = 0; i < length && strPos + 2 <= raw.size(); i++) {
-        uint16_t wc = gff.readUInt16At(strPos);
-        strPos += 2;
-        if (wc == 0) continue;
-        if (wc < 0x80) result += static_cast<char>(wc);
-        else if (wc < 0x800) {
-            result += static_cast<char>(0xC0 | (wc >> 6));
-            result += static_cast<char>(0x80 | (wc & 0x3F));
-        } else {
-            result += static_cast<char>(0xE0 | (wc >> 12));
-            result += static_cast<char>(0x80 | ((wc >> 6) & 0x3F));
-            result += static_cast<char>(0x80 | (wc & 0x3F));
-        }
-    }
-    return result;
+    return std::string(gff.ecString(address));
 }
 
 static std::string gff4ReadFieldValueStr(const GFFFile& gff, const GFFField& field, uint32_t baseOffset) {
@@ -197,15 +169,13 @@ static std::string gff4ReadFieldValueStr(const GFFFile& gff, const GFFField& fie
     }
 }
 
-static std::string gff4StructPreview(const GFFFile& gff, uint32_t structIndex, uint32_t baseOffset) {
-    if (structIndex >= gff.structs().size()) return "?";
-    const GFFStruct& st = gff.structs()[structIndex];
+static std::string gff4StructPreview(const GFFCursor& st) {
+    if (!st) return "?";
     std::string result;
     int totalLen = 0;
-    for (size_t i = 0; i < st.fields.size(); ++i) {
-        const GFFField& field = st.fields[i];
+    for (GFFFieldCursor f : st) {
         if (!result.empty()) { result += ", "; totalLen += 2; }
-        std::string val = gff4ReadFieldValueStr(gff, field, baseOffset);
+        std::string val = gff4ReadFieldValueStr(st.file(), f.field(), st.offset());
         totalLen += (int)val.size();
         if (totalLen > 100) { result += "..."; break; }
         result += val;
@@ -279,8 +249,8 @@ bool loadGffData(GffViewerState& state, const std::vector<uint8_t>& data,
 
 static void buildTreeFromGff32Struct(GffViewerState& state, const GFF32::Structure& st,
                                       const std::string& basePath, int depth, bool forceExpand = false);
-static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
-                                     uint32_t baseOffset, int depth, const std::string& basePath, bool forceExpand = false,
+static void buildTreeFromGff4Struct(GffViewerState& state, const GFFCursor& st,
+                                     int depth, const std::string& basePath, bool forceExpand = false,
                                      std::set<std::pair<uint32_t,uint32_t>>* visited = nullptr);
 void rebuildGffTree(GffViewerState& state) {
     state.visibleIndices.clear();
@@ -319,18 +289,19 @@ static void buildFullTree(GffViewerState& state) {
         std::memcpy(fileVer, &hdr.fileVersion, 4);
         std::memcpy(platform, &hdr.platform, 4);
         std::string version = (hdr.version == 0x56342E30) ? "V4.0" : ((hdr.version == 0x56342E31) ? "V4.1" : "V4.?");
+        GFFCursor top = state.gff4->root();
         GffViewerState::TreeNode rootNode;
         rootNode.numericLabel = 0;
         rootNode.label = std::string("GFF  ") + version + " " + fileType + " " + fileVer + " " + platform;
-        rootNode.typeName = !state.gff4->structs().empty() ? std::string(state.gff4->structs()[0].structType) : "?";
-        rootNode.value = !state.gff4->structs().empty() ? gff4StructPreview(*state.gff4, 0, 0) : "";
-        rootNode.depth = 0; rootNode.isExpandable = !state.gff4->structs().empty();
+        rootNode.typeName = top ? std::string(top.type().structType) : "?";
+        rootNode.value = top ? gff4StructPreview(top) : "";
+        rootNode.depth = 0; rootNode.isExpandable = static_cast<bool>(top);
         rootNode.isExpanded = true;
-        rootNode.childCount = state.gff4->structs().empty() ? 0 : state.gff4->structs()[0].fields.size();
+        rootNode.childCount = top.fieldCount();
         rootNode.path = ""; rootNode.structIndex = 0; rootNode.baseOffset = 0; rootNode.isListItem = false;
         state.flattenedTree.push_back(rootNode);
-        if (!state.gff4->structs().empty())
-            buildTreeFromGff4Struct(state, 0, 0, 1, "", true);
+        if (top)
+            buildTreeFromGff4Struct(state, top, 1, "", true);
     }
     state.fullTree = std::move(state.flattenedTree);
     state.flattenedTree = std::move(savedFlat);
@@ -465,55 +436,53 @@ static void buildTreeFromGff32Struct(GffViewerState& state, const GFF32::Structu
     }
 }
 
-static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
-                                     uint32_t baseOffset, int depth, const std::string& basePath, bool forceExpand,
+// Walks one struct instance through the file's cursors. Lists are capped at
+// 100000 rows each, and an instance already on the tree isn't expanded again,
+// so reference cycles end.
+static void buildTreeFromGff4Struct(GffViewerState& state, const GFFCursor& st,
+                                     int depth, const std::string& basePath, bool forceExpand,
                                      std::set<std::pair<uint32_t,uint32_t>>* visited) {
     if (depth > 100 || state.flattenedTree.size() > 500000) return;
-    if (!state.gff4 || structIndex >= state.gff4->structs().size()) return;
+    if (!st) return;
 
     std::set<std::pair<uint32_t,uint32_t>> localVisited;
     if (!visited) visited = &localVisited;
-    auto key = std::make_pair(structIndex, baseOffset);
+    auto key = std::make_pair(st.structIndex(), st.offset());
     if (visited->count(key)) {
         return;
     }
     visited->insert(key);
 
-    const GFFStruct& st = state.gff4->structs()[structIndex];
-    for (size_t i = 0; i < st.fields.size(); ++i) {
-        const GFFField& field = st.fields[i];
+    const GFFFile& gff = st.file();
+    for (uint32_t i = 0; i < st.fieldCount(); ++i) {
+        GFFFieldCursor f = st.field(i);
+        const GFFField& field = f.field();
         std::string path = basePath.empty() ? std::to_string(field.label) : basePath + "." + std::to_string(field.label);
         GffViewerState::TreeNode node;
         node.numericLabel = field.label;
         node.label = getGFF4FieldName(field.label);
-        node.typeName = gff4TypeDesc(*state.gff4, field.typeId, field.flags);
+        node.typeName = gff4TypeDesc(gff, field.typeId, field.flags);
         node.depth = depth;
         node.path = path;
-        node.structIndex = structIndex;
-        node.fieldIndex = static_cast<uint32_t>(i);
-        node.baseOffset = baseOffset;
+        node.structIndex = st.structIndex();
+        node.fieldIndex = i;
+        node.baseOffset = st.offset();
         node.isListItem = false;
 
-        bool isList = (field.flags & FLAG_LIST) != 0;
-        bool isStruct = (field.flags & FLAG_STRUCT) != 0;
-        bool isRef = (field.flags & FLAG_REFERENCE) != 0;
+        bool isList = f.isList();
+        bool isStruct = f.isStruct();
+        bool isRef = f.isReference();
+        GFFListCursor items = isList ? f.list() : GFFListCursor();
+        uint32_t itemCount = std::min<uint32_t>(items.size(), 100000);
 
-        if (isList && (isStruct || isRef)) {
-            node.isExpandable = true;
-            auto items = state.gff4->readStructList(structIndex, field.label, baseOffset);
+        if (isList) {
+            node.isExpandable = isStruct || isRef || itemCount > 0;
             node.childCount = items.size();
             node.value = gff4ListPreview(items.size());
-        } else if (isList && !isStruct && !isRef) {
-            auto [count, dataStart] = state.gff4->readPrimitiveListInfo(structIndex, field.label, baseOffset);
-            node.childCount = count;
-            node.isExpandable = count > 0;
-            node.value = gff4ListPreview(count);
         } else if (isRef && !isStruct && field.typeId <= 17) {
-
-            uint32_t ptrPos = state.gff4->dataOffset() + baseOffset + field.dataOffset;
-            const auto& raw = state.gff4->rawData();
-            if (ptrPos + 4 <= raw.size()) {
-                uint32_t ptr = state.gff4->readUInt32At(ptrPos);
+            uint32_t ptrPos = f.dataPos();
+            if (ptrPos + 4 <= gff.rawData().size()) {
+                uint32_t ptr = gff.readUInt32At(ptrPos);
                 if (ptr == 0xFFFFFFFF) {
                     node.value = "null";
                 } else {
@@ -521,11 +490,11 @@ static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
                     deref.flags &= ~FLAG_REFERENCE;
                     if (field.typeId == 14) {
 
-                        node.value = gff4ReadFieldValueStr(*state.gff4, deref, baseOffset);
+                        node.value = gff4ReadFieldValueStr(gff, deref, st.offset());
                     } else {
 
                         deref.dataOffset = 0;
-                        node.value = gff4ReadFieldValueStr(*state.gff4, deref, ptr);
+                        node.value = gff4ReadFieldValueStr(gff, deref, ptr);
                     }
                 }
             } else {
@@ -533,39 +502,16 @@ static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
             }
             node.isExpandable = false;
             node.childCount = 0;
-        } else if (isRef && !isStruct) {
-            auto ref = state.gff4->readStructRef(structIndex, field.label, baseOffset);
-            if (ref.structIndex < state.gff4->structs().size()) {
-                node.isExpandable = true;
-                node.childCount = state.gff4->structs()[ref.structIndex].fields.size();
-                node.typeName = gff4StructTypeDesc(*state.gff4, ref.structIndex, true);
-                node.value = gff4StructPreview(*state.gff4, ref.structIndex, ref.offset);
-            } else {
-                node.isExpandable = false;
-                node.childCount = 0;
-                node.value = "...";
-            }
-        } else if (isStruct && isRef) {
-            node.isExpandable = true;
-            auto ref = state.gff4->readStructRef(structIndex, field.label, baseOffset);
-            node.childCount = (ref.structIndex < state.gff4->structs().size())
-                ? state.gff4->structs()[ref.structIndex].fields.size() : 0;
-            node.value = (ref.structIndex < state.gff4->structs().size())
-                ? gff4StructPreview(*state.gff4, ref.structIndex, ref.offset) : "?";
-        } else if (isStruct && !isRef) {
-            node.isExpandable = true;
-            uint32_t embStructOffset = baseOffset + field.dataOffset;
-            uint32_t embStructIdx = field.typeId;
-            if (embStructIdx < state.gff4->structs().size()) {
-                node.childCount = state.gff4->structs()[embStructIdx].fields.size();
-                node.value = gff4StructPreview(*state.gff4, embStructIdx, embStructOffset);
-            } else {
-                node.childCount = 0; node.value = "?";
-            }
+        } else if (isStruct || isRef) {
+            GFFCursor child = f.child();
+            node.isExpandable = static_cast<bool>(child);
+            node.childCount = child.fieldCount();
+            if (child && !isStruct) node.typeName = gff4StructTypeDesc(gff, child.structIndex(), true);
+            node.value = child ? gff4StructPreview(child) : (isStruct ? "?" : "...");
         } else {
             node.isExpandable = false;
             node.childCount = 0;
-            node.value = gff4ReadFieldValueStr(*state.gff4, field, baseOffset);
+            node.value = gff4ReadFieldValueStr(gff, field, st.offset());
         }
 
         node.isExpanded = forceExpand || state.expandedPaths.count(path) > 0;
@@ -573,18 +519,17 @@ static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
 
         if (node.isExpanded && node.isExpandable) {
             if (isList && (isStruct || isRef)) {
-                auto items = state.gff4->readStructList(structIndex, field.label, baseOffset);
-                bool elemIndirect = isRef;
-                for (size_t j = 0; j < items.size(); ++j) {
+                for (uint32_t j = 0; j < itemCount; ++j) {
+                    GFFCursor item = items.at(j);
                     std::string itemPath = path + "[" + std::to_string(j) + "]";
                     GffViewerState::TreeNode itemNode;
-                    itemNode.numericLabel = static_cast<uint32_t>(j);
+                    itemNode.numericLabel = j;
                     itemNode.label = "";
                     itemNode.isListItem = true;
-                    if (items[j].structIndex < state.gff4->structs().size()) {
-                        itemNode.typeName = gff4StructTypeDesc(*state.gff4, items[j].structIndex, elemIndirect);
-                        itemNode.childCount = state.gff4->structs()[items[j].structIndex].fields.size();
-                        itemNode.value = gff4StructPreview(*state.gff4, items[j].structIndex, items[j].offset);
+                    if (item) {
+                        itemNode.typeName = gff4StructTypeDesc(gff, item.structIndex(), isRef);
+                        itemNode.childCount = item.fieldCount();
+                        itemNode.value = gff4StructPreview(item);
                     } else {
                         itemNode.typeName = "?";
                         itemNode.childCount = 0;
@@ -592,20 +537,17 @@ static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
                     }
                     itemNode.depth = depth + 1;
                     itemNode.path = itemPath;
-                    itemNode.structIndex = items[j].structIndex;
-                    itemNode.baseOffset = items[j].offset;
+                    itemNode.structIndex = item.structIndex();
+                    itemNode.baseOffset = item.offset();
                     itemNode.isExpandable = itemNode.childCount > 0;
                     itemNode.isExpanded = forceExpand || state.expandedPaths.count(itemPath) > 0;
                     state.flattenedTree.push_back(itemNode);
                     if (itemNode.isExpanded) {
-                        buildTreeFromGff4Struct(state, items[j].structIndex, items[j].offset, depth + 2, itemPath, forceExpand, visited);
+                        buildTreeFromGff4Struct(state, item, depth + 2, itemPath, forceExpand, visited);
                     }
                 }
-            } else if (isList && !isStruct && !isRef) {
-                auto [count, dataStart] = state.gff4->readPrimitiveListInfo(structIndex, field.label, baseOffset);
-                uint32_t itemSize = GFFFile::primitiveTypeSize(field.typeId);
-                if (count > 100000) count = 100000;
-                for (uint32_t j = 0; j < count; ++j) {
+            } else if (isList) {
+                for (uint32_t j = 0; j < itemCount; ++j) {
                     std::string itemPath = path + "[" + std::to_string(j) + "]";
                     GffViewerState::TreeNode itemNode;
                     itemNode.numericLabel = j;
@@ -618,26 +560,12 @@ static void buildTreeFromGff4Struct(GffViewerState& state, uint32_t structIndex,
                     itemNode.childCount = 0;
                     GFFField fakeField = field;
                     fakeField.flags = 0;
-                    fakeField.dataOffset = (dataStart + j * itemSize) - state.gff4->dataOffset();
-                    itemNode.value = gff4ReadFieldValueStr(*state.gff4, fakeField, 0);
+                    fakeField.dataOffset = items.elementPos(j) - gff.dataOffset();
+                    itemNode.value = gff4ReadFieldValueStr(gff, fakeField, 0);
                     state.flattenedTree.push_back(itemNode);
                 }
-            } else if (isRef && !isStruct) {
-                auto ref = state.gff4->readStructRef(structIndex, field.label, baseOffset);
-                if (ref.structIndex < state.gff4->structs().size()) {
-                    buildTreeFromGff4Struct(state, ref.structIndex, ref.offset, depth + 1, path, forceExpand, visited);
-                }
-            } else if (isStruct && isRef) {
-                auto ref = state.gff4->readStructRef(structIndex, field.label, baseOffset);
-                if (ref.structIndex < state.gff4->structs().size()) {
-                    buildTreeFromGff4Struct(state, ref.structIndex, ref.offset, depth + 1, path, forceExpand, visited);
-                }
-            } else if (isStruct && !isRef) {
-                uint32_t embStructOffset = baseOffset + field.dataOffset;
-                uint32_t embStructIdx = field.typeId;
-                if (embStructIdx < state.gff4->structs().size()) {
-                    buildTreeFromGff4Struct(state, embStructIdx, embStructOffset, depth + 1, path, forceExpand, visited);
-                }
+            } else {
+                buildTreeFromGff4Struct(state, f.child(), depth + 1, path, forceExpand, visited);
             }
         }
     }
@@ -1176,7 +1104,8 @@ void drawGffViewerWindow(GffViewerState& state) {
             std::string savePath = ImGuiFileDialog::Instance()->GetFilePathName();
             std::vector<uint8_t> gffBytes;
             if (state.loadedFormat == GffViewerState::Format::GFF4 && state.gff4) {
-                gffBytes = state.gff4->rawData();
+                GFFBytes raw = state.gff4->rawData();
+                gffBytes.assign(raw.begin(), raw.end());
             } else if (state.loadedFormat == GffViewerState::Format::GFF32 && state.gff32) {
                 gffBytes = state.gff32->save();
             }
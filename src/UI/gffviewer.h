@@ -1,5 +1,5 @@
 #pragma once
-#include "Gff32.h"
+#include "gff32.h"
 #include "Gff.h"
 #include <string>
 #include <vector>
@@ -3,9 +3,12 @@
 #include "terrain_loader.h"
 #include "rml_loader.h"
 #include "spt.h"
+#include "resource_locator.h"
 #include "Gff.h"
 #include "GffViewer.h"
 #include "LevelDatabase.h"
+#include "level_pipeline.h"
+#include "bulk_extract.h"
 #include "blender_addon_embedded.h"
 #include <cstring>
 #include <fstream>
@@ -21,42 +24,14 @@ static bool exportBlenderAddon(const unsigned char* data, unsigned int size, con
     return out.good();
 }
 
+static LevelPipeline s_levelPipeline;
+static BulkExtractor s_bulkExtract;
+
 static const std::vector<LevelGame>& getLevelDB() {
     static std::vector<LevelGame> db = buildLevelDatabase();
     return db;
 }
 
-// Merge every placed instance of the same object into one combined mesh: meshes
-// that share an object identity (mesh name) and material are concatenated, so e.g.
-// 150 instances of a tree become a single mesh / draw call per submesh+material
-// instead of 150. Applies to all level objects (props and trees). Vertices are
-// already baked to world space at placement, so this is a straight concatenation.
-static void mergeLevelInstances(Model& model) {
-    std::vector<Mesh> out;
-    out.reserve(model.meshes.size());
-    std::unordered_map<std::string, int> keyToOut;
-    for (auto& mesh : model.meshes) {
-        if (mesh.vertices.empty() || mesh.indices.empty()) continue;
-        std::string key = mesh.name + "##" + std::to_string(mesh.materialIndex);
-        auto it = keyToOut.find(key);
-        if (it == keyToOut.end()) {
-            keyToOut[key] = (int)out.size();
-            out.push_back(std::move(mesh));
-        } else {
-            Mesh& dst = out[(size_t)it->second];
-            uint32_t base = (uint32_t)dst.vertices.size();
-            uint32_t idxBase = (uint32_t)dst.indices.size();
-            dst.vertices.insert(dst.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
-            dst.indices.reserve(dst.indices.size() + mesh.indices.size());
-            for (uint32_t idx : mesh.indices) dst.indices.push_back(base + idx);
-            for (const auto& r : mesh.instanceRanges)
-                dst.instanceRanges.push_back({ idxBase + r.firstIndex, r.indexCount, r.instanceId });
-        }
-    }
-    for (auto& m : out) m.calculateBounds();
-    model.meshes = std::move(out);
-}
-
 static void startLevelLoad(AppState& state, const std::string& rimPath, const std::string& displayName) {
     if (state.levelLoad.stage != 0) return;
     state.showTerrain = false;
@@ -84,10 +59,6 @@ static void startLevelLoad(AppState& state, const std::string& rimPath, const st
     state.modelErfs.clear();
     state.materialErfs.clear();
     clearPropCache();
-    clearErfIndices();
-    state.modelErfIndex.clear();
-    state.materialErfIndex.clear();
-    state.textureErfIndex.clear();
     ensureBaseErfsLoaded(state);
 
     auto rimForModel = std::make_unique<ERFFile>();
@@ -300,244 +271,75 @@ static CachedEntry s_deleteEntry;
 static CachedEntry s_pendingDumpEntry;
 static bool s_pendingDump = false;
 static bool deleteFromERF(const std::string& erfPath, const std::vector<std::string>& namesToDelete) {
-    if (!fs::exists(erfPath)) return false;
-    std::vector<uint8_t> erfData;
-    {
-        std::ifstream in(erfPath, std::ios::binary | std::ios::ate);
-        if (!in) return false;
-        size_t size = in.tellg();
-        in.seekg(0);
-        erfData.resize(size);
-        in.read(reinterpret_cast<char*>(erfData.data()), size);
-    }
-    if (erfData.size() < 32) return false;
-    auto readU32 = [&](size_t offset) -> uint32_t {
-        if (offset + 4 > erfData.size()) return 0;
-        return *reinterpret_cast<uint32_t*>(&erfData[offset]);
-    };
-    auto readUtf16String = [&](size_t offset, size_t charCount) -> std::string {
-        std::string result;
-        for (size_t i = 0; i < charCount; ++i) {
-            size_t pos = offset + i * 2;
-            if (pos + 2 > erfData.size()) break;
-            uint16_t ch = *reinterpret_cast<uint16_t*>(&erfData[pos]);
-            if (ch == 0) break;
-            if (ch < 128) result += static_cast<char>(ch);
-        }
-        return result;
-    };
-    std::string magic = readUtf16String(0, 4);
-    if (magic != "ERF ") return false;
-    uint32_t fileCount = readU32(16);
-    uint32_t year = readU32(20);
-    uint32_t day = readU32(24);
-    uint32_t unknown = readU32(28);
+    ERFFile erf;
+    if (!erf.open(erfPath) || !erf.isWritable()) return false;
     std::set<std::string> deleteSet;
     for (const auto& name : namesToDelete) {
         std::string lower = name;
         std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
         deleteSet.insert(lower);
     }
-    struct FileEntry { std::string name; uint32_t offset; uint32_t size; };
-    std::vector<FileEntry> keepEntries;
-    size_t tableOffset = 32;
-    for (uint32_t i = 0; i < fileCount; ++i) {
-        size_t entryOff = tableOffset + i * 72;
-        if (entryOff + 72 > erfData.size()) break;
-        FileEntry e;
-        e.name = readUtf16String(entryOff, 32);
-        e.offset = readU32(entryOff + 64);
-        e.size = readU32(entryOff + 68);
+    bool found = false;
+    for (const auto& e : erf.entries()) {
         std::string nameLower = e.name;
         std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-        if (deleteSet.find(nameLower) == deleteSet.end()) {
-            keepEntries.push_back(e);
-        } else {
-        }
-    }
-    if (keepEntries.size() == fileCount) {
-        return false;
+        if (deleteSet.count(nameLower)) { found = true; break; }
     }
-    std::vector<uint8_t> newErf;
-    newErf.reserve(erfData.size());
-    for (int i = 0; i < 32; ++i) newErf.push_back(erfData[i]);
-    uint32_t newCount = static_cast<uint32_t>(keepEntries.size());
-    *reinterpret_cast<uint32_t*>(&newErf[16]) = newCount;
-    size_t dataStart = 32 + keepEntries.size() * 72;
-    uint32_t currentOffset = static_cast<uint32_t>(dataStart);
-    for (auto& e : keepEntries) {
-        for (size_t c = 0; c < 32; ++c) {
-            if (c < e.name.size()) {
-                newErf.push_back(static_cast<uint8_t>(e.name[c]));
-                newErf.push_back(0);
-            } else {
-                newErf.push_back(0);
-                newErf.push_back(0);
-            }
+    if (!found) return false;
+    return erf.patchEntries({}, namesToDelete);
+}
+
+static void drawBulkExtractProgress(AppState& state) {
+    if (s_bulkExtract.finished()) {
+        s_bulkExtract.wait();
+        BulkExtractor::Stats st = s_bulkExtract.stats();
+        char rate[64];
+        snprintf(rate, sizeof(rate), "%.1f MB/s, %.0f files/s", st.mbPerSecond(), st.filesPerSecond());
+        state.statusMessage = "Dumped " + std::to_string(st.files) + " files (" + rate + ")";
+        if (st.failed) {
+            state.statusMessage += ", " + std::to_string(st.failed) + " failed";
+            for (const auto& f : s_bulkExtract.failures())
+                std::cout << "[DUMP] " << f.archive << (f.name.empty() ? "" : ": " + f.name) << ": " << f.reason << std::endl;
         }
-        uint32_t newOffset = currentOffset;
-        for (int b = 0; b < 4; ++b) newErf.push_back((newOffset >> (b * 8)) & 0xFF);
-        for (int b = 0; b < 4; ++b) newErf.push_back((e.size >> (b * 8)) & 0xFF);
-        currentOffset += e.size;
+        s_bulkExtract.reset();
+        return;
     }
-    for (const auto& e : keepEntries) {
-        if (e.offset + e.size <= erfData.size()) {
-            for (uint32_t i = 0; i < e.size; ++i) {
-                newErf.push_back(erfData[e.offset + i]);
-            }
-        }
+    if (!s_bulkExtract.active()) return;
+
+    size_t done = s_bulkExtract.filesDone(), total = s_bulkExtract.filesTotal();
+    double secs = s_bulkExtract.elapsedSeconds();
+    char detail[96];
+    snprintf(detail, sizeof(detail), "%zu / %zu files, %.1f MB/s", done, total,
+             secs > 0 ? s_bulkExtract.bytesDone() / (1024.0 * 1024.0) / secs : 0.0);
+    ImVec2 center = ImGui::GetMainViewport()->GetCenter();
+    ImGui::SetNextWindowPos(center, ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::SetNextWindowSize(ImVec2(400, 0));
+    ImGui::Begin("##BulkExtract", nullptr,
+        ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
+        ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar |
+        ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Dumping files...");
+    ImGui::ProgressBar(total > 0 ? (float)done / total : 0.0f, ImVec2(-1, 0), detail);
+    if (ImGui::Button("Cancel")) {
+        s_bulkExtract.cancel();
+        state.statusMessage = "Dump cancelled after " + std::to_string(s_bulkExtract.filesDone()) + " files";
+        s_bulkExtract.reset();
     }
-    std::ofstream out(erfPath, std::ios::binary);
-    if (!out) return false;
-    out.write(reinterpret_cast<const char*>(newErf.data()), newErf.size());
-    return true;
+    ImGui::End();
 }
 
 void drawBrowserWindow(AppState& state) {
+    drawBulkExtractProgress(state);
     if (state.levelLoad.stage > 0) {
         auto& ll = state.levelLoad;
-        const int BATCH_SIZE = 8;
 
         if (ll.stage == 1) {
             buildErfIndex(state);
-            ll.terrainQueue.clear();
-            ll.propQueue.clear();
-
-            // Map every .msh entry to its (uncompressed) size so we can tell a
-            // genuine LOD variant from a chunk tile. A real LOD (X_1/2/3.msh) is
-            // smaller than its base X_0.msh; chunk tiles named *_1/_2/_3 either
-            // have no _0 sibling or are the same size as it, and must be loaded.
-            std::unordered_map<std::string, uint32_t> mshSize;
-            if (state.currentErf) {
-                for (size_t i = 0; i < state.rimEntries.size(); i++) {
-                    std::string nl = state.rimEntries[i].name;
-                    std::transform(nl.begin(), nl.end(), nl.begin(), ::tolower);
-                    if (nl.size() < 4 || nl.substr(nl.size() - 4) != ".msh") continue;
-                    size_t ei = state.rimEntries[i].entryIdx;
-                    if (ei < state.currentErf->entries().size())
-                        mshSize[nl] = state.currentErf->entries()[ei].length;
-                }
-            }
-            for (size_t i = 0; i < state.rimEntries.size(); i++) {
-                std::string nameLower = state.rimEntries[i].name;
-                std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-                if (nameLower.size() < 4 || nameLower.substr(nameLower.size() - 4) != ".msh") continue;
-
-                size_t lastUnderscore = nameLower.rfind('_');
-                if (lastUnderscore != std::string::npos && lastUnderscore + 1 < nameLower.size() - 4) {
-                    std::string lodStr = nameLower.substr(lastUnderscore + 1, nameLower.size() - 4 - lastUnderscore - 1);
-                    if (lodStr == "1" || lodStr == "2" || lodStr == "3") {
-                        std::string lod0 = nameLower.substr(0, lastUnderscore + 1) + "0.msh";
-                        auto it0 = mshSize.find(lod0);
-                        auto itN = mshSize.find(nameLower);
-                        if (it0 != mshSize.end() && itN != mshSize.end() && itN->second < it0->second)
-                            continue;   // genuine LOD variant (smaller than its LOD0) -> skip
-                    }
-                }
-                ll.terrainQueue.push_back(i);
-            }
-            ll.totalTerrain = (int)ll.terrainQueue.size();
-
-            auto collectProps = [&](ERFFile& rim) {
-                for (const auto& entry : rim.entries()) {
-                    std::string eLower = entry.name;
-                    std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
-                    if (eLower.size() < 4 || eLower.substr(eLower.size() - 4) != ".rml") continue;
-                    std::vector<uint8_t> rmlData = rim.readEntry(entry);
-                    if (rmlData.empty()) continue;
-                    RMLData rml;
-                    if (!parseRML(rmlData, rml)) continue;
-                    for (const auto& prop : rml.props) {
-                        std::string name = prop.modelFile.empty() ? prop.modelName : prop.modelFile;
-                        if (name.empty()) continue;
-                        std::string nameLow = name;
-                        std::transform(nameLow.begin(), nameLow.end(), nameLow.begin(), ::tolower);
-                        size_t lastUs = nameLow.rfind('_');
-                        if (lastUs != std::string::npos && lastUs + 1 < nameLow.size()) {
-                            std::string suffix = nameLow.substr(lastUs + 1);
-                            if (suffix == "1" || suffix == "2" || suffix == "3") continue;
-                        }
-                        AppState::PropWork pw;
-                        pw.modelName = name;
-                        pw.px = rml.roomPosX + prop.posX;
-                        pw.py = rml.roomPosY + prop.posY;
-                        pw.pz = rml.roomPosZ + prop.posZ;
-                        pw.qx = prop.orientX; pw.qy = prop.orientY;
-                        pw.qz = prop.orientZ; pw.qw = prop.orientW;
-                        pw.scale = prop.scale;
-                        ll.propQueue.push_back(pw);
-                    }
-                    for (const auto& si : rml.sptInstances) {
-                        AppState::SptWork sw;
-                        sw.treeId = si.treeId;
-                        sw.px = rml.roomPosX + si.posX;
-                        sw.py = rml.roomPosY + si.posY;
-                        sw.pz = rml.roomPosZ + si.posZ;
-                        sw.qx = si.orientX; sw.qy = si.orientY;
-                        sw.qz = si.orientZ; sw.qw = si.orientW;
-                        sw.scale = si.scale;
-                        ll.sptQueue.push_back(sw);
-                    }
-                }
-            };
-
-            collectProps(*state.currentErf);
-
-            std::string rimDir = fs::path(state.currentRIMPath).parent_path().string();
-            for (const auto& dirEntry : fs::directory_iterator(rimDir)) {
-                if (!dirEntry.is_regular_file()) continue;
-                std::string fnameLower = dirEntry.path().filename().string();
-                std::transform(fnameLower.begin(), fnameLower.end(), fnameLower.begin(), ::tolower);
-                if (fnameLower.size() > 4 && fnameLower.substr(fnameLower.size() - 4) == ".rim" &&
-                    dirEntry.path().string() != state.currentRIMPath) {
-                    ERFFile siblingRim;
-                    if (siblingRim.open(dirEntry.path().string()))
-                        collectProps(siblingRim);
-                }
-            }
+            ll.arlTreeNames.clear();
 
-            // Source the level's trees from its RIM files (the .spt live inside the
-            // area RIMs). Keyed by full stem; falls back to speedtreetools.erf if
-            // that shared library exists.
-            std::map<std::string, std::string> sptLowerToActual;
             {
-                auto scanForSpt = [&](const std::string& archivePath) {
-                    ERFFile arc;
-                    if (!arc.open(archivePath)) return;
-                    for (const auto& entry : arc.entries()) {
-                        std::string eLower = entry.name;
-                        std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
-                        if (eLower.size() > 4 && eLower.substr(eLower.size() - 4) == ".spt") {
-                            ll.sptFileToErf[entry.name] = archivePath;
-                            sptLowerToActual[eLower.substr(0, eLower.size() - 4)] = entry.name;
-                        }
-                    }
-                };
-                scanForSpt(state.currentRIMPath);
-                std::error_code ec;
-                fs::path rimDir2 = fs::path(state.currentRIMPath).parent_path();
-                if (fs::is_directory(rimDir2, ec))
-                    for (const auto& de : fs::directory_iterator(rimDir2, ec)) {
-                        if (!de.is_regular_file()) continue;
-                        std::string fnl = de.path().filename().string();
-                        std::transform(fnl.begin(), fnl.end(), fnl.begin(), ::tolower);
-                        if (fnl.size() > 4 && fnl.substr(fnl.size() - 4) == ".rim" &&
-                            fnl.find(".gpu.rim") == std::string::npos &&
-                            de.path().string() != state.currentRIMPath)
-                            scanForSpt(de.path().string());
-                    }
-                for (const auto& erfPath : state.erfFiles) {
-                    std::string fname = fs::path(erfPath).filename().string();
-                    std::transform(fname.begin(), fname.end(), fname.begin(), ::tolower);
-                    if (fname == "speedtreetools.erf") { scanForSpt(erfPath); break; }
-                }
-            }
-
-            {
-                std::string rimStem = fs::path(state.currentRIMPath).stem().string();
-                std::string rimStemLower = rimStem;
+                std::string rimStemLower = fs::path(state.currentRIMPath).stem().string();
                 std::transform(rimStemLower.begin(), rimStemLower.end(), rimStemLower.begin(), ::tolower);
-                std::string rimPrefix = rimStemLower + "_";
                 std::string arlPath;
                 for (const auto& arl : state.arlFiles) {
                     std::string arlStem = fs::path(arl).stem().string();
@@ -551,7 +353,7 @@ void drawBrowserWindow(AppState& state) {
                     if (arlIn) {
                         std::vector<uint8_t> arlData((std::istreambuf_iterator<char>(arlIn)),
                                                       std::istreambuf_iterator<char>());
-                        if (arlGff.load(arlData)) {
+                        if (arlGff.loadBorrowed(arlData)) {
                             int areaIdx = -1;
                             for (size_t si = 0; si < arlGff.structs().size(); si++) {
                                 if (std::string(arlGff.structs()[si].structType, 4) == "AREA") {
@@ -560,27 +362,10 @@ void drawBrowserWindow(AppState& state) {
                                 }
                             }
                             if (areaIdx >= 0) {
+                                // Resolved against the rims' .spt files by the pipeline.
                                 auto treeList = arlGff.readStructList(areaIdx, 3355, 0);
-                                for (int i = 0; i < (int)treeList.size(); i++) {
-                                    std::string treeName = arlGff.readStringByLabel(
-                                        treeList[i].structIndex, 3353, treeList[i].offset);
-                                    if (treeName.empty()) continue;
-                                    std::string treeNameLower = treeName;
-                                    std::transform(treeNameLower.begin(), treeNameLower.end(), treeNameLower.begin(), ::tolower);
-                                    std::string stripped = treeNameLower;
-                                    if (stripped.size() > rimPrefix.size() &&
-                                        stripped.substr(0, rimPrefix.size()) == rimPrefix) {
-                                        stripped = stripped.substr(rimPrefix.size());
-                                    }
-                                    auto it = sptLowerToActual.find(stripped);
-                                    if (it == sptLowerToActual.end())
-                                        it = sptLowerToActual.find(treeNameLower);
-                                    if (it == sptLowerToActual.end())
-                                        it = sptLowerToActual.find(rimPrefix + stripped);
-                                    if (it != sptLowerToActual.end()) {
-                                        ll.sptIdToFile[i] = it->second;
-                                    }
-                                }
+                                for (const auto& tree : treeList)
+                                    ll.arlTreeNames.push_back(arlGff.readStringByLabel(tree.structIndex, 3353, tree.offset));
 
                                 auto& env = state.envSettings;
                                 env = EnvironmentSettings();
@@ -685,51 +470,20 @@ void drawBrowserWindow(AppState& state) {
                                 }
 
                                 if (!env.skydomeModel.empty()) {
+                                    ResourceLocator::syncPackage(&state.currentErf, &state.currentErf, state.currentErf ? 1 : 0);
+                                    ResourceLocator::syncPackage(&state.modelErfs, state.modelErfs);
+                                    auto readSkyFile = [&](const std::string& name) {
+                                        ResourceRef ref = ResourceLocator::find(name, ResourceLocator::Match::Exact, &state.currentErf);
+                                        if (!ref) ref = ResourceLocator::find(name, ResourceLocator::Match::Exact, &state.modelErfs);
+                                        return ref.read();
+                                    };
                                     std::string skyMshName = env.skydomeModel + ".msh";
-                                    std::string skyMshLower = skyMshName;
-                                    std::transform(skyMshLower.begin(), skyMshLower.end(), skyMshLower.begin(), ::tolower);
-                                    std::vector<uint8_t> skyData;
-                                    if (state.currentErf) {
-                                        for (const auto& e : state.currentErf->entries()) {
-                                            std::string eLower = e.name;
-                                            std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
-                                            if (eLower == skyMshLower) { skyData = state.currentErf->readEntry(e); break; }
-                                        }
-                                    }
-                                    if (skyData.empty()) {
-                                        for (const auto& erf : state.modelErfs) {
-                                            for (const auto& e : erf->entries()) {
-                                                std::string eLower = e.name;
-                                                std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
-                                                if (eLower == skyMshLower) { skyData = erf->readEntry(e); break; }
-                                            }
-                                            if (!skyData.empty()) break;
-                                        }
-                                    }
+                                    std::vector<uint8_t> skyData = readSkyFile(skyMshName);
                                     if (!skyData.empty()) {
                                         Model skyModel;
                                         if (loadMSH(skyData, skyModel)) {
                                             std::string skyMmhName = env.skydomeModel + ".mmh";
-                                            std::string skyMmhLower = skyMmhName;
-                                            std::transform(skyMmhLower.begin(), skyMmhLower.end(), skyMmhLower.begin(), ::tolower);
-                                            std::vector<uint8_t> mmhData;
-                                            if (state.currentErf) {
-                                                for (const auto& e : state.currentErf->entries()) {
-                                                    std::string eLower = e.name;
-                                                    std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
-                                                    if (eLower == skyMmhLower) { mmhData = state.currentErf->readEntry(e); break; }
-                                                }
-                                            }
-                                            if (mmhData.empty()) {
-                                                for (const auto& erf : state.modelErfs) {
-                                                    for (const auto& e : erf->entries()) {
-                                                        std::string eLower = e.name;
-                                                        std::transform(eLower.begin(), eLower.end(), eLower.begin(), ::tolower);
-                                                        if (eLower == skyMmhLower) { mmhData = erf->readEntry(e); break; }
-                                                    }
-                                                    if (!mmhData.empty()) break;
-                                                }
-                                            }
+                                            std::vector<uint8_t> mmhData = readSkyFile(skyMmhName);
                                             if (!mmhData.empty()) {
                                                 loadMMH(mmhData, skyModel);
                                                 std::cout << "[ARL] Loaded skybox MMH, " << skyModel.meshes.size() << " meshes" << std::endl;
@@ -807,365 +561,17 @@ void drawBrowserWindow(AppState& state) {
                 }
             }
 
-            ll.totalProps = (int)ll.propQueue.size();
+            syncErfPackages(state);
 
-            {
-                std::set<uint64_t> seen;
-                std::vector<AppState::SptWork> deduped;
-                deduped.reserve(ll.sptQueue.size());
-                for (const auto& sw : ll.sptQueue) {
-                    uint32_t hx = *reinterpret_cast<const uint32_t*>(&sw.px);
-                    uint32_t hy = *reinterpret_cast<const uint32_t*>(&sw.py);
-                    uint32_t hz = *reinterpret_cast<const uint32_t*>(&sw.pz);
-                    uint64_t key = ((uint64_t)(hx ^ (hy << 16) ^ (hz >> 3)) << 32) | (uint32_t)sw.treeId;
-                    if (seen.insert(key).second)
-                        deduped.push_back(sw);
-                }
-                ll.sptQueue = std::move(deduped);
-            }
-
-            ll.totalSpt = (int)ll.sptQueue.size();
-
-            state.modelErfIndex.build(state.modelErfs);
-            state.materialErfIndex.build(state.materialErfs);
-            state.textureErfIndex.build(state.textureErfs);
-            registerErfIndex(&state.modelErfs, &state.modelErfIndex);
-            registerErfIndex(&state.materialErfs, &state.materialErfIndex);
-            registerErfIndex(&state.textureErfs, &state.textureErfIndex);
-
-            std::sort(ll.propQueue.begin(), ll.propQueue.end(),
-                [](const AppState::PropWork& a, const AppState::PropWork& b) {
-                    return a.modelName < b.modelName;
-                });
-
-            ll.itemIndex = 0;
+            s_levelPipeline.start(state);
             ll.stage = 2;
-            ll.stageLabel = "Loading terrain...";
-        }
-        else if (ll.stage == 2) {
-            if (!state.currentErf) { ll.stage = 0; ll.stageLabel = ""; }
-            else {
-            int processed = 0;
-            for (int i = ll.itemIndex; i < ll.totalTerrain && processed < BATCH_SIZE; i++) {
-                size_t rimIdx = ll.terrainQueue[i];
-                if (rimIdx < state.rimEntries.size() && state.rimEntries[rimIdx].entryIdx < state.currentErf->entries().size()) {
-                    const auto& erfEntry = state.currentErf->entries()[state.rimEntries[rimIdx].entryIdx];
-                    size_t meshCountBefore = state.currentModel.meshes.size();
-                    if (mergeModelEntry(state, erfEntry)) {
-                        // Terrain chunks whose meshes all sit at the world origin (X~0, Y~0)
-                        // are local-space and have no placement in the rim's layout, so every
-                        // chunk piles onto the origin (the "terrain stack"). Drop them; world-
-                        // space terrain (placed away from the origin) loads normally.
-                        bool unplaced = state.currentModel.meshes.size() > meshCountBefore;
-                        for (size_t mi = meshCountBefore; mi < state.currentModel.meshes.size(); mi++) {
-                            state.currentModel.meshes[mi].calculateBounds();
-                            auto c = state.currentModel.meshes[mi].center();
-                            if (c[0] > 1.0f || c[0] < -1.0f || c[1] > 1.0f || c[1] < -1.0f) { unplaced = false; break; }
-                        }
-                        if (unplaced) {
-                            state.currentModel.meshes.resize(meshCountBefore);
-                        } else {
-                            ll.terrainLoaded++;
-                            for (size_t mi = meshCountBefore; mi < state.currentModel.meshes.size(); mi++) {
-                                if (state.currentModel.meshes[mi].name.empty()) {
-                                    std::string displayName = erfEntry.name;
-                                    auto dot = displayName.rfind('.');
-                                    if (dot != std::string::npos) displayName = displayName.substr(0, dot);
-                                    state.currentModel.meshes[mi].name = displayName;
-                                }
-                            }
-                        }
-                    }
-                }
-                ll.itemIndex = i + 1;
-                processed++;
-            }
-            if (ll.itemIndex >= ll.totalTerrain) {
-                ll.itemIndex = 0;
-                ll.stage = 3;
-                ll.stageLabel = "Loading props...";
-            }
-            }
-        }
-        else if (ll.stage == 3) {
-            const int PROP_BATCH_SIZE = 32;
-            int processed = 0;
-            for (int i = ll.itemIndex; i < ll.totalProps && processed < PROP_BATCH_SIZE; i++) {
-                const auto& pw = ll.propQueue[i];
-                size_t meshCountBefore = state.currentModel.meshes.size();
-                if (mergeModelByName(state, pw.modelName, pw.px, pw.py, pw.pz,
-                                     pw.qx, pw.qy, pw.qz, pw.qw, pw.scale)) {
-                    ll.propsLoaded++;
-                    int instId = ll.nextInstanceId++;
-                    for (size_t mi = meshCountBefore; mi < state.currentModel.meshes.size(); mi++) {
-                        auto& m = state.currentModel.meshes[mi];
-                        if (m.name.empty()) {
-                            std::string displayName = pw.modelName;
-                            auto dot = displayName.rfind('.');
-                            if (dot != std::string::npos) displayName = displayName.substr(0, dot);
-                            m.name = displayName;
-                        }
-                        m.instanceRanges = { { 0u, (uint32_t)m.indices.size(), instId } };
-                    }
-                } else {
-                }
-                ll.itemIndex = i + 1;
-                processed++;
-            }
-            if (ll.itemIndex >= ll.totalProps) {
-                ll.itemIndex = 0;
-                ll.stage = 4;
-                ll.stageLabel = "Loading trees...";
-            }
-        }
-        else if (ll.stage == 4) {
-            if (!ll.sptFileToErf.empty() && !ll.sptIdToFile.empty() && !ll.sptSetupDone) {
-                std::map<std::string, std::unique_ptr<ERFFile>> openErfs;
-                auto getErf = [&](const std::string& sptFile) -> ERFFile* {
-                    auto it = ll.sptFileToErf.find(sptFile);
-                    if (it == ll.sptFileToErf.end()) return nullptr;
-                    auto& ptr = openErfs[it->second];
-                    if (!ptr) {
-                        ptr = std::make_unique<ERFFile>();
-                        if (!ptr->open(it->second)) { ptr.reset(); return nullptr; }
-                    }
-                    return ptr.get();
-                };
-
-                for (const auto& [treeId, fileName] : ll.sptIdToFile) {
-                    ERFFile* erf = getErf(fileName);
-                    if (!erf) continue;
-                    for (const auto& entry : erf->entries()) {
-                        if (entry.name == fileName) {
-                            auto sptData = erf->readEntry(entry);
-                            if (!sptData.empty()) {
-                                std::string tempDir;
-                                #ifdef _WIN32
-                                char tmp[MAX_PATH]; GetTempPathA(MAX_PATH, tmp); tempDir = tmp;
-                                #else
-                                tempDir = "/tmp/";
-                                #endif
-                                std::string tempSpt = tempDir + "haven_level_temp.spt";
-                                { std::ofstream f(tempSpt, std::ios::binary);
-                                  f.write((char*)sptData.data(), sptData.size()); }
-                                SptModel model;
-                                if (loadSptModel(tempSpt, model)) {
-                                    extractSptTextures(sptData, model);
-                                    ll.sptCache[treeId] = std::move(model);
-                                }
-                                #ifdef _WIN32
-                                DeleteFileA(tempSpt.c_str());
-                                #else
-                                remove(tempSpt.c_str());
-                                #endif
-                            }
-                            break;
-                        }
-                    }
-                }
-
-                auto stripExt = [](const std::string& s) -> std::string {
-                    size_t d = s.rfind('.');
-                    return (d != std::string::npos) ? s.substr(0, d) : s;
-                };
-
-                // Resolve a tree texture by name across the .spt's own ERF AND all
-                // of the level's loaded archives (texture/model/material/current),
-                // trying .dds/.xds/.tga. Env tree textures often aren't in the .spt's
-                // ERF, so the search must be broad.
-                auto loadTexInto = [&](Material& mat, const std::string& key, ERFFile* srcErf) {
-                    std::string keyLower = key;
-                    std::transform(keyLower.begin(), keyLower.end(), keyLower.begin(), ::tolower);
-                    std::vector<std::string> cands = {keyLower, keyLower + ".dds",
-                                                      keyLower + ".xds", keyLower + ".tga"};
-                    auto decodeInto = [&](const std::vector<uint8_t>& data) -> bool {
-                        if (data.empty()) return false;
-                        if (data.size() > 4 && data[0] == 'D' && data[1] == 'D' &&
-                            data[2] == 'S' && data[3] == ' ') {
-                            mat.diffuseTexId = createTextureFromDDS(data);
-                            decodeDDSToRGBA(data, mat.diffuseData, mat.diffuseWidth, mat.diffuseHeight);
-                            return mat.diffuseTexId != 0;
-                        }
-                        std::vector<uint8_t> rgba; int w = 0, h = 0;
-                        if (isXDS(data)) {
-                            if (!decodeXDSToRGBA(data, rgba, w, h)) return false;
-                        } else if (!decodeTGAToRGBA(data, rgba, w, h)) {
-                            return false;
-                        }
-                        mat.diffuseTexId = createTexture2D(rgba.data(), w, h);
-                        mat.diffuseData = std::move(rgba);
-                        mat.diffuseWidth = w; mat.diffuseHeight = h;
-                        return true;
-                    };
-                    auto searchErf = [&](ERFFile* e) -> bool {
-                        if (!e) return false;
-                        for (const auto& te : e->entries()) {
-                            std::string el = te.name;
-                            std::transform(el.begin(), el.end(), el.begin(), ::tolower);
-                            for (const auto& c : cands)
-                                if (el == c && decodeInto(e->readEntry(te))) return true;
-                        }
-                        return false;
-                    };
-                    if (searchErf(srcErf)) return;
-                    for (const auto& e : state.textureErfs)  if (searchErf(e.get())) return;
-                    for (const auto& e : state.modelErfs)    if (searchErf(e.get())) return;
-                    for (const auto& e : state.materialErfs) if (searchErf(e.get())) return;
-                    searchErf(state.currentErf.get());
-                };
-
-                for (const auto& [treeId, treeModel] : ll.sptCache) {
-                    auto fit = ll.sptIdToFile.find(treeId);
-                    if (fit == ll.sptIdToFile.end()) continue;
-                    std::string baseName = stripExt(fit->second);
-                    ll.sptBaseName[treeId] = baseName;
-
-                    ERFFile* erf = getErf(fit->second);
-                    std::string branchKey = treeModel.branchTexture.empty() ? baseName : stripExt(treeModel.branchTexture);
-                    int branchMatIdx = -1;
-                    for (int mi = 0; mi < (int)state.currentModel.materials.size(); mi++)
-                        if (state.currentModel.materials[mi].diffuseMap == branchKey) { branchMatIdx = mi; break; }
-                    if (branchMatIdx < 0) {
-                        Material mat;
-                        mat.name = branchKey;
-                        mat.diffuseMap = branchKey;
-                        mat.opacity = 1.0f;
-                        loadTexInto(mat, branchKey, erf);
-                        branchMatIdx = (int)state.currentModel.materials.size();
-                        state.currentModel.materials.push_back(std::move(mat));
-                    }
-                    ll.sptBranchMatIdx[treeId] = branchMatIdx;
-
-                    std::string diffuseKey = baseName + "_diffuse";
-                    int ddsMatIdx = -1;
-                    for (int mi = 0; mi < (int)state.currentModel.materials.size(); mi++)
-                        if (state.currentModel.materials[mi].diffuseMap == diffuseKey) { ddsMatIdx = mi; break; }
-                    if (ddsMatIdx < 0) {
-                        Material mat;
-                        mat.name = diffuseKey;
-                        mat.diffuseMap = diffuseKey;
-                        mat.opacity = 1.0f;
-                        // composite filename comes from the map bank; fall back to the guess
-                        loadTexInto(mat, treeModel.compositeTexture.empty() ? diffuseKey
-                                                                            : treeModel.compositeTexture, erf);
-                        ddsMatIdx = (int)state.currentModel.materials.size();
-                        state.currentModel.materials.push_back(std::move(mat));
-                    }
-                    ll.sptDdsMatIdx[treeId] = ddsMatIdx;
-                }
-                ll.sptSetupDone = true;
-            }
-            ll.itemIndex = 0;
-            ll.sptLoaded = 0;
-
-            if (!ll.sptCache.empty()) {
-                size_t estimatedNewMeshes = 0;
-                for (const auto& sw : ll.sptQueue) {
-                    auto cit = ll.sptCache.find(sw.treeId);
-                    if (cit != ll.sptCache.end())
-                        estimatedNewMeshes += cit->second.submeshes.size();
-                }
-                state.currentModel.meshes.reserve(
-                    state.currentModel.meshes.size() + estimatedNewMeshes);
-            }
-            ll.stage = 5;
-            ll.stageLabel = "Placing trees...";
         }
-        else if (ll.stage == 5) {
-
-            const int SPT_BATCH_SIZE = 200;
-            if (!ll.sptSetupDone || ll.sptCache.empty()) {
-                ll.stage = 6;
-                ll.stageLabel = "Loading materials & textures...";
-            } else {
-                const char* typeNames[] = {"Branch", "Frond", "LeafCard", "LeafMesh"};
-                int processed = 0;
-                for (int i = ll.itemIndex; i < (int)ll.sptQueue.size() && processed < SPT_BATCH_SIZE; i++) {
-                    const auto& sw = ll.sptQueue[i];
-                    auto cit = ll.sptCache.find(sw.treeId);
-                    if (cit == ll.sptCache.end()) {
-                        ll.itemIndex = i + 1;
-                        processed++;
-                        continue;
-                    }
-
-                    float qx = sw.qx, qy = sw.qy, qz = sw.qz, qw = sw.qw;
-                    float qlen = std::sqrt(qx*qx + qy*qy + qz*qz + qw*qw);
-                    if (qlen > 0.00001f) { qx/=qlen; qy/=qlen; qz/=qlen; qw/=qlen; }
-
-                    const std::string& baseName = ll.sptBaseName[sw.treeId];
-                    int branchMatIdx = ll.sptBranchMatIdx[sw.treeId];
-                    int ddsMatIdx = ll.sptDdsMatIdx[sw.treeId];
-                    int instId = ll.nextInstanceId++;
-
-                    for (int si = 0; si < (int)cit->second.submeshes.size(); si++) {
-                        const auto& sm = cit->second.submeshes[si];
-                        if (sm.vertexCount() == 0) continue;
-
-                        Mesh mesh;
-                        mesh.name = baseName + "_" + typeNames[(int)sm.type];
-                        mesh.objectId = baseName;
-                        if (sm.type == SptSubmeshType::Branch) {
-                            mesh.materialIndex = branchMatIdx;
-                            mesh.materialName = state.currentModel.materials[branchMatIdx].name;
-                            mesh.alphaTest = false;
-                        } else {
-                            mesh.materialIndex = ddsMatIdx;
-                            mesh.materialName = state.currentModel.materials[ddsMatIdx].name;
-                            mesh.alphaTest = true;
-                        }
-
-                        uint32_t nv = sm.vertexCount();
-                        mesh.vertices.resize(nv);
-                        for (uint32_t vi = 0; vi < nv; vi++) {
-                            float lx = sm.positions[vi*3+0] * sw.scale;
-                            float ly = sm.positions[vi*3+1] * sw.scale;
-                            float lz = sm.positions[vi*3+2] * sw.scale;
-                            float tx = 2.0f*(qy*lz - qz*ly);
-                            float ty = 2.0f*(qz*lx - qx*lz);
-                            float tz = 2.0f*(qx*ly - qy*lx);
-
-                            auto& v = mesh.vertices[vi];
-                            v.x = lx + qw*tx + (qy*tz - qz*ty) + sw.px;
-                            v.y = ly + qw*ty + (qz*tx - qx*tz) + sw.py;
-                            v.z = lz + qw*tz + (qx*ty - qy*tx) + sw.pz;
-
-                            float nx = sm.normals[vi*3+0];
-                            float ny = sm.normals[vi*3+1];
-                            float nz = sm.normals[vi*3+2];
-                            float tnx = 2.0f*(qy*nz - qz*ny);
-                            float tny = 2.0f*(qz*nx - qx*nz);
-                            float tnz = 2.0f*(qx*ny - qy*nx);
-                            v.nx = nx + qw*tnx + (qy*tnz - qz*tny);
-                            v.ny = ny + qw*tny + (qz*tnx - qx*tnz);
-                            v.nz = nz + qw*tnz + (qx*tny - qy*tnx);
-                            v.u = sm.texcoords[vi*2+0];
-                            v.v = sm.texcoords[vi*2+1];
-                        }
-                        mesh.indices = sm.indices;
-                        mesh.instanceRanges = { { 0u, (uint32_t)sm.indices.size(), instId } };
-                        mesh.calculateBounds();
-                        state.currentModel.meshes.push_back(std::move(mesh));
-                    }
-                    ll.sptLoaded++;
-                    ll.itemIndex = i + 1;
-                    processed++;
-                }
-
-                if (ll.itemIndex >= (int)ll.sptQueue.size()) {
-                    ll.sptCache.clear();
-                    ll.sptBranchMatIdx.clear();
-                    ll.sptDdsMatIdx.clear();
-                    ll.sptBaseName.clear();
-
-                    ll.stage = 6;
-                    ll.stageLabel = "Loading materials & textures...";
-                }
-            }
-        }
-        else if (ll.stage == 6) {
-            finalizeLevelMaterials(state);
-            mergeLevelInstances(state.currentModel);  // combine identical-object instances into one mesh each
+        else if (ll.stage == 2 && s_levelPipeline.pumpUploads(8.0)) {
+            Model level;
+            s_levelPipeline.take(level, ll);
+            state.currentModel.meshes = std::move(level.meshes);
+            state.currentModel.materials = std::move(level.materials);
+            state.renderSettings.initMeshVisibility(state.currentModel.meshes.size());
             bakeLevelBuffers(state.currentModel);
 
             if (!state.currentModel.meshes.empty()) {
@@ -1197,37 +603,29 @@ void drawBrowserWindow(AppState& state) {
                 }
             }
 
+            const auto& t = s_levelPipeline.timings();
+            std::cout << "[LEVEL] Loaded in " << (int)t.total << " ms (scan " << (int)t.scan
+                      << ", terrain " << (int)t.terrain << ", props " << (int)t.props
+                      << ", trees " << (int)t.trees << ", materials " << (int)t.materials
+                      << ", merge " << (int)t.merge << ")" << std::endl;
             state.statusMessage = "Loaded level: " + std::to_string(ll.terrainLoaded) + " terrain, " +
                 std::to_string(ll.propsLoaded) + " props (" +
                 std::to_string(ll.totalProps - ll.propsLoaded) + " missing), " +
                 std::to_string(ll.sptLoaded) + " trees, " +
                 std::to_string(state.currentModel.materials.size()) + " materials";
             state.showRenderSettings = true;
-            clearErfIndices();
             ll.stage = 0;
         }
 
         if (ll.stage > 0) {
+            std::string label = ll.stageLabel;
             float progress = 0.0f;
             std::string detail;
-            if (ll.stage == 1) {
-                progress = 0.0f;
-                detail = "Scanning level data...";
-            } else if (ll.stage == 2) {
-                progress = ll.totalTerrain > 0 ? (float)ll.itemIndex / ll.totalTerrain : 0.0f;
-                detail = std::to_string(ll.itemIndex) + " / " + std::to_string(ll.totalTerrain) + " terrain";
-            } else if (ll.stage == 3) {
-                progress = ll.totalProps > 0 ? (float)ll.itemIndex / ll.totalProps : 0.0f;
-                detail = std::to_string(ll.itemIndex) + " / " + std::to_string(ll.totalProps) + " props";
-            } else if (ll.stage == 4) {
-                progress = 0.3f;
-                detail = "Setting up " + std::to_string(ll.sptIdToFile.size()) + " tree types...";
-            } else if (ll.stage == 5) {
-                progress = ll.totalSpt > 0 ? (float)ll.itemIndex / ll.totalSpt : 0.5f;
-                detail = std::to_string(ll.sptLoaded) + " / " + std::to_string(ll.totalSpt) + " trees";
-            } else if (ll.stage == 6) {
-                progress = 1.0f;
-                detail = "Finalizing...";
+            if (ll.stage == 2) {
+                label = s_levelPipeline.stageLabel();
+                int done = s_levelPipeline.itemsDone(), total = s_levelPipeline.itemsTotal();
+                progress = total > 0 ? (float)done / total : 0.0f;
+                if (total > 0) detail = std::to_string(done) + " / " + std::to_string(total);
             }
 
             ImVec2 center = ImGui::GetMainViewport()->GetCenter();
@@ -1237,8 +635,13 @@ void drawBrowserWindow(AppState& state) {
                 ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
                 ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar |
                 ImGuiWindowFlags_AlwaysAutoResize);
-            ImGui::Text("%s", ll.stageLabel.c_str());
+            ImGui::Text("%s", label.c_str());
             ImGui::ProgressBar(progress, ImVec2(-1, 0), detail.c_str());
+            if (ll.stage == 2 && ImGui::Button("Cancel")) {
+                s_levelPipeline.cancel();
+                ll = {};
+                state.statusMessage = "Level load cancelled";
+            }
             ImGui::End();
         }
         return;
@@ -1844,6 +1247,7 @@ void drawBrowserWindow(AppState& state) {
                 ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Playing: %s", state.currentAudioName.c_str());
             }
         } else {
+            ImGui::BeginDisabled(s_bulkExtract.active());
             if (ImGui::Button("Dump all files")) {
                 IGFD::FileDialogConfig config;
                 #ifdef _WIN32
@@ -1857,6 +1261,7 @@ void drawBrowserWindow(AppState& state) {
                 #endif
                 ImGuiFileDialog::Instance()->OpenDialog("DumpAllFiles", "Select Output Folder", nullptr, config);
             }
+            ImGui::EndDisabled();
             if (hasTextures) {
                 ImGui::SameLine();
                 if (ImGui::Button("Dump Textures")) {
@@ -2243,6 +1648,7 @@ void drawBrowserWindow(AppState& state) {
                 bool isRimClick = (state.selectedErfName == "[Env]" && ce.entryIdx == 0);
                 if (isRimClick) {
                     if (state.levelLoad.stage != 0) {
+                        s_levelPipeline.cancel();
                         state.levelLoad.stage = 0;
                         state.levelLoad.stageLabel = "";
                     }
@@ -2465,7 +1871,7 @@ void drawBrowserWindow(AppState& state) {
                                     if (!data.empty()) {
                                         std::string nameLower = ce.name;
                                         std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-                                        state.textureCache[nameLower] = data;
+                                        state.textureCache.set(nameLower, data);
                                         bool isTga = nameLower.size() > 4 && nameLower.substr(nameLower.size() - 4) == ".tga";
                                         if (isTga) {
                                             std::vector<uint8_t> rgba; int w, h;
@@ -2486,9 +1892,10 @@ void drawBrowserWindow(AppState& state) {
                                 } else if (isGda) {
                                     auto data = erf.readEntry(entry);
                                     if (!data.empty()) {
-                                        delete state.gdaEditor.editor;
+                                        closeGdaEditorTable(state.gdaEditor);
                                         state.gdaEditor.editor = new GDAFile();
                                         if (state.gdaEditor.editor->load(data, ce.name)) {
+                                            attachGdaMergedView(state, ce.name);
                                             state.gdaEditor.currentFile = state.erfFiles[ce.erfIdx] + ":" + ce.name;
                                             state.gdaEditor.selectedRow = -1;
                                             state.gdaEditor.statusMessage = "Loaded: " + ce.name;
@@ -2496,8 +1903,7 @@ void drawBrowserWindow(AppState& state) {
                                             state.statusMessage = "Opened GDA: " + ce.name;
                                         } else {
                                             state.gdaEditor.statusMessage = "Failed to parse GDA";
-                                            delete state.gdaEditor.editor;
-                                            state.gdaEditor.editor = nullptr;
+                                            closeGdaEditorTable(state.gdaEditor);
                                         }
                                     }
                                 } else if (isGff) {
@@ -2930,6 +2336,7 @@ void drawBrowserWindow(AppState& state) {
                 state.selectedRIMEntry = -1;
             }
             ImGui::SameLine();
+            ImGui::BeginDisabled(s_bulkExtract.active());
             if (ImGui::Button("Dump All")) {
                 IGFD::FileDialogConfig config;
                 #ifdef _WIN32
@@ -2943,6 +2350,7 @@ void drawBrowserWindow(AppState& state) {
                 #endif
                 ImGuiFileDialog::Instance()->OpenDialog("DumpAllRIM", "Select Output Folder", nullptr, config);
             }
+            ImGui::EndDisabled();
 
             int mshCount = 0;
             for (const auto& re : state.rimEntries) {
@@ -2967,10 +2375,6 @@ void drawBrowserWindow(AppState& state) {
                         state.modelErfs.clear();
                         state.materialErfs.clear();
                         clearPropCache();
-                        clearErfIndices();
-                        state.modelErfIndex.clear();
-                        state.materialErfIndex.clear();
-                        state.textureErfIndex.clear();
                         ensureBaseErfsLoaded(state);
 
                         auto rimForModel = std::make_unique<ERFFile>();
@@ -3157,7 +2561,7 @@ void drawBrowserWindow(AppState& state) {
                                         if (!data.empty()) {
                                             std::string nameLower = re.name;
                                             std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-                                            state.textureCache[nameLower] = data;
+                                            state.textureCache.set(nameLower, data);
                                             bool isTga = nameLower.size() > 4 && nameLower.substr(nameLower.size() - 4) == ".tga";
                                             if (isTga) {
                                                 std::vector<uint8_t> rgba; int w, h;
@@ -3342,29 +2746,21 @@ void drawBrowserWindow(AppState& state) {
     if (ImGuiFileDialog::Instance()->Display("DumpAllFiles", ImGuiWindowFlags_NoCollapse, ImVec2(500, 400))) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             std::string outDir = ImGuiFileDialog::Instance()->GetCurrentPath();
-            int count = 0;
-            std::map<size_t, std::vector<size_t>> entriesByErf;
-            for(const auto& ce : state.mergedEntries) {
-                 if (ce.name.find("__HEADER__") == 0) continue;
-                 entriesByErf[ce.erfIdx].push_back(ce.entryIdx);
-            }
-            for(const auto& [erfIdx, entryIndices] : entriesByErf) {
-                if(erfIdx >= state.erfFiles.size()) continue;
-                ERFFile erf;
-                if(erf.open(state.erfFiles[erfIdx])) {
-                    for(size_t entryIdx : entryIndices) {
-                        if(entryIdx < erf.entries().size()) {
-                            const auto& entry = erf.entries()[entryIdx];
-                            std::string outPath = outDir + "/" + entry.name;
-                            if(erf.extractEntry(entry, outPath)) {
-                                count++;
-                            }
-                        }
-                    }
-                    erf.close();
+            if (s_bulkExtract.active()) {
+                // The dialog was opened before the running dump started.
+                state.statusMessage = "A dump is already running";
+            } else {
+                std::map<size_t, std::vector<size_t>> entriesByErf;
+                for(const auto& ce : state.mergedEntries) {
+                     if (ce.name.find("__HEADER__") == 0) continue;
+                     entriesByErf[ce.erfIdx].push_back(ce.entryIdx);
                 }
+                for(auto& [erfIdx, entryIndices] : entriesByErf) {
+                    if(erfIdx >= state.erfFiles.size()) continue;
+                    s_bulkExtract.addEntries(state.erfFiles[erfIdx], std::move(entryIndices));
+                }
+                s_bulkExtract.start(outDir);
             }
-            state.statusMessage = "Dumped " + std::to_string(count) + " files.";
         }
         ImGuiFileDialog::Instance()->Close();
     }
@@ -3405,6 +2801,7 @@ void drawBrowserWindow(AppState& state) {
                     break;
                 }
             }
+            if (deletedCount > 0) invalidateGdaMergedViews(state);
             unmarkModelAsImported(s_deleteModelName);
             std::string currentModelLower = state.currentModel.name;
             std::transform(currentModelLower.begin(), currentModelLower.end(), currentModelLower.begin(), ::tolower);
@@ -3460,15 +2857,12 @@ void drawBrowserWindow(AppState& state) {
     if (ImGuiFileDialog::Instance()->Display("DumpAllRIM", ImGuiWindowFlags_NoCollapse, ImVec2(500, 400))) {
         if (ImGuiFileDialog::Instance()->IsOk()) {
             std::string outDir = ImGuiFileDialog::Instance()->GetCurrentPath();
-            ERFFile rimErf;
-            int count = 0;
-            if (rimErf.open(state.currentRIMPath)) {
-                for (const auto& entry : rimErf.entries()) {
-                    std::string outPath = outDir + "/" + entry.name;
-                    if (rimErf.extractEntry(entry, outPath)) count++;
-                }
+            if (s_bulkExtract.active()) {
+                state.statusMessage = "A dump is already running";
+            } else {
+                s_bulkExtract.addArchive(state.currentRIMPath);
+                s_bulkExtract.start(outDir);
             }
-            state.statusMessage = "Dumped " + std::to_string(count) + " files from RIM";
         }
         ImGuiFileDialog::Instance()->Close();
     }
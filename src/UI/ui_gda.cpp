@@ -1,10 +1,230 @@
 #include "ui_internal.h"
+#include "gda_query.h"
 
 GDAEditorState::~GDAEditorState() {
+    delete query;
+    query = nullptr;
     delete editor;
     editor = nullptr;
 }
 
+void closeGdaEditorTable(GDAEditorState& ed) {
+    delete ed.query;
+    ed.query = nullptr;
+    delete ed.editor;
+    ed.editor = nullptr;
+    ed.worksheet.clear();
+    ed.merged.reset();
+    ed.showMerged = false;
+    ed.visibleRows.clear();
+    ed.rowsDirty = true;
+    GDAViewCache::clear();
+}
+
+static void loadGdaMergedView(AppState& state) {
+    GDAEditorState& ed = state.gdaEditor;
+    ed.merged.reset();
+    ed.rowsDirty = true;
+    if (ed.worksheet.empty()) return;
+    std::string baseName = ed.worksheet + ".gda";
+    std::string prefix = ed.worksheet + "_";
+
+    // Only the browsed archives that hold a table of this worksheet.
+    std::set<size_t> erfIdx;
+    for (const auto& ce : state.mergedEntries) {
+        if (!(ce.flags & CachedEntry::FLAG_GDA) || ce.erfIdx >= state.erfFiles.size()) continue;
+        std::string name = ce.name;
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name == baseName || name.compare(0, prefix.size(), prefix) == 0) erfIdx.insert(ce.erfIdx);
+    }
+    // The view keeps its own copies of the tables, so the archives are
+    // only open while it's looked up.
+    std::vector<std::unique_ptr<ERFFile>> archives;
+    for (size_t i : erfIdx) {
+        auto erf = std::make_unique<ERFFile>();
+        if (erf->open(state.erfFiles[i])) archives.push_back(std::move(erf));
+    }
+    auto view = GDAViewCache::get(ed.worksheet, archives);
+    if (view && view->sourceCount() > 1) ed.merged = std::move(view);
+    if (!ed.merged) ed.showMerged = false;
+}
+
+void attachGdaMergedView(AppState& state, const std::string& gdaName) {
+    GDAEditorState& ed = state.gdaEditor;
+    delete ed.query;
+    ed.query = new GDAQuery(*ed.editor);
+    ed.showMerged = false;
+
+    std::string worksheet = gdaName;
+    size_t sl = worksheet.find_last_of("/\\");
+    if (sl != std::string::npos) worksheet = worksheet.substr(sl + 1);
+    std::transform(worksheet.begin(), worksheet.end(), worksheet.begin(), ::tolower);
+    if (worksheet.size() > 4 && worksheet.compare(worksheet.size() - 4, 4, ".gda") == 0)
+        worksheet.resize(worksheet.size() - 4);
+    ed.worksheet = worksheet;
+    loadGdaMergedView(state);
+}
+
+void invalidateGdaMergedViews(AppState& state) {
+    GDAViewCache::clear();
+    if (state.gdaEditor.editor) loadGdaMergedView(state);
+}
+
+// Parses "column=value" and "column=low..high" terms, separated by spaces.
+// Fails unless every term names a column and a value of its type.
+static bool parseGdaFilters(const std::string& text, const std::vector<GDAColumn>& columns,
+                            std::vector<GDAFilter>& out) {
+    std::istringstream terms(text);
+    std::string term;
+    while (terms >> term) {
+        size_t eq = term.find('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == term.size()) return false;
+        uint32_t hash = GDAFile::hashColumnName(term.substr(0, eq));
+        size_t col = 0;
+        while (col < columns.size() && columns[col].hash != hash) col++;
+        if (col == columns.size()) return false;
+        std::string value = term.substr(eq + 1);
+        GDAType type = columns[col].type;
+
+        auto parseNumber = [](const std::string& s, double& v) {
+            char* end = nullptr;
+            v = std::strtod(s.c_str(), &end);
+            return !s.empty() && *end == '\0';
+        };
+        size_t dots = value.find("..");
+        if (dots != std::string::npos) {
+            double lo, hi;
+            if (type != GDAType::Int && type != GDAType::Float) return false;
+            if (!parseNumber(value.substr(0, dots), lo) || !parseNumber(value.substr(dots + 2), hi)) return false;
+            out.push_back(GDAFilter::range(col, lo, hi));
+            continue;
+        }
+        double v;
+        switch (type) {
+            case GDAType::Int:
+                if (!parseNumber(value, v) || v != std::floor(v) ||
+                    v < static_cast<double>(INT32_MIN) || v > static_cast<double>(INT32_MAX))
+                    return false;
+                out.push_back(GDAFilter::equal(col, static_cast<int32_t>(v)));
+                break;
+            case GDAType::Float:
+                if (!parseNumber(value, v)) return false;
+                out.push_back(GDAFilter::equal(col, static_cast<float>(v)));
+                break;
+            case GDAType::Bool:
+                if (value == "1" || value == "true") out.push_back(GDAFilter::equal(col, true));
+                else if (value == "0" || value == "false") out.push_back(GDAFilter::equal(col, false));
+                else return false;
+                break;
+            default:
+                out.push_back(GDAFilter::equal(col, value));
+                break;
+        }
+    }
+    return !out.empty();
+}
+
+// Case-insensitive substring match over string, resource and int cells.
+template <typename Table>
+static std::vector<uint32_t> matchGdaText(const Table& table, const std::string& text) {
+    std::string filterLower = text;
+    std::transform(filterLower.begin(), filterLower.end(), filterLower.begin(), ::tolower);
+    const auto& columns = table.columns();
+    std::vector<uint32_t> rows;
+    for (size_t rowIdx = 0; rowIdx < table.rowCount(); rowIdx++) {
+        bool match = false;
+        for (size_t colIdx = 0; colIdx < columns.size() && !match; colIdx++) {
+            GDAType type = columns[colIdx].type;
+            bool missing = table.isMissing(rowIdx, colIdx);
+            if (missing || type == GDAType::String || type == GDAType::Resource) {
+                std::string strLower = std::get<std::string>(table.value(rowIdx, colIdx));
+                std::transform(strLower.begin(), strLower.end(), strLower.begin(), ::tolower);
+                match = strLower.find(filterLower) != std::string::npos;
+            } else if (type == GDAType::Int) {
+                match = std::to_string(std::get<int32_t>(table.value(rowIdx, colIdx))).find(filterLower) != std::string::npos;
+            }
+        }
+        if (match) rows.push_back(static_cast<uint32_t>(rowIdx));
+    }
+    return rows;
+}
+
+static void rebuildGdaRows(GDAEditorState& ed) {
+    const bool merged = ed.showMerged && ed.merged;
+    const std::string filter = ed.rowFilter;
+    const auto& columns = merged ? ed.merged->columns() : ed.editor->columns();
+    size_t rowCount = merged ? ed.merged->rowCount() : ed.editor->rowCount();
+
+    std::vector<GDAFilter> filters;
+    if (filter.find_first_not_of(' ') == std::string::npos) {
+        ed.visibleRows.resize(rowCount);
+        for (size_t i = 0; i < rowCount; i++) ed.visibleRows[i] = static_cast<uint32_t>(i);
+    } else if (parseGdaFilters(filter, columns, filters)) {
+        if (merged) {
+            ed.visibleRows = ed.merged->select(filters);
+        } else {
+            // Editing the value re-runs the filter, so keep an index behind it.
+            for (const auto& f : filters) ed.query->addIndex(f.column);
+            ed.visibleRows = ed.query->select(filters);
+        }
+    } else {
+        ed.visibleRows = merged ? matchGdaText(*ed.merged, filter) : matchGdaText(*ed.editor, filter);
+    }
+    ed.appliedFilter = filter;
+    ed.rowsDirty = false;
+}
+
+template <typename Table>
+static void drawGdaTable(const Table& table, const std::vector<uint32_t>& rows) {
+    const auto& columns = table.columns();
+
+    ImGuiTableFlags tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                 ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX |
+                                 ImGuiTableFlags_ScrollY | ImGuiTableFlags_Hideable;
+
+    int numCols = static_cast<int>(columns.size());
+    if (numCols == 0) numCols = 1;
+
+    if (ImGui::BeginTable("GDATable", numCols, tableFlags)) {
+        for (const auto& col : columns) {
+            ImGui::TableSetupColumn(col.name.c_str());
+        }
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableHeadersRow();
+
+        drawVirtualList(static_cast<int>(rows.size()), [&](int i) {
+            size_t rowIdx = rows[i];
+            ImGui::TableNextRow();
+
+            for (size_t colIdx = 0; colIdx < columns.size(); colIdx++) {
+                ImGui::TableNextColumn();
+
+                if (table.isMissing(rowIdx, colIdx)) {
+                    ImGui::TextUnformatted("****");
+                    continue;
+                }
+                GDAValue v = table.value(rowIdx, colIdx);
+                switch (columns[colIdx].type) {
+                    case GDAType::Int:
+                        ImGui::Text("%d", std::get<int32_t>(v));
+                        break;
+                    case GDAType::Float:
+                        ImGui::Text("%.4f", std::get<float>(v));
+                        break;
+                    case GDAType::Bool:
+                        ImGui::Text("%s", std::get<bool>(v) ? "1" : "0");
+                        break;
+                    default:
+                        ImGui::TextUnformatted(std::get<std::string>(v).c_str());
+                        break;
+                }
+            }
+        });
+
+        ImGui::EndTable();
+    }
+}
+
 void draw2DAEditorWindow(AppState& state) {
     if (!state.gdaEditor.showWindow) return;
 
@@ -15,8 +235,7 @@ void draw2DAEditorWindow(AppState& state) {
         if (ImGui::BeginMenuBar()) {
             if (ImGui::BeginMenu("File")) {
                 if (ImGui::MenuItem("Close", nullptr, false, state.gdaEditor.editor != nullptr)) {
-                    delete state.gdaEditor.editor;
-                    state.gdaEditor.editor = nullptr;
+                    closeGdaEditorTable(state.gdaEditor);
                     state.gdaEditor.currentFile.clear();
                     state.gdaEditor.selectedRow = -1;
                 }
@@ -25,77 +244,26 @@ void draw2DAEditorWindow(AppState& state) {
             ImGui::EndMenuBar();
         }
 
-        if (state.gdaEditor.editor && state.gdaEditor.editor->isLoaded()) {
-            const auto& columns = state.gdaEditor.editor->columns();
-            const auto& rows = state.gdaEditor.editor->rows();
-
-            ImGui::InputText("Filter", state.gdaEditor.rowFilter, sizeof(state.gdaEditor.rowFilter));
-            ImGui::SameLine();
-            ImGui::Text("%zu rows", rows.size());
-
-            std::string filterLower = state.gdaEditor.rowFilter;
-            std::transform(filterLower.begin(), filterLower.end(), filterLower.begin(), ::tolower);
-
-            ImGuiTableFlags tableFlags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
-                                         ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX |
-                                         ImGuiTableFlags_ScrollY | ImGuiTableFlags_Hideable;
+        if (state.gdaEditor.editor && state.gdaEditor.editor->isLoaded() && state.gdaEditor.query) {
+            GDAEditorState& ed = state.gdaEditor;
 
-            int numCols = static_cast<int>(columns.size());
-            if (numCols == 0) numCols = 1;
+            ImGui::InputText("Filter", ed.rowFilter, sizeof(ed.rowFilter));
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Text matches any cell.\ncolumn=value and column=low..high select by column,\ne.g. ID=120 or COST=10..50");
+            if (ed.merged) {
+                ImGui::SameLine();
+                std::string label = "Merge M2DA (" + std::to_string(ed.merged->sourceCount()) + " tables)";
+                if (ImGui::Checkbox(label.c_str(), &ed.showMerged)) ed.rowsDirty = true;
+            }
+            if (ed.rowsDirty || ed.appliedFilter != ed.rowFilter) rebuildGdaRows(ed);
 
-            if (ImGui::BeginTable("GDATable", numCols, tableFlags)) {
-                for (const auto& col : columns) {
-                    ImGui::TableSetupColumn(col.name.c_str());
-                }
-                ImGui::TableSetupScrollFreeze(1, 1);
-                ImGui::TableHeadersRow();
-
-                for (size_t rowIdx = 0; rowIdx < rows.size(); rowIdx++) {
-                    const auto& row = rows[rowIdx];
-
-                    if (!filterLower.empty()) {
-                        bool match = false;
-                        for (const auto& val : row.values) {
-                            if (std::holds_alternative<std::string>(val)) {
-                                std::string strLower = std::get<std::string>(val);
-                                std::transform(strLower.begin(), strLower.end(), strLower.begin(), ::tolower);
-                                if (strLower.find(filterLower) != std::string::npos) {
-                                    match = true;
-                                    break;
-                                }
-                            } else if (std::holds_alternative<int32_t>(val)) {
-                                if (std::to_string(std::get<int32_t>(val)).find(filterLower) != std::string::npos) {
-                                    match = true;
-                                    break;
-                                }
-                            }
-                        }
-                        if (!match) continue;
-                    }
-
-                    ImGui::TableNextRow();
-
-                    for (size_t colIdx = 0; colIdx < columns.size(); colIdx++) {
-                        ImGui::TableNextColumn();
-
-                        if (colIdx < row.values.size()) {
-                            const auto& val = row.values[colIdx];
-
-                            if (std::holds_alternative<int32_t>(val)) {
-                                ImGui::Text("%d", std::get<int32_t>(val));
-                            } else if (std::holds_alternative<float>(val)) {
-                                ImGui::Text("%.4f", std::get<float>(val));
-                            } else if (std::holds_alternative<std::string>(val)) {
-                                ImGui::TextUnformatted(std::get<std::string>(val).c_str());
-                            } else if (std::holds_alternative<bool>(val)) {
-                                ImGui::Text("%s", std::get<bool>(val) ? "1" : "0");
-                            }
-                        }
-                    }
-                }
+            size_t rowCount = (ed.showMerged && ed.merged) ? ed.merged->rowCount() : ed.editor->rowCount();
+            ImGui::SameLine();
+            if (ed.visibleRows.size() == rowCount) ImGui::Text("%zu rows", rowCount);
+            else ImGui::Text("%zu of %zu rows", ed.visibleRows.size(), rowCount);
 
-                ImGui::EndTable();
-            }
+            if (ed.showMerged && ed.merged) drawGdaTable(*ed.merged, ed.visibleRows);
+            else drawGdaTable(*ed.editor, ed.visibleRows);
         } else {
             ImGui::TextWrapped(
                 "No GDA file loaded.\n\n"
@@ -106,4 +274,4 @@ void draw2DAEditorWindow(AppState& state) {
         }
     }
     ImGui::End();
-}
\ No newline at end of file
+}
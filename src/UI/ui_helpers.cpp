@@ -1,5 +1,6 @@
 #include "ui_internal.h"
 #include "model_names_csv.h"
+#include "resource_locator.h"
 
 // Helper: create GL texture from raw data (DDS, XDS, or TGA), with optional RGBA extraction
 static uint32_t createTextureAny(const std::vector<uint8_t>& data,
@@ -17,33 +18,6 @@ static uint32_t createTextureAny(const std::vector<uint8_t>& data,
     return createTextureFromDDS(data);
 }
 
-void ErfEntryIndex::build(const std::vector<std::unique_ptr<ERFFile>>& erfs) {
-    exact.clear();
-    basename.clear();
-    noext.clear();
-    size_t total = 0;
-    for (const auto& erf : erfs) total += erf->entries().size();
-    exact.reserve(total);
-    basename.reserve(total);
-    noext.reserve(total);
-    for (size_t ei = 0; ei < erfs.size(); ei++) {
-        const auto& entries = erfs[ei]->entries();
-        for (size_t enti = 0; enti < entries.size(); enti++) {
-            std::string entryLower = entries[enti].name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            exact.try_emplace(entryLower, ei, enti);
-            std::string base = entryLower;
-            size_t sl = base.find_last_of("/\\");
-            if (sl != std::string::npos) base = base.substr(sl + 1);
-            basename.try_emplace(base, ei, enti);
-            std::string ne = base;
-            size_t dp = ne.rfind('.');
-            if (dp != std::string::npos) ne = ne.substr(0, dp);
-            noext.try_emplace(ne, ei, enti);
-        }
-    }
-    built = true;
-}
 static size_t lastMeshCacheSize = 0;
 void loadMeshDatabase(AppState& state) {
     bool needsCacheUpdate = (state.meshCache.size() != lastMeshCacheSize);
@@ -219,108 +193,21 @@ std::vector<std::pair<std::string, std::string>> findAssociatedEyes(AppState& st
 std::vector<uint8_t> readFromCache(AppState& state, const std::string& name, const std::string& ext) {
     std::string nameLower = name;
     std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-    if (ext == ".msh") {
-        auto it = state.meshCache.find(nameLower);
-        if (it != state.meshCache.end()) return it->second;
-    } else if (ext == ".mmh") {
-        auto it = state.mmhCache.find(nameLower);
-        if (it != state.mmhCache.end()) return it->second;
-    } else if (ext == ".mao") {
-        auto it = state.maoCache.find(nameLower);
-        if (it != state.maoCache.end()) return it->second;
-    } else if (ext == ".dds") {
-        auto it = state.textureCache.find(nameLower);
-        if (it != state.textureCache.end()) return it->second;
+    const BlobMap* cache = ext == ".msh" ? &state.meshCache :
+                           ext == ".mmh" ? &state.mmhCache :
+                           ext == ".mao" ? &state.maoCache :
+                           ext == ".dds" ? &state.textureCache : nullptr;
+    if (cache) {
+        if (const auto* data = cache->find(nameLower)) return *data;
     }
     const auto& erfs = (ext == ".msh" || ext == ".mmh") ? state.modelErfs :
                        (ext == ".mao") ? state.materialErfs : state.textureErfs;
-    const ErfEntryIndex& idx = (ext == ".msh" || ext == ".mmh") ? state.modelErfIndex :
-                               (ext == ".mao") ? state.materialErfIndex : state.textureErfIndex;
-    if (idx.built) {
-        auto eit = idx.exact.find(nameLower);
-        if (eit != idx.exact.end()) {
-            auto [ei, enti] = eit->second;
-            if (ei < erfs.size() && enti < erfs[ei]->entries().size())
-                return erfs[ei]->readEntry(erfs[ei]->entries()[enti]);
-        }
-        return {};
-    }
-    for (const auto& erf : erfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == nameLower) {
-                return erf->readEntry(entry);
-            }
-        }
-    }
-    return {};
-}
-static std::unordered_map<uintptr_t, const ErfEntryIndex*> g_erfIndexRegistry;
-void registerErfIndex(const void* erfsPtr, const ErfEntryIndex* index) {
-    g_erfIndexRegistry[reinterpret_cast<uintptr_t>(erfsPtr)] = index;
-}
-void clearErfIndices() {
-    g_erfIndexRegistry.clear();
+    ResourceLocator::syncPackage(&erfs, erfs);
+    return ResourceLocator::find(nameLower, ResourceLocator::Match::Exact, &erfs).read();
 }
 std::vector<uint8_t> readFromErfs(const std::vector<std::unique_ptr<ERFFile>>& erfs, const std::string& name) {
-    std::string nameLower = name;
-    std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
-    std::string baseNameLower = nameLower;
-    size_t lastSlash = baseNameLower.find_last_of("/\\");
-    if (lastSlash != std::string::npos) baseNameLower = baseNameLower.substr(lastSlash + 1);
-    std::string noExtLower = baseNameLower;
-    size_t dotPos = noExtLower.rfind('.');
-    if (dotPos != std::string::npos) noExtLower = noExtLower.substr(0, dotPos);
-    auto regIt = g_erfIndexRegistry.find(reinterpret_cast<uintptr_t>(&erfs));
-    if (regIt != g_erfIndexRegistry.end() && regIt->second && regIt->second->built) {
-        const ErfEntryIndex* idx = regIt->second;
-        size_t ei = SIZE_MAX, enti = 0;
-        auto it = idx->exact.find(nameLower);
-        if (it != idx->exact.end()) { ei = it->second.first; enti = it->second.second; }
-        if (ei == SIZE_MAX) {
-            it = idx->basename.find(baseNameLower);
-            if (it != idx->basename.end()) { ei = it->second.first; enti = it->second.second; }
-        }
-        if (ei == SIZE_MAX) {
-            it = idx->noext.find(noExtLower);
-            if (it != idx->noext.end()) { ei = it->second.first; enti = it->second.second; }
-        }
-        if (ei != SIZE_MAX && ei < erfs.size() && enti < erfs[ei]->entries().size())
-            return erfs[ei]->readEntry(erfs[ei]->entries()[enti]);
-        return {};
-    }
-    for (const auto& erf : erfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == nameLower) return erf->readEntry(entry);
-        }
-    }
-    for (const auto& erf : erfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            std::string entryBase = entryLower;
-            size_t sl = entryBase.find_last_of("/\\");
-            if (sl != std::string::npos) entryBase = entryBase.substr(sl + 1);
-            if (entryBase == baseNameLower) return erf->readEntry(entry);
-        }
-    }
-    for (const auto& erf : erfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            std::string entryBase = entryLower;
-            size_t sl = entryBase.find_last_of("/\\");
-            if (sl != std::string::npos) entryBase = entryBase.substr(sl + 1);
-            std::string entryNoExt = entryBase;
-            size_t dp = entryNoExt.rfind('.');
-            if (dp != std::string::npos) entryNoExt = entryNoExt.substr(0, dp);
-            if (entryNoExt == noExtLower) return erf->readEntry(entry);
-        }
-    }
-    return {};
+    ResourceLocator::syncPackage(&erfs, erfs);
+    return ResourceLocator::findAny(name, &erfs).read();
 }
 uint32_t loadTexByNameCached(AppState& state, const std::string& texName,
                              std::vector<uint8_t>* rgbaOut, int* wOut, int* hOut) {
@@ -335,41 +222,19 @@ uint32_t loadTexByNameCached(AppState& state, const std::string& texName,
 
     // Check cache with both extensions
     for (const std::string& cacheKey : { texKeyDds, texKeyXds, texNameLower }) {
-        auto it = state.textureCache.find(cacheKey);
-        if (it != state.textureCache.end() && !it->second.empty()) {
-            return createTextureAny(it->second, rgbaOut, wOut, hOut);
+        const auto* data = state.textureCache.find(cacheKey);
+        if (data && !data->empty()) {
+            return createTextureAny(*data, rgbaOut, wOut, hOut);
         }
     }
 
-    if (state.textureErfIndex.built) {
-        auto findInIndex = [&](const std::string& key) -> std::vector<uint8_t> {
-            auto eit = state.textureErfIndex.exact.find(key);
-            if (eit != state.textureErfIndex.exact.end()) {
-                auto [ei, enti] = eit->second;
-                if (ei < state.textureErfs.size() && enti < state.textureErfs[ei]->entries().size())
-                    return state.textureErfs[ei]->readEntry(state.textureErfs[ei]->entries()[enti]);
-            }
-            return {};
-        };
-        std::vector<uint8_t> texData = findInIndex(texKeyDds);
-        if (texData.empty()) texData = findInIndex(texKeyXds);
-        if (texData.empty()) texData = findInIndex(texNameLower);
+    ResourceLocator::syncPackage(&state.textureErfs, state.textureErfs);
+    for (const std::string& key : { texKeyDds, texKeyXds, texNameLower }) {
+        std::vector<uint8_t> texData =
+            ResourceLocator::find(key, ResourceLocator::Match::Exact, &state.textureErfs).read();
         if (!texData.empty()) {
             return createTextureAny(texData, rgbaOut, wOut, hOut);
         }
-        return 0;
-    }
-    for (const auto& erf : state.textureErfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == texKeyDds || entryLower == texKeyXds || entryLower == texNameLower) {
-                std::vector<uint8_t> texData = erf->readEntry(entry);
-                if (!texData.empty()) {
-                    return createTextureAny(texData, rgbaOut, wOut, hOut);
-                }
-            }
-        }
     }
     return 0;
 }
@@ -385,30 +250,12 @@ uint32_t loadTexByName(AppState& state, const std::string& texName,
     if (dp != std::string::npos) noExt = noExt.substr(0, dp);
     std::string xdsVariant = noExt + ".xds";
 
-    if (state.textureErfIndex.built) {
-        for (const std::string& key : { texNameLower, xdsVariant }) {
-            auto eit = state.textureErfIndex.exact.find(key);
-            if (eit != state.textureErfIndex.exact.end()) {
-                auto [ei, enti] = eit->second;
-                if (ei < state.textureErfs.size() && enti < state.textureErfs[ei]->entries().size()) {
-                    std::vector<uint8_t> texData = state.textureErfs[ei]->readEntry(state.textureErfs[ei]->entries()[enti]);
-                    if (!texData.empty())
-                        return createTextureAny(texData, rgbaOut, wOut, hOut);
-                }
-            }
-        }
-        return 0;
-    }
-    for (const auto& erf : state.textureErfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == texNameLower || entryLower == xdsVariant) {
-                std::vector<uint8_t> texData = erf->readEntry(entry);
-                if (!texData.empty())
-                    return createTextureAny(texData, rgbaOut, wOut, hOut);
-            }
-        }
+    ResourceLocator::syncPackage(&state.textureErfs, state.textureErfs);
+    for (const std::string& key : { texNameLower, xdsVariant }) {
+        std::vector<uint8_t> texData =
+            ResourceLocator::find(key, ResourceLocator::Match::Exact, &state.textureErfs).read();
+        if (!texData.empty())
+            return createTextureAny(texData, rgbaOut, wOut, hOut);
     }
     return 0;
 }
@@ -420,34 +267,14 @@ std::vector<uint8_t> loadTextureData(AppState& state, const std::string& texName
     if (texKey.size() < 4 || texKey.substr(texKey.size() - 4) != ".dds") {
         texKey += ".dds";
     }
-    auto it = state.textureCache.find(texKey);
-    if (it != state.textureCache.end() && !it->second.empty()) {
-        return it->second;
-    }
-    it = state.textureCache.find(texNameLower);
-    if (it != state.textureCache.end() && !it->second.empty()) {
-        return it->second;
-    }
-    if (state.textureErfIndex.built) {
-        auto eit = state.textureErfIndex.exact.find(texKey);
-        if (eit == state.textureErfIndex.exact.end()) eit = state.textureErfIndex.exact.find(texNameLower);
-        if (eit != state.textureErfIndex.exact.end()) {
-            auto [ei, enti] = eit->second;
-            if (ei < state.textureErfs.size() && enti < state.textureErfs[ei]->entries().size())
-                return state.textureErfs[ei]->readEntry(state.textureErfs[ei]->entries()[enti]);
-        }
-        return {};
-    }
-    for (const auto& erf : state.textureErfs) {
-        for (const auto& entry : erf->entries()) {
-            std::string entryLower = entry.name;
-            std::transform(entryLower.begin(), entryLower.end(), entryLower.begin(), ::tolower);
-            if (entryLower == texKey || entryLower == texNameLower) {
-                return erf->readEntry(entry);
-            }
-        }
+    for (const std::string& key : { texKey, texNameLower }) {
+        const auto* data = state.textureCache.find(key);
+        if (data && !data->empty()) return *data;
     }
-    return {};
+    ResourceLocator::syncPackage(&state.textureErfs, state.textureErfs);
+    ResourceRef ref = ResourceLocator::find(texKey, ResourceLocator::Match::Exact, &state.textureErfs);
+    if (!ref) ref = ResourceLocator::find(texNameLower, ResourceLocator::Match::Exact, &state.textureErfs);
+    return ref.read();
 }
 void drawVirtualList(int itemCount, std::function<void(int)> renderItem) {
     ImGuiListClipper clipper;
@@ -8,7 +8,7 @@
 #include "dds_loader.h"
 #include "Shaders/d3d_context.h"
 #include "Gff.h"
-#include "Gff32.h"
+#include "gff32.h"
 #include "GffViewer.h"
 #include "gda.h"
 #include "spt.h"
@@ -69,8 +69,7 @@ void finalizeLevelMaterials(AppState& state);
 void buildErfIndex(AppState& state);
 void clearPropCache();
 void ensureBaseErfsLoaded(AppState& state);
-void registerErfIndex(const void* erfsPtr, const ErfEntryIndex* index);
-void clearErfIndices();
+void syncErfPackages(AppState& state);
 std::vector<uint8_t> readFromErfs(const std::vector<std::unique_ptr<ERFFile>>& erfs, const std::string& name);
 std::vector<uint8_t> readFromCache(AppState& state, const std::string& name, const std::string& ext);
 uint32_t loadTexByNameCached(AppState& state, const std::string& texName,
@@ -98,4 +97,11 @@ void drawGffLoadingOverlay(GffViewerState& state);
 // Character designer + filterEncryptedErfs declared in this header:
 #include "CharacterDesigner/CharacterDesigner.h"
 void draw2DAEditorWindow(AppState& state);
+void closeGdaEditorTable(GDAEditorState& ed);
+// Call after loading state.gdaEditor.editor: builds its query and the
+// merged M2DA view of its worksheet.
+void attachGdaMergedView(AppState& state, const std::string& gdaName);
+// Drops cached M2DA views after archives were patched, and rebuilds the
+// editor's one.
+void invalidateGdaMergedViews(AppState& state);
 bool loadSptFromData(AppState& state, const std::vector<uint8_t>& sptData, const std::string& name, const std::string& erfPath);
@@ -2,6 +2,8 @@
 #include "update/update.h"
 #include "animation.h"
 #include "X360_Iso.h"
+#include "erf_cache.h"
+#include <atomic>
 #include <thread>
 #include "import.h"
 #include "export.h"
@@ -126,6 +128,7 @@ static bool s_scrollToBottom = false;
 static std::string s_pendingImportGlbPath;
 static bool s_showImportOptions = false;
 static int s_importMode = 1;
+static std::atomic<bool> s_importRefreshPending{false};
 static std::string s_pendingExportPath;
 static bool s_showExportOptions = false;
 static bool s_showLevelExportOptions = false;
@@ -331,6 +334,8 @@ void runLoadingTask(AppState* statePtr) {
         return;
     }
 
+    ERFTocCache::load(ERFTocCache::defaultPath());
+
     std::sort(state.rimFiles.begin(), state.rimFiles.end());
     std::sort(state.arlFiles.begin(), state.arlFiles.end());
     std::sort(state.opfFiles.begin(), state.opfFiles.end());
@@ -341,7 +346,7 @@ void runLoadingTask(AppState* statePtr) {
         for (size_t i = 0; i < state.rimFiles.size(); i++) {
             try {
                 ERFFile rim;
-                if (rim.open(state.rimFiles[i])) {
+                if (ERFTocCache::open(rim, state.rimFiles[i])) {
                     int mshCount = 0;
                     for (const auto& e : rim.entries()) {
                         size_t len = e.name.size();
@@ -358,6 +363,7 @@ void runLoadingTask(AppState* statePtr) {
             } catch (...) {
             }
         }
+        ERFTocCache::save(ERFTocCache::defaultPath());
         } catch (...) {
         }
         state.rimScanDone = true;
@@ -408,11 +414,21 @@ void runLoadingTask(AppState* statePtr) {
             continue;
         }
         ERFFile erf;
-        if (!erf.open(erfPath)) {
+        if (!ERFTocCache::open(erf, erfPath)) {
             processed++;
             state.preloadProgress = 0.1f + ((float)processed / (float)totalErfs) * 0.8f;
             continue;
         }
+        // Collect every wanted entry first, then read them in one offset-ordered pass.
+        // Names differ by extension across the four caches, so one claimed set covers them.
+        std::vector<const ERFEntry*> wanted;
+        std::vector<std::pair<BlobMap*, std::string>> targets;
+        std::set<std::string> claimed;
+        auto want = [&](BlobMap& cache, const std::string& key, const ERFEntry& entry) {
+            if (cache.contains(key) || !claimed.insert(key).second) return;
+            wanted.push_back(&entry);
+            targets.emplace_back(&cache, key);
+        };
         for (const auto& entry : erf.entries()) {
             std::string nameLower = entry.name;
             std::transform(nameLower.begin(), nameLower.end(), nameLower.begin(), ::tolower);
@@ -426,45 +442,44 @@ void runLoadingTask(AppState* statePtr) {
                 }
                 if (isCharFile && nameLower.size() > 4) {
                     std::string ext = nameLower.substr(nameLower.size() - 4);
-                    if (ext == ".msh" && state.meshCache.find(nameLower) == state.meshCache.end()) {
-                        state.meshCache[nameLower] = erf.readEntry(entry);
-                    } else if (ext == ".mmh" && state.mmhCache.find(nameLower) == state.mmhCache.end()) {
-                        state.mmhCache[nameLower] = erf.readEntry(entry);
+                    if (ext == ".msh") {
+                        want(state.meshCache, nameLower, entry);
+                    } else if (ext == ".mmh") {
+                        want(state.mmhCache, nameLower, entry);
                     }
                 }
             }
             if (isMaterial) {
                 if (nameLower.size() > 4 && nameLower.substr(nameLower.size() - 4) == ".mao") {
-                    if (state.maoCache.find(nameLower) == state.maoCache.end()) {
-                        state.maoCache[nameLower] = erf.readEntry(entry);
-                    }
+                    want(state.maoCache, nameLower, entry);
                 }
             }
             if (isTexture) {
                 if (nameLower.size() > 4 && nameLower.substr(nameLower.size() - 4) == ".dds") {
-                    if (state.textureCache.find(nameLower) == state.textureCache.end()) {
-                        state.textureCache[nameLower] = erf.readEntry(entry);
-                    }
+                    want(state.textureCache, nameLower, entry);
                 }
             }
         }
+        erf.readEntries(wanted, [&](size_t i, ERFEntryView data) {
+            targets[i].first->set(targets[i].second, data.data, data.size);
+        });
         if (isModel) {
             auto erfPtr = std::make_unique<ERFFile>();
-            if (erfPtr->open(erfPath)) {
+            if (ERFTocCache::open(*erfPtr, erfPath)) {
                 state.modelErfs.push_back(std::move(erfPtr));
                 state.modelErfPaths.push_back(erfPath);
             }
         }
         if (isMaterial) {
             auto erfPtr = std::make_unique<ERFFile>();
-            if (erfPtr->open(erfPath)) {
+            if (ERFTocCache::open(*erfPtr, erfPath)) {
                 state.materialErfs.push_back(std::move(erfPtr));
                 state.materialErfPaths.push_back(erfPath);
             }
         }
         if (isTexture) {
             auto erfPtr = std::make_unique<ERFFile>();
-            if (erfPtr->open(erfPath)) {
+            if (ERFTocCache::open(*erfPtr, erfPath)) {
                 state.textureErfs.push_back(std::move(erfPtr));
                 state.textureErfPaths.push_back(erfPath);
             }
@@ -522,6 +537,7 @@ void runLoadingTask(AppState* statePtr) {
     state.preloadProgress = 1.0f;
     if (selectErfPath.empty()) state.statusMessage = "Ready";
     saveSettings(state);
+    ERFTocCache::save(ERFTocCache::defaultPath());
     state.isPreloading = false;
     showSplash = false;
     } catch (const std::exception& e) {
@@ -541,6 +557,60 @@ void runCharDesignerLoading(AppState* statePtr) {
     statePtr->preloadProgress = 1.0f;
     t_isLoadingContent = false;
 }
+// Runs on the UI thread once an ERF import has finished. Level loads read
+// these archives from worker threads, so drawUI holds the refresh back
+// until no level is loading, and Import is disabled while one is.
+static void refreshImportedErfs(AppState& state) {
+    fs::path baseDir(state.selectedFolder);
+    fs::path corePath = baseDir / "packages" / "core" / "data";
+    fs::path texturePath = baseDir / "packages" / "core" / "textures" / "high";
+    std::vector<std::string> modifiedErfs = {
+        (corePath / "modelmeshdata.erf").string(),
+        (corePath / "modelhierarchies.erf").string(),
+        (corePath / "materialobjects.erf").string(),
+        (texturePath / "texturepack.erf").string()
+    };
+    for (const auto& erfPath : modifiedErfs) {
+        if (!fs::exists(erfPath)) continue;
+        std::string pathLower = erfPath;
+        std::transform(pathLower.begin(), pathLower.end(), pathLower.begin(), ::tolower);
+        auto reopen = [&](std::vector<std::unique_ptr<ERFFile>>& erfs,
+                          std::vector<std::string>& paths) {
+            for (size_t i = 0; i < paths.size(); ++i) {
+                std::string existingLower = paths[i];
+                std::transform(existingLower.begin(), existingLower.end(), existingLower.begin(), ::tolower);
+                if (existingLower == pathLower) {
+                    erfs[i]->open(erfPath);
+                    return;
+                }
+            }
+            auto erfPtr = std::make_unique<ERFFile>();
+            if (erfPtr->open(erfPath)) {
+                erfs.push_back(std::move(erfPtr));
+                paths.push_back(erfPath);
+            }
+        };
+        if (pathLower.find("modelmesh") != std::string::npos ||
+            pathLower.find("modelhierarch") != std::string::npos) {
+            reopen(state.modelErfs, state.modelErfPaths);
+        }
+        if (pathLower.find("material") != std::string::npos) {
+            reopen(state.materialErfs, state.materialErfPaths);
+        }
+        if (pathLower.find("texture") != std::string::npos) {
+            reopen(state.textureErfs, state.textureErfPaths);
+        }
+        if (state.currentErf && state.currentErf->isOpen()) {
+            std::string currentLower = state.currentErf->path();
+            std::transform(currentLower.begin(), currentLower.end(), currentLower.begin(), ::tolower);
+            if (currentLower == pathLower) state.currentErf->open(erfPath);
+        }
+    }
+    clearPropCache();
+    releaseSharedERFs();
+    invalidateGdaMergedViews(state);
+}
+
 void runImportTask(AppState* statePtr) {
     AppState& state = *statePtr;
     state.preloadStatus = "Initializing import...";
@@ -556,54 +626,12 @@ void runImportTask(AppState* statePtr) {
     } else {
         success = importer.ImportToDirectory(s_pendingImportGlbPath, state.selectedFolder);
     }
+    // The archives were patched in place, so the open handles stay valid;
+    // the frame loop reopens them to pick up the new entries.
+    if (s_importMode == 0) s_importRefreshPending = true;
     if (success) {
         std::string modelName = fs::path(s_pendingImportGlbPath).stem().string() + ".msh";
         markModelAsImported(modelName);
-        if (s_importMode == 0) {
-            state.preloadStatus = "Refreshing modified ERFs...";
-            state.preloadProgress = 0.92f;
-            fs::path baseDir(state.selectedFolder);
-            fs::path corePath = baseDir / "packages" / "core" / "data";
-            fs::path texturePath = baseDir / "packages" / "core" / "textures" / "high";
-            std::vector<std::string> modifiedErfs = {
-                (corePath / "modelmeshdata.erf").string(),
-                (corePath / "modelhierarchies.erf").string(),
-                (corePath / "materialobjects.erf").string(),
-                (texturePath / "texturepack.erf").string()
-            };
-            for (const auto& erfPath : modifiedErfs) {
-                if (!fs::exists(erfPath)) continue;
-                std::string pathLower = erfPath;
-                std::transform(pathLower.begin(), pathLower.end(), pathLower.begin(), ::tolower);
-                auto removeAndReload = [&](std::vector<std::unique_ptr<ERFFile>>& erfs,
-                                           std::vector<std::string>& paths) {
-                    for (size_t i = 0; i < paths.size(); ++i) {
-                        std::string existingLower = paths[i];
-                        std::transform(existingLower.begin(), existingLower.end(), existingLower.begin(), ::tolower);
-                        if (existingLower == pathLower) {
-                            erfs.erase(erfs.begin() + i);
-                            paths.erase(paths.begin() + i);
-                            break;
-                        }
-                    }
-                    auto erfPtr = std::make_unique<ERFFile>();
-                    if (erfPtr->open(erfPath)) {
-                        erfs.push_back(std::move(erfPtr));
-                        paths.push_back(erfPath);
-                    }
-                };
-                if (pathLower.find("modelmesh") != std::string::npos ||
-                    pathLower.find("modelhierarch") != std::string::npos) {
-                    removeAndReload(state.modelErfs, state.modelErfPaths);
-                }
-                if (pathLower.find("material") != std::string::npos) {
-                    removeAndReload(state.materialErfs, state.materialErfPaths);
-                }
-                if (pathLower.find("texture") != std::string::npos) {
-                    removeAndReload(state.textureErfs, state.textureErfPaths);
-                }
-            }
-        }
         state.preloadProgress = 1.0f;
         state.preloadStatus = "Import complete!";
         std::string dest = (s_importMode == 1) ? "override folder" : "ERF archives";
@@ -634,33 +662,15 @@ void runExportTask(AppState* statePtr) {
     size_t processed = 0;
     for (const auto& animFile : state.availableAnimFiles) {
         if (!s_animSelection[animFile.first]) continue;
-        ERFFile animErf;
-        if (animErf.open(animFile.second)) {
-            for (const auto& animEntry : animErf.entries()) {
+        auto animErf = openSharedERF(animFile.second);
+        if (animErf) {
+            for (const auto& animEntry : animErf->entries()) {
                 if (animEntry.name == animFile.first) {
-                    auto aniData = animErf.readEntry(animEntry);
+                    auto aniData = animErf->readEntry(animEntry);
                     if (!aniData.empty()) {
                         Animation anim = loadANI(aniData, animEntry.name);
                         resolveX360AnimHashes(anim, state.currentModel.skeleton);
-                        auto normalize = [](const std::string& s) {
-                            std::string result;
-                            for (char c : s) {
-                                if (c != '_') result += std::tolower(c);
-                            }
-                            return result;
-                        };
-                        for (auto& track : anim.tracks) {
-                            track.boneIndex = state.currentModel.skeleton.findBone(track.boneName);
-                            if (track.boneIndex < 0) {
-                                std::string trackNorm = normalize(track.boneName);
-                                for (size_t bi = 0; bi < state.currentModel.skeleton.bones.size(); bi++) {
-                                    if (trackNorm == normalize(state.currentModel.skeleton.bones[bi].name)) {
-                                        track.boneIndex = (int)bi;
-                                        break;
-                                    }
-                                }
-                            }
-                        }
+                        resolveAnimTracks(anim, state.currentModel.skeleton);
                         exportAnims.push_back(anim);
                     }
                     break;
@@ -1246,6 +1256,7 @@ void drawKeybindsWindow(AppState& state) {
     ImGui::End();
 }
 void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
+    if (state.levelLoad.stage == 0 && s_importRefreshPending.exchange(false)) refreshImportedErfs(state);
     int displayW, displayH;
     glfwGetFramebufferSize(window, &displayW, &displayH);
     static bool s_startedUpdateCheck = false;
@@ -1394,6 +1405,9 @@ void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
         ImGui::PopStyleColor();
         ImGui::Spacing();
         ImGui::Separator();
+        bool levelLoading = state.levelLoad.stage != 0;
+        if (levelLoading) ImGui::TextDisabled("Wait for the level to finish loading.");
+        ImGui::BeginDisabled(levelLoading);
         if (ImGui::Button("Import", ImVec2(120, 0))) {
             s_showImportOptions = false;
             t_active = true;
@@ -1404,6 +1418,7 @@ void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
             std::thread(runImportTask, &state).detach();
             ImGui::CloseCurrentPopup();
         }
+        ImGui::EndDisabled();
         ImGui::SameLine();
         if (ImGui::Button("Cancel", ImVec2(120, 0))) {
             s_showImportOptions = false;
@@ -1562,33 +1577,15 @@ void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
                                 if (animName == validAnim) { found = true; break; }
                             }
                             if (!found) continue;
-                            ERFFile animErf;
-                            if (animErf.open(animFile.second)) {
-                                for (const auto& animEntry : animErf.entries()) {
+                            auto animErf = openSharedERF(animFile.second);
+                            if (animErf) {
+                                for (const auto& animEntry : animErf->entries()) {
                                     if (animEntry.name == animFile.first) {
-                                        auto aniData = animErf.readEntry(animEntry);
+                                        auto aniData = animErf->readEntry(animEntry);
                                         if (!aniData.empty()) {
                                             Animation anim = loadANI(aniData, animEntry.name);
                         resolveX360AnimHashes(anim, state.currentModel.skeleton);
-                                            auto normalize = [](const std::string& s) {
-                                                std::string result;
-                                                for (char c : s) {
-                                                    if (c != '_') result += std::tolower(c);
-                                                }
-                                                return result;
-                                            };
-                                            for (auto& track : anim.tracks) {
-                                                track.boneIndex = state.currentModel.skeleton.findBone(track.boneName);
-                                                if (track.boneIndex < 0) {
-                                                    std::string trackNorm = normalize(track.boneName);
-                                                    for (size_t bi = 0; bi < state.currentModel.skeleton.bones.size(); bi++) {
-                                                        if (trackNorm == normalize(state.currentModel.skeleton.bones[bi].name)) {
-                                                            track.boneIndex = (int)bi;
-                                                            break;
-                                                        }
-                                                    }
-                                                }
-                                            }
+                                            resolveAnimTracks(anim, state.currentModel.skeleton);
                                             exportAnims.push_back(anim);
                                         }
                                         break;
@@ -1657,10 +1654,9 @@ void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
             std::string exportPath = ImGuiFileDialog::Instance()->GetFilePathName();
             std::string texName = state.previewTextureName;
             std::transform(texName.begin(), texName.end(), texName.begin(), ::tolower);
-            auto it = state.textureCache.find(texName);
-            if (it != state.textureCache.end()) {
+            if (const auto* cached = state.textureCache.find(texName)) {
                 std::ofstream out(exportPath, std::ios::binary);
-                out.write(reinterpret_cast<const char*>(it->second.data()), it->second.size());
+                out.write(reinterpret_cast<const char*>(cached->data()), cached->size());
                 state.statusMessage = "Extracted: " + exportPath;
             } else {
                 for (const auto& erfPath : state.erfFiles) {
@@ -1691,9 +1687,8 @@ void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
             std::string texName = state.previewTextureName;
             std::transform(texName.begin(), texName.end(), texName.begin(), ::tolower);
             std::vector<uint8_t> ddsData;
-            auto it = state.textureCache.find(texName);
-            if (it != state.textureCache.end()) {
-                ddsData = it->second;
+            if (const auto* cached = state.textureCache.find(texName)) {
+                ddsData = *cached;
             } else {
                 for (const auto& erfPath : state.erfFiles) {
                     ERFFile erf;
@@ -1785,33 +1780,15 @@ void drawUI(AppState& state, GLFWwindow* window, ImGuiIO& io) {
                                         if (animName == validAnim) { found = true; break; }
                                     }
                                     if (!found) continue;
-                                    ERFFile animErf;
-                                    if (animErf.open(animFile.second)) {
-                                        for (const auto& animEntry : animErf.entries()) {
+                                    auto animErf = openSharedERF(animFile.second);
+                                    if (animErf) {
+                                        for (const auto& animEntry : animErf->entries()) {
                                             if (animEntry.name == animFile.first) {
-                                                auto aniData = animErf.readEntry(animEntry);
+                                                auto aniData = animErf->readEntry(animEntry);
                                                 if (!aniData.empty()) {
                                                     Animation anim = loadANI(aniData, animEntry.name);
                         resolveX360AnimHashes(anim, state.currentModel.skeleton);
-                                                    auto normalize = [](const std::string& s) {
-                                                        std::string result;
-                                                        for (char c : s) {
-                                                            if (c != '_') result += std::tolower(c);
-                                                        }
-                                                        return result;
-                                                    };
-                                                    for (auto& track : anim.tracks) {
-                                                        track.boneIndex = state.currentModel.skeleton.findBone(track.boneName);
-                                                        if (track.boneIndex < 0) {
-                                                            std::string trackNorm = normalize(track.boneName);
-                                                            for (size_t bi = 0; bi < state.currentModel.skeleton.bones.size(); bi++) {
-                                                                if (trackNorm == normalize(state.currentModel.skeleton.bones[bi].name)) {
-                                                                    track.boneIndex = (int)bi;
-                                                                    break;
-                                                                }
-                                                            }
-                                                        }
-                                                    }
+                                                    resolveAnimTracks(anim, state.currentModel.skeleton);
                                                     exportAnims.push_back(anim);
                                                 }
                                                 break;
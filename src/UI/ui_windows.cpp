@@ -597,30 +597,7 @@ void drawAnimWindow(AppState& state, ImGuiIO& io) {
                                 if (!aniData.empty()) {
                                     state.currentAnim = loadANI(aniData, entry.name);
                                     resolveX360AnimHashes(state.currentAnim, state.currentModel.skeleton);
-                                    auto normalize = [](const std::string& s) {
-                                        std::string result;
-                                        for (char c : s) {
-                                            if (c != '_') result += std::tolower(c);
-                                        }
-                                        return result;
-                                    };
-                                    int matched = 0;
-                                    for (auto& track : state.currentAnim.tracks) {
-                                        track.boneIndex = state.currentModel.skeleton.findBone(track.boneName);
-                                        if (track.boneIndex >= 0) {
-                                            matched++;
-                                            continue;
-                                        }
-                                        std::string trackNorm = normalize(track.boneName);
-                                        for (size_t bi = 0; bi < state.currentModel.skeleton.bones.size(); bi++) {
-                                            std::string boneNorm = normalize(state.currentModel.skeleton.bones[bi].name);
-                                            if (trackNorm == boneNorm) {
-                                                track.boneIndex = (int)bi;
-                                                matched++;
-                                                break;
-                                            }
-                                        }
-                                    }
+                                    int matched = resolveAnimTracks(state.currentAnim, state.currentModel.skeleton);
                                     if (matched > 0) {
                                         state.animPlaying = true;
                                         state.animTime = 0.0f;
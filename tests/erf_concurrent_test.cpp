@@ -0,0 +1,74 @@
+#include "erf.h"
+#include "test_common.h"
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+static const char* kArchivePath = "erf_concurrent_test.erf";
+
+static std::string payload(uint32_t i) {
+    return std::string(100 + (i * 37) % 5000, char('a' + i % 26)) + std::to_string(i);
+}
+
+static bool writeArchive(uint32_t count) {
+    std::vector<ERFEntry> entries(count);
+    for (uint32_t i = 0; i < count; i++) entries[i].name = "f" + std::to_string(i) + ".txt";
+    ERFWriter writer;
+    if (!writer.begin(kArchivePath, ERFVersion::V2_0, entries)) return false;
+    for (uint32_t i = 0; i < count; i++) {
+        std::string data = payload(i);
+        if (!writer.write(data.data(), data.size())) return false;
+    }
+    return writer.finish();
+}
+
+// One shared ERFFile read from many threads at once, as the level loader
+// and the browser previews do, through every read path.
+static void testSharedReads() {
+    const uint32_t count = 2000;
+    const int threads = 8;
+    CHECK(writeArchive(count));
+
+    auto erf = openSharedERF(kArchivePath);
+    CHECK(erf != nullptr);
+    if (!erf) return;
+    CHECK(openSharedERF(kArchivePath) == erf);
+    CHECK(erf->entries().size() == count);
+    CHECK(erf->entries()[5].name == "f5.txt");
+
+    std::atomic<int> bad{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            for (int pass = 0; pass < 3; pass++) {
+                for (uint32_t i = t; i < count; i += threads - pass) {
+                    const ERFEntry& entry = erf->entries()[i];
+                    std::vector<uint8_t> data = erf->readEntry(entry);
+                    if (std::string(data.begin(), data.end()) != payload(i)) bad++;
+                    ERFEntryView view = erf->viewEntry(entry);
+                    if (view && std::string(reinterpret_cast<const char*>(view.data), view.size) != payload(i)) bad++;
+                }
+            }
+            std::vector<const ERFEntry*> batch;
+            for (uint32_t i = t; i < count; i += threads) batch.push_back(&erf->entries()[i]);
+            erf->readEntries(batch, [&](size_t k, ERFEntryView data) {
+                uint32_t i = static_cast<uint32_t>(t + k * threads);
+                if (!data || std::string(reinterpret_cast<const char*>(data.data), data.size) != payload(i)) bad++;
+            });
+        });
+    }
+    for (auto& w : workers) w.join();
+    std::printf("erf_concurrent_test: %d threads, %u entries in %.1f ms (mapped %d)\n",
+                threads, count, elapsedMs(start), int(erf->isMapped()));
+    CHECK(bad.load() == 0);
+
+    erf.reset();
+    releaseSharedERFs();
+    std::remove(kArchivePath);
+}
+
+int main() {
+    testSharedReads();
+    return testResult("erf_concurrent_test");
+}
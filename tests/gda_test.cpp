@@ -0,0 +1,190 @@
+#include "gda.h"
+#include "test_common.h"
+#include <cstring>
+
+// Builds a G2DA table (GFF V4.0PC) with one column per kind of cell the
+// game files use. Strings are stored once and shared between rows, as in
+// the shipped tables. truncate cuts bytes off the end so the last rows
+// point past the data.
+struct GdaColumnSpec { uint32_t hash; uint8_t gdaType; uint16_t gffType; };
+static const GdaColumnSpec kColumns[] = {
+    { 1, 1, 5 },    // int32
+    { 2, 0, 14 },   // string
+    { 3, 2, 8 },    // float
+    { 4, 3, 0 },    // bool stored as a byte
+    { 5, 4, 14 },   // resource
+    { 6, 1, 2 },    // int stored as uint16
+    { 7, 2, 9 },    // float stored as a double
+    { 8, 9, 5 },    // unknown GDA type
+};
+static const uint32_t kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+
+static std::vector<uint8_t> makeGda(uint32_t rows, uint32_t distinct, uint32_t truncate) {
+    std::vector<uint8_t> v;
+    auto put = [&](size_t at, auto x) {
+        if (v.size() < at + sizeof(x)) v.resize(at + sizeof(x));
+        std::memcpy(&v[at], &x, sizeof(x));
+    };
+    const uint32_t headerSize = 28, rowSize = kColumnCount * 8, colmSize = 8;
+    const uint32_t fieldBase = headerSize + 3 * 16;
+    const uint32_t dataOffset = fieldBase + (2 + 2 + kColumnCount) * 12;
+    v.resize(dataOffset);
+    std::memcpy(&v[0], "GFF V4.0PC  G2DAV0.2", 20);
+    put(20, uint32_t(3));
+    put(24, dataOffset);
+
+    const char* structNames[3] = { "gtop", "colm", "rows" };
+    const uint32_t fieldCounts[3] = { 2, 2, kColumnCount };
+    const uint32_t structSizes[3] = { 8, colmSize, rowSize };
+    uint32_t fieldPos = fieldBase;
+    for (uint32_t s = 0; s < 3; s++) {
+        std::memcpy(&v[headerSize + s * 16], structNames[s], 4);
+        put(headerSize + s * 16 + 4, fieldCounts[s]);
+        put(headerSize + s * 16 + 8, fieldPos);
+        put(headerSize + s * 16 + 12, structSizes[s]);
+        for (uint32_t f = 0; f < fieldCounts[s]; f++) {
+            uint16_t type = 0, flags = 0;
+            uint32_t offset = 0;
+            if (s == 0) { type = uint16_t(1 + f); flags = 0xC000; offset = 4 * f; }
+            if (s == 1) { type = f == 0 ? 4 : 0; offset = 4 * f; }
+            if (s == 2) { type = kColumns[f].gffType; offset = 8 * f; }
+            put(fieldPos, 100 * s + f);
+            put(fieldPos + 4, type);
+            put(fieldPos + 6, flags);
+            put(fieldPos + 8, offset);
+            fieldPos += 12;
+        }
+    }
+
+    auto at = [&](uint32_t rel) { return size_t(dataOffset) + rel; };
+    uint32_t tail = 8;
+    auto alloc = [&](uint32_t n) { uint32_t r = tail; tail += n; v.resize(at(tail)); return r; };
+    v.resize(at(tail));
+    uint32_t colm = alloc(4 + kColumnCount * colmSize);
+    put(at(0), colm);
+    put(at(colm), kColumnCount);
+    for (uint32_t c = 0; c < kColumnCount; c++) {
+        put(at(colm + 4 + c * colmSize), kColumns[c].hash);
+        put(at(colm + 4 + c * colmSize + 4), kColumns[c].gdaType);
+    }
+    uint32_t rowList = alloc(4 + rows * rowSize);
+    put(at(4), rowList);
+    put(at(rowList), rows);
+
+    std::vector<uint32_t> strings;
+    for (uint32_t k = 0; k < distinct; k++) {
+        std::string s = k % 17 == 0 ? "" : "name_" + std::to_string(k) + (k % 7 == 0 ? "\xe9" : "");
+        uint32_t r = alloc(4 + 2 * uint32_t(s.size()));
+        put(at(r), uint32_t(s.size()));
+        for (size_t i = 0; i < s.size(); i++) put(at(r + 4 + 2 * uint32_t(i)), uint16_t((unsigned char)s[i]));
+        strings.push_back(r);
+    }
+    TestRng rng(12345);
+    for (uint32_t r = 0; r < rows; r++) {
+        uint32_t base = rowList + 4 + r * rowSize;
+        put(at(base + 0), int32_t(r) - 5);
+        put(at(base + 8), r % 11 == 0 ? int32_t(-1) : int32_t(strings[rng.next() % distinct]));
+        put(at(base + 16), float(rng.next() % 10000) / 7.f);
+        put(at(base + 24), uint8_t(rng.next() % 2));
+        put(at(base + 32), int32_t(strings[rng.next() % distinct]));
+        put(at(base + 40), uint16_t(rng.next()));
+        put(at(base + 48), double(rng.next() % 1000) * 0.25);
+        put(at(base + 56), int32_t(rng.next()));
+    }
+    if (truncate) v.resize(v.size() - truncate);
+    return v;
+}
+
+// Every cell as it read through the old row layout, floats as their bits.
+static std::string dumpCells(const GDAFile& file) {
+    std::string out = std::to_string(file.rowCount()) + " rows " + std::to_string(file.columns().size()) + " cols\n";
+    for (size_t r = 0; r < file.rowCount(); r++) {
+        GDARow row = file.row(r);
+        for (size_t c = 0; c < file.columns().size(); c++) {
+            const GDAValue& v = row.values[c];
+            CHECK(v == file.value(r, c));
+            out += std::to_string(r) + " " + std::to_string(c) + " ";
+            if (auto* i = std::get_if<int32_t>(&v)) {
+                out += "i " + std::to_string(*i);
+            } else if (auto* f = std::get_if<float>(&v)) {
+                uint32_t bits;
+                std::memcpy(&bits, f, 4);
+                out += "f " + std::to_string(bits);
+            } else if (auto* b = std::get_if<bool>(&v)) {
+                out += std::string("b ") + (*b ? "1" : "0");
+            } else {
+                out += "s " + std::get<std::string>(v);
+            }
+            out += "\n";
+        }
+    }
+    return out;
+}
+
+// The typed accessors and column scans must read the same cells as value().
+static void checkTypedAccess(const GDAFile& file) {
+    for (size_t c = 0; c < file.columns().size(); c++) {
+        GDAType type = file.columns()[c].type;
+        for (size_t r = 0; r < file.rowCount(); r++) {
+            if (file.isMissing(r, c)) {
+                CHECK(std::get<std::string>(file.value(r, c)) == "****");
+                continue;
+            }
+            GDAValue v = file.value(r, c);
+            switch (type) {
+                case GDAType::Int:
+                    CHECK(file.intAt(r, c) == std::get<int32_t>(v));
+                    CHECK(file.cells(c).ints[r] == std::get<int32_t>(v));
+                    break;
+                case GDAType::Float:
+                    CHECK(file.floatAt(r, c) == std::get<float>(v));
+                    break;
+                case GDAType::Bool:
+                    CHECK(file.boolAt(r, c) == std::get<bool>(v));
+                    break;
+                case GDAType::String:
+                case GDAType::Resource:
+                    CHECK(file.stringAt(r, c) == std::get<std::string>(v));
+                    CHECK(file.findString(file.stringAt(r, c)) == file.cells(c).strings[r]);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
+
+// Hashes were recorded from the row-per-vector layout this file replaced.
+static void testRowParity() {
+    struct Case { uint32_t rows, distinct, truncate; uint64_t hash; };
+    const Case cases[] = {
+        { 0, 5, 0, 0xf223d7dfa5292737ull },
+        { 1, 5, 0, 0x9cb32ed6dadc7663ull },
+        { 50, 20, 0, 0xc0773411afbc42eaull },
+        { 300, 40, 100, 0xf77bee2eeb7cfd98ull },
+        { 300, 40, 1000, 0xa372432a4c05e7d0ull },
+        { 2000, 300, 7, 0xbefdd7b840a65297ull },
+    };
+    for (const auto& c : cases) {
+        GDAFile file;
+        CHECK(file.load(makeGda(c.rows, c.distinct, c.truncate), "test.gda"));
+        CHECK_HASH(dumpCells(file), c.hash);
+        checkTypedAccess(file);
+    }
+}
+
+static void testLookups() {
+    GDAFile file;
+    CHECK(file.load(makeGda(20, 10, 0), "test.gda"));
+    CHECK(file.name() == "test.gda");
+    CHECK(file.columns().size() == kColumnCount);
+    CHECK(file.findString("no such string") == UINT32_MAX);
+    CHECK(file.findColumn("not a column") == -1);
+    CHECK(file.memoryUsage() > 0);
+}
+
+int main() {
+    testRowParity();
+    testLookups();
+    return testResult("gda_test");
+}
@@ -0,0 +1,456 @@
+#include "gff32.h"
+#include "test_common.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <type_traits>
+
+using namespace GFF32;
+
+// One field of every value type. The suffix lets a struct hold several sets.
+static void addFields(Structure& s, int i, const std::string& suffix = "") {
+    s.setField("Byte" + suffix, TypeID::BYTE, uint8_t(i));
+    s.setField("Char" + suffix, TypeID::CHAR, int8_t(-i));
+    s.setField("Word" + suffix, TypeID::WORD, uint16_t(i * 3));
+    s.setField("Short" + suffix, TypeID::SHORT, int16_t(-i * 3));
+    s.setField("Dword" + suffix, TypeID::DWORD, uint32_t(i * 100003u));
+    s.setField("Int" + suffix, TypeID::INT, int32_t(-i * 7919));
+    s.setField("Dw64" + suffix, TypeID::DWORD64, uint64_t(i) << 40);
+    s.setField("I64" + suffix, TypeID::INT64, -(int64_t(i) << 33));
+    s.setField("Float" + suffix, TypeID::FLOAT, float(i) * 0.37f);
+    s.setField("Double" + suffix, TypeID::DOUBLE, double(i) / 7.0);
+    s.setField("Name" + suffix, TypeID::ExoString, "item_" + std::to_string(i));
+    s.setField("Tex" + suffix, TypeID::ResRef, "tex_" + std::to_string(i % 97));
+    ExoLocString loc;
+    loc.stringref = (i % 3) ? i : -1;
+    if (i % 2) loc.strings.push_back({0, false, "hello " + std::to_string(i)});
+    if (i % 4 == 1) loc.strings.push_back({2, true, "bonjour"});
+    s.setField("Loc" + suffix, TypeID::ExoLocString, loc);
+    VoidData blob;
+    for (int k = 0; k < i % 23; k++) blob.data.push_back(uint8_t(k * i));
+    s.setField("Blob" + suffix, TypeID::VOID, blob);
+}
+
+static Structure makeNode(int i, int depth) {
+    Structure s;
+    s.structId = i;
+    addFields(s, i);
+    if (depth > 0) {
+        s.setField("Child", TypeID::Structure, std::make_shared<Structure>(makeNode(i + 1, depth - 1)));
+        auto kids = std::make_shared<std::vector<Structure>>();
+        for (int k = 0; k < 2; k++) kids->push_back(makeNode(i * 3 + k, depth - 1));
+        s.setField("Kids", TypeID::List, kids);
+    }
+    return s;
+}
+
+// Trees without nested fields, which the old writer saved correctly.
+static Structure makeWideRoot() {
+    Structure s;
+    for (int set = 0; set < 20; set++) addFields(s, set * 5 + 1, std::to_string(set));
+    return s;
+}
+
+static Structure makeEmptyItems() {
+    Structure s;
+    s.setField("Tag", TypeID::ExoString, std::string("container"));
+    for (int l = 0; l < 3; l++) {
+        auto items = std::make_shared<std::vector<Structure>>();
+        for (int k = 0; k < l * 2; k++) {
+            items->emplace_back();
+            items->back().structId = k;
+        }
+        s.setField("Items" + std::to_string(l), TypeID::List, items);
+    }
+    return s;
+}
+
+static Structure makeSingleField() {
+    Structure s;
+    s.setField("Only", TypeID::INT, int32_t(-42));
+    return s;
+}
+
+// Writes a tree without going through GFF32File, so the parser is checked
+// against an independent encoder. Structs are numbered breadth-first.
+struct TreeWriter {
+    std::vector<uint8_t> structs, fields, labels, fieldData, fieldIndices, listIndices;
+    std::vector<std::string> labelList;
+    uint32_t structCount = 0, fieldCount = 0;
+
+    template <typename T>
+    static void put(std::vector<uint8_t>& b, T v) {
+        size_t p = b.size();
+        b.resize(p + sizeof(T));
+        std::memcpy(&b[p], &v, sizeof(T));
+    }
+    static void putText(std::vector<uint8_t>& b, const std::string& s) { b.insert(b.end(), s.begin(), s.end()); }
+
+    uint32_t label(const std::string& l) {
+        for (size_t i = 0; i < labelList.size(); i++)
+            if (labelList[i] == l) return static_cast<uint32_t>(i);
+        labelList.push_back(l);
+        char buf[16] = {};
+        std::memcpy(buf, l.data(), std::min<size_t>(16, l.size()));
+        labels.insert(labels.end(), buf, buf + 16);
+        return static_cast<uint32_t>(labelList.size() - 1);
+    }
+
+    uint32_t fieldValue(const Field& f, std::vector<const Structure*>& queue) {
+        uint32_t d = 0;
+        switch (f.typeId) {
+            case TypeID::BYTE: d = std::get<uint8_t>(f.value); break;
+            case TypeID::CHAR: d = uint8_t(std::get<int8_t>(f.value)); break;
+            case TypeID::WORD: d = std::get<uint16_t>(f.value); break;
+            case TypeID::SHORT: d = uint16_t(std::get<int16_t>(f.value)); break;
+            case TypeID::DWORD: d = std::get<uint32_t>(f.value); break;
+            case TypeID::INT: d = uint32_t(std::get<int32_t>(f.value)); break;
+            case TypeID::FLOAT: std::memcpy(&d, &std::get<float>(f.value), 4); break;
+            case TypeID::DWORD64: d = uint32_t(fieldData.size()); put(fieldData, std::get<uint64_t>(f.value)); break;
+            case TypeID::INT64: d = uint32_t(fieldData.size()); put(fieldData, std::get<int64_t>(f.value)); break;
+            case TypeID::DOUBLE: d = uint32_t(fieldData.size()); put(fieldData, std::get<double>(f.value)); break;
+            case TypeID::ExoString: {
+                const auto& s = std::get<std::string>(f.value);
+                d = uint32_t(fieldData.size());
+                put(fieldData, uint32_t(s.size()));
+                putText(fieldData, s);
+                break;
+            }
+            case TypeID::ResRef: {
+                const auto& s = std::get<std::string>(f.value);
+                d = uint32_t(fieldData.size());
+                put(fieldData, uint8_t(s.size()));
+                putText(fieldData, s);
+                break;
+            }
+            case TypeID::ExoLocString: {
+                const auto& loc = std::get<ExoLocString>(f.value);
+                std::vector<uint8_t> body;
+                put(body, uint32_t(loc.stringref));
+                put(body, uint32_t(loc.strings.size()));
+                for (const auto& ls : loc.strings) {
+                    put(body, uint32_t(ls.language << 2 | (ls.gender ? 1u : 0u)));
+                    put(body, uint32_t(ls.text.size()));
+                    putText(body, ls.text);
+                }
+                d = uint32_t(fieldData.size());
+                put(fieldData, uint32_t(body.size()));
+                fieldData.insert(fieldData.end(), body.begin(), body.end());
+                break;
+            }
+            case TypeID::VOID: {
+                const auto& bytes = std::get<VoidData>(f.value).data;
+                d = uint32_t(fieldData.size());
+                put(fieldData, uint32_t(bytes.size()));
+                fieldData.insert(fieldData.end(), bytes.begin(), bytes.end());
+                break;
+            }
+            case TypeID::Structure:
+                d = structCount++;
+                queue.push_back(std::get<StructurePtr>(f.value).get());
+                break;
+            case TypeID::List: {
+                const auto& items = *std::get<ListPtr>(f.value);
+                d = uint32_t(listIndices.size());
+                put(listIndices, uint32_t(items.size()));
+                for (const auto& item : items) {
+                    put(listIndices, structCount++);
+                    queue.push_back(&item);
+                }
+                break;
+            }
+        }
+        return d;
+    }
+
+    std::vector<uint8_t> write(const Structure& root, const char* fileType) {
+        std::vector<const Structure*> queue{&root};
+        structCount = 1;
+        for (size_t qi = 0; qi < queue.size(); qi++) {
+            const Structure& st = *queue[qi];
+            std::vector<uint32_t> indices;
+            for (const auto& l : st.fieldOrder) {
+                const Field& f = st.fields.at(l);
+                uint32_t d = fieldValue(f, queue);
+                indices.push_back(fieldCount++);
+                put(fields, uint32_t(f.typeId));
+                put(fields, label(l));
+                put(fields, d);
+            }
+            put(structs, uint32_t(st.structId));
+            if (indices.size() == 1) {
+                put(structs, indices[0]);
+            } else {
+                put(structs, uint32_t(fieldIndices.size()));
+                for (uint32_t i : indices) put(fieldIndices, i);
+            }
+            put(structs, uint32_t(indices.size()));
+        }
+
+        std::vector<uint8_t> out(56);
+        std::memcpy(out.data(), fileType, 4);
+        std::memcpy(out.data() + 4, "V3.2", 4);
+        uint32_t header[12];
+        uint32_t offset = 56;
+        auto section = [&](int k, const std::vector<uint8_t>& b, size_t count) {
+            header[k * 2] = offset;
+            header[k * 2 + 1] = uint32_t(count);
+            offset += uint32_t(b.size());
+            out.resize(offset);
+            if (!b.empty()) std::memcpy(&out[offset - b.size()], b.data(), b.size());
+        };
+        section(0, structs, structCount);
+        section(1, fields, fieldCount);
+        section(2, labels, labelList.size());
+        section(3, fieldData, fieldData.size());
+        section(4, fieldIndices, fieldIndices.size());
+        section(5, listIndices, listIndices.size());
+        std::memcpy(out.data() + 8, header, sizeof(header));
+        return out;
+    }
+};
+
+static std::vector<uint8_t> writeTree(const Structure& root, const char* fileType) {
+    return TreeWriter().write(root, fileType);
+}
+
+static std::string hexBits(uint64_t bits, int digits) {
+    char buf[20];
+    std::snprintf(buf, sizeof(buf), "%0*llx", digits, static_cast<unsigned long long>(bits));
+    return buf;
+}
+
+static std::string floatText(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, 4);
+    return hexBits(bits, 8);
+}
+
+static std::string doubleText(double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, 8);
+    return hexBits(bits, 16);
+}
+
+static std::string bytesText(const char* data, size_t size) {
+    std::string out;
+    for (size_t i = 0; i < size; i++) out += hexBits(static_cast<uint8_t>(data[i]), 2);
+    return out;
+}
+
+// Canonical text form of a tree: integers in decimal, floats as their bits,
+// so the recorded hashes don't depend on how a platform formats numbers.
+static void dumpStruct(const Structure& st, std::string& out) {
+    out += "{" + std::to_string(st.structId);
+    for (const auto& label : st.fieldOrder) {
+        const Field& f = st.fields.at(label);
+        out += " " + label + ":" + std::to_string(static_cast<int>(f.typeId)) + "=";
+        std::visit([&](const auto& v) {
+            using T = std::decay_t<decltype(v)>;
+            if constexpr (std::is_integral_v<T>) {
+                out += std::to_string(v);
+            } else if constexpr (std::is_same_v<T, float>) {
+                out += floatText(v);
+            } else if constexpr (std::is_same_v<T, double>) {
+                out += doubleText(v);
+            } else if constexpr (std::is_same_v<T, std::string>) {
+                out += std::to_string(v.size()) + ":" + v;
+            } else if constexpr (std::is_same_v<T, ExoLocString>) {
+                out += std::to_string(v.stringref);
+                for (const auto& ls : v.strings)
+                    out += "," + std::to_string(ls.language) + "/" + std::to_string(int(ls.gender)) + ":" + ls.text;
+            } else if constexpr (std::is_same_v<T, VoidData>) {
+                out += bytesText(reinterpret_cast<const char*>(v.data.data()), v.data.size());
+            } else if constexpr (std::is_same_v<T, StructurePtr>) {
+                if (v) dumpStruct(*v, out);
+            } else {
+                out += "[";
+                if (v)
+                    for (const auto& item : *v) dumpStruct(item, out);
+                out += "]";
+            }
+        }, f.value);
+    }
+    out += "}";
+}
+
+static std::string dump(const GFF32File& file) {
+    std::string out;
+    if (file.root()) dumpStruct(*file.root(), out);
+    return out;
+}
+
+static void dumpFlatStruct(FlatStruct st, std::string& out) {
+    out += "{" + std::to_string(st.structId());
+    for (FlatField f : st) {
+        out += " " + std::string(f.label()) + ":" + std::to_string(static_cast<int>(f.typeId())) + "=";
+        switch (f.typeId()) {
+            case TypeID::BYTE:
+            case TypeID::WORD:
+            case TypeID::DWORD:
+            case TypeID::DWORD64:
+                out += std::to_string(f.asUInt());
+                break;
+            case TypeID::CHAR:
+            case TypeID::SHORT:
+            case TypeID::INT:
+            case TypeID::INT64:
+                out += std::to_string(f.asInt());
+                break;
+            case TypeID::FLOAT:
+                out += floatText(f.asFloat());
+                break;
+            case TypeID::DOUBLE:
+                out += doubleText(f.asDouble());
+                break;
+            case TypeID::ExoString:
+            case TypeID::ResRef:
+                out += std::to_string(f.asString().size()) + ":" + std::string(f.asString());
+                break;
+            case TypeID::ExoLocString:
+                out += std::to_string(f.stringRef());
+                for (size_t i = 0; i < f.localCount(); i++) {
+                    FlatLocalString ls = f.local(i);
+                    out += "," + std::to_string(ls.language) + "/" + std::to_string(int(ls.gender)) + ":" + std::string(ls.text);
+                }
+                break;
+            case TypeID::VOID:
+                out += bytesText(f.asBytes().data(), f.asBytes().size());
+                break;
+            case TypeID::Structure:
+                dumpFlatStruct(f.asStruct(), out);
+                break;
+            case TypeID::List:
+                out += "[";
+                for (FlatStruct item : f.asList()) dumpFlatStruct(item, out);
+                out += "]";
+                break;
+        }
+    }
+    out += "}";
+}
+
+static std::string dump(const FlatFile& file) {
+    std::string out;
+    dumpFlatStruct(file.root(), out);
+    return out;
+}
+
+static std::string asText(const std::vector<uint8_t>& bytes) {
+    return std::string(bytes.begin(), bytes.end());
+}
+
+// save() must produce the same bytes as the writer it replaced. Hashes were
+// recorded from that writer, which was only correct for trees whose root
+// has no nested struct fields.
+static void testWriterParity() {
+    struct Case { const char* name; Structure tree; uint64_t hash; };
+    const Case cases[] = {
+        { "wide root", makeWideRoot(), 0x221781ed600ff4a9ull },
+        { "empty list items", makeEmptyItems(), 0x98579965dffd3b5cull },
+        { "single field", makeSingleField(), 0xa57472a8bb0fad06ull },
+    };
+    for (const auto& c : cases) {
+        GFF32File file;
+        CHECK(file.load(writeTree(c.tree, "UTI ")));
+        std::vector<uint8_t> saved = file.save();
+        CHECK_HASH(asText(saved), c.hash);
+    }
+}
+
+// Both readers must agree with each other, with the tree that was written,
+// and with the dump the old parser produced. The old parser only read two
+// levels correctly, so that's as deep as the recorded hashes go.
+static void testParserParity() {
+    struct Case { int id; int depth; uint64_t hash; };
+    const Case cases[] = {
+        { 1, 0, 0x05371d7cca2e9066ull },
+        { 1, 1, 0x3d7541dced97cd8aull },
+        { 6, 1, 0xcdf16c9faa017148ull },
+    };
+    for (const auto& c : cases) {
+        Structure tree = makeNode(c.id, c.depth);
+        std::vector<uint8_t> bytes = writeTree(tree, "UTC ");
+        GFF32File file;
+        FlatFile flat;
+        CHECK(file.load(bytes));
+        CHECK(flat.load(bytes));
+        std::string expected;
+        dumpStruct(tree, expected);
+        CHECK(dump(file) == expected);
+        CHECK(dump(flat) == expected);
+        CHECK_HASH(dump(file), c.hash);
+    }
+
+    FlatFile flat;
+    CHECK(flat.load(writeTree(makeNode(1, 1), "UTC ")));
+    FlatStruct root = flat.root();
+    CHECK(root.hasField("Loc") && !root.hasField("Nope"));
+    CHECK(root.getField("Float").asFloat() == 0.37f);
+    CHECK(root.getField("Tex").asString() == "tex_1");
+    CHECK(root.getField("Char").asInt() == -1);
+    CHECK(root.getField("Kids").asList().size() == 2);
+    CHECK(root.getField("Child").asStruct().structId() == 2);
+    CHECK(!root.getField("Nope").asStruct());
+    CHECK(root.getField("Nope").asList().empty());
+}
+
+// Deeper trees have no old output to compare against, so they have to
+// survive load and save unchanged, through either reader.
+static void testRoundTrip() {
+    for (int depth : {2, 4}) {
+        Structure tree = makeNode(1, depth);
+        std::string expected;
+        dumpStruct(tree, expected);
+
+        GFF32File file;
+        CHECK(file.load(writeTree(tree, "DLG ")));
+        CHECK(dump(file) == expected);
+        std::vector<uint8_t> saved = file.save();
+
+        GFF32File reloaded;
+        CHECK(reloaded.load(saved));
+        CHECK(dump(reloaded) == expected);
+        CHECK(reloaded.fileType() == "DLG ");
+        CHECK(reloaded.save() == saved);
+
+        FlatFile flat;
+        CHECK(flat.load(saved));
+        CHECK(dump(flat) == expected);
+        GFF32File copied;
+        CHECK(copied.load(writeTree(flat.toStructure(), "DLG ")));
+        CHECK(copied.save() == saved);
+
+        const std::string path = "gff32_test_roundtrip.gff";
+        CHECK(file.save(path));
+        std::ifstream in(path, std::ios::binary);
+        std::vector<uint8_t> onDisk((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::remove(path.c_str());
+        CHECK(onDisk == saved);
+    }
+}
+
+// A default FlatField stands for a missing field; every accessor has to
+// read as empty rather than touch the file it doesn't have.
+static void testEmptyField() {
+    FlatField f;
+    CHECK(!f);
+    CHECK(f.label().empty());
+    CHECK(f.localCount() == 0);
+    CHECK(f.local(0).text.empty());
+    CHECK(!f.asStruct());
+    CHECK(f.asList().size() == 0);
+    CHECK(f.asString().empty());
+    CHECK(f.asInt() == 0);
+}
+
+int main() {
+    testWriterParity();
+    testParserParity();
+    testRoundTrip();
+    testEmptyField();
+    return testResult("gff32_test");
+}
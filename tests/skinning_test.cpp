@@ -0,0 +1,101 @@
+#include "skinning.h"
+#include "test_common.h"
+#include <algorithm>
+#include <cmath>
+
+static void randomRotation(TestRng& rng, float& x, float& y, float& z, float& w) {
+    x = rng.unit(); y = rng.unit(); z = rng.unit(); w = rng.unit();
+    float len = std::sqrt(x * x + y * y + z * z + w * w);
+    if (len < 1e-3f) { x = y = z = 0; w = 1; return; }
+    x /= len; y /= len; z /= len; w /= len;
+}
+
+// A posed skeleton plus a mesh whose bone names only partly match it: some
+// mesh bones are missing, names differ in case, and vertices carry zero
+// weights and out-of-range indices, as exported meshes do.
+static void makeSkinnedModel(TestRng& rng, Model& model, int boneCount, int vertexCount) {
+    for (int i = 0; i < boneCount; i++) {
+        Bone b;
+        b.name = "Bone_" + std::to_string(i);
+        randomRotation(rng, b.worldRotX, b.worldRotY, b.worldRotZ, b.worldRotW);
+        randomRotation(rng, b.invBindRotX, b.invBindRotY, b.invBindRotZ, b.invBindRotW);
+        b.worldPosX = rng.unit() * 2; b.worldPosY = rng.unit() * 2; b.worldPosZ = rng.unit() * 2;
+        b.invBindPosX = rng.unit(); b.invBindPosY = rng.unit(); b.invBindPosZ = rng.unit();
+        model.skeleton.bones.push_back(b);
+    }
+    for (int i = 0; i < boneCount + 5; i++)
+        model.boneIndexArray.push_back(i % 17 == 3 ? "no_such_bone" : "BONE_" + std::to_string(i));
+
+    Mesh mesh;
+    for (int i = 0; i < boneCount; i++) mesh.bonesUsed.push_back((i * 7) % (boneCount + 5));
+    for (int i = 0; i < vertexCount; i++) {
+        Vertex v;
+        v.x = rng.unit(); v.y = rng.unit(); v.z = rng.unit();
+        v.nx = rng.unit(); v.ny = rng.unit(); v.nz = rng.unit();
+        v.u = v.v = 0;
+        for (int k = 0; k < 4; k++) {
+            v.boneIndices[k] = static_cast<int>(rng.next() % (boneCount + 8)) - 2;
+            v.boneWeights[k] = rng.next() % 5 == 0 ? 0.f : std::fabs(rng.unit());
+        }
+        if (i % 50 == 0)
+            for (int k = 0; k < 4; k++) v.boneWeights[k] = 0;
+        mesh.vertices.push_back(v);
+    }
+    model.meshes.push_back(mesh);
+}
+
+struct SkinnedVertex { float x, y, z, nx, ny, nz, u, v; };
+
+// skinMesh has to land where the per-vertex reference does, and only touch
+// the six floats it owns in each output vertex.
+static void testMatchesReference() {
+    TestRng rng(7);
+    Model model;
+    const int vertexCount = 200000;
+    makeSkinnedModel(rng, model, 120, vertexCount);
+    Mesh& mesh = model.meshes[0];
+    buildSkinningCache(mesh, model);
+    CHECK(mesh.skinningCacheBuilt);
+    const auto& map = mesh.skinningBoneMap;
+    CHECK(std::count_if(map.begin(), map.end(), [](int b) { return b >= 0; }) > 60);
+    CHECK(std::count(map.begin(), map.end(), -1) > 0);
+
+    double worst = 0, refMs = 0, bulkMs = 0;
+    int clobbered = 0;
+    for (bool skipInvBind : {false, true}) {
+        mesh.skipInvBind = skipInvBind;
+        std::vector<SkinnedVertex> expected(vertexCount), actual(vertexCount, SkinnedVertex{0, 0, 0, 0, 0, 0, 1, 2});
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < vertexCount; i++) {
+            const Vertex& v = mesh.vertices[i];
+            SkinnedVertex& out = expected[i];
+            out.x = v.x; out.y = v.y; out.z = v.z;
+            out.nx = v.nx; out.ny = v.ny; out.nz = v.nz;
+            transformVertexBySkeleton(v, mesh, model, out.x, out.y, out.z, out.nx, out.ny, out.nz);
+        }
+        refMs += elapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        SkinPalette palette;
+        palette.build(model.skeleton);
+        skinMesh(mesh, palette, &actual[0].x, sizeof(SkinnedVertex));
+        bulkMs += elapsedMs(start);
+
+        for (int i = 0; i < vertexCount; i++) {
+            const float* a = &expected[i].x;
+            const float* b = &actual[i].x;
+            for (int k = 0; k < 6; k++) worst = std::max(worst, static_cast<double>(std::fabs(a[k] - b[k])));
+            if (actual[i].u != 1 || actual[i].v != 2) clobbered++;
+        }
+    }
+    std::printf("skinning_test: max difference %g, reference %.1f Mvert/s, skinMesh %.1f Mvert/s\n",
+                worst, 2 * vertexCount / refMs / 1000.0, 2 * vertexCount / bulkMs / 1000.0);
+    CHECK(worst < 1e-4);
+    CHECK(clobbered == 0);
+}
+
+int main() {
+    testMatchesReference();
+    return testResult("skinning_test");
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "fnv.h"
+
+// Minimal harness: each test is a plain executable that returns non-zero
+// when any CHECK failed, which is all ctest looks at.
+static int s_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            s_failures++; \
+        } \
+    } while (0)
+
+// Compares a dump against a value recorded from the previous implementation.
+// Prints the new hash so a deliberate format change can update the table.
+#define CHECK_HASH(text, expected) \
+    do { \
+        uint64_t h_ = fnv64(text); \
+        if (h_ != (expected)) { \
+            std::printf("%s:%d: hash 0x%016llxull, expected 0x%016llxull\n", __FILE__, __LINE__, \
+                        static_cast<unsigned long long>(h_), static_cast<unsigned long long>(expected)); \
+            s_failures++; \
+        } \
+    } while (0)
+
+inline int testResult(const char* name) {
+    if (s_failures) std::printf("%s: %d check(s) failed\n", name, s_failures);
+    else std::printf("%s: ok\n", name);
+    return s_failures ? 1 : 0;
+}
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Deterministic across compilers and platforms, unlike <random> distributions.
+struct TestRng {
+    uint32_t seed;
+    explicit TestRng(uint32_t s) : seed(s) {}
+    uint32_t next() { seed = seed * 1103515245u + 12345u; return seed >> 8; }
+    // Uniform in [-1, 1].
+    float unit() { return static_cast<float>(next() % 20001) / 10000.0f - 1.0f; }
+};